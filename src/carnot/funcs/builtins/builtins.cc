@@ -24,9 +24,11 @@
 #include "src/carnot/funcs/builtins/math_sketches.h"
 #include "src/carnot/funcs/builtins/ml_ops.h"
 #include "src/carnot/funcs/builtins/pii_ops.h"
+#include "src/carnot/funcs/builtins/pprof_ops.h"
 #include "src/carnot/funcs/builtins/regex_ops.h"
 #include "src/carnot/funcs/builtins/request_path_ops.h"
 #include "src/carnot/funcs/builtins/sql_ops.h"
+#include "src/carnot/funcs/builtins/stack_trace_ops.h"
 #include "src/carnot/funcs/builtins/string_ops.h"
 #include "src/carnot/funcs/builtins/uri_ops.h"
 
@@ -49,6 +51,8 @@ void RegisterBuiltinsOrDie(udf::Registry* registry) {
   RegisterRegexOpsOrDie(registry);
   RegisterPIIOpsOrDie(registry);
   RegisterURIOpsOrDie(registry);
+  RegisterStackTraceOpsOrDie(registry);
+  RegisterPProfOpsOrDie(registry);
 }
 
 }  // namespace builtins
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <string>
+
+#include <absl/strings/escaping.h>
+
+#include "src/carnot/udf/registry.h"
+#include "src/shared/pprof/pprof.h"
+#include "src/shared/types/types.h"
+
+namespace px {
+namespace carnot {
+namespace builtins {
+
+void RegisterPProfOpsOrDie(udf::Registry* registry);
+
+/**
+ * Aggregates sampled stack traces into a gzip-compressed pprof profile.
+ *
+ * The profile is base64 encoded, since string columns must hold valid UTF-8 to be sent to
+ * clients.
+ *
+ * Partial aggregates are serialized as (uncompressed) pprof profiles, in which each distinct
+ * frame is stored only once, so aggregating on the PEMs also reduces the data sent to Kelvin.
+ */
+class PProfUDA : public udf::UDA {
+ public:
+  void Update(FunctionContext*, Time64NSValue time, StringValue stack_trace, Int64Value count) {
+    builder_.AddFoldedStackTrace(stack_trace, count.val);
+    builder_.AddTime(time.val);
+  }
+
+  void Merge(FunctionContext*, const PProfUDA& other) { builder_.Merge(other.builder_); }
+
+  StringValue Finalize(FunctionContext*) {
+    StatusOr<std::string> profile = pprof::SerializeGzipped(builder_.Build());
+    if (!profile.ok()) {
+      LOG(ERROR) << "Failed to compress pprof profile: " << profile.status().msg();
+      return "";
+    }
+    return absl::Base64Escape(profile.ConsumeValueOrDie());
+  }
+
+  StringValue Serialize(FunctionContext*) { return builder_.Build().SerializeAsString(); }
+
+  Status Deserialize(FunctionContext*, const StringValue& data) {
+    pprof::ProfilePB profile;
+    if (!profile.ParseFromString(data)) {
+      return error::InvalidArgument("Failed to parse partial pprof profile.");
+    }
+    return builder_.AddProfile(profile);
+  }
+
+  static udf::UDADocBuilder Doc() {
+    return udf::UDADocBuilder("Aggregates stack traces into a pprof profile.")
+        .Details(
+            "Builds a profile in the gzip-compressed protobuf format used by pprof and other "
+            "standard profiling tools, from folded stack traces (frames separated by semicolons, "
+            "from the root of the stack) and their sample counts. The profile covers the time "
+            "range of the aggregated rows. The profile is base64 encoded; decode it and write it "
+            "to a file to open it with pprof.")
+        .Example(R"doc(
+        | df = px.DataFrame('stack_traces.beta', start_time='-5m')
+        | df.pod = df.ctx['pod']
+        | df = df.groupby('pod').agg(profile=('time_', 'stack_trace', 'count', px.pprof))
+        )doc")
+        .Arg("time", "The time of the sample.")
+        .Arg("stack_trace", "The folded stack trace.")
+        .Arg("count", "The number of times the stack trace was sampled.")
+        .Returns("The base64 encoded, gzip-compressed, serialized pprof profile.");
+  }
+
+ private:
+  pprof::ProfileBuilder builder_;
+};
+
+}  // namespace builtins
+}  // namespace carnot
+}  // namespace px
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <absl/strings/escaping.h>
+
+#include "src/carnot/funcs/builtins/pprof_ops.h"
+#include "src/carnot/udf/test_utils.h"
+#include "src/common/base/base.h"
+#include "src/common/zlib/zlib_wrapper.h"
+
+namespace px {
+namespace carnot {
+namespace builtins {
+
+TEST(PProfOps, pprof_uda) {
+  pprof::ProfileBuilder builder;
+  builder.AddFoldedStackTrace("main;foo;bar", 5);
+  builder.AddFoldedStackTrace("main;baz", 2);
+  builder.AddTime(100);
+  builder.AddTime(300);
+  ASSERT_OK_AND_ASSIGN(std::string gzipped, pprof::SerializeGzipped(builder.Build()));
+  std::string expected = absl::Base64Escape(gzipped);
+
+  auto uda_tester = udf::UDATester<PProfUDA>();
+  uda_tester.ForInput(types::Time64NSValue(100), "main;foo;bar", 2)
+      .ForInput(types::Time64NSValue(200), "main;baz", 2)
+      .ForInput(types::Time64NSValue(300), "main;foo;bar", 3)
+      .Expect(expected);
+}
+
+TEST(PProfOps, pprof_uda_output_is_parseable) {
+  auto uda_tester = udf::UDATester<PProfUDA>();
+  uda_tester.ForInput(types::Time64NSValue(100), "main;foo", 1);
+
+  std::string gzipped;
+  ASSERT_TRUE(absl::Base64Unescape(std::string(uda_tester.Result()), &gzipped));
+  ASSERT_OK_AND_ASSIGN(std::string serialized, zlib::Inflate(gzipped));
+  pprof::ProfilePB profile;
+  ASSERT_TRUE(profile.ParseFromString(serialized));
+  EXPECT_EQ(profile.sample_size(), 1);
+  EXPECT_EQ(profile.function_size(), 2);
+  EXPECT_EQ(profile.time_nanos(), 100);
+}
+
+TEST(PProfOps, pprof_uda_rejects_bad_partial) {
+  auto uda_tester = udf::UDATester<PProfUDA>();
+  EXPECT_NOT_OK(uda_tester.Deserialize("not a profile"));
+}
+
+}  // namespace builtins
+}  // namespace carnot
+}  // namespace px
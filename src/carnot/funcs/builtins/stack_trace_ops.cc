@@ -0,0 +1,36 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/carnot/funcs/builtins/stack_trace_ops.h"
+#include "src/carnot/udf/registry.h"
+#include "src/common/base/base.h"
+
+namespace px {
+namespace carnot {
+namespace builtins {
+
+void RegisterStackTraceOpsOrDie(udf::Registry* registry) {
+  CHECK(registry != nullptr);
+  registry->RegisterOrDie<StackTraceDepthUDF>("stack_trace_depth");
+  registry->RegisterOrDie<StackTraceFrameIDUDF>("stack_trace_frame_id");
+  registry->RegisterOrDie<StackTracePrefixUDF>("stack_trace_prefix");
+}
+
+}  // namespace builtins
+}  // namespace carnot
+}  // namespace px
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <absl/strings/numbers.h>
+#include <absl/strings/str_join.h>
+#include <absl/strings/str_split.h>
+
+#include "src/carnot/udf/registry.h"
+#include "src/shared/types/types.h"
+
+namespace px {
+namespace carnot {
+namespace builtins {
+
+void RegisterStackTraceOpsOrDie(udf::Registry* registry);
+
+// Stack traces are lists of frames separated by semicolons, ordered from the root of the stack.
+// The frames are either symbols (folded stack traces), or frame IDs (normalized stack traces).
+constexpr char kStackTraceSeparator = ';';
+
+inline std::vector<std::string_view> SplitStackTrace(std::string_view stack_trace) {
+  if (stack_trace.empty()) {
+    return {};
+  }
+  return absl::StrSplit(stack_trace, kStackTraceSeparator);
+}
+
+class StackTraceDepthUDF : public udf::ScalarUDF {
+ public:
+  Int64Value Exec(FunctionContext*, StringValue stack_trace) {
+    if (stack_trace.empty()) {
+      return 0;
+    }
+    return std::count(stack_trace.begin(), stack_trace.end(), kStackTraceSeparator) + 1;
+  }
+
+  static udf::ScalarUDFDocBuilder Doc() {
+    return udf::ScalarUDFDocBuilder("Returns the number of frames in a stack trace.")
+        .Details(
+            "Works on both folded stack traces (symbols separated by semicolons) and normalized "
+            "stack traces (frame IDs separated by semicolons).")
+        .Example(R"doc(
+        | df = px.DataFrame('normalized_stack_traces.beta')
+        | df.depth = px.stack_trace_depth(df.frame_ids)
+        )doc")
+        .Arg("stack_trace", "The stack trace.")
+        .Returns("The number of frames.");
+  }
+};
+
+class StackTraceFrameIDUDF : public udf::ScalarUDF {
+ public:
+  Int64Value Exec(FunctionContext*, StringValue frame_ids, Int64Value level) {
+    const std::vector<std::string_view> frames = SplitStackTrace(frame_ids);
+    const int64_t num_frames = frames.size();
+    int64_t idx = level.val < 0 ? num_frames + level.val : level.val;
+    if (idx < 0 || idx >= num_frames) {
+      return -1;
+    }
+    int64_t frame_id;
+    if (!absl::SimpleAtoi(frames[idx], &frame_id)) {
+      return -1;
+    }
+    return frame_id;
+  }
+
+  static udf::ScalarUDFDocBuilder Doc() {
+    return udf::ScalarUDFDocBuilder("Returns the ID of the frame at a level of a stack trace.")
+        .Details(
+            "Level 0 is the root of the stack; negative levels count from the leaf, so -1 is the "
+            "leaf frame. The ID can be joined with `stack_frames.beta` to get the frame's symbol. "
+            "Frame IDs are assigned by each agent, so the join must also match the agent (asid).")
+        .Example(R"doc(
+        | df = px.DataFrame('normalized_stack_traces.beta')
+        | df.asid = px.upid_to_asid(df.upid)
+        | df.leaf_frame_id = px.stack_trace_frame_id(df.frame_ids, -1)
+        | frames = px.DataFrame('stack_frames.beta')
+        | frames = frames.groupby(['asid', 'frame_id', 'frame']).agg()
+        | df = df.merge(frames, how='left', left_on=['asid', 'leaf_frame_id'],
+        |               right_on=['asid', 'frame_id'])
+        )doc")
+        .Arg("frame_ids", "A normalized stack trace.")
+        .Arg("level", "The level of the frame in the stack.")
+        .Returns("The frame ID, or -1 if the stack has no such level.");
+  }
+};
+
+class StackTracePrefixUDF : public udf::ScalarUDF {
+ public:
+  StringValue Exec(FunctionContext*, StringValue stack_trace, Int64Value depth) {
+    if (depth.val <= 0) {
+      return "";
+    }
+    std::vector<std::string_view> frames = SplitStackTrace(stack_trace);
+    if (static_cast<size_t>(depth.val) >= frames.size()) {
+      return stack_trace;
+    }
+    frames.resize(depth.val);
+    return absl::StrJoin(frames, std::string_view(&kStackTraceSeparator, 1));
+  }
+
+  static udf::ScalarUDFDocBuilder Doc() {
+    return udf::ScalarUDFDocBuilder("Truncates a stack trace to its frames closest to the root.")
+        .Details(
+            "Useful to aggregate samples by the top levels of a flamegraph. Works on both folded "
+            "and normalized stack traces.")
+        .Example(R"doc(
+        | df = px.DataFrame('normalized_stack_traces.beta')
+        | df.prefix = px.stack_trace_prefix(df.frame_ids, 3)
+        | df = df.groupby('prefix').agg(count=('count', px.sum))
+        )doc")
+        .Arg("stack_trace", "The stack trace.")
+        .Arg("depth", "The number of frames to keep.")
+        .Returns("The first `depth` frames of the stack trace.");
+  }
+};
+
+}  // namespace builtins
+}  // namespace carnot
+}  // namespace px
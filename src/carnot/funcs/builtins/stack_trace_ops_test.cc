@@ -0,0 +1,60 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include "src/carnot/funcs/builtins/stack_trace_ops.h"
+#include "src/carnot/udf/test_utils.h"
+#include "src/common/base/base.h"
+
+namespace px {
+namespace carnot {
+namespace builtins {
+
+TEST(StackTraceOps, stack_trace_depth) {
+  auto udf_tester = udf::UDFTester<StackTraceDepthUDF>();
+  udf_tester.ForInput("").Expect(0);
+  udf_tester.ForInput("7").Expect(1);
+  udf_tester.ForInput("3;17;5").Expect(3);
+  udf_tester.ForInput("main;foo;[k] do_syscall").Expect(3);
+}
+
+TEST(StackTraceOps, stack_trace_frame_id) {
+  auto udf_tester = udf::UDFTester<StackTraceFrameIDUDF>();
+  udf_tester.ForInput("3;17;5", 0).Expect(3);
+  udf_tester.ForInput("3;17;5", 2).Expect(5);
+  udf_tester.ForInput("3;17;5", -1).Expect(5);
+  udf_tester.ForInput("3;17;5", -3).Expect(3);
+  udf_tester.ForInput("3;17;5", 3).Expect(-1);
+  udf_tester.ForInput("3;17;5", -4).Expect(-1);
+  udf_tester.ForInput("", 0).Expect(-1);
+  udf_tester.ForInput("main;foo", 0).Expect(-1);
+}
+
+TEST(StackTraceOps, stack_trace_prefix) {
+  auto udf_tester = udf::UDFTester<StackTracePrefixUDF>();
+  udf_tester.ForInput("3;17;5", 2).Expect("3;17");
+  udf_tester.ForInput("3;17;5", 3).Expect("3;17;5");
+  udf_tester.ForInput("3;17;5", 10).Expect("3;17;5");
+  udf_tester.ForInput("3;17;5", 0).Expect("");
+  udf_tester.ForInput("main;foo;bar", 1).Expect("main");
+}
+
+}  // namespace builtins
+}  // namespace carnot
+}  // namespace px
@@ -110,6 +110,8 @@ class PodIDToPodNameUDF : public ScalarUDF {
 
     return "";
   }
+  static constexpr bool Memoize() { return true; }
+
   static udf::InfRuleVec SemanticInferenceRules() {
     return {udf::ExplicitRule::Create<PodIDToPodNameUDF>(types::ST_POD_NAME, {types::ST_NONE})};
   }
@@ -247,6 +249,8 @@ class UPIDToContainerIDUDF : public ScalarUDF {
     return pid->cid();
   }
 
+  static constexpr bool Memoize() { return true; }
+
   static udf::ScalarUDFDocBuilder Doc() {
     return udf::ScalarUDFDocBuilder("Get the Kubernetes container ID from a UPID.")
         .Details(
@@ -285,6 +289,8 @@ class UPIDToContainerNameUDF : public ScalarUDF {
     return std::string(container_info->name());
   }
 
+  static constexpr bool Memoize() { return true; }
+
   static udf::InfRuleVec SemanticInferenceRules() {
     return {udf::ExplicitRule::Create<UPIDToContainerNameUDF>(types::ST_CONTAINER_NAME,
                                                               {types::ST_NONE})};
@@ -350,6 +356,8 @@ class UPIDToNamespaceUDF : public ScalarUDF {
     return pod_info->ns();
   }
 
+  static constexpr bool Memoize() { return true; }
+
   static udf::InfRuleVec SemanticInferenceRules() {
     return {
         udf::ExplicitRule::Create<UPIDToNamespaceUDF>(types::ST_NAMESPACE_NAME, {types::ST_NONE})};
@@ -382,6 +390,8 @@ class UPIDToPodIDUDF : public ScalarUDF {
     return std::string(container_info->pod_id());
   }
 
+  static constexpr bool Memoize() { return true; }
+
   static udf::ScalarUDFDocBuilder Doc() {
     return udf::ScalarUDFDocBuilder("Get the Kubernetes Pod ID from a UPID.")
         .Details(
@@ -409,6 +419,8 @@ class UPIDToPodNameUDF : public ScalarUDF {
     return absl::Substitute("$0/$1", pod_info->ns(), pod_info->name());
   }
 
+  static constexpr bool Memoize() { return true; }
+
   static udf::InfRuleVec SemanticInferenceRules() {
     return {udf::ExplicitRule::Create<UPIDToPodNameUDF>(types::ST_POD_NAME, {types::ST_NONE})};
   }
@@ -441,6 +453,8 @@ class ServiceIDToServiceNameUDF : public ScalarUDF {
 
     return "";
   }
+  static constexpr bool Memoize() { return true; }
+
   static udf::InfRuleVec SemanticInferenceRules() {
     return {udf::ExplicitRule::Create<ServiceIDToServiceNameUDF>(types::ST_SERVICE_NAME,
                                                                  {types::ST_NONE})};
@@ -579,6 +593,8 @@ class UPIDToServiceIDUDF : public ScalarUDF {
     return StringifyVector(running_service_ids);
   }
 
+  static constexpr bool Memoize() { return true; }
+
   static udf::ScalarUDFDocBuilder Doc() {
     return udf::ScalarUDFDocBuilder("Get the Service ID from a UPID.")
         .Details(
@@ -620,6 +636,8 @@ class UPIDToServiceNameUDF : public ScalarUDF {
     }
     return StringifyVector(running_service_names);
   }
+  static constexpr bool Memoize() { return true; }
+
   static udf::InfRuleVec SemanticInferenceRules() {
     return {
         udf::ExplicitRule::Create<UPIDToServiceNameUDF>(types::ST_SERVICE_NAME, {types::ST_NONE})};
@@ -656,6 +674,8 @@ class UPIDToNodeNameUDF : public ScalarUDF {
     std::string foo = std::string(pod_info->node_name());
     return foo;
   }
+  static constexpr bool Memoize() { return true; }
+
   static udf::InfRuleVec SemanticInferenceRules() {
     return {udf::ExplicitRule::Create<UPIDToNodeNameUDF>(types::ST_NODE_NAME, {types::ST_NONE})};
   }
@@ -687,6 +707,8 @@ class UPIDToHostnameUDF : public ScalarUDF {
     }
     return pod_info->hostname();
   }
+  static constexpr bool Memoize() { return true; }
+
   static udf::ScalarUDFDocBuilder Doc() {
     return udf::ScalarUDFDocBuilder("Get the Hostname from a UPID.")
         .Details(
@@ -728,6 +750,8 @@ class PodIDToServiceNameUDF : public ScalarUDF {
     }
     return StringifyVector(running_service_names);
   }
+  static constexpr bool Memoize() { return true; }
+
   static udf::InfRuleVec SemanticInferenceRules() {
     return {
         udf::ExplicitRule::Create<PodIDToServiceNameUDF>(types::ST_SERVICE_NAME, {types::ST_NONE})};
@@ -769,6 +793,8 @@ class PodIDToServiceIDUDF : public ScalarUDF {
     }
     return StringifyVector(running_service_ids);
   }
+  static constexpr bool Memoize() { return true; }
+
   static udf::ScalarUDFDocBuilder Doc() {
     return udf::ScalarUDFDocBuilder("Get the service ID for a given pod ID.")
         .Details(
@@ -839,6 +865,8 @@ class PodNameToServiceNameUDF : public ScalarUDF {
     }
     return StringifyVector(running_service_names);
   }
+  static constexpr bool Memoize() { return true; }
+
   static udf::InfRuleVec SemanticInferenceRules() {
     return {udf::ExplicitRule::Create<PodNameToServiceNameUDF>(types::ST_SERVICE_NAME,
                                                                {types::ST_POD_NAME})};
@@ -884,6 +912,8 @@ class PodNameToServiceIDUDF : public ScalarUDF {
     }
     return StringifyVector(running_service_ids);
   }
+  static constexpr bool Memoize() { return true; }
+
   static udf::ScalarUDFDocBuilder Doc() {
     return udf::ScalarUDFDocBuilder("Get the service ID for a given pod name.")
         .Details(
@@ -1353,6 +1383,8 @@ class UPIDToPodStatusUDF : public ScalarUDF {
     return PodInfoToPodStatus(UPIDtoPod(md, upid_value));
   }
 
+  static constexpr bool Memoize() { return true; }
+
   static udf::InfRuleVec SemanticInferenceRules() {
     return {udf::ExplicitRule::Create<UPIDToPodStatusUDF>(types::ST_POD_STATUS, {types::ST_NONE})};
   }
@@ -1398,6 +1430,8 @@ class UPIDToCmdLineUDF : public ScalarUDF {
     return pid_info->cmdline();
   }
 
+  static constexpr bool Memoize() { return true; }
+
   static udf::ScalarUDFDocBuilder Doc() {
     return udf::ScalarUDFDocBuilder("Get the command line arguments used to start a UPID.")
         .Details(
@@ -1432,6 +1466,8 @@ class UPIDToPodQoSUDF : public ScalarUDF {
     auto md = GetMetadataState(ctx);
     return PodInfoToPodQoS(UPIDtoPod(md, upid_value));
   }
+  static constexpr bool Memoize() { return true; }
+
   static udf::ScalarUDFDocBuilder Doc() {
     return udf::ScalarUDFDocBuilder("Get the Kubernetes QOS class for the UPID.")
         .Details(
@@ -1495,6 +1531,8 @@ class IPToPodIDUDF : public ScalarUDF {
     auto md = GetMetadataState(ctx);
     return md->k8s_metadata_state().PodIDByIP(pod_ip);
   }
+  static constexpr bool Memoize() { return true; }
+
   static udf::ScalarUDFDocBuilder Doc() {
     return udf::ScalarUDFDocBuilder(
                "Convert IP address to the kubernetes pod ID that runs the backing service.")
@@ -1537,6 +1575,8 @@ class IPToServiceIDUDF : public ScalarUDF {
     return udf.Exec(ctx, pod_id);
   }
 
+  static constexpr bool Memoize() { return true; }
+
   static udf::ScalarUDFDocBuilder Doc() {
     return udf::ScalarUDFDocBuilder("Get the service ID for a given IP.")
         .Details(
@@ -70,44 +70,83 @@ StatusOr<std::string> ConvertMetadataRule::FindKeyColumn(std::shared_ptr<TableTy
       absl::StrJoin(parent_type->ColumnNames(), ","));
 }
 
-StatusOr<bool> ConvertMetadataRule::Apply(IRNode* ir_node) {
-  if (!Match(ir_node, Metadata())) {
+bool ConvertMetadataRule::HasPrecomputedColumn(std::shared_ptr<TableType> parent_type,
+                                               MetadataProperty* property) const {
+  DCHECK_NE(property, nullptr);
+  // Only columns added by ingest-time enrichment qualify; a column that merely has the same name
+  // (e.g. a user-defined "namespace") may hold something else entirely.
+  if (!parent_type->IsIngestTimeMetadataColumn(property->name())) {
+    return false;
+  }
+  auto col_type_or_s = parent_type->GetColumnType(property->name());
+  if (!col_type_or_s.ok()) {
+    return false;
+  }
+  TypePtr col_type = col_type_or_s.ConsumeValueOrDie();
+  if (!col_type->IsValueType()) {
     return false;
   }
+  return std::static_pointer_cast<ValueType>(col_type)->data_type() == property->column_type();
+}
 
-  auto graph = ir_node->graph();
-  auto metadata = static_cast<MetadataIR*>(ir_node);
+StatusOr<ExpressionIR*> ConvertMetadataRule::CreateMetadataExpr(
+    MetadataIR* metadata, std::shared_ptr<TableType> parent_type) const {
+  auto graph = metadata->graph();
   auto md_property = metadata->property();
   auto parent_op_idx = metadata->container_op_parent_idx();
-  auto column_type = md_property->column_type();
-  auto md_type = md_property->metadata_type();
 
-  PL_ASSIGN_OR_RETURN(auto parent, metadata->ReferencedOperator());
-  PL_ASSIGN_OR_RETURN(auto containing_ops, metadata->ContainingOperators());
+  // Tables that were enriched at ingest time already carry the metadata value, resolved when the
+  // row was written. Reading it is cheaper than the lookup, and stays correct after the metadata
+  // itself has expired.
+  if (HasPrecomputedColumn(parent_type, md_property)) {
+    PL_ASSIGN_OR_RETURN(ColumnIR * precomputed_column,
+                        graph->CreateNode<ColumnIR>(metadata->ast(), md_property->name(),
+                                                    parent_op_idx));
+    return precomputed_column;
+  }
 
   PL_ASSIGN_OR_RETURN(std::string key_column_name,
-                      FindKeyColumn(parent->resolved_table_type(), md_property, ir_node));
+                      FindKeyColumn(parent_type, md_property, metadata));
 
   PL_ASSIGN_OR_RETURN(ColumnIR * key_column,
-                      graph->CreateNode<ColumnIR>(ir_node->ast(), key_column_name, parent_op_idx));
+                      graph->CreateNode<ColumnIR>(metadata->ast(), key_column_name, parent_op_idx));
 
   PL_ASSIGN_OR_RETURN(std::string func_name, md_property->UDFName(key_column_name));
   PL_ASSIGN_OR_RETURN(
       FuncIR * conversion_func,
-      graph->CreateNode<FuncIR>(ir_node->ast(), FuncIR::Op{FuncIR::Opcode::non_op, "", func_name},
+      graph->CreateNode<FuncIR>(metadata->ast(), FuncIR::Op{FuncIR::Opcode::non_op, "", func_name},
                                 std::vector<ExpressionIR*>{key_column}));
+  return conversion_func;
+}
+
+StatusOr<bool> ConvertMetadataRule::Apply(IRNode* ir_node) {
+  if (!Match(ir_node, Metadata())) {
+    return false;
+  }
+
+  auto graph = ir_node->graph();
+  auto metadata = static_cast<MetadataIR*>(ir_node);
+  auto md_property = metadata->property();
+  auto column_type = md_property->column_type();
+  auto md_type = md_property->metadata_type();
+
+  PL_ASSIGN_OR_RETURN(auto parent, metadata->ReferencedOperator());
+  PL_ASSIGN_OR_RETURN(auto containing_ops, metadata->ContainingOperators());
+
+  PL_ASSIGN_OR_RETURN(ExpressionIR * metadata_expr,
+                      CreateMetadataExpr(metadata, parent->resolved_table_type()));
   for (int64_t parent_id : graph->dag().ParentsOf(metadata->id())) {
     // For each container node of the metadata expression, update it to point to the
-    // new conversion func instead.
-    PL_RETURN_IF_ERROR(UpdateMetadataContainer(graph->Get(parent_id), metadata, conversion_func));
+    // new metadata expression instead.
+    PL_RETURN_IF_ERROR(UpdateMetadataContainer(graph->Get(parent_id), metadata, metadata_expr));
   }
 
-  // Propagate type changes from the new conversion_func.
-  PL_RETURN_IF_ERROR(PropagateTypeChangesFromNode(graph, conversion_func, compiler_state_));
+  // Propagate type changes from the new metadata expression.
+  PL_RETURN_IF_ERROR(PropagateTypeChangesFromNode(graph, metadata_expr, compiler_state_));
 
-  DCHECK_EQ(conversion_func->EvaluatedDataType(), column_type)
+  DCHECK_EQ(metadata_expr->EvaluatedDataType(), column_type)
       << "Expected the parent key column type and metadata property type to match.";
-  conversion_func->set_annotations(ExpressionIR::Annotations(md_type));
+  metadata_expr->set_annotations(ExpressionIR::Annotations(md_type));
 
   return true;
 }
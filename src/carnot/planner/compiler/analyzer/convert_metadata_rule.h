@@ -46,6 +46,18 @@ class ConvertMetadataRule : public Rule {
                                  ExpressionIR* metadata_expr) const;
   StatusOr<std::string> FindKeyColumn(std::shared_ptr<TableType> parent_type,
                                       MetadataProperty* property, IRNode* node_for_error) const;
+  /**
+   * @brief Returns whether the parent already has a column holding the metadata property, i.e. one
+   * added by ingest-time enrichment on the PEM (see TableType::IsIngestTimeMetadataColumn).
+   */
+  bool HasPrecomputedColumn(std::shared_ptr<TableType> parent_type,
+                            MetadataProperty* property) const;
+  /**
+   * @brief Creates the expression that evaluates the metadata: a reference to the precomputed
+   * column when the parent has one, otherwise a conversion func applied to a key column.
+   */
+  StatusOr<ExpressionIR*> CreateMetadataExpr(MetadataIR* metadata,
+                                             std::shared_ptr<TableType> parent_type) const;
 };
 
 }  // namespace compiler
@@ -88,6 +88,67 @@ TEST_F(ConvertMetadataRuleTest, multichild) {
   EXPECT_EQ(types::ST_POD_NAME, type->semantic_type());
 }
 
+TEST_F(ConvertMetadataRuleTest, precomputed_column) {
+  auto relation = Relation(cpu_relation);
+  relation.AddColumn(types::DataType::UINT128, "upid");
+  relation.AddColumn(
+      types::DataType::STRING, "pod_id", types::ST_NONE,
+      absl::StrCat("The pod ID", table_store::schema::kIngestTimeMetadataDescSuffix));
+  compiler_state_->relation_map()->emplace("table", relation);
+
+  auto metadata_name = "pod_id";
+  MetadataProperty* property = md_handler->GetProperty(metadata_name).ValueOrDie();
+  MetadataIR* metadata_ir = MakeMetadataIR(metadata_name, /* parent_op_idx */ 0);
+  metadata_ir->set_property(property);
+
+  auto map = MakeMap(MakeMemSource(relation), {{"md", metadata_ir}});
+
+  ResolveTypesRule type_rule(compiler_state_.get());
+  ASSERT_OK(type_rule.Execute(graph.get()));
+
+  ConvertMetadataRule rule(compiler_state_.get());
+  auto result = rule.Execute(graph.get());
+  ASSERT_OK(result);
+  EXPECT_TRUE(result.ValueOrDie());
+
+  EXPECT_EQ(0, graph->FindNodesThatMatch(Metadata()).size());
+
+  // The precomputed column is read directly, instead of converting the upid.
+  auto converted_md = map->col_exprs()[0].node;
+  EXPECT_MATCH(converted_md, ColumnNode("pod_id"));
+  EXPECT_MATCH(converted_md, ResolvedExpression());
+  EXPECT_EQ(types::DataType::STRING, converted_md->EvaluatedDataType());
+  EXPECT_EQ(ExpressionIR::Annotations(MetadataType::POD_ID), converted_md->annotations());
+}
+
+TEST_F(ConvertMetadataRuleTest, same_name_column_is_not_precomputed) {
+  // A column that has the name of the metadata property, but was not added by ingest-time
+  // enrichment, is not read as the metadata.
+  auto relation = Relation(cpu_relation);
+  relation.AddColumn(types::DataType::UINT128, "upid");
+  relation.AddColumn(types::DataType::STRING, "pod_id");
+  compiler_state_->relation_map()->emplace("table", relation);
+
+  auto metadata_name = "pod_id";
+  MetadataProperty* property = md_handler->GetProperty(metadata_name).ValueOrDie();
+  MetadataIR* metadata_ir = MakeMetadataIR(metadata_name, /* parent_op_idx */ 0);
+  metadata_ir->set_property(property);
+
+  auto map = MakeMap(MakeMemSource(relation), {{"md", metadata_ir}});
+
+  ResolveTypesRule type_rule(compiler_state_.get());
+  ASSERT_OK(type_rule.Execute(graph.get()));
+
+  ConvertMetadataRule rule(compiler_state_.get());
+  auto result = rule.Execute(graph.get());
+  ASSERT_OK(result);
+  EXPECT_TRUE(result.ValueOrDie());
+
+  auto converted_md = map->col_exprs()[0].node;
+  EXPECT_MATCH(converted_md, Func());
+  EXPECT_EQ("upid_to_pod_id", static_cast<FuncIR*>(converted_md)->func_name());
+}
+
 TEST_F(ConvertMetadataRuleTest, missing_conversion_column) {
   auto relation = table_store::schema::Relation(cpu_relation);
   compiler_state_->relation_map()->emplace("table", relation);
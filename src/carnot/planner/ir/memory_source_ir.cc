@@ -167,6 +167,9 @@ Status MemorySourceIR::ResolveType(CompilerState* compiler_state) {
   for (const auto& col_name : column_names_) {
     PL_ASSIGN_OR_RETURN(auto col_type, full_table_type->GetColumnType(col_name));
     new_table->AddColumn(col_name, col_type);
+    if (full_table_type->IsIngestTimeMetadataColumn(col_name)) {
+      new_table->MarkIngestTimeMetadataColumn(col_name);
+    }
     column_indices.push_back(table_relation.GetColumnIndex(col_name));
   }
 
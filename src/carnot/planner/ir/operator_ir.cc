@@ -96,10 +96,14 @@ Status OperatorIR::PruneOutputColumnsTo(const absl::flat_hash_set<std::string>&
   }
   PL_ASSIGN_OR_RETURN(auto required_columns, PruneOutputColumnsToImpl(output_cols));
 
+  auto old_table = std::static_pointer_cast<TableType>(resolved_type());
   auto new_table = TableType::Create();
-  for (const auto& [col_name, col_type] : *std::static_pointer_cast<TableType>(resolved_type())) {
+  for (const auto& [col_name, col_type] : *old_table) {
     if (required_columns.contains(col_name)) {
       new_table->AddColumn(col_name, col_type->Copy());
+      if (old_table->IsIngestTimeMetadataColumn(col_name)) {
+        new_table->MarkIngestTimeMetadataColumn(col_name);
+      }
     }
   }
   return SetResolvedType(new_table);
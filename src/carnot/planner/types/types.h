@@ -26,6 +26,7 @@
 #include <vector>
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 #include <absl/strings/substitute.h>
 
 #include "src/common/base/statusor.h"
@@ -127,12 +128,27 @@ class TableType : public BaseType {
     ordered_col_names_.push_back(col_name);
   }
   bool HasColumn(std::string col_name) const { return map_.find(col_name) != map_.end(); }
+
+  /**
+   * @brief Ingest-time metadata columns hold metadata that was resolved when the row was written
+   * (see table_store::schema::IsIngestTimeMetadataDesc). The mark is only carried over by
+   * operators that pass the column through unchanged.
+   */
+  void MarkIngestTimeMetadataColumn(std::string col_name) {
+    DCHECK(HasColumn(col_name));
+    ingest_time_metadata_cols_.insert(std::move(col_name));
+  }
+  bool IsIngestTimeMetadataColumn(const std::string& col_name) const {
+    return ingest_time_metadata_cols_.contains(col_name);
+  }
+
   bool RemoveColumn(std::string col_name) {
     auto col_to_remove = map_.find(col_name);
     if (col_to_remove == map_.end()) {
       return false;
     }
     map_.erase(col_to_remove);
+    ingest_time_metadata_cols_.erase(col_name);
     auto it = std::find(ordered_col_names_.begin(), ordered_col_names_.end(), col_name);
     ordered_col_names_.erase(it);
     return true;
@@ -146,6 +162,7 @@ class TableType : public BaseType {
     }
     map_.insert({new_col_name, it->second});
     map_.erase(old_col_name);
+    ingest_time_metadata_cols_.erase(old_col_name);
     auto col_name_it =
         std::find(ordered_col_names_.begin(), ordered_col_names_.end(), old_col_name);
     *col_name_it = new_col_name;
@@ -166,6 +183,7 @@ class TableType : public BaseType {
     for (const auto& [name, type] : *this) {
       copy->AddColumn(name, type);
     }
+    copy->ingest_time_metadata_cols_ = ingest_time_metadata_cols_;
     return copy;
   }
 
@@ -266,12 +284,16 @@ class TableType : public BaseType {
     for (size_t i = 0; i < rel.NumColumns(); i++) {
       AddColumn(rel.col_names()[i],
                 ValueType::Create(rel.col_types()[i], rel.col_semantic_types()[i]));
+      if (table_store::schema::IsIngestTimeMetadataDesc(rel.GetColumnDesc(i))) {
+        MarkIngestTimeMetadataColumn(rel.col_names()[i]);
+      }
     }
   }
 
  private:
   std::map<std::string, std::shared_ptr<BaseType>> map_;
   std::vector<std::string> ordered_col_names_;
+  absl::flat_hash_set<std::string> ingest_time_metadata_cols_;
 };
 
 }  // namespace planner
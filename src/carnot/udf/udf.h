@@ -74,6 +74,12 @@ class AnyUDA : public BaseFunc {
  *      Status Init(FunctionContext *ctx, UDFValue... init_args) {}
  *  This function is called once during initialization of each instance (many instances
  *  may exists in a given query). The arguments are as provided by the query.
+ *
+ * A ScalarUDF with a single Exec argument can also _optionally_ implement:
+ *      static constexpr bool Memoize() { return true; }
+ *  This declares that within a query, the result of Exec only depends on its argument. Each
+ *  batch then calls Exec once per distinct argument value, and reuses the result for the
+ *  other rows. This pays off for lookups such as the metadata UDFs, whose inputs repeat a lot.
  */
 class ScalarUDF : public AnyUDF {
  public:
@@ -167,6 +173,13 @@ struct has_udf_executor_fn<T, std::void_t<decltype(&T::Executor)>> : std::true_t
       "If an executor function exists, it must have the form: UDFSourceExecutor Executor()");
 };
 
+// SFINAE test for Memoize fn.
+template <typename T, typename = void>
+struct has_udf_memoize_fn : std::false_type {};
+
+template <typename T>
+struct has_udf_memoize_fn<T, std::void_t<decltype(&T::Memoize)>> : std::true_type {};
+
 template <typename T, typename = void>
 struct check_executor_fn {};
 
@@ -228,6 +241,22 @@ class ScalarUDFTraits {
    */
   static constexpr bool HasExecutor() { return has_udf_executor_fn<T>::value; }
 
+  /**
+   * Checks if the results of the UDF can be reused for repeated arguments.
+   * @return true if the UDF has a Memoize function that returns true.
+   */
+  template <typename Q = T, std::enable_if_t<has_udf_memoize_fn<Q>::value, void>* = nullptr>
+  static constexpr bool Memoize() {
+    static_assert(GetArgumentTypesHelper(&Q::Exec).size() == 1,
+                  "Only UDFs with a single Exec argument can be memoized");
+    return Q::Memoize();
+  }
+
+  template <typename Q = T, std::enable_if_t<!has_udf_memoize_fn<Q>::value, void>* = nullptr>
+  static constexpr bool Memoize() {
+    return false;
+  }
+
   template <typename Q = T, std::enable_if_t<ScalarUDFTraits<Q>::HasInit(), void>* = nullptr>
   static constexpr auto InitArguments() {
     return GetArgumentTypesHelper(&Q::Init);
@@ -51,6 +51,17 @@ class AddUDF : public ScalarUDF {
   }
 };
 
+class MemoizedSubStrUDF : public ScalarUDF {
+ public:
+  types::StringValue Exec(FunctionContext*, types::StringValue str) {
+    ++exec_count;
+    return str.substr(1, 2);
+  }
+  static constexpr bool Memoize() { return true; }
+
+  int exec_count = 0;
+};
+
 class InitArgUDF : public ScalarUDF {
  public:
   Status Init(FunctionContext*, types::StringValue str, types::Int64Value i) {
@@ -136,6 +147,47 @@ TEST(UDFDefinition, arrow_write) {
   EXPECT_EQ(6, resArr->Value(1));
 }
 
+TEST(UDFDefinition, memoized_str_args) {
+  auto ctx = FunctionContext(nullptr, nullptr);
+  ScalarUDFDefinition def("memoized_substr");
+  EXPECT_OK(def.Init<MemoizedSubStrUDF>());
+
+  types::StringValueColumnWrapper v1({"abcd", "abcd", "hello", "abcd", "hello"});
+
+  types::StringValueColumnWrapper out(v1.Size());
+  auto u = def.Make();
+  EXPECT_OK(def.ExecBatch(u.get(), &ctx, {&v1}, &out, v1.Size()));
+
+  EXPECT_EQ("bc", out[0]);
+  EXPECT_EQ("bc", out[1]);
+  EXPECT_EQ("el", out[2]);
+  EXPECT_EQ("bc", out[3]);
+  EXPECT_EQ("el", out[4]);
+  EXPECT_EQ(2, static_cast<MemoizedSubStrUDF*>(u.get())->exec_count);
+}
+
+TEST(UDFDefinition, memoized_arrow_write) {
+  auto ctx = FunctionContext(nullptr, nullptr);
+  std::vector<types::StringValue> v1 = {"abcd", "hello", "hello", "abcd", "world"};
+  auto v1a = ToArrow(v1, arrow::default_memory_pool());
+
+  auto output_builder = std::make_shared<arrow::StringBuilder>();
+  auto u = std::make_shared<MemoizedSubStrUDF>();
+  EXPECT_OK(ScalarUDFWrapper<MemoizedSubStrUDF>::ExecBatchArrow(u.get(), &ctx, {v1a.get()},
+                                                                output_builder.get(), v1.size()));
+
+  std::shared_ptr<arrow::Array> res;
+  EXPECT_OK(output_builder->Finish(&res));
+  auto* res_arr = static_cast<arrow::StringArray*>(res.get());
+  ASSERT_EQ(5, res_arr->length());
+  EXPECT_EQ("bc", res_arr->GetString(0));
+  EXPECT_EQ("el", res_arr->GetString(1));
+  EXPECT_EQ("el", res_arr->GetString(2));
+  EXPECT_EQ("bc", res_arr->GetString(3));
+  EXPECT_EQ("or", res_arr->GetString(4));
+  EXPECT_EQ(3, u->exec_count);
+}
+
 TEST(UDFDefinition, init_args) {
   auto ctx = FunctionContext(nullptr, nullptr);
   ScalarUDFDefinition def("initargudf");
@@ -22,8 +22,11 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <absl/container/flat_hash_map.h>
+
 #include "src/carnot/udf/udf.h"
 #include "src/carnot/udf/udtf.h"
 #include "src/common/base/base.h"
@@ -96,14 +99,10 @@ inline auto UnWrap<types::StringValue>(const types::StringValue& s) {
 }
 
 /**
- * This is the inner wrapper for the arrow type.
- * This performs type casting and storing the data in the output builder.
+ * Appends the results of row_fn(0) ... row_fn(count - 1) to the output builder.
  */
-template <typename TUDF, typename TOutput, std::size_t... I>
-Status ExecWrapperArrow(TUDF* udf, FunctionContext* ctx, size_t count, TOutput* out,
-                        const std::vector<arrow::Array*>& args, std::index_sequence<I...>) {
-  [[maybe_unused]] static constexpr auto exec_argument_types =
-      ScalarUDFTraits<TUDF>::ExecArguments();
+template <typename TOutput, typename TRowFn>
+Status AppendArrowResults(TOutput* out, size_t count, TRowFn row_fn) {
   CHECK(out->Reserve(count).ok());
   size_t reserved = count * kStringAssumedSizeHeuristic;
   size_t total_size = 0;
@@ -114,8 +113,7 @@ Status ExecWrapperArrow(TUDF* udf, FunctionContext* ctx, size_t count, TOutput*
     CHECK(out->ReserveData(reserved).ok());
   }
   for (size_t idx = 0; idx < count; ++idx) {
-    auto res = UnWrap(
-        udf->Exec(ctx, types::GetValueFromArrowArray<exec_argument_types[I]>(args[I], idx)...));
+    decltype(auto) res = row_fn(idx);
 
     // We use doubling to make sure we minimize the number of allocations.
     // PL_CARNOT_UPDATE_FOR_NEW_TYPES.
@@ -132,6 +130,107 @@ Status ExecWrapperArrow(TUDF* udf, FunctionContext* ctx, size_t count, TOutput*
   return Status::OK();
 }
 
+/**
+ * This is the inner wrapper for the arrow type.
+ * This performs type casting and storing the data in the output builder.
+ */
+template <typename TUDF, typename TOutput, std::size_t... I>
+Status ExecWrapperArrow(TUDF* udf, FunctionContext* ctx, size_t count, TOutput* out,
+                        const std::vector<arrow::Array*>& args, std::index_sequence<I...>) {
+  [[maybe_unused]] static constexpr auto exec_argument_types =
+      ScalarUDFTraits<TUDF>::ExecArguments();
+  return AppendArrowResults(out, count, [&](size_t idx) {
+    return UnWrap(
+        udf->Exec(ctx, types::GetValueFromArrowArray<exec_argument_types[I]>(args[I], idx)...));
+  });
+}
+
+/**
+ * Holds the results of a memoized UDF, keyed by argument.
+ * Consecutive rows with the same argument are served without a hash lookup.
+ */
+template <typename TKey, typename TResult>
+class MemoTable {
+ public:
+  template <typename TExecFn>
+  const TResult& GetOrExec(const TKey& key, TExecFn exec_fn) {
+    if (last_result_ != nullptr && last_key_ == key) {
+      return *last_result_;
+    }
+    auto [it, inserted] = results_.try_emplace(key);
+    if (inserted) {
+      it->second = exec_fn();
+    }
+    last_key_ = key;
+    last_result_ = &it->second;
+    return *last_result_;
+  }
+
+ private:
+  absl::flat_hash_map<TKey, TResult> results_;
+  TKey last_key_ = {};
+  // Points into results_, and is refreshed after every insertion, which may rehash.
+  const TResult* last_result_ = nullptr;
+};
+
+// Returns the memoization key of a UDF value. Strings are keyed by a view of the input column,
+// so that looking them up does not copy them.
+template <typename TValue>
+inline auto MemoKey(const TValue& v) {
+  return v.val;
+}
+
+template <>
+inline auto MemoKey<types::StringValue>(const types::StringValue& s) {
+  return std::string_view(s);
+}
+
+template <types::DataType TArgType>
+inline auto MemoKeyFromArrowArray(const arrow::Array* arr, int64_t idx) {
+  if constexpr (TArgType == types::DataType::STRING) {
+    return types::GetStringViewFromArrowArray(arr, idx);
+  } else {
+    return types::GetValueFromArrowArray<TArgType>(arr, idx);
+  }
+}
+
+/**
+ * Variant of ExecWrapper for memoized UDFs (see ScalarUDFTraits::Memoize()).
+ * Calls Exec once per distinct argument of the batch.
+ */
+template <typename TUDF, typename TOutput>
+Status ExecWrapperMemoized(TUDF* udf, FunctionContext* ctx, size_t count, TOutput* out,
+                           const std::vector<const types::BaseValueType*>& args) {
+  constexpr auto exec_argument_types = ScalarUDFTraits<TUDF>::ExecArguments();
+  const auto* arg = CastToUDFValueType<exec_argument_types[0]>(args[0]);
+  MemoTable<decltype(MemoKey(arg[0])), TOutput> memo;
+  for (size_t idx = 0; idx < count; ++idx) {
+    out[idx] = memo.GetOrExec(MemoKey(arg[idx]), [&]() { return udf->Exec(ctx, arg[idx]); });
+  }
+  return Status::OK();
+}
+
+/**
+ * Variant of ExecWrapperArrow for memoized UDFs (see ScalarUDFTraits::Memoize()).
+ * Calls Exec once per distinct argument of the batch.
+ */
+template <typename TUDF, typename TOutput>
+Status ExecWrapperArrowMemoized(TUDF* udf, FunctionContext* ctx, size_t count, TOutput* out,
+                                const std::vector<arrow::Array*>& args) {
+  static constexpr auto exec_argument_types = ScalarUDFTraits<TUDF>::ExecArguments();
+  constexpr types::DataType arg_type = exec_argument_types[0];
+  const arrow::Array* arg = args[0];
+
+  auto exec_fn = [&](size_t idx) {
+    return UnWrap(udf->Exec(ctx, types::GetValueFromArrowArray<arg_type>(arg, idx)));
+  };
+  MemoTable<decltype(MemoKeyFromArrowArray<arg_type>(arg, 0)), decltype(exec_fn(0))> memo;
+  return AppendArrowResults(out, count, [&](size_t idx) -> const auto& {
+    return memo.GetOrExec(MemoKeyFromArrowArray<arg_type>(arg, idx),
+                          [&]() { return exec_fn(idx); });
+  });
+}
+
 /**
  * Checks types between column wrapper and array of types::UDFDataTypes.
  * @return true if all types match.
@@ -197,13 +296,17 @@ struct ScalarUDFWrapper {
     // Check that the arity is correct.
     DCHECK(inputs.size() == ScalarUDFTraits<TUDF>::ExecArguments().size());
 
+    auto* casted_output =
+        static_cast<typename types::DataTypeTraits<return_type>::arrow_builder_type*>(output);
+    if constexpr (ScalarUDFTraits<TUDF>::Memoize()) {
+      return ExecWrapperArrowMemoized<TUDF>(static_cast<TUDF*>(udf), ctx, count, casted_output,
+                                            inputs);
+    }
     // The outer wrapper just casts the output type and UDF type. We then pass in
     // the inputs with a sequence based on the number of arguments to iterate through and
     // cast the inputs.
-    return ExecWrapperArrow<TUDF>(
-        static_cast<TUDF*>(udf), ctx, count,
-        static_cast<typename types::DataTypeTraits<return_type>::arrow_builder_type*>(output),
-        inputs, std::make_index_sequence<exec_argument_types.size()>{});
+    return ExecWrapperArrow<TUDF>(static_cast<TUDF*>(udf), ctx, count, casted_output, inputs,
+                                  std::make_index_sequence<exec_argument_types.size()>{});
   }
 
   /**
@@ -238,6 +341,10 @@ struct ScalarUDFWrapper {
 
     using output_type = typename types::DataTypeTraits<return_type>::value_type;
     auto* casted_output = static_cast<output_type*>(output->UnsafeRawData());
+    if constexpr (ScalarUDFTraits<TUDF>::Memoize()) {
+      return ExecWrapperMemoized<TUDF>(static_cast<TUDF*>(udf), ctx, count, casted_output,
+                                       input_as_base_value);
+    }
     // The outer wrapper just casts the output type and UDF type. We then pass in
     // the inputs with a sequence based on the number of arguments to iterate through and
     // cast the inputs.
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/common/system/proc_connector.h"
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <string>
+
+namespace px {
+namespace system {
+
+namespace {
+
+// Receive buffer requested for the netlink socket. Process events are small (~100 bytes),
+// so this absorbs bursts of tens of thousands of fork/exit events between reads.
+constexpr int kRecvBufSize = 4 * 1024 * 1024;
+
+// How long Create() waits for the kernel to acknowledge the subscription.
+constexpr std::chrono::milliseconds kSubscribeAckTimeout{1000};
+
+constexpr size_t kNLMsgHdrLen = NLMSG_ALIGN(sizeof(struct nlmsghdr));
+
+// Invokes fn on every proc_event in buf. Returns false if the buffer contained a netlink
+// error or overrun message, which means events were dropped.
+template <typename TFn>
+bool ForEachProcEvent(std::string_view buf, TFn fn) {
+  bool ok = true;
+  while (buf.size() >= kNLMsgHdrLen) {
+    struct nlmsghdr hdr;
+    std::memcpy(&hdr, buf.data(), sizeof(hdr));
+    if (hdr.nlmsg_len < kNLMsgHdrLen || hdr.nlmsg_len > buf.size()) {
+      break;
+    }
+
+    if (hdr.nlmsg_type == NLMSG_ERROR || hdr.nlmsg_type == NLMSG_OVERRUN) {
+      ok = false;
+    } else if (hdr.nlmsg_type == NLMSG_DONE) {
+      // The connector sends each event as a single NLMSG_DONE message wrapping a cn_msg.
+      std::string_view payload = buf.substr(kNLMsgHdrLen, hdr.nlmsg_len - kNLMsgHdrLen);
+      if (payload.size() >= sizeof(struct cn_msg)) {
+        struct cn_msg cn_hdr;
+        std::memcpy(&cn_hdr, payload.data(), sizeof(cn_hdr));
+        payload.remove_prefix(sizeof(struct cn_msg));
+        if (cn_hdr.id.idx == CN_IDX_PROC && cn_hdr.id.val == CN_VAL_PROC) {
+          struct proc_event event = {};
+          std::memcpy(&event, payload.data(), std::min(payload.size(), sizeof(event)));
+          fn(event);
+        }
+      }
+    }
+
+    buf.remove_prefix(std::min<size_t>(NLMSG_ALIGN(hdr.nlmsg_len), buf.size()));
+  }
+  return ok;
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<ProcConnector>> ProcConnector::Create() {
+  auto proc_connector = std::unique_ptr<ProcConnector>(new ProcConnector);
+  PL_RETURN_IF_ERROR(proc_connector->Connect());
+  PL_RETURN_IF_ERROR(proc_connector->Subscribe());
+  return proc_connector;
+}
+
+ProcConnector::~ProcConnector() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+Status ProcConnector::Connect() {
+  fd_ = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+  if (fd_ < 0) {
+    return error::Internal("Could not create NETLINK_CONNECTOR socket. [errno=$0]", errno);
+  }
+
+  // Best effort: without CAP_NET_ADMIN the kernel caps this at rmem_max.
+  if (setsockopt(fd_, SOL_SOCKET, SO_RCVBUFFORCE, &kRecvBufSize, sizeof(kRecvBufSize)) < 0) {
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &kRecvBufSize, sizeof(kRecvBufSize));
+  }
+
+  struct sockaddr_nl nl_addr = {};
+  nl_addr.nl_family = AF_NETLINK;
+  nl_addr.nl_groups = CN_IDX_PROC;
+  if (bind(fd_, reinterpret_cast<struct sockaddr*>(&nl_addr), sizeof(nl_addr)) < 0) {
+    return error::Internal("Could not bind to the proc connector. [errno=$0]", errno);
+  }
+  return Status::OK();
+}
+
+Status ProcConnector::Subscribe() {
+  constexpr size_t kMsgLen = NLMSG_ALIGN(kNLMsgHdrLen + sizeof(struct cn_msg) +
+                                         sizeof(enum proc_cn_mcast_op));
+
+  struct nlmsghdr hdr = {};
+  hdr.nlmsg_len = kMsgLen;
+  hdr.nlmsg_type = NLMSG_DONE;
+  hdr.nlmsg_pid = getpid();
+
+  struct cn_msg cn_hdr = {};
+  cn_hdr.id.idx = CN_IDX_PROC;
+  cn_hdr.id.val = CN_VAL_PROC;
+  cn_hdr.len = sizeof(enum proc_cn_mcast_op);
+
+  enum proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+
+  char msg[kMsgLen] = {};
+  std::memcpy(msg, &hdr, sizeof(hdr));
+  std::memcpy(msg + kNLMsgHdrLen, &cn_hdr, sizeof(cn_hdr));
+  std::memcpy(msg + kNLMsgHdrLen + sizeof(cn_hdr), &op, sizeof(op));
+
+  if (send(fd_, msg, sizeof(msg), 0) < 0) {
+    return error::Internal("Could not subscribe to process events. [errno=$0]", errno);
+  }
+
+  // The kernel acknowledges the subscription with a PROC_EVENT_NONE event, except when the
+  // caller is outside the initial PID/user namespace, in which case the request is silently
+  // dropped. Wait for the ack so that we never end up with a socket that receives nothing.
+  char buf[8192];
+  auto deadline = std::chrono::steady_clock::now() + kSubscribeAckTimeout;
+  while (true) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0) {
+      return error::FailedPrecondition(
+          "Proc connector did not acknowledge the subscription. "
+          "Is the process running in the host PID namespace?");
+    }
+
+    struct pollfd pfd = {};
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    int rc = poll(&pfd, 1, remaining.count());
+    if (rc < 0 && errno != EINTR) {
+      return error::Internal("Failed to poll the proc connector. [errno=$0]", errno);
+    }
+    if (rc <= 0) {
+      continue;
+    }
+
+    ssize_t num_bytes = recv(fd_, buf, sizeof(buf), 0);
+    if (num_bytes < 0) {
+      if (errno == EAGAIN || errno == EINTR || errno == ENOBUFS) {
+        continue;
+      }
+      return error::Internal("Failed to read from the proc connector. [errno=$0]", errno);
+    }
+
+    std::optional<uint32_t> ack_err;
+    ForEachProcEvent(std::string_view(buf, num_bytes), [&ack_err](const struct proc_event& ev) {
+      if (ev.what == proc_event::PROC_EVENT_NONE) {
+        ack_err = ev.event_data.ack.err;
+      }
+    });
+    if (ack_err.has_value()) {
+      if (ack_err.value() != 0) {
+        return error::Internal("Proc connector rejected the subscription. [err=$0]",
+                               ack_err.value());
+      }
+      return Status::OK();
+    }
+  }
+}
+
+Status ProcConnector::ReadEvents(ProcEventDeltas* deltas) {
+  char buf[8192];
+  while (true) {
+    ssize_t num_bytes = recv(fd_, buf, sizeof(buf), 0);
+    if (num_bytes < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == ENOBUFS) {
+        // The socket buffer overflowed and the kernel dropped events.
+        deltas->events_lost = true;
+        continue;
+      }
+      return error::Internal("Failed to read from the proc connector. [errno=$0]", errno);
+    }
+    ParseMessages(std::string_view(buf, num_bytes), deltas);
+  }
+  return Status::OK();
+}
+
+void ProcConnector::ParseMessages(std::string_view buf, ProcEventDeltas* deltas) {
+  bool ok = ForEachProcEvent(buf, [deltas](const struct proc_event& ev) {
+    switch (ev.what) {
+      case proc_event::PROC_EVENT_FORK:
+        // Thread creation also generates fork events; only track new processes.
+        if (ev.event_data.fork.child_pid == ev.event_data.fork.child_tgid) {
+          deltas->started.insert(ev.event_data.fork.child_tgid);
+        }
+        break;
+      case proc_event::PROC_EVENT_EXEC:
+        // An exec changes the binary (and possibly the cgroup) of an existing PID, so it is
+        // treated as a new start; the consumer deduplicates on PID start time.
+        if (ev.event_data.exec.process_pid == ev.event_data.exec.process_tgid) {
+          deltas->started.insert(ev.event_data.exec.process_tgid);
+        }
+        break;
+      case proc_event::PROC_EVENT_EXIT:
+        // If the leader exits before the other threads, this is the only exit reported for the
+        // process, and the process is still running; consumers have to recheck such PIDs.
+        if (ev.event_data.exit.process_pid == ev.event_data.exit.process_tgid) {
+          deltas->started.erase(ev.event_data.exit.process_tgid);
+          deltas->exited.insert(ev.event_data.exit.process_tgid);
+        }
+        break;
+      default:
+        break;
+    }
+  });
+  if (!ok) {
+    deltas->events_lost = true;
+  }
+}
+
+}  // namespace system
+}  // namespace px
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <memory>
+#include <string_view>
+
+#include <absl/container/flat_hash_set.h>
+
+#include "src/common/base/base.h"
+
+namespace px {
+namespace system {
+
+/**
+ * Process lifecycle changes observed since the last call to ProcConnector::ReadEvents().
+ * Only thread-group leaders are reported, so the sets contain PIDs (TGIDs), not TIDs.
+ */
+struct ProcEventDeltas {
+  // PIDs that were forked or exec'd. A PID that started and exited within the same window
+  // only appears in exited.
+  absl::flat_hash_set<uint32_t> started;
+  absl::flat_hash_set<uint32_t> exited;
+
+  // Set if the kernel dropped events (e.g. the socket receive buffer overflowed).
+  // When set, the deltas are incomplete and the consumer should fall back to a full scan.
+  bool events_lost = false;
+
+  bool empty() const { return started.empty() && exited.empty() && !events_lost; }
+
+  void clear() {
+    started.clear();
+    exited.clear();
+    events_lost = false;
+  }
+};
+
+/**
+ * ProcConnector subscribes to the kernel's netlink process connector (CN_IDX_PROC), which
+ * multicasts an event on every fork, exec and exit in the system. It lets callers track process
+ * lifecycle incrementally, instead of periodically rescanning /proc or cgroups.
+ *
+ * Requires CAP_NET_ADMIN, and must be created from the initial PID and user namespaces;
+ * elsewhere the kernel silently ignores the subscription, which Create() detects and reports.
+ */
+class ProcConnector {
+ public:
+  static StatusOr<std::unique_ptr<ProcConnector>> Create();
+
+  ~ProcConnector();
+
+  /**
+   * Drains all pending events without blocking, and merges them into deltas.
+   *
+   * @return error if the socket could not be read. Lost events are not an error;
+   * they are reported through ProcEventDeltas::events_lost.
+   */
+  Status ReadEvents(ProcEventDeltas* deltas);
+
+  /**
+   * Parses a buffer of netlink messages received from the process connector,
+   * and merges the process events into deltas. Exposed for testing.
+   */
+  static void ParseMessages(std::string_view buf, ProcEventDeltas* deltas);
+
+ private:
+  ProcConnector() = default;
+
+  Status Connect();
+  Status Subscribe();
+
+  int fd_ = -1;
+};
+
+}  // namespace system
+}  // namespace px
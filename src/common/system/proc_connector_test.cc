@@ -0,0 +1,148 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+#include "src/common/system/proc_connector.h"
+#include "src/common/testing/testing.h"
+
+namespace px {
+namespace system {
+
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+namespace {
+
+// Appends a netlink message wrapping the proc_event, laid out the way the kernel sends it.
+void AppendEvent(const struct proc_event& event, std::string* buf) {
+  struct nlmsghdr hdr = {};
+  hdr.nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(event));
+  hdr.nlmsg_type = NLMSG_DONE;
+
+  struct cn_msg cn_hdr = {};
+  cn_hdr.id.idx = CN_IDX_PROC;
+  cn_hdr.id.val = CN_VAL_PROC;
+  cn_hdr.len = sizeof(event);
+
+  std::string msg(NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(event)), '\0');
+  std::memcpy(msg.data(), &hdr, sizeof(hdr));
+  std::memcpy(msg.data() + NLMSG_HDRLEN, &cn_hdr, sizeof(cn_hdr));
+  std::memcpy(msg.data() + NLMSG_HDRLEN + sizeof(cn_hdr), &event, sizeof(event));
+  buf->append(msg);
+}
+
+struct proc_event ForkEvent(uint32_t child_pid, uint32_t child_tgid) {
+  struct proc_event event = {};
+  event.what = proc_event::PROC_EVENT_FORK;
+  event.event_data.fork.parent_pid = 1;
+  event.event_data.fork.parent_tgid = 1;
+  event.event_data.fork.child_pid = child_pid;
+  event.event_data.fork.child_tgid = child_tgid;
+  return event;
+}
+
+struct proc_event ExecEvent(uint32_t pid) {
+  struct proc_event event = {};
+  event.what = proc_event::PROC_EVENT_EXEC;
+  event.event_data.exec.process_pid = pid;
+  event.event_data.exec.process_tgid = pid;
+  return event;
+}
+
+struct proc_event ExitEvent(uint32_t pid, uint32_t tgid) {
+  struct proc_event event = {};
+  event.what = proc_event::PROC_EVENT_EXIT;
+  event.event_data.exit.process_pid = pid;
+  event.event_data.exit.process_tgid = tgid;
+  return event;
+}
+
+}  // namespace
+
+TEST(ProcConnectorTest, ParseLifecycleEvents) {
+  std::string buf;
+  AppendEvent(ForkEvent(100, 100), &buf);
+  AppendEvent(ExecEvent(200), &buf);
+  AppendEvent(ExitEvent(300, 300), &buf);
+
+  ProcEventDeltas deltas;
+  ProcConnector::ParseMessages(buf, &deltas);
+  EXPECT_THAT(deltas.started, UnorderedElementsAre(100, 200));
+  EXPECT_THAT(deltas.exited, UnorderedElementsAre(300));
+  EXPECT_FALSE(deltas.events_lost);
+}
+
+TEST(ProcConnectorTest, IgnoreThreads) {
+  std::string buf;
+  AppendEvent(ForkEvent(101, 100), &buf);
+  AppendEvent(ExitEvent(101, 100), &buf);
+
+  ProcEventDeltas deltas;
+  ProcConnector::ParseMessages(buf, &deltas);
+  EXPECT_TRUE(deltas.empty());
+}
+
+TEST(ProcConnectorTest, ShortLivedProcessOnlyReportedAsExited) {
+  std::string buf;
+  AppendEvent(ForkEvent(100, 100), &buf);
+  AppendEvent(ExecEvent(100), &buf);
+  AppendEvent(ExitEvent(100, 100), &buf);
+
+  ProcEventDeltas deltas;
+  ProcConnector::ParseMessages(buf, &deltas);
+  EXPECT_THAT(deltas.started, IsEmpty());
+  EXPECT_THAT(deltas.exited, UnorderedElementsAre(100));
+}
+
+TEST(ProcConnectorTest, OverrunMarksEventsLost) {
+  std::string buf;
+  AppendEvent(ForkEvent(100, 100), &buf);
+
+  struct nlmsghdr hdr = {};
+  hdr.nlmsg_len = NLMSG_HDRLEN;
+  hdr.nlmsg_type = NLMSG_OVERRUN;
+  buf.append(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+
+  ProcEventDeltas deltas;
+  ProcConnector::ParseMessages(buf, &deltas);
+  EXPECT_THAT(deltas.started, UnorderedElementsAre(100));
+  EXPECT_TRUE(deltas.events_lost);
+}
+
+TEST(ProcConnectorTest, TruncatedMessageIgnored) {
+  std::string buf;
+  AppendEvent(ForkEvent(100, 100), &buf);
+  AppendEvent(ForkEvent(200, 200), &buf);
+  buf.resize(buf.size() - 8);
+
+  ProcEventDeltas deltas;
+  ProcConnector::ParseMessages(buf, &deltas);
+  EXPECT_THAT(deltas.started, UnorderedElementsAre(100));
+}
+
+}  // namespace system
+}  // namespace px
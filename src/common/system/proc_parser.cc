@@ -637,6 +637,22 @@ StatusOr<std::filesystem::path> ProcParser::GetExePath(int32_t pid) const {
   return proc_exe;
 }
 
+StatusOr<std::vector<std::string>> ProcParser::GetPIDCGroupPaths(int32_t pid) const {
+  std::string fpath = absl::Substitute("$0/$1/cgroup", proc_base_path_, pid);
+  PL_ASSIGN_OR_RETURN(std::string content, px::ReadFileToString(fpath));
+
+  // Each line has the format <hierarchy-id>:<controller-list>:<cgroup-path>.
+  std::vector<std::string> paths;
+  for (std::string_view line : absl::StrSplit(content, "\n", absl::SkipWhitespace())) {
+    std::vector<std::string_view> fields = absl::StrSplit(line, absl::MaxSplits(':', 2));
+    if (fields.size() != 3) {
+      continue;
+    }
+    paths.emplace_back(fields[2]);
+  }
+  return paths;
+}
+
 StatusOr<int64_t> ProcParser::GetPIDStartTimeTicks(int32_t pid) const {
   const std::filesystem::path proc_pid_path =
       std::filesystem::path(proc_base_path_) / std::to_string(pid);
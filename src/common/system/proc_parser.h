@@ -216,6 +216,14 @@ class ProcParser {
    */
   StatusOr<std::filesystem::path> GetExePath(int32_t pid) const;
 
+  /**
+   * Returns the cgroup paths listed in /proc/<pid>/cgroup, one per hierarchy.
+   * @param pid is the pid for which we want the cgroup paths.
+   * @return The cgroup paths (e.g. /kubepods/besteffort/pod<uid>/<cid>), or error if the file
+   * could not be read.
+   */
+  StatusOr<std::vector<std::string>> GetPIDCGroupPaths(int32_t pid) const;
+
   /**
    * Parses /proc/<pid>/io files.
    * @param pid is the pid for which to read IO data.
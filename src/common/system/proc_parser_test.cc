@@ -369,6 +369,16 @@ TEST_F(ProcParserTest, GetExecutableMapEntry) {
   }
 }
 
+TEST_F(ProcParserTest, GetPIDCGroupPaths) {
+  const std::string kContainerPath =
+      "/kubepods/besteffort/pod8dbc5577-d0e2-4706-8787-57d52c03ddf2/"
+      "a7638fe3934b37419cc56bca73465a02b354ba6e98e10272542d84eb2014dd62";
+  ASSERT_OK_AND_ASSIGN(std::vector<std::string> paths, parser_->GetPIDCGroupPaths(123));
+  EXPECT_THAT(paths, ElementsAre(kContainerPath, kContainerPath, kContainerPath, "/"));
+
+  EXPECT_NOT_OK(parser_->GetPIDCGroupPaths(999));
+}
+
 // Check ProcParser can detect itself.
 TEST(ProcParserGetExePathTest, CheckTestProcess) {
   // Since bazel prepares test files as symlinks, creating testdata/proc/123/exe symlink would
@@ -0,0 +1,354 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/common/system/proc_stats_sampler.h"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <absl/strings/ascii.h>
+#include <absl/strings/str_split.h>
+
+namespace px {
+namespace system {
+
+namespace {
+
+/*************************************************
+ * constants for the /proc/<pid>/stat file
+ *************************************************/
+// Field indices, counting the pid as field 0 and the process name as field 1.
+constexpr int kProcStatProcessNameField = 1;
+
+constexpr int kProcStatMinorFaultsField = 9;
+constexpr int kProcStatMajorFaultsField = 11;
+
+constexpr int kProcStatUTimeField = 13;
+constexpr int kProcStatKTimeField = 14;
+constexpr int kProcStatNumThreadsField = 19;
+
+constexpr int kProcStatVSizeField = 22;
+constexpr int kProcStatRSSField = 23;
+
+// Below this many PIDs per thread, the cost of starting a thread outweighs the gains.
+constexpr size_t kMinPIDsPerThread = 64;
+
+// Cached PID files use at most 1/kOpenFilesLimitDivisor of the soft limit on open files; the rest
+// of the process (e.g. BPF maps and perf buffers, sockets) needs file descriptors too.
+constexpr rlim_t kOpenFilesLimitDivisor = 4;
+
+// Each cached PID holds its stat and io files open.
+constexpr rlim_t kFilesPerPID = 2;
+
+size_t CapMaxOpenPIDs(int max_open_pids) {
+  size_t cap = std::max(max_open_pids, 0);
+  struct rlimit rlim;
+  if (getrlimit(RLIMIT_NOFILE, &rlim) != 0 || rlim.rlim_cur == RLIM_INFINITY) {
+    return cap;
+  }
+  const size_t limit = rlim.rlim_cur / kOpenFilesLimitDivisor / kFilesPerPID;
+  if (cap > limit) {
+    LOG(INFO) << absl::Substitute(
+        "Keeping the /proc files of at most $0 PIDs open (instead of $1), because of the open "
+        "files limit of $2.",
+        limit, cap, rlim.rlim_cur);
+    cap = limit;
+  }
+  return cap;
+}
+
+}  // namespace
+
+void ProcStatsSampler::PIDFiles::Close() {
+  if (stat_fd >= 0) {
+    close(stat_fd);
+    stat_fd = -1;
+  }
+  if (io_fd >= 0) {
+    close(io_fd);
+    io_fd = -1;
+  }
+}
+
+ProcStatsSampler::ProcStatsSampler(const Config& cfg, int num_threads, int max_open_pids)
+    : ProcStatsSampler(cfg.proc_path().string(), cfg.PageSizeBytes(), cfg.KernelTickTimeNS(),
+                       num_threads, max_open_pids) {}
+
+ProcStatsSampler::ProcStatsSampler(std::string proc_path, int64_t page_size_bytes,
+                                   int64_t kernel_tick_time_ns, int num_threads,
+                                   int max_open_pids)
+    : proc_path_(std::move(proc_path)),
+      page_size_bytes_(page_size_bytes),
+      kernel_tick_time_ns_(kernel_tick_time_ns),
+      num_threads_(std::max(num_threads, 1)),
+      max_open_pids_(CapMaxOpenPIDs(max_open_pids)),
+      buffers_(num_threads_) {}
+
+ProcStatsSampler::~ProcStatsSampler() {
+  for (auto& [pid, files] : pid_files_) {
+    files.Close();
+  }
+}
+
+void ProcStatsSampler::Sample(const std::vector<int32_t>& pids, std::vector<PIDSample>* out) {
+  DCHECK(out != nullptr);
+  ++batch_;
+  out->resize(pids.size());
+
+  // First insert the new PIDs, so that the pointers taken below are not invalidated by a rehash.
+  for (int32_t pid : pids) {
+    if (pid_files_.size() >= max_open_pids_) {
+      break;
+    }
+    pid_files_.try_emplace(pid);
+  }
+
+  // PIDs without cached files, including repeated PIDs, get files that are closed after reading.
+  // This also guarantees that no two threads share the same PIDFiles.
+  batch_files_.resize(pids.size());
+  for (size_t i = 0; i < pids.size(); ++i) {
+    auto it = pid_files_.find(pids[i]);
+    if (it != pid_files_.end() && it->second.batch != batch_) {
+      it->second.batch = batch_;
+      batch_files_[i] = &it->second;
+    } else {
+      batch_files_[i] = nullptr;
+    }
+  }
+
+  auto sample_range = [this, &pids, out](size_t begin, size_t end, ReadBuffer* buf) {
+    for (size_t i = begin; i < end; ++i) {
+      PIDFiles uncached_files;
+      PIDFiles* files = batch_files_[i] != nullptr ? batch_files_[i] : &uncached_files;
+      PIDSample& sample = (*out)[i];
+      sample.stats.Clear();
+      sample.status =
+          SamplePID(pids[i], files, /* keep_open */ files != &uncached_files, buf, &sample.stats);
+    }
+  };
+
+  const size_t num_threads =
+      std::clamp<size_t>(pids.size() / kMinPIDsPerThread, 1, static_cast<size_t>(num_threads_));
+  const size_t pids_per_thread = (pids.size() + num_threads - 1) / num_threads;
+
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < num_threads; ++t) {
+    const size_t begin = std::min(t * pids_per_thread, pids.size());
+    const size_t end = std::min(begin + pids_per_thread, pids.size());
+    threads.emplace_back(sample_range, begin, end, &buffers_[t]);
+  }
+  sample_range(0, std::min(pids_per_thread, pids.size()), &buffers_[0]);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Drop PIDs that were not part of this batch, or whose files could not be read.
+  for (auto it = pid_files_.begin(); it != pid_files_.end();) {
+    if (it->second.batch != batch_ || it->second.stat_fd < 0) {
+      it->second.Close();
+      pid_files_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+Status ProcStatsSampler::SamplePID(int32_t pid, PIDFiles* files, bool keep_open, ReadBuffer* buf,
+                                   ProcParser::ProcessStats* out) const {
+  const bool was_open = files->stat_fd >= 0;
+  if (!was_open) {
+    PL_RETURN_IF_ERROR(OpenFiles(pid, files));
+  }
+
+  auto read_and_parse = [&]() -> Status {
+    std::string_view contents;
+    PL_RETURN_IF_ERROR(ReadFile(files->stat_fd, "stat", pid, buf, &contents));
+    PL_RETURN_IF_ERROR(ParseStat(contents, page_size_bytes_, kernel_tick_time_ns_, out));
+    PL_RETURN_IF_ERROR(ReadFile(files->io_fd, "io", pid, buf, &contents));
+    return ParseIO(contents, out);
+  };
+
+  Status s = read_and_parse();
+  if (!s.ok() && was_open) {
+    // Reads through a descriptor fail once its process is gone, even if the PID has since been
+    // reused. Retry with fresh descriptors, which refer to the current holder of the PID.
+    files->Close();
+    s = OpenFiles(pid, files);
+    if (s.ok()) {
+      out->Clear();
+      s = read_and_parse();
+    }
+  }
+
+  if (!keep_open || !s.ok()) {
+    files->Close();
+  }
+  return s;
+}
+
+Status ProcStatsSampler::OpenFiles(int32_t pid, PIDFiles* files) const {
+  const std::string stat_path = absl::Substitute("$0/$1/stat", proc_path_, pid);
+  files->stat_fd = open(stat_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (files->stat_fd < 0) {
+    return error::Internal("Failed to open file $0: $1", stat_path, std::strerror(errno));
+  }
+
+  const std::string io_path = absl::Substitute("$0/$1/io", proc_path_, pid);
+  files->io_fd = open(io_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (files->io_fd < 0) {
+    const int open_errno = errno;
+    files->Close();
+    return error::Internal("Failed to open file $0: $1", io_path, std::strerror(open_errno));
+  }
+  return Status::OK();
+}
+
+Status ProcStatsSampler::ReadFile(int fd, std::string_view name, int32_t pid, ReadBuffer* buf,
+                                  std::string_view* contents) const {
+  // Reading from offset 0 makes the kernel regenerate the file contents.
+  ssize_t n = pread(fd, buf->data, sizeof(buf->data), 0);
+  if (n < 0) {
+    return error::Internal("Failed to read file $0/$1/$2: $3", proc_path_, pid, name,
+                           std::strerror(errno));
+  }
+  *contents = std::string_view(buf->data, n);
+  return Status::OK();
+}
+
+Status ProcStatsSampler::ParseStat(std::string_view buf, int64_t page_size_bytes,
+                                   int64_t kernel_tick_time_ns, ProcParser::ProcessStats* out) {
+  /**
+   * Sample file:
+   * 4602 (ibazel) S 3260 4602 3260 34818 4602 1077936128 1799 174589 \
+   * 55 68 8 23 106 72 20 0 13 0 14329 114384896 2577 18446744073709551615 \
+   * ...
+   */
+  DCHECK(out != nullptr);
+
+  // The process name can itself contain spaces and parentheses, so it spans from the first '('
+  // to the last ')'.
+  const size_t name_begin = buf.find('(');
+  const size_t name_end = buf.rfind(')');
+  if (name_begin == std::string_view::npos || name_end == std::string_view::npos ||
+      name_end <= name_begin + 1) {
+    return error::Internal("Failed to parse stat file: malformed process name.");
+  }
+
+  bool ok = absl::SimpleAtoi(absl::StripAsciiWhitespace(buf.substr(0, name_begin)), &out->pid);
+  out->process_name.assign(buf.substr(name_begin + 1, name_end - name_begin - 1));
+
+  // Iterating over the split lazily does not allocate.
+  int field = kProcStatProcessNameField;
+  for (std::string_view token :
+       absl::StrSplit(buf.substr(name_end + 1), absl::ByAnyChar(" \n"), absl::SkipEmpty())) {
+    ++field;
+    switch (field) {
+      case kProcStatMinorFaultsField:
+        ok &= absl::SimpleAtoi(token, &out->minor_faults);
+        break;
+      case kProcStatMajorFaultsField:
+        ok &= absl::SimpleAtoi(token, &out->major_faults);
+        break;
+      case kProcStatUTimeField:
+        ok &= absl::SimpleAtoi(token, &out->utime_ns);
+        break;
+      case kProcStatKTimeField:
+        ok &= absl::SimpleAtoi(token, &out->ktime_ns);
+        break;
+      case kProcStatNumThreadsField:
+        ok &= absl::SimpleAtoi(token, &out->num_threads);
+        break;
+      case kProcStatVSizeField:
+        ok &= absl::SimpleAtoi(token, &out->vsize_bytes);
+        break;
+      case kProcStatRSSField:
+        ok &= absl::SimpleAtoi(token, &out->rss_bytes);
+        break;
+      default:
+        break;
+    }
+    if (field == kProcStatRSSField) {
+      break;
+    }
+  }
+
+  if (field < kProcStatRSSField) {
+    return error::Unknown("Incorrect number of fields in stat file: $0", field + 1);
+  }
+  if (!ok) {
+    return error::Internal("Failed to parse stat file. ATOI failed.");
+  }
+
+  // The kernel tracks utime and ktime in kernel ticks, and RSS in pages.
+  out->utime_ns *= kernel_tick_time_ns;
+  out->ktime_ns *= kernel_tick_time_ns;
+  out->rss_bytes *= page_size_bytes;
+
+  return Status::OK();
+}
+
+Status ProcStatsSampler::ParseIO(std::string_view buf, ProcParser::ProcessStats* out) {
+  /**
+   * Sample file:
+   *   rchar: 5405203
+   *   wchar: 1239158
+   *   syscr: 10608
+   *   syscw: 3141
+   *   read_bytes: 17838080
+   *   write_bytes: 634880
+   *   cancelled_write_bytes: 192512
+   */
+  DCHECK(out != nullptr);
+
+  for (std::string_view line : absl::StrSplit(buf, '\n', absl::SkipEmpty())) {
+    const size_t colon = line.find(':');
+    if (colon == std::string_view::npos) {
+      continue;
+    }
+    const std::string_view key = line.substr(0, colon);
+
+    int64_t* val_ptr = nullptr;
+    if (key == "rchar") {
+      val_ptr = &out->rchar_bytes;
+    } else if (key == "wchar") {
+      val_ptr = &out->wchar_bytes;
+    } else if (key == "read_bytes") {
+      val_ptr = &out->read_bytes;
+    } else if (key == "write_bytes") {
+      val_ptr = &out->write_bytes;
+    } else {
+      continue;
+    }
+
+    // Same convention as ProcParser: fields that fail to parse are set to -1.
+    if (!absl::SimpleAtoi(absl::StripAsciiWhitespace(line.substr(colon + 1)), val_ptr)) {
+      *val_ptr = -1;
+    }
+  }
+
+  return Status::OK();
+}
+
+}  // namespace system
+}  // namespace px
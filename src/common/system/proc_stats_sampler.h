@@ -0,0 +1,135 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <absl/container/flat_hash_map.h>
+#include "src/common/base/base.h"
+#include "src/common/system/config.h"
+#include "src/common/system/proc_parser.h"
+
+namespace px {
+namespace system {
+
+/**
+ * ProcStatsSampler collects /proc/<pid>/stat and /proc/<pid>/io for a batch of PIDs.
+ *
+ * Compared to calling ProcParser::ParseProcPIDStat() and ParseProcPIDStatIO() per PID, it:
+ *  - keeps the per-PID files open across Sample() calls, and re-reads them with pread(),
+ *  - parses the file contents in place, without splitting them into vectors of fields,
+ *  - optionally spreads the PIDs of a batch over several threads.
+ *
+ * Files of PIDs that are absent from a batch, or that failed to be read, are closed at the end of
+ * that batch.
+ * Not thread-safe; a single thread should call Sample().
+ */
+class ProcStatsSampler : public NotCopyable {
+ public:
+  struct PIDSample {
+    Status status;
+    ProcParser::ProcessStats stats;
+  };
+
+  /**
+   * ProcStatsSampler constructor.
+   * @param cfg the system config, used for the proc path, page size and kernel tick time.
+   * @param num_threads the number of threads a batch is spread over. With 1, everything is read
+   * on the calling thread.
+   * @param max_open_pids the maximum number of PIDs whose files are kept open. Files of PIDs
+   * beyond this limit are opened and closed on each read. Further capped to a fraction of the
+   * soft limit on open files (RLIMIT_NOFILE), since each PID holds two files open.
+   */
+  explicit ProcStatsSampler(const Config& cfg, int num_threads = 1, int max_open_pids = 1024);
+  ProcStatsSampler(std::string proc_path, int64_t page_size_bytes, int64_t kernel_tick_time_ns,
+                   int num_threads = 1, int max_open_pids = 1024);
+  ~ProcStatsSampler();
+
+  /**
+   * Reads the stats of each of the PIDs.
+   * @param pids the PIDs to sample.
+   * @param out resized to pids.size(); (*out)[i] holds the result for pids[i]. Passing the same
+   * vector on every call avoids reallocating it.
+   */
+  void Sample(const std::vector<int32_t>& pids, std::vector<PIDSample>* out);
+
+  /**
+   * Returns the number of PIDs whose files are currently held open.
+   */
+  size_t num_open_pids() const { return pid_files_.size(); }
+
+  /**
+   * Returns the maximum number of PIDs whose files are kept open, after capping.
+   */
+  size_t max_open_pids() const { return max_open_pids_; }
+
+  /**
+   * Parses the contents of a /proc/<pid>/stat file.
+   */
+  static Status ParseStat(std::string_view buf, int64_t page_size_bytes,
+                          int64_t kernel_tick_time_ns, ProcParser::ProcessStats* out);
+
+  /**
+   * Parses the contents of a /proc/<pid>/io file.
+   */
+  static Status ParseIO(std::string_view buf, ProcParser::ProcessStats* out);
+
+ private:
+  struct PIDFiles {
+    int stat_fd = -1;
+    int io_fd = -1;
+    // The batch in which this PID was last sampled.
+    uint64_t batch = 0;
+
+    void Close();
+  };
+
+  // Per-thread scratch space, sized to fit the stat and io files.
+  struct ReadBuffer {
+    char data[4096];
+  };
+
+  // Reads and parses the files of a single PID. Re-opens the files once if the cached
+  // descriptors no longer refer to a live process (e.g. the PID was reused).
+  Status SamplePID(int32_t pid, PIDFiles* files, bool keep_open, ReadBuffer* buf,
+                   ProcParser::ProcessStats* out) const;
+  Status OpenFiles(int32_t pid, PIDFiles* files) const;
+  Status ReadFile(int fd, std::string_view name, int32_t pid, ReadBuffer* buf,
+                  std::string_view* contents) const;
+
+  const std::string proc_path_;
+  const int64_t page_size_bytes_;
+  const int64_t kernel_tick_time_ns_;
+  const int num_threads_;
+  const size_t max_open_pids_;
+
+  absl::flat_hash_map<int32_t, PIDFiles> pid_files_;
+  uint64_t batch_ = 0;
+
+  // Scratch space for Sample(), kept across calls to avoid reallocations.
+  std::vector<PIDFiles*> batch_files_;
+  std::vector<ReadBuffer> buffers_;
+};
+
+}  // namespace system
+}  // namespace px
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "src/common/base/base.h"
+#include "src/common/system/config.h"
+#include "src/common/system/proc_parser.h"
+#include "src/common/system/proc_stats_sampler.h"
+
+namespace px {
+namespace system {
+
+namespace {
+
+// Returns up to max_pids PIDs of processes currently running on this machine.
+std::vector<int32_t> ListPIDs(size_t max_pids) {
+  std::vector<int32_t> pids;
+  for (const auto& entry : std::filesystem::directory_iterator(Config::GetInstance().proc_path())) {
+    int32_t pid = 0;
+    if (pids.size() < max_pids && absl::SimpleAtoi(entry.path().filename().string(), &pid)) {
+      pids.push_back(pid);
+    }
+  }
+  return pids;
+}
+
+}  // namespace
+
+// The baseline: what ProcessStatsConnector used to do for each PID.
+// NOLINTNEXTLINE : runtime/references.
+static void BM_ProcParser(benchmark::State& state) {
+  const Config& cfg = Config::GetInstance();
+  ProcParser parser(cfg);
+  const std::vector<int32_t> pids = ListPIDs(state.range(0));
+
+  for (auto _ : state) {
+    for (int32_t pid : pids) {
+      ProcParser::ProcessStats stats;
+      Status s1 = parser.ParseProcPIDStat(pid, cfg.PageSizeBytes(), cfg.KernelTickTimeNS(), &stats);
+      Status s2 = parser.ParseProcPIDStatIO(pid, &stats);
+      benchmark::DoNotOptimize(stats);
+      benchmark::DoNotOptimize(s1.ok() && s2.ok());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * pids.size());
+}
+
+// NOLINTNEXTLINE : runtime/references.
+static void BM_ProcStatsSampler(benchmark::State& state) {
+  ProcStatsSampler sampler(Config::GetInstance(), /* num_threads */ state.range(1));
+  const std::vector<int32_t> pids = ListPIDs(state.range(0));
+  std::vector<ProcStatsSampler::PIDSample> samples;
+
+  for (auto _ : state) {
+    sampler.Sample(pids, &samples);
+    benchmark::DoNotOptimize(samples.data());
+  }
+  state.SetItemsProcessed(state.iterations() * pids.size());
+}
+
+BENCHMARK(BM_ProcParser)->Arg(64)->Arg(1024);
+BENCHMARK(BM_ProcStatsSampler)->Args({64, 1})->Args({1024, 1})->Args({1024, 4});
+
+}  // namespace system
+}  // namespace px
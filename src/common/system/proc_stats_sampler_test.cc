@@ -0,0 +1,171 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/common/system/proc_stats_sampler.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "src/common/testing/test_environment.h"
+#include "src/common/testing/testing.h"
+
+namespace px {
+namespace system {
+
+constexpr char kTestDataBasePath[] = "src/common/system";
+
+namespace {
+std::string GetPathToTestDataFile(std::string_view fname) {
+  return testing::BazelRunfilePath(std::filesystem::path(kTestDataBasePath) / fname);
+}
+}  // namespace
+
+constexpr int64_t kBytesPerPage = 4096;
+constexpr int64_t kKernelTickTimeNS = 100;
+
+TEST(ProcStatsSamplerTest, ParseStat) {
+  ASSERT_OK_AND_ASSIGN(std::string contents,
+                       ReadFileToString(GetPathToTestDataFile("testdata/proc/123/stat")));
+
+  ProcParser::ProcessStats stats;
+  ASSERT_OK(ProcStatsSampler::ParseStat(contents, kBytesPerPage, kKernelTickTimeNS, &stats));
+
+  EXPECT_EQ(4602, stats.pid);
+  EXPECT_EQ("ibazel", stats.process_name);
+  EXPECT_EQ(800, stats.utime_ns);
+  EXPECT_EQ(2300, stats.ktime_ns);
+  EXPECT_EQ(13, stats.num_threads);
+  EXPECT_EQ(55, stats.major_faults);
+  EXPECT_EQ(1799, stats.minor_faults);
+  EXPECT_EQ(114384896, stats.vsize_bytes);
+  EXPECT_EQ(2577 * kBytesPerPage, stats.rss_bytes);
+}
+
+TEST(ProcStatsSamplerTest, ParseStatNameWithSpaces) {
+  ProcParser::ProcessStats stats;
+  ASSERT_OK(ProcStatsSampler::ParseStat(
+      "42 (a (b) c) S 1 42 42 0 -1 4194560 10 0 3 0 7 9 0 0 20 0 2 0 100 4096 3 "
+      "18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 1 0 0 0 0 0 0 0 0 0 0 0 0 0\n",
+      kBytesPerPage, kKernelTickTimeNS, &stats));
+
+  EXPECT_EQ(42, stats.pid);
+  EXPECT_EQ("a (b) c", stats.process_name);
+  EXPECT_EQ(10, stats.minor_faults);
+  EXPECT_EQ(3, stats.major_faults);
+  EXPECT_EQ(700, stats.utime_ns);
+  EXPECT_EQ(900, stats.ktime_ns);
+  EXPECT_EQ(2, stats.num_threads);
+  EXPECT_EQ(4096, stats.vsize_bytes);
+  EXPECT_EQ(3 * kBytesPerPage, stats.rss_bytes);
+}
+
+TEST(ProcStatsSamplerTest, ParseStatErrors) {
+  ProcParser::ProcessStats stats;
+  EXPECT_NOT_OK(ProcStatsSampler::ParseStat("", kBytesPerPage, kKernelTickTimeNS, &stats));
+  EXPECT_NOT_OK(ProcStatsSampler::ParseStat("42 () S 1 42", kBytesPerPage, kKernelTickTimeNS,
+                                            &stats));
+  EXPECT_NOT_OK(ProcStatsSampler::ParseStat("42 (foo) S 1 42", kBytesPerPage, kKernelTickTimeNS,
+                                            &stats));
+}
+
+TEST(ProcStatsSamplerTest, ParseIO) {
+  ASSERT_OK_AND_ASSIGN(std::string contents,
+                       ReadFileToString(GetPathToTestDataFile("testdata/proc/123/io")));
+
+  ProcParser::ProcessStats stats;
+  ASSERT_OK(ProcStatsSampler::ParseIO(contents, &stats));
+
+  EXPECT_EQ(5405203, stats.rchar_bytes);
+  EXPECT_EQ(1239158, stats.wchar_bytes);
+  EXPECT_EQ(17838080, stats.read_bytes);
+  EXPECT_EQ(634880, stats.write_bytes);
+}
+
+TEST(ProcStatsSamplerTest, Sample) {
+  ProcStatsSampler sampler(GetPathToTestDataFile("testdata/proc"), kBytesPerPage,
+                           kKernelTickTimeNS);
+
+  std::vector<ProcStatsSampler::PIDSample> samples;
+  sampler.Sample({123, 999}, &samples);
+  ASSERT_EQ(samples.size(), 2);
+
+  ASSERT_OK(samples[0].status);
+  EXPECT_EQ("ibazel", samples[0].stats.process_name);
+  EXPECT_EQ(2577 * kBytesPerPage, samples[0].stats.rss_bytes);
+  EXPECT_EQ(634880, samples[0].stats.write_bytes);
+
+  // PID 999 does not exist.
+  EXPECT_NOT_OK(samples[1].status);
+  EXPECT_EQ(sampler.num_open_pids(), 1);
+
+  // Files are re-read through the cached descriptors.
+  sampler.Sample({123}, &samples);
+  ASSERT_EQ(samples.size(), 1);
+  ASSERT_OK(samples[0].status);
+  EXPECT_EQ(800, samples[0].stats.utime_ns);
+  EXPECT_EQ(5405203, samples[0].stats.rchar_bytes);
+
+  // Descriptors of PIDs that are no longer sampled are closed.
+  sampler.Sample({}, &samples);
+  EXPECT_THAT(samples, ::testing::IsEmpty());
+  EXPECT_EQ(sampler.num_open_pids(), 0);
+}
+
+TEST(ProcStatsSamplerTest, SampleSelfInParallel) {
+  ProcStatsSampler sampler(Config::GetInstance(), /* num_threads */ 4, /* max_open_pids */ 1);
+
+  // Repeated PIDs are read through uncached descriptors, so the threads never share any.
+  const std::vector<int32_t> pids(512, getpid());
+  std::vector<ProcStatsSampler::PIDSample> samples;
+  for (int i = 0; i < 2; ++i) {
+    sampler.Sample(pids, &samples);
+    ASSERT_EQ(samples.size(), pids.size());
+    for (const auto& sample : samples) {
+      ASSERT_OK(sample.status);
+      EXPECT_EQ(sample.stats.pid, getpid());
+      EXPECT_GT(sample.stats.rss_bytes, 0);
+    }
+    EXPECT_EQ(sampler.num_open_pids(), 1);
+  }
+}
+
+TEST(ProcStatsSamplerTest, MaxOpenPIDsIsCappedByOpenFilesLimit) {
+  struct rlimit orig_rlim;
+  ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &orig_rlim), 0);
+  DEFER(setrlimit(RLIMIT_NOFILE, &orig_rlim));
+
+  // Lowering the soft limit is always allowed.
+  struct rlimit rlim = orig_rlim;
+  rlim.rlim_cur = 64;
+  ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &rlim), 0);
+
+  // A quarter of the limit, with two files per PID.
+  EXPECT_EQ(ProcStatsSampler(Config::GetInstance(), 1, /* max_open_pids */ 4096).max_open_pids(),
+            8);
+  EXPECT_EQ(ProcStatsSampler(Config::GetInstance(), 1, /* max_open_pids */ 4).max_open_pids(), 4);
+}
+
+}  // namespace system
+}  // namespace px
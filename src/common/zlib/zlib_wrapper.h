@@ -35,5 +35,13 @@ namespace zlib {
  */
 StatusOr<std::string> Inflate(std::string_view in, size_t output_block_size = 16384);
 
+/**
+ * @brief Deflates (gzip) a source buffer and returns the compressed content as a string.
+ *
+ * @param in A view into the source buffer.
+ * @return Status or the gzip-compressed content as a string.
+ */
+StatusOr<std::string> Deflate(std::string_view in);
+
 }  // namespace zlib
 }  // namespace px
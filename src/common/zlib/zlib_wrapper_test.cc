@@ -46,4 +46,14 @@ TEST_F(ZlibTest, inflate_test) {
   EXPECT_OK_AND_EQ(result, GetExpectedResult());
 }
 
+TEST_F(ZlibTest, deflate_test) {
+  ASSERT_OK_AND_ASSIGN(std::string compressed, px::zlib::Deflate(GetExpectedResult()));
+  // Gzip magic bytes.
+  EXPECT_EQ(compressed.substr(0, 2), "\x1f\x8b");
+  EXPECT_OK_AND_EQ(px::zlib::Inflate(compressed), GetExpectedResult());
+
+  ASSERT_OK_AND_ASSIGN(compressed, px::zlib::Deflate(""));
+  EXPECT_OK_AND_EQ(px::zlib::Inflate(compressed), "");
+}
+
 }  // namespace px
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <utility>
+
+#include <absl/container/flat_hash_map.h>
+
+namespace px {
+namespace md {
+
+/**
+ * CowMap is a hash map with copy-on-write structural sharing, for state that is snapshotted on
+ * every update (e.g. AgentMetadataState). The entries are partitioned into a fixed number of
+ * reference counted shards. Copying a CowMap only copies the shard pointers, and a shard is copied
+ * the first time it is modified while shared with another copy. An update that modifies k entries
+ * therefore costs O(k * size / kNumShards) rather than O(size).
+ *
+ * Lookups and iteration are const-only; all modifications go through the methods below, so that
+ * shared shards can be copied first. As with flat_hash_map, modifications invalidate iterators.
+ * Values are copied along with their shard, so large values should be held by shared_ptr and
+ * modified through CopyOnWrite().
+ */
+template <typename K, typename V, typename Hash = absl::container_internal::hash_default_hash<K>,
+          typename Eq = absl::container_internal::hash_default_eq<K>>
+class CowMap {
+ public:
+  using Map = absl::flat_hash_map<K, V, Hash, Eq>;
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = typename Map::value_type;
+  using size_type = size_t;
+
+  static constexpr int kShardBits = 6;
+  static constexpr size_t kNumShards = 1 << kShardBits;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename Map::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = const value_type&;
+    using pointer = const value_type*;
+
+    const_iterator() = default;
+
+    reference operator*() const { return *it_; }
+    pointer operator->() const { return &*it_; }
+
+    const_iterator& operator++() {
+      ++it_;
+      SkipEmptyShards();
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return shard_ == other.shard_ && (shard_ == kNumShards || it_ == other.it_);
+    }
+    bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+   private:
+    friend class CowMap;
+
+    explicit const_iterator(const CowMap* map) : map_(map), shard_(kNumShards) {}
+
+    const_iterator(const CowMap* map, size_t shard, typename Map::const_iterator it)
+        : map_(map), shard_(shard), it_(it) {}
+
+    // Advances to the next entry if the current shard is exhausted.
+    void SkipEmptyShards() {
+      while (it_ == map_->shards_[shard_]->end()) {
+        do {
+          ++shard_;
+        } while (shard_ < kNumShards && map_->shards_[shard_] == nullptr);
+        if (shard_ == kNumShards) {
+          return;
+        }
+        it_ = map_->shards_[shard_]->begin();
+      }
+    }
+
+    const CowMap* map_ = nullptr;
+    size_t shard_ = kNumShards;
+    typename Map::const_iterator it_;
+  };
+  using iterator = const_iterator;
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const_iterator begin() const {
+    for (size_t i = 0; i < kNumShards; ++i) {
+      if (shards_[i] != nullptr && !shards_[i]->empty()) {
+        return const_iterator(this, i, shards_[i]->begin());
+      }
+    }
+    return end();
+  }
+
+  const_iterator end() const { return const_iterator(this); }
+
+  template <typename Q>
+  const_iterator find(const Q& key) const {
+    size_t shard = ShardIndex(key);
+    if (shards_[shard] == nullptr) {
+      return end();
+    }
+    auto it = shards_[shard]->find(key);
+    if (it == shards_[shard]->end()) {
+      return end();
+    }
+    return const_iterator(this, shard, it);
+  }
+
+  template <typename Q>
+  bool contains(const Q& key) const {
+    return find(key) != end();
+  }
+
+  /**
+   * Returns a mutable pointer to the value for the key, or nullptr if the key is not present.
+   */
+  template <typename Q>
+  V* FindMutable(const Q& key) {
+    size_t shard = ShardIndex(key);
+    if (shards_[shard] == nullptr || !shards_[shard]->contains(key)) {
+      return nullptr;
+    }
+    return &MutableShard(shard)->find(key)->second;
+  }
+
+  V& operator[](const K& key) {
+    Map* shard = MutableShard(ShardIndex(key));
+    size_t prev_size = shard->size();
+    V& value = (*shard)[key];
+    size_ += shard->size() - prev_size;
+    return value;
+  }
+
+  template <typename... TArgs>
+  std::pair<V*, bool> try_emplace(const K& key, TArgs&&... args) {
+    Map* shard = MutableShard(ShardIndex(key));
+    auto [it, inserted] = shard->try_emplace(key, std::forward<TArgs>(args)...);
+    if (inserted) {
+      ++size_;
+    }
+    return {&it->second, inserted};
+  }
+
+  void insert_or_assign(const K& key, V value) { (*this)[key] = std::move(value); }
+
+  template <typename Q>
+  size_t erase(const Q& key) {
+    size_t shard = ShardIndex(key);
+    if (shards_[shard] == nullptr || !shards_[shard]->contains(key)) {
+      return 0;
+    }
+    MutableShard(shard)->erase(key);
+    --size_;
+    return 1;
+  }
+
+  void clear() {
+    shards_ = {};
+    size_ = 0;
+  }
+
+ private:
+  // Uses the high bits of the hash, because flat_hash_map uses the low bits to place and
+  // filter entries within a shard.
+  template <typename Q>
+  static size_t ShardIndex(const Q& key) {
+    return Hash{}(key) >> (std::numeric_limits<size_t>::digits - kShardBits);
+  }
+
+  Map* MutableShard(size_t shard) {
+    if (shards_[shard] == nullptr) {
+      shards_[shard] = std::make_shared<Map>();
+    } else if (shards_[shard].use_count() > 1) {
+      shards_[shard] = std::make_shared<Map>(*shards_[shard]);
+    }
+    return shards_[shard].get();
+  }
+
+  std::array<std::shared_ptr<Map>, kNumShards> shards_;
+  size_t size_ = 0;
+};
+
+/**
+ * Returns a mutable pointer to the object held by ptr. If the object is shared with another
+ * snapshot, ptr is first pointed at a private copy made with T::Clone().
+ */
+template <typename T>
+T* CopyOnWrite(std::shared_ptr<T>* ptr) {
+  if (ptr->use_count() > 1) {
+    *ptr = std::shared_ptr<T>((*ptr)->Clone());
+  }
+  return ptr->get();
+}
+
+}  // namespace md
+}  // namespace px
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/common/testing/testing.h"
+#include "src/shared/metadata/cow_map.h"
+
+namespace px {
+namespace md {
+
+using ::testing::IsEmpty;
+using ::testing::Pair;
+using ::testing::UnorderedElementsAre;
+
+TEST(CowMapTest, Basic) {
+  CowMap<std::string, int> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_THAT(map, IsEmpty());
+
+  map["a"] = 1;
+  map.insert_or_assign("b", 2);
+  EXPECT_TRUE(map.try_emplace("c", 3).second);
+  EXPECT_FALSE(map.try_emplace("c", 4).second);
+
+  EXPECT_EQ(map.size(), 3);
+  EXPECT_THAT(map, UnorderedElementsAre(Pair("a", 1), Pair("b", 2), Pair("c", 3)));
+
+  // Heterogeneous lookup.
+  std::string_view key = "b";
+  ASSERT_NE(map.find(key), map.end());
+  EXPECT_EQ(map.find(key)->second, 2);
+  EXPECT_TRUE(map.contains("a"));
+  EXPECT_FALSE(map.contains("d"));
+
+  *map.FindMutable("a") = 10;
+  EXPECT_EQ(map.FindMutable("d"), nullptr);
+
+  EXPECT_EQ(map.erase("b"), 1);
+  EXPECT_EQ(map.erase("b"), 0);
+  EXPECT_THAT(map, UnorderedElementsAre(Pair("a", 10), Pair("c", 3)));
+
+  map.clear();
+  EXPECT_THAT(map, IsEmpty());
+  EXPECT_EQ(map.begin(), map.end());
+}
+
+TEST(CowMapTest, CopiesAreIndependent) {
+  CowMap<int, int> map;
+  for (int i = 0; i < 1000; ++i) {
+    map[i] = i;
+  }
+
+  CowMap<int, int> copy = map;
+  copy[0] = -1;
+  copy.erase(1);
+  copy[1000] = 1000;
+
+  map[2] = -2;
+
+  EXPECT_EQ(map.size(), 1000);
+  EXPECT_EQ(map.find(0)->second, 0);
+  EXPECT_TRUE(map.contains(1));
+  EXPECT_FALSE(map.contains(1000));
+  EXPECT_EQ(map.find(2)->second, -2);
+
+  EXPECT_EQ(copy.size(), 1000);
+  EXPECT_EQ(copy.find(0)->second, -1);
+  EXPECT_FALSE(copy.contains(1));
+  EXPECT_TRUE(copy.contains(1000));
+  EXPECT_EQ(copy.find(2)->second, 2);
+
+  int count = 0;
+  for (const auto& [k, v] : copy) {
+    EXPECT_TRUE(k == 0 || k == v);
+    ++count;
+  }
+  EXPECT_EQ(count, 1000);
+}
+
+struct Object {
+  explicit Object(int v) : value(v) {}
+  std::unique_ptr<Object> Clone() const { return std::make_unique<Object>(value); }
+  int value;
+};
+
+TEST(CowMapTest, CopyOnWriteValues) {
+  CowMap<int, std::shared_ptr<Object>> map;
+  map[1] = std::make_shared<Object>(1);
+  const Object* original = map.find(1)->second.get();
+
+  // Not shared, so modified in place.
+  CopyOnWrite(map.FindMutable(1))->value = 2;
+  EXPECT_EQ(map.find(1)->second.get(), original);
+
+  CowMap<int, std::shared_ptr<Object>> copy = map;
+  CopyOnWrite(copy.FindMutable(1))->value = 3;
+
+  EXPECT_EQ(map.find(1)->second.get(), original);
+  EXPECT_EQ(map.find(1)->second->value, 2);
+  EXPECT_NE(copy.find(1)->second.get(), original);
+  EXPECT_EQ(copy.find(1)->second->value, 3);
+}
+
+}  // namespace md
+}  // namespace px
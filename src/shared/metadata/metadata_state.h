@@ -29,6 +29,7 @@
 
 #include "src/common/base/base.h"
 #include "src/shared/k8s/metadatapb/metadata.pb.h"
+#include "src/shared/metadata/cow_map.h"
 #include "src/shared/metadata/k8s_objects.h"
 #include "src/shared/metadata/pids.h"
 #include "src/shared/upid/upid.h"
@@ -36,13 +37,18 @@
 namespace px {
 namespace md {
 
-using K8sMetadataObjectUPtr = std::unique_ptr<K8sMetadataObject>;
-using ContainerInfoUPtr = std::unique_ptr<ContainerInfo>;
-using PIDInfoUPtr = std::unique_ptr<PIDInfo>;
 using AgentID = sole::uuid;
 
+// Metadata objects are shared between snapshots of the state, and copied on write.
+using K8sMetadataObjectSPtr = std::shared_ptr<K8sMetadataObject>;
+using ContainerInfoSPtr = std::shared_ptr<ContainerInfo>;
+using PIDInfoSPtr = std::shared_ptr<PIDInfo>;
+using PIDInfoMap = CowMap<UPID, PIDInfoSPtr>;
+
 /**
  * This class contains all kubernetes relate metadata.
+ * The underlying maps are copy-on-write, so Clone() is cheap and only the objects that are
+ * modified afterwards get copied.
  */
 class K8sMetadataState : NotCopyable {
  public:
@@ -92,15 +98,15 @@ class K8sMetadataState : NotCopyable {
       }
     };
   };
-  using K8sEntityByNameMap =
-      absl::flat_hash_map<K8sNameIdent, UID, K8sIdentHashEq::Hash, K8sIdentHashEq::Eq>;
+  using K8sEntityByNameMap = CowMap<K8sNameIdent, UID, K8sIdentHashEq::Hash, K8sIdentHashEq::Eq>;
 
   using PodsByNameMap = K8sEntityByNameMap;
   using ServicesByNameMap = K8sEntityByNameMap;
   using NamespacesByNameMap = K8sEntityByNameMap;
-  using ContainersByNameMap = absl::flat_hash_map<std::string, CID>;
-  using PodsByPodIpMap = absl::flat_hash_map<std::string, UID>;
-  using ServicesByServiceIpMap = absl::flat_hash_map<std::string, UID>;
+  using ContainersByNameMap = CowMap<std::string, CID>;
+  using PodsByPodIpMap = CowMap<std::string, UID>;
+  using ServicesByServiceIpMap = CowMap<std::string, UID>;
+  using ContainersByIDMap = CowMap<CID, ContainerInfoSPtr>;
 
   void set_service_cidr(CIDRBlock cidr) {
     if (!service_cidr_.has_value() || service_cidr_.value() != cidr) {
@@ -152,6 +158,14 @@ class K8sMetadataState : NotCopyable {
    */
   const ContainerInfo* ContainerInfoByID(CIDView id) const;
 
+  /**
+   * MutableContainerInfoByID returns a modifiable container info by ID. If the container info is
+   * shared with another snapshot of the state, it is copied first.
+   * @param id The ID of the container.
+   * @return ContainerInfo or nullptr if not found.
+   */
+  ContainerInfo* MutableContainerInfoByID(CIDView id);
+
   /**
    * ContainerIDByName returns the ContainerID for the container of the given name.
    * @param container_name the container name
@@ -199,11 +213,12 @@ class K8sMetadataState : NotCopyable {
 
   Status CleanupExpiredMetadata(int64_t retention_time_ns);
 
-  absl::flat_hash_map<CID, ContainerInfoUPtr>& containers_by_id() { return containers_by_id_; }
+  const ContainersByIDMap& containers_by_id() const { return containers_by_id_; }
   std::string DebugString(int indent_level = 0) const;
 
  private:
   const K8sMetadataObject* K8sMetadataObjectByID(UIDView id, K8sObjectType type) const;
+  K8sMetadataObject* MutableK8sMetadataObjectByID(UIDView id);
 
   // The CIDR block used for services inside the cluster.
   std::optional<CIDRBlock> service_cidr_;
@@ -212,10 +227,10 @@ class K8sMetadataState : NotCopyable {
   std::vector<CIDRBlock> pod_cidrs_;
 
   // This stores K8s native objects (services, pods, etc).
-  absl::flat_hash_map<UID, K8sMetadataObjectUPtr> k8s_objects_by_id_;
+  CowMap<UID, K8sMetadataObjectSPtr> k8s_objects_by_id_;
 
   // This stores container objects, complementing k8s_objects_by_id_.
-  absl::flat_hash_map<CID, ContainerInfoUPtr> containers_by_id_;
+  ContainersByIDMap containers_by_id_;
 
   /**
    * Mapping of pods by name.
@@ -287,7 +302,7 @@ class AgentMetadataState : NotCopyable {
 
   std::shared_ptr<AgentMetadataState> CloneToShared() const;
 
-  PIDInfo* GetPIDByUPID(UPID upid) const {
+  const PIDInfo* GetPIDByUPID(UPID upid) const {
     auto it = pids_by_upid_.find(upid);
     if (it != pids_by_upid_.end()) {
       return it->second.get();
@@ -299,27 +314,36 @@ class AgentMetadataState : NotCopyable {
     DCHECK(pid_info != nullptr);
     DCHECK_EQ(pid_info->stop_time_ns(), 0);
 
-    pids_by_upid_[upid] = std::move(pid_info);
-    upids_.insert(upid);
+    pids_by_upid_.insert_or_assign(upid, std::move(pid_info));
+    mutable_upids()->insert(upid);
   }
 
   void MarkUPIDAsStopped(UPID upid, int64_t ts) {
-    auto* pid_info = GetPIDByUPID(upid);
+    PIDInfoSPtr* pid_info = pids_by_upid_.FindMutable(upid);
     if (pid_info != nullptr) {
-      pid_info->set_stop_time_ns(ts);
-      upids_.erase(upid);
+      CopyOnWrite(pid_info)->set_stop_time_ns(ts);
+      mutable_upids()->erase(upid);
     } else {
-      DCHECK(!upids_.contains(upid));
+      DCHECK(!upids_->contains(upid));
     }
   }
 
-  const absl::flat_hash_map<UPID, PIDInfoUPtr>& pids_by_upid() const { return pids_by_upid_; }
+  const PIDInfoMap& pids_by_upid() const { return pids_by_upid_; }
 
-  const absl::flat_hash_set<md::UPID>& upids() const { return upids_; }
+  const absl::flat_hash_set<md::UPID>& upids() const { return *upids_; }
 
   std::string DebugString(int indent_level = 0) const;
 
  private:
+  // Returns the set of active UPIDs for modification, copying it first if it is shared with
+  // another snapshot.
+  absl::flat_hash_set<md::UPID>* mutable_upids() {
+    if (upids_.use_count() > 1) {
+      upids_ = std::make_shared<absl::flat_hash_set<md::UPID>>(*upids_);
+    }
+    return upids_.get();
+  }
+
   /**
    * Tracks the time that this K8s metadata object was created. The object should be periodically
    * refreshed to get the latest version.
@@ -347,14 +371,16 @@ class AgentMetadataState : NotCopyable {
   /**
    * Mapping of PIDs by UPID for active pods on the system.
    */
-  absl::flat_hash_map<UPID, PIDInfoUPtr> pids_by_upid_;
+  PIDInfoMap pids_by_upid_;
 
   /**
    * All active UPIDs. Unlike pids_by_upid_, this does not contain stopped pids.
    * While this set could be reconstructed from pids_by_upid_,
    * it is tracked separately as a performance optimization.
+   * It is shared between snapshots until modified, since it is exposed as a plain set.
    */
-  absl::flat_hash_set<md::UPID> upids_;
+  std::shared_ptr<absl::flat_hash_set<md::UPID>> upids_ =
+      std::make_shared<absl::flat_hash_set<md::UPID>>();
 };
 
 }  // namespace md
@@ -172,6 +172,63 @@ TEST(K8sMetadataStateTest, CloneCopiedCIDR) {
   EXPECT_EQ(service_cidr.prefix_length, state_copy->service_cidr()->prefix_length);
 }
 
+TEST(K8sMetadataStateTest, CloneIsCopyOnWrite) {
+  K8sMetadataState state;
+
+  K8sMetadataState::ContainerUpdate container_update;
+  ASSERT_TRUE(TextFormat::MergeFromString(kContainer0UpdatePbTxt, &container_update));
+  K8sMetadataState::PodUpdate pod_update;
+  ASSERT_TRUE(TextFormat::MergeFromString(kPod0UpdatePbTxt, &pod_update));
+  EXPECT_OK(state.HandleContainerUpdate(container_update));
+  EXPECT_OK(state.HandlePodUpdate(pod_update));
+
+  auto state_copy = state.Clone();
+
+  // Unmodified objects are shared.
+  EXPECT_EQ(state.PodInfoByID("pod0_uid"), state_copy->PodInfoByID("pod0_uid"));
+  EXPECT_EQ(state.ContainerInfoByID("container0_uid"),
+            state_copy->ContainerInfoByID("container0_uid"));
+
+  // Modifying the copy does not affect the original.
+  ContainerInfo* cinfo = state_copy->MutableContainerInfoByID("container0_uid");
+  ASSERT_NE(nullptr, cinfo);
+  cinfo->set_stop_time_ns(999);
+  cinfo->mutable_active_upids()->emplace(UPID(1, 2, 3));
+
+  EXPECT_EQ(102, state.ContainerInfoByID("container0_uid")->stop_time_ns());
+  EXPECT_TRUE(state.ContainerInfoByID("container0_uid")->active_upids().empty());
+  EXPECT_EQ(999, state_copy->ContainerInfoByID("container0_uid")->stop_time_ns());
+  EXPECT_EQ(state.PodInfoByID("pod0_uid"), state_copy->PodInfoByID("pod0_uid"));
+
+  pod_update.set_pod_ip("1.2.3.9");
+  EXPECT_OK(state_copy->HandlePodUpdate(pod_update));
+  EXPECT_EQ("1.2.3.4", state.PodInfoByID("pod0_uid")->pod_ip());
+  EXPECT_EQ("pod0_uid", state.PodIDByIP("1.2.3.4"));
+  EXPECT_EQ("", state.PodIDByIP("1.2.3.9"));
+  EXPECT_EQ("1.2.3.9", state_copy->PodInfoByID("pod0_uid")->pod_ip());
+  EXPECT_EQ("pod0_uid", state_copy->PodIDByIP("1.2.3.9"));
+}
+
+TEST(AgentMetadataStateTest, CloneIsCopyOnWrite) {
+  AgentMetadataState state(/* asid */ 1, /* pid */ 2);
+  const UPID upid1(1, 100, 1000);
+  const UPID upid2(1, 200, 2000);
+  state.AddUPID(upid1, std::make_unique<PIDInfo>(upid1, "exe", "cmdline", "container0_uid"));
+
+  std::shared_ptr<AgentMetadataState> state_copy = state.CloneToShared();
+  EXPECT_EQ(state.GetPIDByUPID(upid1), state_copy->GetPIDByUPID(upid1));
+
+  state_copy->MarkUPIDAsStopped(upid1, 5000);
+  state_copy->AddUPID(upid2, std::make_unique<PIDInfo>(upid2, "exe", "cmdline", "container0_uid"));
+
+  EXPECT_EQ(0, state.GetPIDByUPID(upid1)->stop_time_ns());
+  EXPECT_THAT(state.upids(), UnorderedElementsAre(upid1));
+  EXPECT_EQ(nullptr, state.GetPIDByUPID(upid2));
+
+  EXPECT_EQ(5000, state_copy->GetPIDByUPID(upid1)->stop_time_ns());
+  EXPECT_THAT(state_copy->upids(), UnorderedElementsAre(upid2));
+}
+
 TEST(K8sMetadataStateTest, HandleContainerUpdate) {
   K8sMetadataState state;
 
@@ -17,12 +17,21 @@
  */
 
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include <absl/base/internal/spinlock.h>
+#include <absl/strings/str_split.h>
 #include "src/shared/metadata/state_manager.h"
 
+DEFINE_bool(metadata_use_proc_events, gflags::BoolFromEnv("PL_METADATA_USE_PROC_EVENTS", true),
+            "If true, track process creation and termination through the kernel's proc connector, "
+            "instead of reading the cgroups of every container on each metadata update.");
+DEFINE_int32(metadata_pid_scan_interval_epochs, 12,
+             "When process events are in use, the number of metadata updates between full scans "
+             "of the container cgroups, which reconcile any missed events.");
+
 namespace px {
 namespace md {
 
@@ -52,6 +61,50 @@ std::unique_ptr<PIDStatusEvent> AgentMetadataStateManagerImpl::GetNextPIDStatusE
   return found ? std::move(event) : nullptr;
 }
 
+void AgentMetadataStateManagerImpl::InitProcConnector() {
+  if (!FLAGS_metadata_use_proc_events) {
+    return;
+  }
+  auto proc_connector_or = system::ProcConnector::Create();
+  if (!proc_connector_or.ok()) {
+    LOG(WARNING) << absl::Substitute(
+        "Process events are unavailable, falling back to polling cgroups for PIDs. [msg=$0]",
+        proc_connector_or.msg());
+    return;
+  }
+  proc_connector_ = proc_connector_or.ConsumeValueOrDie();
+}
+
+Status AgentMetadataStateManagerImpl::UpdatePIDs(int64_t ts, AgentMetadataState* state) {
+  // Drain the events before any scan, so that nothing that happens during the scan is missed.
+  // Events already reflected by the scan are deduplicated using the PID start times.
+  proc_event_deltas_.clear();
+  if (proc_connector_ != nullptr) {
+    Status s = proc_connector_->ReadEvents(&proc_event_deltas_);
+    if (!s.ok()) {
+      LOG(WARNING) << absl::Substitute(
+          "Failed to read process events, falling back to polling cgroups for PIDs. [msg=$0]",
+          s.msg());
+      proc_connector_.reset();
+    }
+  }
+
+  bool full_scan = proc_connector_ == nullptr || proc_event_deltas_.events_lost ||
+                   epochs_since_pid_scan_ < 0 ||
+                   epochs_since_pid_scan_ >= FLAGS_metadata_pid_scan_interval_epochs;
+  if (full_scan) {
+    scanned_containers_.clear();
+    pending_exits_.clear();
+    epochs_since_pid_scan_ = 0;
+    return ProcessPIDUpdates(ts, proc_parser_, state, md_reader_.get(), &pid_updates_,
+                             &scanned_containers_);
+  }
+
+  ++epochs_since_pid_scan_;
+  return ProcessPIDEvents(ts, proc_parser_, state, md_reader_.get(), proc_event_deltas_,
+                          &scanned_containers_, &pending_exits_, &pid_updates_);
+}
+
 Status AgentMetadataStateManagerImpl::AddK8sUpdate(std::unique_ptr<ResourceUpdate> update) {
   incoming_k8s_updates_.enqueue(std::move(update));
   return Status::OK();
@@ -64,7 +117,7 @@ Status AgentMetadataStateManagerImpl::PerformMetadataStateUpdate() {
    * Performing a state update involves:
    *   1. Create a copy of the current metadata state.
    *   2. Drain the incoming update queue from the metadata service and apply the updates.
-   *   3. For each container pull the pid information. Diff this with the existing pids and update.
+   *   3. Update the pid information, from process events or by pulling it for each container.
    *   4. Send diff of pids to the outgoing update Q.
    *   5. Set current update time and increment the epoch.
    *   6. Update pod/service CIDR information if it has changed.
@@ -90,8 +143,7 @@ Status AgentMetadataStateManagerImpl::PerformMetadataStateUpdate() {
 
   if (collects_data_) {
     // Update PID information.
-    PL_RETURN_IF_ERROR(
-        ProcessPIDUpdates(ts, proc_parser_, shadow_state.get(), md_reader_.get(), &pid_updates_));
+    PL_RETURN_IF_ERROR(UpdatePIDs(ts, shadow_state.get()));
   }
 
   // Update the pod/service CIDRs if they have been updated.
@@ -169,6 +221,23 @@ StatusOr<UPID> InitUPID(const system::ProcParser& proc_parser, uint32_t asid, ui
   return UPID(asid, pid, pid_start_time);
 }
 
+void AddContainerUPID(
+    CIDView cid, const UPID& upid, const system::ProcParser& proc_parser, AgentMetadataState* md,
+    StartTimeOrderedUPIDSet* upids,
+    moodycamel::BlockingConcurrentQueue<std::unique_ptr<PIDStatusEvent>>* pid_updates) {
+  upids->emplace(upid);
+
+  std::string exe_path = proc_parser.GetExePath(upid.pid()).ValueOr("");
+  std::string cmdline = proc_parser.GetPIDCmdline(upid.pid());
+  auto pid_info =
+      std::make_unique<PIDInfo>(upid, std::move(exe_path), std::move(cmdline), CID(cid));
+
+  // Push creation events to the queue.
+  pid_updates->enqueue(std::make_unique<PIDStartedEvent>(*pid_info));
+
+  md->AddUPID(upid, std::move(pid_info));
+}
+
 }  // namespace
 
 void ProcessContainerPIDUpdates(
@@ -208,83 +277,249 @@ void ProcessContainerPIDUpdates(
       LOG(WARNING) << absl::Substitute("Could not convert PID to UPID: $0", pid);
       continue;
     }
+    AddContainerUPID(cid, upid_status.ValueOrDie(), proc_parser, md, upids, pid_updates);
+  }
+}
+
+namespace {
+
+/**
+ * Reads the PIDs of a single container from cgroups and applies the differences to the state.
+ * Returns true if the container is live and its PIDs were read.
+ */
+bool ScanContainerPIDs(
+    CIDView cid, const ContainerInfo& cinfo, int64_t ts, const system::ProcParser& proc_parser,
+    AgentMetadataState* md, CGroupMetadataReader* md_reader,
+    moodycamel::BlockingConcurrentQueue<std::unique_ptr<PIDStatusEvent>>* pid_updates) {
+  K8sMetadataState* k8s_md_state = md->k8s_metadata_state();
+
+  if (cinfo.stop_time_ns() != 0) {
+    // Ignore dead containers.
+    // TODO(zasgar): Come up with a cleaner way of doing this. Probably by using active/inactive
+    // containers.
+    VLOG(1) << "Ignore dead container: " << cinfo.DebugString();
+    return false;
+  }
 
-    UPID upid = upid_status.ValueOrDie();
-    upids->emplace(upid);
+  // For every container:
+  //   1. Read the current PIDs (from cgroups).
+  //   2. Get the list of current PIDs (from metadata).
+  //   3. For each new PID create metadata object and attach to container.
+  //   4. For each old PID deactivate it and set time of death.
+
+  const UID& pod_id = cinfo.pod_id();
+  if (pod_id.empty()) {
+    // No pod id implies it has not synced yet.
+    VLOG(1) << "Ignoring Container due to missing pod: \n" << cinfo.DebugString(1);
+    return false;
+  }
+  const PodInfo* pod_info = k8s_md_state->PodInfoByID(pod_id);
+
+  if (pod_info->stop_time_ns() != 0) {
+    VLOG(1) << absl::Substitute("Found a running container in a deleted pod [cid=$0, pod_id=$1]",
+                                cid, pod_id);
+    k8s_md_state->MutableContainerInfoByID(cid)->set_stop_time_ns(pod_info->stop_time_ns());
+    return false;
+  }
+
+  absl::flat_hash_set<uint32_t> cgroups_active_pids;
+  Status s = md_reader->ReadPIDs(pod_info->qos_class(), pod_id, cid, cinfo.type(),
+                                 &cgroups_active_pids);
+  if (!s.ok()) {
+    // Container probably died, we will eventually get a message from MDS and everything in that
+    // container will be marked dead.
+    LOG(WARNING) << absl::Substitute("Failed to read PID info for pod=$0, cid=$1 [msg=$2]",
+                                     pod_id, cid, s.msg());
+
+    // Don't wait for MDS to send the container death information; set the stop time right away.
+    // This is so we stop trying to read stats for this non-existent container.
+    // NOTE: Currently, MDS sends pods that do no belong to this Agent, so this is actually
+    // required to avoid repeatedly printing out the warning message above.
+    if (error::IsNotFound(s)) {
+      ContainerInfo* mutable_cinfo = k8s_md_state->MutableContainerInfoByID(cid);
+      mutable_cinfo->set_stop_time_ns(ts);
+      for (const auto& upid : mutable_cinfo->active_upids()) {
+        md->MarkUPIDAsStopped(upid, ts);
+      }
+      mutable_cinfo->mutable_active_upids()->clear();
+    }
+    return false;
+  }
+
+  // Only modify (and thereby copy) the container if its PIDs changed.
+  const StartTimeOrderedUPIDSet& active_upids = cinfo.active_upids();
+  bool pids_changed = active_upids.size() != cgroups_active_pids.size();
+  for (auto iter = active_upids.begin(); !pids_changed && iter != active_upids.end(); ++iter) {
+    pids_changed = !cgroups_active_pids.contains(iter->pid());
+  }
+  if (!pids_changed) {
+    return true;
+  }
 
-    std::string exe_path = proc_parser.GetExePath(upid.pid()).ValueOr("");
-    std::string cmdline = proc_parser.GetPIDCmdline(upid.pid());
-    auto pid_info =
-        std::make_unique<PIDInfo>(upid, std::move(exe_path), std::move(cmdline), CID(cid));
+  ProcessContainerPIDUpdates(cid, ts, proc_parser, md,
+                             k8s_md_state->MutableContainerInfoByID(cid)->mutable_active_upids(),
+                             &cgroups_active_pids, pid_updates);
+  return true;
+}
 
-    // Push creation events to the queue.
-    pid_updates->enqueue(std::make_unique<PIDStartedEvent>(*pid_info));
+/**
+ * Finds the scanned container that a PID belongs to, by matching the components of the
+ * PID's cgroup paths against the container IDs. This covers both the cgroupfs layout
+ * (.../pod<uid>/<cid>) and the systemd layout (.../<runtime>-<cid>.scope).
+ */
+const ContainerInfo* FindContainerForPID(uint32_t pid, const system::ProcParser& proc_parser,
+                                         const AgentMetadataState& md,
+                                         const absl::flat_hash_set<CID>& scanned_containers) {
+  StatusOr<std::vector<std::string>> paths_or = proc_parser.GetPIDCGroupPaths(pid);
+  if (!paths_or.ok()) {
+    // Most likely the process has already exited.
+    return nullptr;
+  }
 
-    md->AddUPID(upid, std::move(pid_info));
+  const auto& containers = md.k8s_metadata_state().containers_by_id();
+  for (const auto& path : paths_or.ValueOrDie()) {
+    for (std::string_view token :
+         absl::StrSplit(path, absl::ByAnyChar("/-.:"), absl::SkipEmpty())) {
+      auto iter = containers.find(token);
+      if (iter != containers.end() && scanned_containers.contains(iter->first)) {
+        return iter->second.get();
+      }
+    }
   }
+  return nullptr;
 }
 
+}  // namespace
+
 Status ProcessPIDUpdates(
     int64_t ts, const system::ProcParser& proc_parser, AgentMetadataState* md,
     CGroupMetadataReader* md_reader,
+    moodycamel::BlockingConcurrentQueue<std::unique_ptr<PIDStatusEvent>>* pid_updates,
+    absl::flat_hash_set<CID>* scanned_containers) {
+  // Iterate over a (cheap, copy-on-write) copy, since scanning modifies the containers.
+  const K8sMetadataState::ContainersByIDMap containers =
+      md->k8s_metadata_state()->containers_by_id();
+
+  for (const auto& [cid, cinfo] : containers) {
+    bool scanned = ScanContainerPIDs(cid, *cinfo, ts, proc_parser, md, md_reader, pid_updates);
+    if (scanned && scanned_containers != nullptr) {
+      scanned_containers->insert(cid);
+    }
+  }
+
+  return Status::OK();
+}
+
+Status ProcessPIDEvents(
+    int64_t ts, const system::ProcParser& proc_parser, AgentMetadataState* md,
+    CGroupMetadataReader* md_reader, const system::ProcEventDeltas& deltas,
+    absl::flat_hash_set<CID>* scanned_containers, absl::flat_hash_set<uint32_t>* pending_exits,
     moodycamel::BlockingConcurrentQueue<std::unique_ptr<PIDStatusEvent>>* pid_updates) {
-  const auto& k8s_md_state = md->k8s_metadata_state();
-
-  for (const auto& [cid, cinfo] : k8s_md_state->containers_by_id()) {
-    if (cinfo->stop_time_ns() != 0) {
-      // Ignore dead containers.
-      // TODO(zasgar): Come up with a cleaner way of doing this. Probably by using active/inactive
-      // containers.
-      VLOG(1) << "Ignore dead container: " << cinfo->DebugString();
+  K8sMetadataState* k8s_md_state = md->k8s_metadata_state();
+  // Iterate over a (cheap, copy-on-write) copy, since scanning modifies the containers.
+  const K8sMetadataState::ContainersByIDMap containers = k8s_md_state->containers_by_id();
+
+  // Stop tracking containers that have died or been removed.
+  for (auto iter = scanned_containers->begin(); iter != scanned_containers->end();) {
+    auto cinfo_iter = containers.find(*iter);
+    if (cinfo_iter == containers.end() || cinfo_iter->second->stop_time_ns() != 0) {
+      scanned_containers->erase(iter++);
+    } else {
+      ++iter;
+    }
+  }
+
+  // Containers that are new since the last update need a full read of their PIDs, since their
+  // processes may have started before the container metadata arrived.
+  for (const auto& [cid, cinfo] : containers) {
+    if (scanned_containers->contains(cid)) {
       continue;
     }
+    if (ScanContainerPIDs(cid, *cinfo, ts, proc_parser, md, md_reader, pid_updates)) {
+      scanned_containers->insert(cid);
+    }
+  }
 
-    // For every container:
-    //   1. Read the current PIDs (from cgroups).
-    //   2. Get the list of current PIDs (from metadata).
-    //   3. For each new PID create metadata object and attach to container.
-    //   4. For each old PID deactivate it and set time of death.
+  if (deltas.exited.empty() && deltas.started.empty() && pending_exits->empty()) {
+    return Status::OK();
+  }
 
-    const UID& pod_id = cinfo->pod_id();
-    if (pod_id.empty()) {
-      // No pod id implies it has not synced yet.
-      VLOG(1) << "Ignoring Container due to missing pod: \n" << cinfo->DebugString(1);
-      continue;
+  absl::flat_hash_map<uint32_t, UPID> upids_by_pid;
+  upids_by_pid.reserve(md->upids().size());
+  for (const auto& upid : md->upids()) {
+    upids_by_pid[upid.pid()] = upid;
+  }
+
+  // Terminates a tracked PID, unless it is still running (e.g. the exit was for a different
+  // process that has since reused the PID and was already picked up by a container scan).
+  // Returns false if the PID is still running.
+  auto terminate_pid = [&](uint32_t pid, bool check_running) {
+    auto iter = upids_by_pid.find(pid);
+    if (iter == upids_by_pid.end()) {
+      return true;
+    }
+    const UPID upid = iter->second;
+    if (check_running) {
+      StatusOr<int64_t> start_time = proc_parser.GetPIDStartTimeTicks(pid);
+      if (start_time.ok() && start_time.ValueOrDie() == upid.start_ts()) {
+        return false;
+      }
     }
-    const PodInfo* pod_info = k8s_md_state->PodInfoByID(pod_id);
 
-    if (pod_info->stop_time_ns() != 0) {
-      VLOG(1) << absl::Substitute("Found a running container in a deleted pod [cid=$0, pod_id=$1]",
-                                  cid, pod_id);
-      cinfo->set_stop_time_ns(pod_info->stop_time_ns());
+    const PIDInfo* pid_info = md->GetPIDByUPID(upid);
+    if (pid_info != nullptr) {
+      ContainerInfo* cinfo = k8s_md_state->MutableContainerInfoByID(pid_info->cid());
+      if (cinfo != nullptr) {
+        cinfo->mutable_active_upids()->erase(upid);
+      }
+    }
+    md->MarkUPIDAsStopped(upid, ts);
+    pid_updates->enqueue(std::make_unique<PIDTerminatedEvent>(upid, ts));
+    upids_by_pid.erase(iter);
+    return true;
+  };
+
+  // An exited PID can still be running if its thread group leader exited before the other
+  // threads, whose exits are not reported, or if its parent has not reaped it yet. Either way,
+  // it is checked again on the next update, until it is gone.
+  pending_exits->insert(deltas.exited.begin(), deltas.exited.end());
+  for (auto iter = pending_exits->begin(); iter != pending_exits->end();) {
+    if (terminate_pid(*iter, /* check_running */ true)) {
+      pending_exits->erase(iter++);
+    } else {
+      ++iter;
+    }
+  }
+
+  for (uint32_t pid : deltas.started) {
+    StatusOr<UPID> upid_status = InitUPID(proc_parser, md->asid(), pid);
+    if (!upid_status.ok()) {
+      // Exited before we got to it.
       continue;
     }
+    const UPID upid = upid_status.ValueOrDie();
 
-    absl::flat_hash_set<uint32_t> cgroups_active_pids;
-    Status s = md_reader->ReadPIDs(pod_info->qos_class(), pod_id, cid, cinfo->type(),
-                                   &cgroups_active_pids);
-    if (!s.ok()) {
-      // Container probably died, we will eventually get a message from MDS and everything in that
-      // container will be marked dead.
-      LOG(WARNING) << absl::Substitute("Failed to read PID info for pod=$0, cid=$1 [msg=$2]",
-                                       pod_id, cid, s.msg());
-
-      // Don't wait for MDS to send the container death information; set the stop time right away.
-      // This is so we stop trying to read stats for this non-existent container.
-      // NOTE: Currently, MDS sends pods that do no belong to this Agent, so this is actually
-      // required to avoid repeatedly printing out the warning message above.
-      if (error::IsNotFound(s)) {
-        cinfo->set_stop_time_ns(ts);
-        for (const auto& upid : cinfo->active_upids()) {
-          md->MarkUPIDAsStopped(upid, ts);
-        }
-        cinfo->mutable_active_upids()->clear();
+    auto iter = upids_by_pid.find(pid);
+    if (iter != upids_by_pid.end()) {
+      if (iter->second == upid) {
+        // Already tracked, e.g. an exec, or a process found by a container scan.
+        continue;
       }
-      continue;
+      // The PID was reused, and the exit of the previous process was missed.
+      terminate_pid(pid, /* check_running */ false);
+      pending_exits->erase(pid);
     }
 
-    ProcessContainerPIDUpdates(cid, ts, proc_parser, md, cinfo->mutable_active_upids(),
-                               &cgroups_active_pids, pid_updates);
+    const ContainerInfo* cinfo = FindContainerForPID(pid, proc_parser, *md, *scanned_containers);
+    if (cinfo == nullptr) {
+      // Not in a container we know about, e.g. a host process.
+      continue;
+    }
+    const CID cid = cinfo->cid();
+    AddContainerUPID(cid, upid, proc_parser, md,
+                     k8s_md_state->MutableContainerInfoByID(cid)->mutable_active_upids(),
+                     pid_updates);
+    upids_by_pid[pid] = upid;
   }
 
   return Status::OK();
@@ -30,6 +30,7 @@
 #include <absl/container/flat_hash_set.h>
 
 #include "src/common/base/base.h"
+#include "src/common/system/proc_connector.h"
 #include "src/common/system/system.h"
 #include "src/shared/k8s/metadatapb/metadata.pb.h"
 #include "src/shared/metadata/cgroup_metadata_reader.h"
@@ -128,6 +129,9 @@ class AgentMetadataStateManagerImpl : public AgentMetadataStateManager {
     md_reader_ = std::make_unique<CGroupMetadataReader>(config);
     agent_metadata_state_ = std::make_shared<AgentMetadataState>(hostname, asid, pid, agent_id,
                                                                  pod_name, vizier_id, vizier_name);
+    if (collects_data_) {
+      InitProcConnector();
+    }
   }
 
   AgentMetadataFilter* metadata_filter() const override { return metadata_filter_; }
@@ -158,9 +162,33 @@ class AgentMetadataStateManagerImpl : public AgentMetadataStateManager {
    */
   size_t NumPIDUpdates() const;
 
+  /**
+   * Subscribes to process lifecycle events, so that PID updates can be applied incrementally.
+   * On failure, PID updates fall back to polling every container's cgroup.
+   */
+  void InitProcConnector();
+
+  /**
+   * Updates the PIDs in the state, either from the process events received since the last update,
+   * or from a full scan of the containers' cgroups. A full scan is used on the first update,
+   * periodically to reconcile any missed events, and whenever events were dropped.
+   */
+  Status UpdatePIDs(int64_t ts, AgentMetadataState* state);
+
   std::string pod_name_;
   system::ProcParser proc_parser_;
 
+  // Source of process lifecycle events. Null if events are unavailable, in which case
+  // PIDs are discovered by polling cgroups on every update.
+  std::unique_ptr<system::ProcConnector> proc_connector_;
+  system::ProcEventDeltas proc_event_deltas_;
+  // The live containers whose PIDs have been fully scanned, and are kept up-to-date by events.
+  absl::flat_hash_set<CID> scanned_containers_;
+  // PIDs whose exit was reported while they were still running (see ProcessPIDEvents()).
+  absl::flat_hash_set<uint32_t> pending_exits_;
+  // Number of updates since the last full PID scan; negative if there has not been one yet.
+  int epochs_since_pid_scan_ = -1;
+
   std::unique_ptr<CGroupMetadataReader> md_reader_;
   // The metadata state stored here is immutable so that we can easily share a read only
   // copy across threads. The pointer is atomically updated in PerformMetadataStateUpdate(),
@@ -194,10 +222,27 @@ Status ApplyK8sUpdates(
 void RemoveDeadPods(int64_t ts, AgentMetadataState* md, CGroupMetadataReader* md_reader);
 
 /**
- * Processes PID updates.
+ * Processes PID updates by reading the PIDs of every live container from cgroups.
+ * If scanned_containers is provided, the containers that were successfully scanned are added to it.
  */
 Status ProcessPIDUpdates(
     int64_t ts, const system::ProcParser& proc_parser, AgentMetadataState*, CGroupMetadataReader*,
+    moodycamel::BlockingConcurrentQueue<std::unique_ptr<PIDStatusEvent>>* pid_updates,
+    absl::flat_hash_set<CID>* scanned_containers = nullptr);
+
+/**
+ * Processes PID updates incrementally from process lifecycle events.
+ * Only live containers that are not yet in scanned_containers have their cgroups read;
+ * containers that are no longer live are removed from scanned_containers.
+ * Started PIDs are attributed to a container through /proc/<pid>/cgroup.
+ * Exited PIDs that /proc still shows running are kept in pending_exits and checked again on
+ * later updates: when a thread group leader exits before its other threads, its exit is the
+ * only one reported for the process.
+ */
+Status ProcessPIDEvents(
+    int64_t ts, const system::ProcParser& proc_parser, AgentMetadataState*, CGroupMetadataReader*,
+    const system::ProcEventDeltas& deltas, absl::flat_hash_set<CID>* scanned_containers,
+    absl::flat_hash_set<uint32_t>* pending_exits,
     moodycamel::BlockingConcurrentQueue<std::unique_ptr<PIDStatusEvent>>* pid_updates);
 
 /**
@@ -33,6 +33,7 @@ using ResourceUpdate = px::shared::k8s::metadatapb::ResourceUpdate;
 
 using ::testing::_;
 using ::testing::ElementsAre;
+using ::testing::IsEmpty;
 using ::testing::Pair;
 using ::testing::Return;
 using ::testing::ReturnArg;
@@ -280,6 +281,75 @@ TEST_F(AgentMetadataStateTest, pid_created) {
   EXPECT_THAT(pids_started, UnorderedElementsAre(PIDStartedEvent{pid1}, PIDStartedEvent{pid2}));
 }
 
+TEST_F(AgentMetadataStateTest, pid_events) {
+  moodycamel::BlockingConcurrentQueue<std::unique_ptr<ResourceUpdate>> updates;
+  GenerateTestUpdateEvents(&updates);
+
+  EXPECT_OK(ApplyK8sUpdates(2000 /*ts*/, &metadata_state_, &md_filter_, &updates));
+
+  moodycamel::BlockingConcurrentQueue<std::unique_ptr<PIDStatusEvent>> events;
+  FakePIDData md_reader;
+
+  // The initial scan finds PIDs 100 and 200.
+  std::filesystem::path proc_path = testing::BazelRunfilePath("src/shared/metadata/testdata/proc");
+  system::ProcParser proc_parser(proc_path.string());
+  absl::flat_hash_set<CID> scanned_containers;
+  EXPECT_OK(ProcessPIDUpdates(1000, proc_parser, &metadata_state_, &md_reader, &events,
+                              &scanned_containers));
+  EXPECT_THAT(scanned_containers, UnorderedElementsAre("container_id1"));
+  EXPECT_EQ(2, events.size_approx());
+
+  std::unique_ptr<PIDStatusEvent> event;
+  while (events.try_dequeue(event)) {
+  }
+
+  // Afterwards, PID 200 exits, 100 execs, 300 starts in the container, and 400 on the host.
+  // PID 100 also reports an exit, as its thread group leader exits before its other threads.
+  std::filesystem::path proc_events_path =
+      testing::BazelRunfilePath("src/shared/metadata/testdata/proc_events");
+  system::ProcParser proc_events_parser(proc_events_path.string());
+  system::ProcEventDeltas deltas;
+  deltas.started = {100, 300, 400};
+  deltas.exited = {100, 200};
+  absl::flat_hash_set<uint32_t> pending_exits;
+  EXPECT_OK(ProcessPIDEvents(3000, proc_events_parser, &metadata_state_, &md_reader, deltas,
+                             &scanned_containers, &pending_exits, &events));
+  EXPECT_THAT(pending_exits, UnorderedElementsAre(100));
+
+  std::vector<PIDStartedEvent> pids_started;
+  std::vector<UPID> pids_terminated;
+  while (events.try_dequeue(event)) {
+    if (event->type == PIDStatusEventType::kStarted) {
+      pids_started.emplace_back(*static_cast<PIDStartedEvent*>(event.get()));
+    } else {
+      pids_terminated.push_back(static_cast<PIDTerminatedEvent*>(event.get())->upid);
+    }
+  }
+
+  PIDInfo pid3(UPID(kASID, 300 /*pid*/, 3000 /*ts*/), "", "cmdline300", "container_id1");
+  EXPECT_THAT(pids_started, ElementsAre(PIDStartedEvent{pid3}));
+  EXPECT_THAT(pids_terminated, ElementsAre(UPID(kASID, 200 /*pid*/, 2000 /*ts*/)));
+
+  EXPECT_THAT(metadata_state_.upids(),
+              UnorderedElementsAre(UPID(kASID, 100, 1000), UPID(kASID, 300, 3000)));
+  const ContainerInfo* cinfo =
+      metadata_state_.k8s_metadata_state()->ContainerInfoByID("container_id1");
+  ASSERT_NE(nullptr, cinfo);
+  EXPECT_THAT(cinfo->active_upids(),
+              UnorderedElementsAre(UPID(kASID, 100, 1000), UPID(kASID, 300, 3000)));
+
+  // The last thread of PID 100 exits without an event; the pending exit is rechecked.
+  system::ProcParser no_procs_parser("/nonexistent");
+  EXPECT_OK(ProcessPIDEvents(4000, no_procs_parser, &metadata_state_, &md_reader,
+                             system::ProcEventDeltas(), &scanned_containers, &pending_exits,
+                             &events));
+  EXPECT_THAT(pending_exits, IsEmpty());
+  ASSERT_TRUE(events.try_dequeue(event));
+  ASSERT_EQ(event->type, PIDStatusEventType::kTerminated);
+  EXPECT_EQ(static_cast<PIDTerminatedEvent*>(event.get())->upid, UPID(kASID, 100, 1000));
+  EXPECT_THAT(metadata_state_.upids(), UnorderedElementsAre(UPID(kASID, 300, 3000)));
+}
+
 TEST_F(AgentMetadataStateTest, insert_into_filter) {
   moodycamel::BlockingConcurrentQueue<std::unique_ptr<ResourceUpdate>> updates;
   GenerateTestUpdateEvents(&updates);
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/shared/pprof/pprof.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <absl/strings/str_join.h>
+#include <absl/strings/str_split.h>
+
+#include "src/common/zlib/zlib_wrapper.h"
+
+namespace px {
+namespace pprof {
+
+namespace {
+
+constexpr char kSeparator = ';';
+
+// Assigns indexes in the string table of a profile.
+class StringTable {
+ public:
+  explicit StringTable(ProfilePB* profile) : profile_(profile) { Index(""); }
+
+  int64_t Index(std::string_view str) {
+    auto [iter, inserted] = indexes_.try_emplace(str, profile_->string_table_size());
+    if (inserted) {
+      profile_->add_string_table(std::string(str));
+    }
+    return iter->second;
+  }
+
+ private:
+  ProfilePB* profile_;
+  absl::flat_hash_map<std::string, int64_t> indexes_;
+};
+
+}  // namespace
+
+void ProfileBuilder::AddFoldedStackTrace(std::string_view stack_trace, int64_t count) {
+  histo_[stack_trace] += count;
+}
+
+void ProfileBuilder::AddTime(int64_t time_ns) {
+  min_time_ns_ = std::min(min_time_ns_, time_ns);
+  max_time_ns_ = std::max(max_time_ns_, time_ns);
+}
+
+Status ProfileBuilder::AddProfile(const ProfilePB& profile) {
+  const auto& strings = profile.string_table();
+  auto get_string = [&strings](int64_t idx) -> StatusOr<std::string_view> {
+    if (idx < 0 || idx >= strings.size()) {
+      return error::InvalidArgument("String index $0 is out of range.", idx);
+    }
+    return std::string_view(strings[idx]);
+  };
+
+  absl::flat_hash_map<uint64_t, std::string_view> function_names;
+  for (const auto& function : profile.function()) {
+    PL_ASSIGN_OR_RETURN(function_names[function.id()], get_string(function.name()));
+  }
+
+  // Location ID => frames of the location, from the caller to inlined callees.
+  absl::flat_hash_map<uint64_t, std::vector<std::string_view>> location_frames;
+  for (const auto& location : profile.location()) {
+    std::vector<std::string_view>& frames = location_frames[location.id()];
+    for (auto iter = location.line().rbegin(); iter != location.line().rend(); ++iter) {
+      auto fn_iter = function_names.find(iter->function_id());
+      if (fn_iter == function_names.end()) {
+        return error::InvalidArgument("Unknown function ID $0.", iter->function_id());
+      }
+      frames.push_back(fn_iter->second);
+    }
+  }
+
+  std::vector<std::string_view> frames;
+  for (const auto& sample : profile.sample()) {
+    if (sample.value_size() != 1) {
+      return error::InvalidArgument("Expected 1 value per sample, got $0.", sample.value_size());
+    }
+    frames.clear();
+    // Location IDs start at the leaf.
+    for (auto iter = sample.location_id().rbegin(); iter != sample.location_id().rend(); ++iter) {
+      auto loc_iter = location_frames.find(*iter);
+      if (loc_iter == location_frames.end()) {
+        return error::InvalidArgument("Unknown location ID $0.", *iter);
+      }
+      frames.insert(frames.end(), loc_iter->second.begin(), loc_iter->second.end());
+    }
+    AddFoldedStackTrace(absl::StrJoin(frames, std::string_view(&kSeparator, 1)),
+                        sample.value(0));
+  }
+
+  if (profile.time_nanos() != 0) {
+    AddTime(profile.time_nanos());
+    AddTime(profile.time_nanos() + profile.duration_nanos());
+  }
+  return Status::OK();
+}
+
+void ProfileBuilder::Merge(const ProfileBuilder& other) {
+  for (const auto& [stack_trace, count] : other.histo_) {
+    histo_[stack_trace] += count;
+  }
+  min_time_ns_ = std::min(min_time_ns_, other.min_time_ns_);
+  max_time_ns_ = std::max(max_time_ns_, other.max_time_ns_);
+}
+
+ProfilePB ProfileBuilder::Build() const {
+  ProfilePB profile;
+  StringTable strings(&profile);
+
+  auto* sample_type = profile.add_sample_type();
+  sample_type->set_type(strings.Index("samples"));
+  sample_type->set_unit(strings.Index("count"));
+
+  if (min_time_ns_ <= max_time_ns_) {
+    profile.set_time_nanos(min_time_ns_);
+    profile.set_duration_nanos(max_time_ns_ - min_time_ns_);
+  }
+
+  std::vector<const std::pair<const std::string, int64_t>*> entries;
+  entries.reserve(histo_.size());
+  for (const auto& entry : histo_) {
+    entries.push_back(&entry);
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const auto* a, const auto* b) { return a->first < b->first; });
+
+  // Frame => ID of its Function and Location, which are the same, as each location holds
+  // exactly one function.
+  absl::flat_hash_map<std::string_view, uint64_t> frame_ids;
+  std::vector<uint64_t> location_ids;
+  for (const auto* entry : entries) {
+    const auto& [stack_trace, count] = *entry;
+    location_ids.clear();
+    for (std::string_view frame : absl::StrSplit(stack_trace, kSeparator)) {
+      auto [iter, inserted] = frame_ids.try_emplace(frame, frame_ids.size() + 1);
+      const uint64_t id = iter->second;
+      if (inserted) {
+        auto* function = profile.add_function();
+        function->set_id(id);
+        function->set_name(strings.Index(frame));
+        auto* location = profile.add_location();
+        location->set_id(id);
+        location->add_line()->set_function_id(id);
+      }
+      location_ids.push_back(id);
+    }
+
+    auto* sample = profile.add_sample();
+    for (auto iter = location_ids.rbegin(); iter != location_ids.rend(); ++iter) {
+      sample->add_location_id(*iter);
+    }
+    sample->add_value(count);
+  }
+
+  return profile;
+}
+
+StatusOr<std::string> SerializeGzipped(const ProfilePB& profile) {
+  return zlib::Deflate(profile.SerializeAsString());
+}
+
+}  // namespace pprof
+}  // namespace px
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include <absl/container/flat_hash_map.h>
+
+#include "src/common/base/base.h"
+#include "src/shared/pprofpb/profile.pb.h"
+
+namespace px {
+namespace pprof {
+
+using ProfilePB = shared::pprofpb::Profile;
+
+/**
+ * ProfileBuilder aggregates folded stack traces (frames separated by semicolons, ordered from
+ * the root of the stack) into a pprof profile. Each distinct frame is stored as a single
+ * Function and Location, so the profile is usually much smaller than the folded strings.
+ */
+class ProfileBuilder {
+ public:
+  /**
+   * Adds count samples of the stack trace.
+   */
+  void AddFoldedStackTrace(std::string_view stack_trace, int64_t count);
+
+  /**
+   * Extends the time range covered by the profile to include time_ns.
+   */
+  void AddTime(int64_t time_ns);
+
+  /**
+   * Adds the samples and time range of a profile, such as one produced by Build().
+   * Profiles are expected to have a single sample value, the sample count.
+   */
+  Status AddProfile(const ProfilePB& profile);
+
+  /**
+   * Adds the samples and time range aggregated by another builder.
+   */
+  void Merge(const ProfileBuilder& other);
+
+  /**
+   * Builds the profile. Samples are sorted by stack trace, so that the output is deterministic.
+   */
+  ProfilePB Build() const;
+
+  size_t num_stack_traces() const { return histo_.size(); }
+
+ private:
+  // Folded stack trace => sample count.
+  absl::flat_hash_map<std::string, int64_t> histo_;
+
+  int64_t min_time_ns_ = std::numeric_limits<int64_t>::max();
+  int64_t max_time_ns_ = std::numeric_limits<int64_t>::min();
+};
+
+/**
+ * Serializes a profile in the gzip-compressed form expected by pprof.
+ */
+StatusOr<std::string> SerializeGzipped(const ProfilePB& profile);
+
+}  // namespace pprof
+}  // namespace px
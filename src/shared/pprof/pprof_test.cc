@@ -0,0 +1,124 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/shared/pprof/pprof.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/common/testing/testing.h"
+#include "src/common/zlib/zlib_wrapper.h"
+
+namespace px {
+namespace pprof {
+
+// Returns the frames of each sample, leaf first, with the sample count.
+std::vector<std::pair<std::vector<std::string>, int64_t>> Samples(const ProfilePB& profile) {
+  absl::flat_hash_map<uint64_t, std::string> names;
+  for (const auto& function : profile.function()) {
+    names[function.id()] = profile.string_table(function.name());
+  }
+  absl::flat_hash_map<uint64_t, std::string> location_names;
+  for (const auto& location : profile.location()) {
+    location_names[location.id()] = names[location.line(0).function_id()];
+  }
+
+  std::vector<std::pair<std::vector<std::string>, int64_t>> samples;
+  for (const auto& sample : profile.sample()) {
+    std::vector<std::string> frames;
+    for (uint64_t id : sample.location_id()) {
+      frames.push_back(location_names[id]);
+    }
+    samples.emplace_back(std::move(frames), sample.value(0));
+  }
+  return samples;
+}
+
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+TEST(ProfileBuilderTest, DeduplicatesFrames) {
+  ProfileBuilder builder;
+  builder.AddFoldedStackTrace("main;foo;bar", 2);
+  builder.AddFoldedStackTrace("main;foo;baz", 1);
+  builder.AddFoldedStackTrace("main;foo;bar", 3);
+  builder.AddTime(100);
+  builder.AddTime(400);
+
+  const ProfilePB profile = builder.Build();
+  EXPECT_EQ(profile.string_table(0), "");
+  EXPECT_EQ(profile.function_size(), 4);
+  EXPECT_EQ(profile.location_size(), 4);
+  EXPECT_EQ(profile.time_nanos(), 100);
+  EXPECT_EQ(profile.duration_nanos(), 300);
+  EXPECT_THAT(Samples(profile),
+              ElementsAre(Pair(ElementsAre("bar", "foo", "main"), 5),
+                          Pair(ElementsAre("baz", "foo", "main"), 1)));
+}
+
+TEST(ProfileBuilderTest, AddProfileRoundTrip) {
+  ProfileBuilder builder;
+  builder.AddFoldedStackTrace("main;foo;bar", 2);
+  builder.AddFoldedStackTrace("main;qux", 1);
+  builder.AddTime(100);
+  builder.AddTime(200);
+
+  ProfileBuilder other;
+  other.AddFoldedStackTrace("main;qux", 4);
+  other.AddTime(300);
+  ASSERT_OK(other.AddProfile(builder.Build()));
+
+  EXPECT_EQ(other.num_stack_traces(), 2);
+  const ProfilePB profile = other.Build();
+  EXPECT_EQ(profile.time_nanos(), 100);
+  EXPECT_EQ(profile.duration_nanos(), 200);
+  EXPECT_THAT(Samples(profile), ElementsAre(Pair(ElementsAre("bar", "foo", "main"), 2),
+                                            Pair(ElementsAre("qux", "main"), 5)));
+
+  ProfilePB bad_profile = profile;
+  bad_profile.mutable_sample(0)->add_location_id(1000);
+  EXPECT_NOT_OK(other.AddProfile(bad_profile));
+}
+
+TEST(ProfileBuilderTest, Merge) {
+  ProfileBuilder a;
+  a.AddFoldedStackTrace("main;foo", 1);
+  ProfileBuilder b;
+  b.AddFoldedStackTrace("main;foo", 2);
+  b.AddFoldedStackTrace("main;bar", 1);
+
+  a.Merge(b);
+  EXPECT_THAT(Samples(a.Build()), ElementsAre(Pair(ElementsAre("bar", "main"), 1),
+                                              Pair(ElementsAre("foo", "main"), 3)));
+}
+
+TEST(ProfileBuilderTest, SerializeGzipped) {
+  ProfileBuilder builder;
+  builder.AddFoldedStackTrace("main;foo", 1);
+  const ProfilePB profile = builder.Build();
+
+  ASSERT_OK_AND_ASSIGN(std::string gzipped, SerializeGzipped(profile));
+  ASSERT_OK_AND_ASSIGN(std::string serialized, zlib::Inflate(gzipped));
+  ProfilePB parsed;
+  ASSERT_TRUE(parsed.ParseFromString(serialized));
+  EXPECT_THAT(Samples(parsed), ElementsAre(Pair(ElementsAre("foo", "main"), 1)));
+}
+
+}  // namespace pprof
+}  // namespace px
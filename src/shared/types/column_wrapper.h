@@ -63,10 +63,12 @@ class ColumnWrapper {
   virtual const BaseValueType* UnsafeRawData() const = 0;
   virtual DataType data_type() const = 0;
   virtual size_t Size() const = 0;
+  virtual size_t Capacity() const = 0;
   virtual bool Empty() const = 0;
   virtual int64_t Bytes() const = 0;
 
   virtual void Reserve(size_t size) = 0;
+  virtual void Resize(size_t size) = 0;
   virtual void Clear() = 0;
   virtual void ShrinkToFit() = 0;
   virtual std::shared_ptr<arrow::Array> ConvertToArrow(arrow::MemoryPool* mem_pool) = 0;
@@ -119,6 +121,7 @@ class ColumnWrapperTmpl : public ColumnWrapper {
   DataType data_type() const override { return ValueTypeTraits<T>::data_type; }
 
   size_t Size() const override { return data_.size(); }
+  size_t Capacity() const override { return data_.capacity(); }
   bool Empty() const override { return data_.empty(); }
 
   std::shared_ptr<arrow::Array> ConvertToArrow(arrow::MemoryPool* mem_pool) override {
@@ -135,7 +138,7 @@ class ColumnWrapperTmpl : public ColumnWrapper {
 
   void ShrinkToFit() override { data_.shrink_to_fit(); }
 
-  void Resize(size_t size) { data_.resize(size); }
+  void Resize(size_t size) override { data_.resize(size); }
 
   void Clear() override { data_.clear(); }
 
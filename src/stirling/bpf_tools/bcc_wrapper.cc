@@ -20,16 +20,26 @@
 
 #include <linux/perf_event.h>
 #include <sys/mount.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>
 
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 #include <magic_enum.hpp>
 
 #include "src/common/base/base.h"
 #include "src/common/fs/fs_wrapper.h"
+#include "src/common/perf/elapsed_timer.h"
 #include "src/common/system/config.h"
 #include "src/stirling/bpf_tools/task_struct_resolver.h"
+#include "src/stirling/bpf_tools/uprobe_metrics.h"
+#include "src/stirling/obj_tools/elf_reader.h"
 #include "src/stirling/utils/linux_headers.h"
 
 namespace px {
@@ -48,6 +58,16 @@ namespace bpf_tools {
 // used for bookkeeping, which translate to equal number of struct kretprobe in memory.
 constexpr int kKprobeMaxActive = 512;
 
+namespace {
+
+// The symbol to hand to BCC. BCC resolves the symbol whenever one is given, so uprobes whose
+// address is known (see ResolveUProbeSymbols()) are attached and detached by address only.
+std::string BCCSymbol(const UProbeSpec& probe) {
+  return probe.address == 0 ? probe.symbol : std::string();
+}
+
+}  // namespace
+
 // BCC requires debugfs to be mounted to deploy BPF programs.
 // Most kernels already have this mounted, but some do not.
 // See https://github.com/iovisor/bcc/blob/master/INSTALL.md.
@@ -205,12 +225,23 @@ Status BCCWrapper::AttachUProbe(const UProbeSpec& probe) {
   VLOG(1) << "Deploying uprobe: " << probe.ToString();
   // TODO(oazizi): Natively support this attach type in BCCWrapper.
   DCHECK(probe.attach_type != BPFProbeAttachType::kReturnInsts);
-  DCHECK((probe.symbol.empty() && probe.address != 0) ||
-         (!probe.symbol.empty() && probe.address == 0))
-      << "Exactly one of 'symbol' and 'address' must be specified.";
-  PL_RETURN_IF_ERROR(bpf_.attach_uprobe(
-      probe.binary_path, probe.symbol, std::string(probe.probe_fn), probe.address,
+  DCHECK(!probe.symbol.empty() || probe.address != 0)
+      << "One of 'symbol' and 'address' must be specified.";
+
+  UProbeMetrics& metrics = UProbeMetrics::Get();
+  ElapsedTimer timer;
+  timer.Start();
+  Status s = StatusAdapter(bpf_.attach_uprobe(
+      probe.binary_path, BCCSymbol(probe), std::string(probe.probe_fn), probe.address,
       static_cast<bpf_probe_attach_type>(probe.attach_type), probe.pid));
+  timer.Stop();
+  metrics.attach_time_us.Increment(timer.ElapsedTime_us());
+  if (!s.ok()) {
+    metrics.attach_failures.Increment();
+    return s;
+  }
+  metrics.attached.Increment();
+
   uprobes_.push_back(probe);
   ++num_attached_uprobes_;
   return Status::OK();
@@ -231,6 +262,19 @@ Status BCCWrapper::AttachSamplingProbe(const SamplingProbeSpec& probe) {
   return AttachPerfEvent(perf_event_spec);
 }
 
+Status BCCWrapper::DetachSamplingProbe(const SamplingProbeSpec& probe) {
+  auto iter = std::find_if(perf_events_.begin(), perf_events_.end(), [&probe](const auto& p) {
+    return p.type == PERF_TYPE_SOFTWARE && p.config == PERF_COUNT_SW_CPU_CLOCK &&
+           p.probe_fn == probe.probe_fn;
+  });
+  if (iter == perf_events_.end()) {
+    return error::NotFound("Sampling probe $0 is not attached.", probe.probe_fn);
+  }
+  PL_RETURN_IF_ERROR(DetachPerfEvent(*iter));
+  perf_events_.erase(iter);
+  return Status::OK();
+}
+
 Status BCCWrapper::AttachKProbes(const ArrayView<KProbeSpec>& probes) {
   for (const KProbeSpec& p : probes) {
     PL_RETURN_IF_ERROR(AttachKProbe(p));
@@ -245,8 +289,53 @@ Status BCCWrapper::AttachTracepoints(const ArrayView<TracepointSpec>& probes) {
   return Status::OK();
 }
 
-Status BCCWrapper::AttachUProbes(const ArrayView<UProbeSpec>& probes) {
+std::vector<UProbeSpec> BCCWrapper::ResolveUProbeSymbols(const ArrayView<UProbeSpec>& probes) {
+  absl::flat_hash_map<std::string, absl::flat_hash_set<std::string>> binary_symbols;
+  for (const UProbeSpec& p : probes) {
+    if (!p.symbol.empty()) {
+      binary_symbols[p.binary_path.string()].insert(p.symbol);
+    }
+  }
+
+  absl::flat_hash_map<std::string, absl::flat_hash_map<std::string, int64_t>> binary_symbol_addrs;
+  for (const auto& [binary, symbols] : binary_symbols) {
+    // A single lookup is no cheaper here than in BCC.
+    if (symbols.size() < 2) {
+      continue;
+    }
+    auto elf_reader_or = obj_tools::ElfReader::Create(binary);
+    if (!elf_reader_or.ok()) {
+      continue;
+    }
+    auto symbol_addrs_or = elf_reader_or.ValueOrDie()->SymbolAddresses(symbols);
+    if (symbol_addrs_or.ok()) {
+      binary_symbol_addrs[binary] = symbol_addrs_or.ConsumeValueOrDie();
+    }
+  }
+
+  std::vector<UProbeSpec> resolved;
+  resolved.reserve(probes.size());
   for (const UProbeSpec& p : probes) {
+    resolved.push_back(p);
+  }
+  for (UProbeSpec& p : resolved) {
+    auto binary_iter = binary_symbol_addrs.find(p.binary_path.string());
+    if (p.symbol.empty() || binary_iter == binary_symbol_addrs.end()) {
+      continue;
+    }
+    auto addr_iter = binary_iter->second.find(p.symbol);
+    // BCC treats address 0 as "not specified", so such symbols are also left for BCC.
+    if (addr_iter == binary_iter->second.end() || addr_iter->second == 0) {
+      continue;
+    }
+    // The symbol is kept for logging; the address takes precedence when attaching.
+    p.address = static_cast<uint64_t>(addr_iter->second);
+  }
+  return resolved;
+}
+
+Status BCCWrapper::AttachUProbes(const ArrayView<UProbeSpec>& probes) {
+  for (const UProbeSpec& p : ResolveUProbeSymbols(probes)) {
     PL_RETURN_IF_ERROR(AttachUProbe(p));
   }
   return Status::OK();
@@ -281,6 +370,61 @@ Status BCCWrapper::AttachXDP(const std::string& dev_name, const std::string& fn_
   return Status::OK();
 }
 
+Status BCCWrapper::AttachIterator(const std::string& fn_name) {
+  VLOG(1) << absl::Substitute("Attaching iterator: $0", fn_name);
+  if (iterator_link_fds_.count(fn_name) > 0) {
+    return error::AlreadyExists("Iterator $0 is already attached.", fn_name);
+  }
+
+  int prog_fd = -1;
+  PL_RETURN_IF_ERROR(bpf_.load_func(fn_name, BPF_PROG_TYPE_TRACING, prog_fd));
+
+  int link_fd = bcc_iter_attach(prog_fd, /*link_info*/ nullptr, /*link_info_len*/ 0);
+  if (link_fd < 0) {
+    bpf_.unload_func(fn_name);
+    return error::Internal("Unable to attach iterator $0, errorno: $1", fn_name, link_fd);
+  }
+
+  iterator_link_fds_[fn_name] = link_fd;
+  ++num_attached_iterators_;
+  return Status::OK();
+}
+
+Status BCCWrapper::ReadIterator(const std::string& fn_name, std::string* buf) {
+  DCHECK(buf != nullptr);
+  auto it = iterator_link_fds_.find(fn_name);
+  if (it == iterator_link_fds_.end()) {
+    return error::NotFound("Iterator $0 is not attached.", fn_name);
+  }
+
+  // Every iterator file descriptor runs one pass over the kernel objects.
+  int iter_fd = bcc_iter_create(it->second);
+  if (iter_fd < 0) {
+    return error::Internal("Unable to create iterator $0, errorno: $1", fn_name, iter_fd);
+  }
+  DEFER(close(iter_fd););
+
+  constexpr size_t kReadChunkSize = 64 * 1024;
+  buf->clear();
+  while (true) {
+    const size_t offset = buf->size();
+    buf->resize(offset + kReadChunkSize);
+    ssize_t n = read(iter_fd, buf->data() + offset, kReadChunkSize);
+    if (n < 0 && errno == EINTR) {
+      buf->resize(offset);
+      continue;
+    }
+    if (n < 0) {
+      buf->resize(offset);
+      return error::Internal("Failed to read iterator $0: $1", fn_name, std::strerror(errno));
+    }
+    buf->resize(offset + n);
+    if (n == 0) {
+      return Status::OK();
+    }
+  }
+}
+
 // TODO(PL-1294): This can fail in rare cases. See the cited issue. Find the root cause.
 Status BCCWrapper::DetachKProbe(const KProbeSpec& probe) {
   VLOG(1) << "Detaching kprobe: " << probe.ToString();
@@ -293,11 +437,18 @@ Status BCCWrapper::DetachKProbe(const KProbeSpec& probe) {
 Status BCCWrapper::DetachUProbe(const UProbeSpec& probe) {
   VLOG(1) << "Detaching uprobe " << probe.ToString();
 
+  UProbeMetrics& metrics = UProbeMetrics::Get();
   if (fs::Exists(probe.binary_path)) {
-    PL_RETURN_IF_ERROR(bpf_.detach_uprobe(probe.binary_path, probe.symbol, probe.address,
-                                          static_cast<bpf_probe_attach_type>(probe.attach_type),
-                                          probe.pid));
+    ElapsedTimer timer;
+    timer.Start();
+    Status s = StatusAdapter(bpf_.detach_uprobe(
+        probe.binary_path, BCCSymbol(probe), probe.address,
+        static_cast<bpf_probe_attach_type>(probe.attach_type), probe.pid));
+    timer.Stop();
+    metrics.detach_time_us.Increment(timer.ElapsedTime_us());
+    PL_RETURN_IF_ERROR(s);
   }
+  metrics.detached.Increment();
   --num_attached_uprobes_;
   return Status::OK();
 }
@@ -409,6 +560,25 @@ void BCCWrapper::DetachPerfEvents() {
   perf_events_.clear();
 }
 
+Status BCCWrapper::DetachIterator(const std::string& fn_name) {
+  VLOG(1) << absl::Substitute("Detaching iterator: $0", fn_name);
+  auto it = iterator_link_fds_.find(fn_name);
+  if (it == iterator_link_fds_.end()) {
+    return error::NotFound("Iterator $0 is not attached.", fn_name);
+  }
+  close(it->second);
+  iterator_link_fds_.erase(it);
+  --num_attached_iterators_;
+  return StatusAdapter(bpf_.unload_func(fn_name));
+}
+
+void BCCWrapper::DetachIterators() {
+  while (!iterator_link_fds_.empty()) {
+    auto res = DetachIterator(iterator_link_fds_.begin()->first);
+    LOG_IF(ERROR, !res.ok()) << res.msg();
+  }
+}
+
 std::string BCCWrapper::GetKProbeTargetName(const KProbeSpec& probe) {
   auto target = std::string(probe.kernel_fn);
   if (probe.is_syscall) {
@@ -431,6 +601,7 @@ void BCCWrapper::PollPerfBuffers(int timeout_ms) {
 }
 
 void BCCWrapper::Close() {
+  DetachIterators();
   DetachPerfEvents();
   ClosePerfBuffers();
   DetachKProbes();
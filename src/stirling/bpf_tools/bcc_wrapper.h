@@ -106,7 +106,8 @@ struct UProbeSpec {
   // The canonical path to the binary to which this uprobe is attached.
   std::filesystem::path binary_path;
 
-  // Exactly one of symbol and address must be specified.
+  // At least one of symbol and address must be specified. If both are, the probe is attached at
+  // the address, and the symbol is only informational.
   std::string symbol;
   uint64_t address = 0;
 
@@ -286,6 +287,14 @@ class BCCWrapper {
    */
   Status AttachSamplingProbe(const SamplingProbeSpec& probe);
 
+  /**
+   * Detach a sampling probe attached with AttachSamplingProbe(), e.g. to re-attach it with a
+   * different sampling period.
+   * @param probe Specifications of the probe; only the bpf function is used.
+   * @return Error if the probe is not attached, or fails to detach.
+   */
+  Status DetachSamplingProbe(const SamplingProbeSpec& probe);
+
   /**
    * Open a perf buffer for reading events.
    * @param perf_buff Specifications of the perf buffer (name, callback function, etc.).
@@ -319,11 +328,21 @@ class BCCWrapper {
 
   /**
    * Convenience function that attaches multiple uprobes.
+   * Symbols are resolved with one pass over each binary's symbol table (see ResolveUProbeSymbols).
    * @param probes Vector of probes.
    * @return Error of first probe to fail to attach (remaining probe attachments are not attempted).
    */
   Status AttachUProbes(const ArrayView<UProbeSpec>& uprobes);
 
+  /**
+   * Converts symbol-based uprobes into address-based uprobes, resolving all the symbols of a
+   * binary with a single pass over its symbol table. Otherwise BCC scans the whole symbol table
+   * once per uprobe, which dominates the cost of attaching many uprobes to a large binary.
+   * Resolved uprobes keep their symbol, for logging. Uprobes whose symbols cannot be resolved are
+   * returned unchanged, and are left for BCC.
+   */
+  static std::vector<UProbeSpec> ResolveUProbeSymbols(const ArrayView<UProbeSpec>& uprobes);
+
   /**
    * Convenience function that attaches multiple uprobes.
    * @param probes Vector of probes.
@@ -336,6 +355,24 @@ class BCCWrapper {
    */
   Status AttachXDP(const std::string& dev_name, const std::string& fn_name);
 
+  /**
+   * Attaches a BPF iterator program (Linux 5.8+).
+   * @param fn_name Name of the iterator program in the BPF code. BCC derives the kernel objects to
+   *                iterate over from the name, which must be of the form bpf_iter__<target>
+   *                (e.g. bpf_iter__task).
+   * @return error if the program could not be loaded or attached.
+   */
+  Status AttachIterator(const std::string& fn_name);
+
+  /**
+   * Runs an attached BPF iterator over all of its kernel objects, and collects everything
+   * it wrote with bpf_seq_write().
+   * @param fn_name Name of the iterator program, as passed to AttachIterator().
+   * @param buf Output buffer. It is overwritten, but its capacity is reused across calls.
+   * @return error if the iterator is not attached or could not be read.
+   */
+  Status ReadIterator(const std::string& fn_name, std::string* buf);
+
   /**
    * Convenience function that opens multiple perf buffers.
    * @param probes Vector of perf buffer descriptors.
@@ -416,6 +453,7 @@ class BCCWrapper {
   static size_t num_attached_probes() { return num_attached_kprobes_ + num_attached_uprobes_; }
   static size_t num_open_perf_buffers() { return num_open_perf_buffers_; }
   static size_t num_attached_perf_events() { return num_attached_perf_events_; }
+  static size_t num_attached_iterators() { return num_attached_iterators_; }
 
  private:
   FRIEND_TEST(BCCWrapperTest, DetachUProbe);
@@ -425,6 +463,7 @@ class BCCWrapper {
   Status DetachTracepoint(const TracepointSpec& probe);
   Status ClosePerfBuffer(const PerfBufferSpec& perf_buffer);
   Status DetachPerfEvent(const PerfEventSpec& perf_event);
+  Status DetachIterator(const std::string& fn_name);
   void PollPerfBuffer(std::string_view perf_buffer_name, int timeout_ms);
 
   // Detaches all kprobes/uprobes/perf buffers/perf events that were attached by the wrapper.
@@ -434,6 +473,7 @@ class BCCWrapper {
   void DetachTracepoints();
   void ClosePerfBuffers();
   void DetachPerfEvents();
+  void DetachIterators();
 
   // Returns the name that identifies the target to attach this k-probe.
   std::string GetKProbeTargetName(const KProbeSpec& probe);
@@ -443,6 +483,8 @@ class BCCWrapper {
   std::vector<TracepointSpec> tracepoints_;
   std::vector<PerfBufferSpec> perf_buffers_;
   std::vector<PerfEventSpec> perf_events_;
+  // The bpf_link file descriptor of each attached iterator, keyed by program name.
+  std::map<std::string, int> iterator_link_fds_;
 
   std::string system_headers_include_dir_;
 
@@ -467,6 +509,7 @@ class BCCWrapper {
   inline static size_t num_attached_tracepoints_;
   inline static size_t num_open_perf_buffers_;
   inline static size_t num_attached_perf_events_;
+  inline static size_t num_attached_iterators_;
 
  private:
   // This is shared by all source connectors that uses BCCWrapper.
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/bpf_tools/uprobe_metrics.h"
+
+#include <string>
+
+namespace px {
+namespace stirling {
+namespace bpf_tools {
+
+namespace {
+prometheus::Counter& BuildUProbeCounter(prometheus::Registry* registry, const std::string& name,
+                                        const std::string& help) {
+  return prometheus::BuildCounter().Name(name).Help(help).Register(*registry).Add({});
+}
+}  // namespace
+
+UProbeMetrics::UProbeMetrics(prometheus::Registry* registry)
+    : attached(BuildUProbeCounter(registry, "uprobes_attached",
+                                  "Total number of uprobes successfully attached.")),
+      attach_failures(BuildUProbeCounter(registry, "uprobe_attach_failures",
+                                         "Total number of uprobes that failed to attach.")),
+      attach_time_us(BuildUProbeCounter(
+          registry, "uprobe_attach_time_us",
+          "Total time spent attaching uprobes (including failed attempts), in microseconds.")),
+      detached(BuildUProbeCounter(registry, "uprobes_detached",
+                                  "Total number of uprobes detached.")),
+      detach_time_us(BuildUProbeCounter(registry, "uprobe_detach_time_us",
+                                        "Total time spent detaching uprobes, in microseconds.")) {}
+
+UProbeMetrics& UProbeMetrics::Get() {
+  static UProbeMetrics metrics(&GetMetricsRegistry());
+  return metrics;
+}
+
+}  // namespace bpf_tools
+}  // namespace stirling
+}  // namespace px
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <prometheus/counter.h>
+#include <prometheus/registry.h>
+
+#include "src/common/metrics/metrics.h"
+
+namespace px {
+namespace stirling {
+namespace bpf_tools {
+
+/**
+ * Counters for the cost of attaching and detaching uprobes, which is paid in CPU time by the
+ * thread that deploys them.
+ */
+struct UProbeMetrics {
+  explicit UProbeMetrics(prometheus::Registry* registry);
+
+  prometheus::Counter& attached;
+  prometheus::Counter& attach_failures;
+  prometheus::Counter& attach_time_us;
+  prometheus::Counter& detached;
+  prometheus::Counter& detach_time_us;
+
+  static UProbeMetrics& Get();
+};
+
+}  // namespace bpf_tools
+}  // namespace stirling
+}  // namespace px
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/core/data_push_queue.h"
+
+#include <prometheus/family.h>
+
+#include <utility>
+
+#include "src/common/metrics/metrics.h"
+
+namespace px {
+namespace stirling {
+
+namespace {
+
+prometheus::Family<prometheus::Gauge>& QueueDepthFamily() {
+  static auto& family = prometheus::BuildGauge()
+                            .Name("stirling_data_push_queue_depth")
+                            .Help("Record batches, and their bytes, waiting in the queue between "
+                                  "the Stirling sources and the table store.")
+                            .Register(GetMetricsRegistry());
+  return family;
+}
+
+prometheus::Family<prometheus::Counter>& DroppedBatchesFamily() {
+  static auto& family = prometheus::BuildCounter()
+                            .Name("stirling_data_push_queue_dropped_batches")
+                            .Help("Total number of record batches of a table dropped, because "
+                                  "the queue to the table store was full.")
+                            .Register(GetMetricsRegistry());
+  return family;
+}
+
+prometheus::Family<prometheus::Counter>& DroppedRecordsFamily() {
+  static auto& family = prometheus::BuildCounter()
+                            .Name("stirling_data_push_queue_dropped_records")
+                            .Help("Total number of records of a table dropped, because the queue "
+                                  "to the table store was full.")
+                            .Register(GetMetricsRegistry());
+  return family;
+}
+
+int64_t RecordBatchBytes(const types::ColumnWrapperRecordBatch& record_batch) {
+  int64_t bytes = 0;
+  for (const auto& col : record_batch) {
+    bytes += col->Bytes();
+  }
+  return bytes;
+}
+
+size_t RecordBatchSize(const types::ColumnWrapperRecordBatch& record_batch) {
+  return record_batch.empty() ? 0 : record_batch.front()->Size();
+}
+
+}  // namespace
+
+DataPushQueue::DataPushQueue(DataPushCallback push_callback, int64_t capacity_bytes)
+    : push_callback_(std::move(push_callback)),
+      capacity_bytes_(capacity_bytes),
+      queued_bytes_gauge_(QueueDepthFamily().Add({{"unit", "bytes"}})),
+      queued_batches_gauge_(QueueDepthFamily().Add({{"unit", "batches"}})) {}
+
+DataPushQueue::~DataPushQueue() {
+  Stop();
+
+  absl::MutexLock lock(&tables_mu_);
+  for (const auto& [table_id, table] : tables_) {
+    RemoveTableMetrics(table);
+  }
+}
+
+void DataPushQueue::RegisterTable(uint32_t table_id, std::string table_name,
+                                  OverflowPolicy policy) {
+  absl::MutexLock lock(&tables_mu_);
+  TableInfo& table = tables_[table_id];
+  table.policy = policy;
+  if (table.dropped_batches == nullptr) {
+    table.dropped_batches = &DroppedBatchesFamily().Add({{"table", table_name}});
+    table.dropped_records = &DroppedRecordsFamily().Add({{"table", table_name}});
+  }
+}
+
+void DataPushQueue::UnregisterTable(uint32_t table_id) {
+  absl::MutexLock lock(&tables_mu_);
+  auto iter = tables_.find(table_id);
+  if (iter == tables_.end()) {
+    return;
+  }
+  RemoveTableMetrics(iter->second);
+  tables_.erase(iter);
+}
+
+void DataPushQueue::RemoveTableMetrics(const TableInfo& table) {
+  // Dynamic trace tables come and go, so do not leave their series behind.
+  DroppedBatchesFamily().Remove(table.dropped_batches);
+  DroppedRecordsFamily().Remove(table.dropped_records);
+}
+
+void DataPushQueue::Start() {
+  DCHECK(!thread_.joinable()) << "DataPushQueue was already started.";
+  stop_requested_ = false;
+  thread_ = std::thread(&DataPushQueue::Run, this);
+}
+
+void DataPushQueue::Stop() {
+  stop_requested_ = true;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+bool DataPushQueue::TryReserve(int64_t bytes) {
+  int64_t queued = queued_bytes_;
+  do {
+    // An empty queue accepts any record batch, so that large record batches are not always lost.
+    if (queued > 0 && queued + bytes > capacity_bytes_) {
+      return false;
+    }
+  } while (!queued_bytes_.compare_exchange_weak(queued, queued + bytes));
+  return true;
+}
+
+Status DataPushQueue::Push(uint32_t table_id, types::TabletID tablet_id,
+                           std::unique_ptr<types::ColumnWrapperRecordBatch> record_batch) {
+  const int64_t bytes = RecordBatchBytes(*record_batch);
+
+  bool reserved = TryReserve(bytes);
+  if (!reserved) {
+    TableInfo table;
+    {
+      absl::ReaderMutexLock lock(&tables_mu_);
+      auto iter = tables_.find(table_id);
+      if (iter != tables_.end()) {
+        table = iter->second;
+      }
+    }
+
+    if (table.policy == OverflowPolicy::kBlock) {
+      constexpr auto kPollPeriod = std::chrono::milliseconds{1};
+      const auto deadline = std::chrono::steady_clock::now() + kMaxBlockDuration;
+      while (!reserved && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(kPollPeriod);
+        reserved = TryReserve(bytes);
+      }
+    }
+
+    if (!reserved) {
+      ++num_dropped_batches_;
+      if (table.dropped_batches != nullptr) {
+        table.dropped_batches->Increment();
+        table.dropped_records->Increment(RecordBatchSize(*record_batch));
+      }
+      LOG_FIRST_N(WARNING, 10) << absl::Substitute(
+          "Data push queue is full [queued bytes=$0], dropping a record batch of table $1.",
+          queued_bytes_.load(), table_id);
+      return Status::OK();
+    }
+  }
+
+  queued_bytes_gauge_.Increment(bytes);
+  queued_batches_gauge_.Increment();
+  queue_.enqueue(QueuedBatch{table_id, std::move(tablet_id), std::move(record_batch), bytes});
+  return Status::OK();
+}
+
+void DataPushQueue::Write(QueuedBatch* batch) {
+  Status s = push_callback_(batch->table_id, batch->tablet_id, std::move(batch->record_batch));
+  LOG_IF(DFATAL, !s.ok()) << absl::Substitute("Failed to push data. Message = $0", s.msg());
+
+  queued_bytes_ -= batch->bytes;
+  queued_bytes_gauge_.Decrement(batch->bytes);
+  queued_batches_gauge_.Decrement();
+}
+
+void DataPushQueue::Run() {
+  constexpr auto kStopPollPeriod = std::chrono::milliseconds{100};
+
+  QueuedBatch batch;
+  while (!stop_requested_) {
+    if (queue_.wait_dequeue_timed(batch, kStopPollPeriod)) {
+      Write(&batch);
+    }
+  }
+
+  // Push whatever was queued before stopping.
+  while (queue_.try_dequeue(batch)) {
+    Write(&batch);
+  }
+}
+
+}  // namespace stirling
+}  // namespace px
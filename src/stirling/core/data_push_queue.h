@@ -0,0 +1,148 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <prometheus/counter.h>
+#include <prometheus/gauge.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+
+#include "src/common/base/base.h"
+#include "src/stirling/core/types.h"
+
+PL_SUPPRESS_WARNINGS_START()
+#include "blockingconcurrentqueue.h"
+PL_SUPPRESS_WARNINGS_END()
+
+namespace px {
+namespace stirling {
+
+/**
+ * DataPushQueue hands the record batches pushed by the sources to the data push callback
+ * (i.e. the table store) on a separate writer thread.
+ *
+ * Pushing only enqueues the record batch on a lock-free queue, so a slow callback
+ * (e.g. while the table store compacts, or a query holds a table) does not stall the sampling of
+ * the sources. Instead, the queue fills up. It is bounded by the total bytes of the queued
+ * record batches; a record batch that does not fit is handled per the policy of its table.
+ *
+ * The queue depth and the dropped record batches are reported as metrics.
+ */
+class DataPushQueue : public NotCopyMoveable {
+ public:
+  enum class OverflowPolicy {
+    // Drop the record batch.
+    kDrop,
+    // Wait up to kMaxBlockDuration for the writer to make room, then drop the record batch.
+    // This slows down the source instead, so it is meant for small tables that should not lose
+    // data (e.g. stirling_error). Only for sources that push from their own thread; Stirling
+    // uses kDrop for all tables when the sources share its main thread.
+    kBlock,
+  };
+
+  static constexpr auto kMaxBlockDuration = std::chrono::milliseconds{100};
+
+  /**
+   * @param push_callback Called with the queued record batches, only from the writer thread.
+   * @param capacity_bytes Maximum total bytes of the queued record batches.
+   *                       A larger record batch is only accepted into an empty queue.
+   */
+  DataPushQueue(DataPushCallback push_callback, int64_t capacity_bytes);
+
+  ~DataPushQueue();
+
+  /**
+   * Sets the name (for metrics) and the overflow policy of a table.
+   * Record batches of unregistered tables are dropped on overflow.
+   */
+  void RegisterTable(uint32_t table_id, std::string table_name, OverflowPolicy policy);
+
+  /**
+   * Removes a registered table. Must not race with pushes to the table.
+   */
+  void UnregisterTable(uint32_t table_id);
+
+  /**
+   * Starts the writer thread.
+   */
+  void Start();
+
+  /**
+   * Stops the writer thread, after it has pushed the record batches still in the queue.
+   */
+  void Stop();
+
+  /**
+   * Queues the record batch for the writer thread. Same signature as DataPushCallback.
+   * Returns OK even if the record batch was dropped; drops are reported through metrics.
+   */
+  Status Push(uint32_t table_id, types::TabletID tablet_id,
+              std::unique_ptr<types::ColumnWrapperRecordBatch> record_batch);
+
+  int64_t queued_bytes() const { return queued_bytes_; }
+  uint64_t num_dropped_batches() const { return num_dropped_batches_; }
+
+ private:
+  struct QueuedBatch {
+    uint32_t table_id = 0;
+    types::TabletID tablet_id;
+    std::unique_ptr<types::ColumnWrapperRecordBatch> record_batch;
+    int64_t bytes = 0;
+  };
+
+  struct TableInfo {
+    OverflowPolicy policy = OverflowPolicy::kDrop;
+    prometheus::Counter* dropped_batches = nullptr;
+    prometheus::Counter* dropped_records = nullptr;
+  };
+
+  void Run();
+  void Write(QueuedBatch* batch);
+
+  // Reserves space for a record batch of the given size. Returns false if it does not fit.
+  bool TryReserve(int64_t bytes);
+
+  void RemoveTableMetrics(const TableInfo& table);
+
+  const DataPushCallback push_callback_;
+  const int64_t capacity_bytes_;
+
+  moodycamel::BlockingConcurrentQueue<QueuedBatch> queue_;
+  std::atomic<int64_t> queued_bytes_ = 0;
+  std::atomic<uint64_t> num_dropped_batches_ = 0;
+
+  std::thread thread_;
+  std::atomic<bool> stop_requested_ = false;
+
+  absl::Mutex tables_mu_;
+  absl::flat_hash_map<uint32_t, TableInfo> tables_ ABSL_GUARDED_BY(tables_mu_);
+
+  prometheus::Gauge& queued_bytes_gauge_;
+  prometheus::Gauge& queued_batches_gauge_;
+};
+
+}  // namespace stirling
+}  // namespace px
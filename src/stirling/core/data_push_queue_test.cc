@@ -0,0 +1,117 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <absl/synchronization/notification.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "src/common/testing/testing.h"
+#include "src/stirling/core/data_push_queue.h"
+
+namespace px {
+namespace stirling {
+
+using ::testing::ElementsAre;
+using OverflowPolicy = DataPushQueue::OverflowPolicy;
+
+constexpr uint32_t kTableID = 1;
+constexpr size_t kNumRecords = 8;
+constexpr int64_t kBatchBytes = kNumRecords * sizeof(types::Int64Value);
+
+std::unique_ptr<types::ColumnWrapperRecordBatch> MakeRecordBatch() {
+  auto record_batch = std::make_unique<types::ColumnWrapperRecordBatch>();
+  record_batch->push_back(types::ColumnWrapper::Make(types::DataType::INT64, kNumRecords));
+  return record_batch;
+}
+
+class DataPushQueueTest : public ::testing::Test {
+ protected:
+  // Creates a queue with room for a single record batch.
+  // The callback records the tablets it was called with, once writes are unblocked.
+  void CreateQueue(OverflowPolicy policy) {
+    queue_ = std::make_unique<DataPushQueue>(
+        [this](uint32_t, types::TabletID tablet_id,
+               std::unique_ptr<types::ColumnWrapperRecordBatch>) {
+          unblock_writes_.WaitForNotification();
+          pushed_tablets_.push_back(tablet_id);
+          return Status::OK();
+        },
+        kBatchBytes);
+    queue_->RegisterTable(kTableID, "test_table", policy);
+    queue_->Start();
+  }
+
+  absl::Notification unblock_writes_;
+  std::vector<types::TabletID> pushed_tablets_;
+  std::unique_ptr<DataPushQueue> queue_;
+};
+
+TEST_F(DataPushQueueTest, pushes_in_order) {
+  CreateQueue(OverflowPolicy::kDrop);
+  unblock_writes_.Notify();
+
+  // Wait for each record batch to be written, so that none of them overflow the queue.
+  for (const auto& tablet_id : {"a", "b", "c"}) {
+    ASSERT_OK(queue_->Push(kTableID, tablet_id, MakeRecordBatch()));
+    while (queue_->queued_bytes() != 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+  }
+  queue_->Stop();
+
+  EXPECT_THAT(pushed_tablets_, ElementsAre("a", "b", "c"));
+  EXPECT_EQ(queue_->num_dropped_batches(), 0);
+}
+
+TEST_F(DataPushQueueTest, drop_on_overflow) {
+  CreateQueue(OverflowPolicy::kDrop);
+
+  // The writer is stuck on the first record batch, so the second one does not fit.
+  ASSERT_OK(queue_->Push(kTableID, "a", MakeRecordBatch()));
+  ASSERT_OK(queue_->Push(kTableID, "b", MakeRecordBatch()));
+  EXPECT_EQ(queue_->num_dropped_batches(), 1);
+
+  unblock_writes_.Notify();
+  queue_->Stop();
+
+  EXPECT_THAT(pushed_tablets_, ElementsAre("a"));
+  EXPECT_EQ(queue_->queued_bytes(), 0);
+}
+
+TEST_F(DataPushQueueTest, block_on_overflow) {
+  CreateQueue(OverflowPolicy::kBlock);
+
+  ASSERT_OK(queue_->Push(kTableID, "a", MakeRecordBatch()));
+
+  // The second push waits for the writer to make room.
+  std::thread unblocker([this]() {
+    std::this_thread::sleep_for(DataPushQueue::kMaxBlockDuration / 4);
+    unblock_writes_.Notify();
+  });
+  ASSERT_OK(queue_->Push(kTableID, "b", MakeRecordBatch()));
+  unblocker.join();
+  queue_->Stop();
+
+  EXPECT_THAT(pushed_tablets_, ElementsAre("a", "b"));
+  EXPECT_EQ(queue_->num_dropped_batches(), 0);
+}
+
+}  // namespace stirling
+}  // namespace px
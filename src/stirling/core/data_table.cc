@@ -59,14 +59,30 @@ Tablet* DataTable::GetTablet(types::TabletIDView tablet_id) {
   return &tablet;
 }
 
+namespace {
+
+// Returns true if the first n sort indexes are {0, 1, ..., n-1},
+// meaning that the first n records are already in sorted order.
+bool IsInOrder(const std::vector<size_t>& sort_indexes, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    if (sort_indexes[i] != i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
 std::vector<TaggedRecordBatch> DataTable::ConsumeRecords() {
   std::vector<TaggedRecordBatch> tablets_out;
   absl::flat_hash_map<types::TabletID, Tablet> carryover_tablets;
   uint64_t next_start_time = start_time_;
 
   for (auto& [tablet_id, tablet] : tablets_) {
-    // Sort based on times.
-    std::vector<size_t> sort_indexes = utils::SortedIndexes(tablet.times);
+    // Sort based on times. Only the out-of-order tail, if any, needs to be sorted.
+    std::vector<size_t> sort_indexes =
+        utils::SortedIndexes(tablet.times, tablet.sorted_prefix_size);
 
     // End time is cutoff time + 1, so call to SplitSortedVector() produces the following
     // classification: which classified according to:
@@ -91,24 +107,10 @@ std::vector<TaggedRecordBatch> DataTable::ConsumeRecords() {
         "time=$3].",
         num_expired, table_schema_.name(), end_time, tablet.times[sort_indexes[0]]);
 
-    // Case 2: Pushable records. Copy to output.
-    if (num_pushable > 0) {
-      // TODO(oazizi): Consider VectorView to avoid copying.
-      std::vector<size_t> push_indexes(sort_indexes.begin() + num_expired,
-                                       sort_indexes.end() - num_carryover);
-      types::ColumnWrapperRecordBatch pushable_records;
-      for (auto& col : tablet.records) {
-        pushable_records.push_back(col->MoveIndexes(push_indexes));
-      }
-      uint64_t last_time = tablet.times[push_indexes.back()];
-      next_start_time = std::max(next_start_time, last_time);
-      tablets_out.push_back(TaggedRecordBatch{tablet_id, std::move(pushable_records)});
-    }
-
     // Case 3: Carryover records.
+    // These are moved out first, because the pushable records may be handed out in place.
     if (num_carryover > 0) {
-      // TODO(oazizi): Consider VectorView to avoid copying.
-      std::vector<size_t> carryover_indexes(sort_indexes.begin() + num_pushable,
+      std::vector<size_t> carryover_indexes(sort_indexes.begin() + positions[1],
                                             sort_indexes.end());
       types::ColumnWrapperRecordBatch carryover_records;
       for (auto& col : tablet.records) {
@@ -119,8 +121,40 @@ std::vector<TaggedRecordBatch> DataTable::ConsumeRecords() {
       for (size_t i = 0; i < times.size(); ++i) {
         times[i] = tablet.times[carryover_indexes[i]];
       }
+      size_t num_times = times.size();
       carryover_tablets[tablet_id] =
-          Tablet{tablet_id, std::move(times), std::move(carryover_records)};
+          Tablet{tablet_id, std::move(times), std::move(carryover_records), num_times};
+    }
+
+    // Case 2: Pushable records.
+    if (num_pushable > 0) {
+      uint64_t last_time = tablet.times[sort_indexes[positions[1] - 1]];
+      next_start_time = std::max(next_start_time, last_time);
+
+      // The table store accounts for the size of the columns, not their capacity, so a column
+      // is only handed out in place when the records fill most of it. Smaller pushes are copied
+      // into exact-sized columns, so they do not pin the reserved buffers.
+      bool fills_columns = static_cast<size_t>(num_pushable) * kMinInPlaceFillFactor >=
+                           tablet.records.front()->Capacity();
+
+      types::ColumnWrapperRecordBatch pushable_records;
+      if (num_expired == 0 && fills_columns && IsInOrder(sort_indexes, num_pushable)) {
+        // The pushable records are the leading records of the tablet, already in order.
+        // Hand out the columns themselves, minus the carried over records (which were moved out
+        // above). Resizing down never reallocates, so nothing is copied.
+        for (auto& col : tablet.records) {
+          col->Resize(num_pushable);
+          pushable_records.push_back(std::move(col));
+        }
+      } else {
+        // TODO(oazizi): Consider VectorView to avoid copying.
+        std::vector<size_t> push_indexes(sort_indexes.begin() + positions[0],
+                                         sort_indexes.begin() + positions[1]);
+        for (auto& col : tablet.records) {
+          pushable_records.push_back(col->MoveIndexes(push_indexes));
+        }
+      }
+      tablets_out.push_back(TaggedRecordBatch{tablet_id, std::move(pushable_records)});
     }
   }
   tablets_ = std::move(carryover_tablets);
@@ -43,9 +43,19 @@ struct TaggedRecordBatch {
 
 struct Tablet {
   types::TabletID tablet_id;
-  // TODO(oazizi): Convert this vector into a heap of {time, index} objects.
+  // The time of each record, in the order the records were appended.
   std::vector<uint64_t> times;
   types::ColumnWrapperRecordBatch records;
+  // Number of leading entries in times that are in sorted order. Records mostly arrive in time
+  // order, so only the tail beyond this prefix needs to be sorted when records are consumed.
+  size_t sorted_prefix_size = 0;
+
+  void AppendTime(uint64_t time) {
+    if (sorted_prefix_size == times.size() && (times.empty() || times.back() <= time)) {
+      ++sorted_prefix_size;
+    }
+    times.push_back(time);
+  }
 };
 
 class DataTable : public NotCopyable {
@@ -58,6 +68,10 @@ class DataTable : public NotCopyable {
    * Consume the data buffered in the data table, up to the specified time.
    * Any records beyond the specified time will remain buffered in the table.
    *
+   * Records that were appended in time order, and that fill at least half of the columns'
+   * capacity, are handed out in their original columns without being copied. Otherwise the
+   * records are moved into new, exact-sized columns.
+   *
    * Note that this function also internally tracks the largest timestamp pushed
    * across all previous calls to the function. Any records that have a timestamp
    * that would cause the appearance of records going backwards in time are dropped.
@@ -191,7 +205,7 @@ class DataTable : public NotCopyable {
    private:
     void Init(uint64_t time) {
       DCHECK_EQ(schema->elements().size(), tablet_.records.size());
-      tablet_.times.push_back(time);
+      tablet_.AppendTime(time);
     }
 
     Tablet& tablet_;
@@ -247,7 +261,7 @@ class DataTable : public NotCopyable {
    private:
     void Init(uint64_t time) {
       DCHECK_EQ(schema_.elements().size(), tablet_.records.size());
-      tablet_.times.push_back(time);
+      tablet_.AppendTime(time);
       LOG_IF(DFATAL, schema_.elements().size() > kMaxSupportedColumns) << absl::Substitute(
           "Tables with more than $0 columns are not supported.", kMaxSupportedColumns);
     }
@@ -265,6 +279,10 @@ class DataTable : public NotCopyable {
   // ColumnWrapper specific members
   static constexpr size_t kTargetCapacity = 1024;
 
+  // In-order records are only handed out in their original columns if they fill at least
+  // 1/kMinInPlaceFillFactor of the columns' capacity.
+  static constexpr size_t kMinInPlaceFillFactor = 2;
+
   // Unique ID set by InfoClassManager.
   const uint64_t id_;
 
@@ -314,6 +314,94 @@ TEST_F(DataTableTest, Carryover) {
   }
 }
 
+// Records appended in time order are pushed in place, while the records beyond the cutoff time
+// are carried over. Records appended after a carryover, out of order or not, must be merged
+// with the carried over records.
+TEST_F(DataTableTest, InOrderCarryover) {
+  auto append = [this](int time) {
+    DataTable::RecordBuilder<&kSchema> r(data_table_.get(), time);
+    r.Append<r.ColIndex("time_")>(time);
+    r.Append<r.ColIndex("x")>(time / 10);
+    r.Append<r.ColIndex("s")>(std::to_string(time));
+  };
+
+  auto check_times = [](const TaggedRecordBatch& tablet, const std::vector<int>& expected_times) {
+    const types::ColumnWrapperRecordBatch& rb = tablet.records;
+    ASSERT_EQ(rb[0]->Size(), expected_times.size());
+    for (size_t i = 0; i < expected_times.size(); ++i) {
+      EXPECT_EQ(rb[0]->Get<types::Time64NSValue>(i), expected_times[i]);
+      EXPECT_EQ(rb[1]->Get<types::Int64Value>(i), expected_times[i] / 10);
+      EXPECT_EQ(rb[2]->Get<types::StringValue>(i), std::to_string(expected_times[i]));
+    }
+  };
+
+  for (int t = 0; t < 100; t += 10) {
+    append(t);
+  }
+
+  {
+    data_table_->SetConsumeRecordsCutoffTime(50);
+    std::vector<TaggedRecordBatch> tablets = data_table_->ConsumeRecords();
+    ASSERT_EQ(tablets.size(), 1);
+    check_times(tablets[0], {0, 10, 20, 30, 40, 50});
+  }
+
+  append(100);
+  append(65);
+  append(110);
+
+  {
+    data_table_->SetConsumeRecordsCutoffTime(80);
+    std::vector<TaggedRecordBatch> tablets = data_table_->ConsumeRecords();
+    ASSERT_EQ(tablets.size(), 1);
+    check_times(tablets[0], {60, 65, 70, 80});
+  }
+
+  {
+    data_table_->SetConsumeRecordsCutoffTime(200);
+    std::vector<TaggedRecordBatch> tablets = data_table_->ConsumeRecords();
+    ASSERT_EQ(tablets.size(), 1);
+    check_times(tablets[0], {90, 100, 110});
+  }
+}
+
+// Small pushes must not hand out columns with the reserved capacity, since the table store only
+// accounts for their size. Pushes that fill the columns are handed out in place.
+TEST_F(DataTableTest, PushedColumnCapacity) {
+  auto append = [this](int time) {
+    DataTable::RecordBuilder<&kSchema> r(data_table_.get(), time);
+    r.Append<r.ColIndex("time_")>(time);
+    r.Append<r.ColIndex("x")>(time);
+    r.Append<r.ColIndex("s")>(std::to_string(time));
+  };
+
+  for (int t = 0; t < 3; ++t) {
+    append(t);
+  }
+
+  {
+    std::vector<TaggedRecordBatch> tablets = data_table_->ConsumeRecords();
+    ASSERT_EQ(tablets.size(), 1);
+    for (const auto& col : tablets[0].records) {
+      EXPECT_EQ(col->Size(), 3);
+      EXPECT_EQ(col->Capacity(), 3);
+    }
+  }
+
+  for (int t = 3; t < 1003; ++t) {
+    append(t);
+  }
+
+  {
+    std::vector<TaggedRecordBatch> tablets = data_table_->ConsumeRecords();
+    ASSERT_EQ(tablets.size(), 1);
+    for (const auto& col : tablets[0].records) {
+      EXPECT_EQ(col->Size(), 1000);
+      EXPECT_LT(col->Capacity(), 2 * col->Size());
+    }
+  }
+}
+
 class DataTableStressTest : public ::testing::Test {
  private:
   std::default_random_engine rng_;
@@ -28,6 +28,18 @@
 namespace px {
 namespace stirling {
 
+namespace {
+
+// CPU time consumed by the calling thread. Used, rather than process CPU time,
+// because sources may be run concurrently on separate threads.
+int64_t ThreadCPUTimeNS() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+}  // namespace
+
 Status SourceConnector::Init() {
   if (state_ != State::kUninitialized) {
     return error::Internal("Cannot re-initialize a connector [current state = $0].",
@@ -50,24 +62,42 @@ void SourceConnector::TransferData(ConnectorContext* ctx,
   DCHECK(ctx != nullptr);
   DCHECK_EQ(data_tables.size(), table_schemas().size())
       << "DataTable objects must all be specified.";
+  const int64_t wall_start_ns = CurrentSteadyTimeNS();
+  const int64_t cpu_start_ns = ThreadCPUTimeNS();
   TransferDataImpl(ctx, data_tables);
+  ++source_stats_.num_transfers;
+  source_stats_.transfer_wall_time_ns += CurrentSteadyTimeNS() - wall_start_ns;
+  source_stats_.transfer_cpu_time_ns += ThreadCPUTimeNS() - cpu_start_ns;
   sampling_freq_mgr_.Reset();
 }
 
 void SourceConnector::PushData(DataPushCallback agent_callback,
                                const std::vector<DataTable*>& data_tables) {
+  const int64_t wall_start_ns = CurrentSteadyTimeNS();
+  const int64_t cpu_start_ns = ThreadCPUTimeNS();
   for (auto* data_table : data_tables) {
     auto record_batches = data_table->ConsumeRecords();
     for (auto& record_batch : record_batches) {
       if (record_batch.records.empty()) {
         continue;
       }
+      source_stats_.records_pushed += record_batch.records.front()->Size();
+      for (const auto& col : record_batch.records) {
+        source_stats_.bytes_pushed += col->Bytes();
+      }
       Status s = agent_callback(
           data_table->id(), record_batch.tablet_id,
           std::make_unique<types::ColumnWrapperRecordBatch>(std::move(record_batch.records)));
       LOG_IF(DFATAL, !s.ok()) << absl::Substitute("Failed to push data. Message = $0", s.msg());
     }
   }
+  source_stats_.push_wall_time_ns = CurrentSteadyTimeNS() - wall_start_ns;
+  source_stats_.push_cpu_time_ns = ThreadCPUTimeNS() - cpu_start_ns;
+  source_stats_.timestamp_ns = CurrentTimeNS();
+  source_stats_.source_connector = source_name_;
+  AddSourceStatsImpl(&source_stats_);
+  StirlingMonitor::GetInstance()->AppendSourceStatsRecord(std::move(source_stats_));
+  source_stats_ = SourceStatsRecord();
   push_freq_mgr_.Reset();
 }
 
@@ -27,6 +27,7 @@
 #include "src/stirling/core/connector_context.h"
 #include "src/stirling/core/data_table.h"
 #include "src/stirling/core/frequency_manager.h"
+#include "src/stirling/utils/monitor.h"
 
 /**
  * These are the steps to follow to add a new data source connector.
@@ -66,6 +67,10 @@ class SourceConnector : public NotCopyable {
 
   /**
    * Pushes data in data tables into table store.
+   * Also reports the cost of the transfers and the push since the previous push
+   * to the StirlingMonitor, for the stirling_source_stats table. This adds a record on every
+   * push, including the pushes that happen before the push period expires, because the data
+   * tables have buffered a lot of data.
    */
   void PushData(DataPushCallback agent_callback, const std::vector<DataTable*>& data_tables);
 
@@ -132,6 +137,11 @@ class SourceConnector : public NotCopyable {
 
   virtual Status StopImpl() = 0;
 
+  // Provide a default AddSourceStatsImpl which does nothing.
+  // SourceConnectors may override to report data loss events and connector specific info
+  // (as JSON) since the previous push. Called once per push.
+  virtual void AddSourceStatsImpl(SourceStatsRecord* /* record */) {}
+
  protected:
   /**
    * Track state of connector. A connector's lifetime typically progresses sequentially
@@ -158,6 +168,9 @@ class SourceConnector : public NotCopyable {
 
   const std::string source_name_;
   const ArrayView<DataTableSchema> table_schemas_;
+
+  // Accumulates the cost of TransferData() calls until the next PushData().
+  SourceStatsRecord source_stats_;
 };
 
 }  // namespace stirling
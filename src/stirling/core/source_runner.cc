@@ -0,0 +1,191 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/core/source_runner.h"
+
+#include <prometheus/family.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "src/common/metrics/metrics.h"
+
+namespace px {
+namespace stirling {
+
+bool DataExceedsThreshold(const std::vector<DataTable*>& data_tables) {
+  // Data push threshold, based on percentage of buffer that is filled.
+  constexpr uint32_t kDefaultOccupancyPctThreshold = 100;
+
+  // Data push threshold, based number of records after which a push.
+  constexpr uint32_t kDefaultOccupancyThreshold = 1024;
+
+  for (const auto* data_table : data_tables) {
+    if (static_cast<uint32_t>(100 * data_table->OccupancyPct()) > kDefaultOccupancyPctThreshold) {
+      return true;
+    }
+    if (data_table->Occupancy() > kDefaultOccupancyThreshold) {
+      return true;
+    }
+  }
+  return false;
+}
+
+namespace {
+
+prometheus::Family<prometheus::Counter>& MissedDeadlinesFamily() {
+  static auto& family = prometheus::BuildCounter()
+                            .Name("stirling_source_missed_deadlines")
+                            .Help("Total number of sampling and push phases of a source connector "
+                                  "that started late, relative to their period.")
+                            .Register(GetMetricsRegistry());
+  return family;
+}
+
+prometheus::Family<prometheus::Counter>& LatenessFamily() {
+  static auto& family = prometheus::BuildCounter()
+                            .Name("stirling_source_deadline_lateness_ms")
+                            .Help("Total time in milliseconds by which the sampling and push "
+                                  "phases of a source connector started after their deadline.")
+                            .Register(GetMetricsRegistry());
+  return family;
+}
+
+prometheus::Counter& SourceCounter(prometheus::Family<prometheus::Counter>* family,
+                                   const std::string& source_name, const std::string& phase) {
+  return family->Add({{"source", source_name}, {"phase", phase}});
+}
+
+}  // namespace
+
+SourceRunner::SourceRunner(SourceConnector* source, std::vector<DataTable*> data_tables,
+                           DataPushCallback push_callback, ContextFn context_fn)
+    : source_(source),
+      data_tables_(std::move(data_tables)),
+      push_callback_(std::move(push_callback)),
+      context_fn_(std::move(context_fn)),
+      missed_sampling_deadlines_counter_(
+          SourceCounter(&MissedDeadlinesFamily(), source->name(), "sampling")),
+      missed_push_deadlines_counter_(
+          SourceCounter(&MissedDeadlinesFamily(), source->name(), "push")),
+      sampling_lateness_counter_(SourceCounter(&LatenessFamily(), source->name(), "sampling")),
+      push_lateness_counter_(SourceCounter(&LatenessFamily(), source->name(), "push")) {}
+
+SourceRunner::~SourceRunner() {
+  Stop();
+
+  // Dynamic trace sources come and go, so do not leave their series behind.
+  MissedDeadlinesFamily().Remove(&missed_sampling_deadlines_counter_);
+  MissedDeadlinesFamily().Remove(&missed_push_deadlines_counter_);
+  LatenessFamily().Remove(&sampling_lateness_counter_);
+  LatenessFamily().Remove(&push_lateness_counter_);
+}
+
+void SourceRunner::Start() {
+  absl::MutexLock stop_lock(&stop_mu_);
+  DCHECK(!thread_.joinable()) << "SourceRunner was already started.";
+  {
+    absl::MutexLock lock(&mu_);
+    stop_requested_ = false;
+  }
+  thread_ = std::thread(&SourceRunner::Run, this);
+}
+
+void SourceRunner::Stop() {
+  absl::MutexLock stop_lock(&stop_mu_);
+  {
+    absl::MutexLock lock(&mu_);
+    stop_requested_ = true;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void SourceRunner::RunExclusive(const std::function<void(SourceConnector*)>& fn) {
+  absl::MutexLock lock(&mu_);
+  if (stop_requested_) {
+    return;
+  }
+  fn(source_);
+}
+
+bool SourceRunner::CheckDeadline(const FrequencyManager& freq_mgr,
+                                 prometheus::Counter* missed_counter,
+                                 prometheus::Counter* lateness_counter) {
+  // The first deadline is not meaningful, since the phase has never run.
+  if (freq_mgr.count() == 0) {
+    return false;
+  }
+  auto lateness = std::chrono::duration_cast<std::chrono::milliseconds>(
+      px::chrono::coarse_steady_clock::now() - freq_mgr.next());
+  lateness_counter->Increment(lateness.count());
+  if (lateness > freq_mgr.period() * kMissedDeadlineTolerance) {
+    missed_counter->Increment();
+    return true;
+  }
+  return false;
+}
+
+std::chrono::milliseconds SourceRunner::RunOnce() {
+  absl::MutexLock lock(&mu_);
+
+  // Phase 1: Probe the source for its data.
+  if (source_->sampling_freq_mgr().Expired()) {
+    if (CheckDeadline(source_->sampling_freq_mgr(), &missed_sampling_deadlines_counter_,
+                      &sampling_lateness_counter_)) {
+      ++num_missed_sampling_deadlines_;
+    }
+    std::unique_ptr<ConnectorContext> ctx = context_fn_();
+    source_->TransferData(ctx.get(), data_tables_);
+  }
+
+  // Phase 2: Push data upstream.
+  bool push_expired = source_->push_freq_mgr().Expired();
+  if (push_expired || DataExceedsThreshold(data_tables_)) {
+    if (push_expired && CheckDeadline(source_->push_freq_mgr(), &missed_push_deadlines_counter_,
+                                      &push_lateness_counter_)) {
+      ++num_missed_push_deadlines_;
+    }
+    source_->PushData(push_callback_, data_tables_);
+  }
+
+  auto next = std::min(source_->sampling_freq_mgr().next(), source_->push_freq_mgr().next());
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      next - px::chrono::coarse_steady_clock::now());
+}
+
+void SourceRunner::Run() {
+  constexpr std::chrono::milliseconds kMinSleepDuration{1};
+
+  while (true) {
+    std::chrono::milliseconds sleep_duration = RunOnce();
+
+    absl::MutexLock lock(&mu_);
+    if (sleep_duration > kMinSleepDuration) {
+      mu_.AwaitWithTimeout(absl::Condition(&stop_requested_), absl::FromChrono(sleep_duration));
+    }
+    if (stop_requested_) {
+      break;
+    }
+  }
+}
+
+}  // namespace stirling
+}  // namespace px
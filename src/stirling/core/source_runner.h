@@ -0,0 +1,134 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <prometheus/counter.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <absl/synchronization/mutex.h>
+
+#include "src/common/base/base.h"
+#include "src/stirling/core/connector_context.h"
+#include "src/stirling/core/data_table.h"
+#include "src/stirling/core/source_connector.h"
+#include "src/stirling/core/types.h"
+
+namespace px {
+namespace stirling {
+
+/**
+ * Returns true if any of the data tables has buffered enough records that it should be pushed
+ * before the push period expires.
+ */
+bool DataExceedsThreshold(const std::vector<DataTable*>& data_tables);
+
+/**
+ * SourceRunner samples and pushes the data of a single source connector on its own thread.
+ *
+ * Each iteration sleeps until the earliest of the source's sampling and push deadlines, and then
+ * runs whichever phases are due. Running every source on its own thread means that a slow
+ * TransferData() of one source (e.g. the socket tracer under load) does not delay the sampling of
+ * the others.
+ *
+ * A phase that starts noticeably later than its deadline is counted as a missed deadline, in the
+ * stirling_source_missed_deadlines metric.
+ */
+class SourceRunner : public NotCopyable {
+ public:
+  using ContextFn = std::function<std::unique_ptr<ConnectorContext>()>;
+
+  // A phase that starts later than this fraction of its period after its deadline, is late.
+  static constexpr double kMissedDeadlineTolerance = 0.1;
+
+  /**
+   * @param source The source to run. Must outlive the runner.
+   * @param data_tables The data tables of the source, in the order of its table schemas.
+   * @param push_callback Called with the records of the source. Must be safe to call from the
+   *                      runner thread.
+   * @param context_fn Returns the context passed to TransferData(), once per sampling.
+   */
+  SourceRunner(SourceConnector* source, std::vector<DataTable*> data_tables,
+               DataPushCallback push_callback, ContextFn context_fn);
+
+  ~SourceRunner();
+
+  /**
+   * Starts the runner thread.
+   */
+  void Start();
+
+  /**
+   * Stops the runner thread, and waits for it to finish the current iteration.
+   * Safe to call from several threads at once.
+   */
+  void Stop() ABSL_LOCKS_EXCLUDED(stop_mu_, mu_);
+
+  /**
+   * Runs fn on the source, between iterations of the runner.
+   * This is how other threads operate on the source without racing with TransferData().
+   * Does nothing once the runner is stopped, since the source may be gone by then.
+   */
+  void RunExclusive(const std::function<void(SourceConnector*)>& fn) ABSL_LOCKS_EXCLUDED(mu_);
+
+  /**
+   * Runs the phases that are due. Returns how long to wait before they are due again.
+   * Exposed for testing; it is otherwise only called from the runner thread.
+   */
+  std::chrono::milliseconds RunOnce() ABSL_LOCKS_EXCLUDED(mu_);
+
+  uint64_t num_missed_sampling_deadlines() const { return num_missed_sampling_deadlines_; }
+  uint64_t num_missed_push_deadlines() const { return num_missed_push_deadlines_; }
+
+ private:
+  void Run();
+
+  // Counts the phase as missed, if it is starting too late after its deadline.
+  bool CheckDeadline(const FrequencyManager& freq_mgr, prometheus::Counter* missed_counter,
+                     prometheus::Counter* lateness_counter);
+
+  SourceConnector* source_;
+  const std::vector<DataTable*> data_tables_;
+  const DataPushCallback push_callback_;
+  const ContextFn context_fn_;
+
+  // Serializes Stop(), so that only one caller joins thread_.
+  absl::Mutex stop_mu_;
+  std::thread thread_ ABSL_GUARDED_BY(stop_mu_);
+
+  // Held while an iteration runs, and used to wake the runner up to stop.
+  absl::Mutex mu_;
+  bool stop_requested_ ABSL_GUARDED_BY(mu_) = false;
+
+  std::atomic<uint64_t> num_missed_sampling_deadlines_ = 0;
+  std::atomic<uint64_t> num_missed_push_deadlines_ = 0;
+
+  prometheus::Counter& missed_sampling_deadlines_counter_;
+  prometheus::Counter& missed_push_deadlines_counter_;
+  prometheus::Counter& sampling_lateness_counter_;
+  prometheus::Counter& push_lateness_counter_;
+};
+
+}  // namespace stirling
+}  // namespace px
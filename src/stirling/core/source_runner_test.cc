@@ -0,0 +1,168 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "src/common/testing/testing.h"
+#include "src/stirling/core/source_runner.h"
+#include "src/stirling/source_connectors/seq_gen/seq_gen_connector.h"
+
+namespace px {
+namespace stirling {
+
+using ::testing::Ge;
+using ::testing::Le;
+
+constexpr auto kSamplingPeriod = std::chrono::milliseconds{10};
+constexpr auto kPushPeriod = std::chrono::milliseconds{20};
+
+// A SeqGenConnector with short periods, to keep the tests fast.
+class FastSeqGenConnector : public SeqGenConnector {
+ public:
+  static std::unique_ptr<SourceConnector> Create(std::string_view name) {
+    return std::unique_ptr<SourceConnector>(new FastSeqGenConnector(name));
+  }
+
+ protected:
+  explicit FastSeqGenConnector(std::string_view name) : SeqGenConnector(name) {}
+
+  Status InitImpl() override {
+    PL_RETURN_IF_ERROR(SeqGenConnector::InitImpl());
+    sampling_freq_mgr_.set_period(kSamplingPeriod);
+    push_freq_mgr_.set_period(kPushPeriod);
+    return Status::OK();
+  }
+};
+
+class SourceRunnerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    source_ = FastSeqGenConnector::Create("fast_sequences");
+    ASSERT_OK(source_->Init());
+    data_tables_.push_back(std::make_unique<DataTable>(0, SeqGenConnector::kSeq0Table));
+    data_tables_.push_back(std::make_unique<DataTable>(1, SeqGenConnector::kSeq1Table));
+
+    std::vector<DataTable*> data_tables;
+    for (const auto& data_table : data_tables_) {
+      data_tables.push_back(data_table.get());
+    }
+    runner_ = std::make_unique<SourceRunner>(
+        source_.get(), std::move(data_tables),
+        [this](uint32_t, types::TabletID, std::unique_ptr<types::ColumnWrapperRecordBatch>) {
+          ++num_pushes_;
+          return Status::OK();
+        },
+        []() { return std::make_unique<SystemWideStandaloneContext>(); });
+  }
+
+  void TearDown() override { runner_.reset(); }
+
+  std::unique_ptr<SourceConnector> source_;
+  std::vector<std::unique_ptr<DataTable>> data_tables_;
+  std::unique_ptr<SourceRunner> runner_;
+  std::atomic<int> num_pushes_ = 0;
+};
+
+TEST_F(SourceRunnerTest, run_once) {
+  // Both phases are due initially.
+  std::chrono::milliseconds wait = runner_->RunOnce();
+  EXPECT_EQ(source_->sampling_freq_mgr().count(), 1);
+  EXPECT_EQ(source_->push_freq_mgr().count(), 1);
+  EXPECT_GT(num_pushes_, 0);
+  EXPECT_THAT(wait, Le(kSamplingPeriod));
+
+  // Nothing is due right away.
+  runner_->RunOnce();
+  EXPECT_EQ(source_->sampling_freq_mgr().count(), 1);
+  EXPECT_EQ(source_->push_freq_mgr().count(), 1);
+  EXPECT_EQ(runner_->num_missed_sampling_deadlines(), 0);
+}
+
+TEST_F(SourceRunnerTest, missed_deadlines) {
+  runner_->RunOnce();
+  EXPECT_EQ(runner_->num_missed_sampling_deadlines(), 0);
+  EXPECT_EQ(runner_->num_missed_push_deadlines(), 0);
+
+  // Run well past both deadlines.
+  std::this_thread::sleep_for(5 * kPushPeriod);
+  runner_->RunOnce();
+  EXPECT_EQ(runner_->num_missed_sampling_deadlines(), 1);
+  EXPECT_EQ(runner_->num_missed_push_deadlines(), 1);
+}
+
+TEST_F(SourceRunnerTest, source_stats) {
+  StirlingMonitor& monitor = *StirlingMonitor::GetInstance();
+  monitor.ConsumeSourceStatsRecords();
+
+  runner_->RunOnce();
+
+  std::vector<SourceStatsRecord> records = monitor.ConsumeSourceStatsRecords();
+  ASSERT_EQ(records.size(), 1);
+  EXPECT_EQ(records[0].source_connector, "fast_sequences");
+  EXPECT_EQ(records[0].num_transfers, 1);
+  EXPECT_GT(records[0].transfer_wall_time_ns, 0);
+  EXPECT_GT(records[0].records_pushed, 0);
+  EXPECT_GT(records[0].bytes_pushed, 0);
+  EXPECT_EQ(records[0].data_loss_events, 0);
+}
+
+TEST_F(SourceRunnerTest, start_stop) {
+  runner_->Start();
+  std::this_thread::sleep_for(10 * kPushPeriod);
+
+  // Operations on the source are serialized with the runner's iterations.
+  runner_->RunExclusive([](SourceConnector* source) { source->SetDebugLevel(1); });
+
+  runner_->Stop();
+  EXPECT_THAT(source_->sampling_freq_mgr().count(), Ge(2));
+  EXPECT_THAT(source_->push_freq_mgr().count(), Ge(2));
+  EXPECT_GT(num_pushes_, 0);
+
+  // The runner does not touch the source after it was stopped.
+  uint32_t sampling_count = source_->sampling_freq_mgr().count();
+  std::this_thread::sleep_for(5 * kSamplingPeriod);
+  EXPECT_EQ(source_->sampling_freq_mgr().count(), sampling_count);
+
+  // Nor does RunExclusive(), since the source may be gone.
+  bool ran = false;
+  runner_->RunExclusive([&ran](SourceConnector*) { ran = true; });
+  EXPECT_FALSE(ran);
+}
+
+TEST_F(SourceRunnerTest, concurrent_stop) {
+  runner_->Start();
+  std::this_thread::sleep_for(2 * kSamplingPeriod);
+
+  // Both callers return once the runner thread was joined.
+  std::thread other_thread([this]() { runner_->Stop(); });
+  runner_->Stop();
+  other_thread.join();
+
+  uint32_t sampling_count = source_->sampling_freq_mgr().count();
+  std::this_thread::sleep_for(5 * kSamplingPeriod);
+  EXPECT_EQ(source_->sampling_freq_mgr().count(), sampling_count);
+}
+
+}  // namespace stirling
+}  // namespace px
@@ -23,6 +23,8 @@
 
 #include <absl/container/flat_hash_set.h>
 #include <algorithm>
+#include <cctype>
+#include <cstring>
 
 #include <llvm/DebugInfo/DIContext.h>
 #include <llvm/Object/ObjectFile.h>
@@ -67,8 +69,16 @@ StatusOr<std::unique_ptr<DwarfReader>> DwarfReader::CreateWithoutIndexing(
 
   std::string obj_filename = path.string();
 
-  llvm::ErrorOr<std::unique_ptr<MemoryBuffer>> buff_or_err =
-      MemoryBuffer::getFileOrSTDIN(obj_filename);
+  // Not requiring a null terminator lets LLVM always mmap the file, rather than reading it into
+  // memory. The DWARF sections are then read in place, and only the pages that are touched
+  // become resident.
+#if LLVM_VERSION_MAJOR >= 13
+  llvm::ErrorOr<std::unique_ptr<MemoryBuffer>> buff_or_err = MemoryBuffer::getFile(
+      obj_filename, /*IsText*/ false, /*RequiresNullTerminator*/ false);
+#else
+  llvm::ErrorOr<std::unique_ptr<MemoryBuffer>> buff_or_err = MemoryBuffer::getFile(
+      obj_filename, /*FileSize*/ -1, /*RequiresNullTerminator*/ false);
+#endif
   ec = buff_or_err.getError();
   if (ec) {
     return error::Internal("DwarfReader $0: $1", ec.message(), obj_filename);
@@ -109,6 +119,13 @@ StatusOr<std::unique_ptr<DwarfReader>> DwarfReader::CreateWithSelectiveIndexing(
   return dwarf_reader;
 }
 
+StatusOr<std::unique_ptr<DwarfReader>> DwarfReader::CreateWithLazyIndexing(
+    const std::filesystem::path& path) {
+  PL_ASSIGN_OR_RETURN(auto dwarf_reader, CreateWithoutIndexing(path));
+  dwarf_reader->InitLazyIndexing();
+  return dwarf_reader;
+}
+
 DwarfReader::DwarfReader(std::unique_ptr<llvm::MemoryBuffer> buffer,
                          std::unique_ptr<llvm::DWARFContext> dwarf_context)
     : memory_buffer_(std::move(buffer)), dwarf_context_(std::move(dwarf_context)) {
@@ -262,11 +279,321 @@ void DwarfReader::IndexDIEs(
   }
 }
 
+namespace {
+
+// The .gdb_index section is little-endian, as are all hosts that Stirling runs on.
+uint32_t ReadU32(std::string_view buf, size_t offset) {
+  uint32_t val;
+  memcpy(&val, buf.data() + offset, sizeof(val));
+  return val;
+}
+
+uint64_t ReadU64(std::string_view buf, size_t offset) {
+  uint64_t val;
+  memcpy(&val, buf.data() + offset, sizeof(val));
+  return val;
+}
+
+}  // namespace
+
+/**
+ * A read-only view of a .gdb_index section (versions 7 and 8), which maps symbol names to the
+ * compilation units that define them.
+ * See https://sourceware.org/gdb/onlinedocs/gdb/Index-Section-Format.html.
+ */
+class GdbIndexView {
+ public:
+  static StatusOr<std::unique_ptr<GdbIndexView>> Parse(std::string_view data) {
+    constexpr size_t kHeaderSize = 6 * sizeof(uint32_t);
+    if (data.size() < kHeaderSize) {
+      return error::InvalidArgument(".gdb_index is truncated.");
+    }
+    const uint32_t version = ReadU32(data, 0);
+    if (version < 7 || version > 8) {
+      return error::Unimplemented("Unsupported .gdb_index version $0.", version);
+    }
+    const uint32_t cu_list_offset = ReadU32(data, 4);
+    const uint32_t types_cu_list_offset = ReadU32(data, 8);
+    const uint32_t symbol_table_offset = ReadU32(data, 16);
+    const uint32_t constant_pool_offset = ReadU32(data, 20);
+    if (cu_list_offset > types_cu_list_offset || symbol_table_offset > constant_pool_offset ||
+        constant_pool_offset > data.size() || types_cu_list_offset > data.size()) {
+      return error::InvalidArgument(".gdb_index header is inconsistent.");
+    }
+
+    auto index = std::unique_ptr<GdbIndexView>(new GdbIndexView);
+
+    // Each CU list entry is a pair of 64-bit values: the .debug_info offset and the length.
+    constexpr size_t kCUEntrySize = 2 * sizeof(uint64_t);
+    const size_t num_cus = (types_cu_list_offset - cu_list_offset) / kCUEntrySize;
+    index->cu_offsets_.reserve(num_cus);
+    for (size_t i = 0; i < num_cus; ++i) {
+      index->cu_offsets_.push_back(ReadU64(data, cu_list_offset + i * kCUEntrySize));
+    }
+
+    index->symbol_table_ =
+        data.substr(symbol_table_offset, constant_pool_offset - symbol_table_offset);
+    index->constant_pool_ = data.substr(constant_pool_offset);
+
+    const size_t num_slots = index->symbol_table_.size() / kSlotSize;
+    if ((num_slots & (num_slots - 1)) != 0) {
+      return error::InvalidArgument(".gdb_index symbol table size is not a power of 2.");
+    }
+
+    return index;
+  }
+
+  /**
+   * Returns the .debug_info offsets of the compilation units that define the symbol.
+   * Note that C++ symbols are indexed by their qualified names (e.g. ns::Class::Method).
+   */
+  std::vector<uint64_t> Lookup(std::string_view name) const {
+    std::vector<uint64_t> cu_offsets;
+
+    const uint32_t num_slots = symbol_table_.size() / kSlotSize;
+    if (num_slots == 0) {
+      return cu_offsets;
+    }
+
+    // The hash table uses open addressing with double hashing, as implemented in gdb.
+    const uint32_t hash = Hash(name);
+    const uint32_t step = ((hash * 17) & (num_slots - 1)) | 1;
+    uint32_t slot = hash & (num_slots - 1);
+    for (uint32_t i = 0; i < num_slots; ++i, slot = (slot + step) & (num_slots - 1)) {
+      const uint32_t name_offset = ReadU32(symbol_table_, slot * kSlotSize);
+      const uint32_t cu_vector_offset = ReadU32(symbol_table_, slot * kSlotSize + 4);
+      if (name_offset == 0 && cu_vector_offset == 0) {
+        // Empty slot: the symbol is not in the index.
+        break;
+      }
+      if (name_offset >= constant_pool_.size()) {
+        continue;
+      }
+      std::string_view slot_name = constant_pool_.substr(name_offset);
+      slot_name = slot_name.substr(0, slot_name.find('\0'));
+      if (slot_name != name) {
+        continue;
+      }
+
+      if (cu_vector_offset + sizeof(uint32_t) > constant_pool_.size()) {
+        break;
+      }
+      const uint32_t num_entries = ReadU32(constant_pool_, cu_vector_offset);
+      for (uint32_t j = 0; j < num_entries; ++j) {
+        const size_t entry_offset = cu_vector_offset + (j + 1) * sizeof(uint32_t);
+        if (entry_offset + sizeof(uint32_t) > constant_pool_.size()) {
+          break;
+        }
+        // The low 24 bits are the CU index; the upper bits describe the symbol kind.
+        // Indexes past the CU list refer to type units, which are not used here.
+        const uint32_t cu_index = ReadU32(constant_pool_, entry_offset) & 0xffffff;
+        if (cu_index < cu_offsets_.size()) {
+          cu_offsets.push_back(cu_offsets_[cu_index]);
+        }
+      }
+      break;
+    }
+
+    return cu_offsets;
+  }
+
+  size_t num_compile_units() const { return cu_offsets_.size(); }
+
+ private:
+  GdbIndexView() = default;
+
+  // mapped_index_string_hash() from gdb, for index versions >= 5.
+  static uint32_t Hash(std::string_view str) {
+    uint32_t r = 0;
+    for (unsigned char c : str) {
+      r = r * 67 + std::tolower(c) - 113;
+    }
+    return r;
+  }
+
+  // Each symbol table slot is a pair of 32-bit offsets into the constant pool:
+  // the symbol name, and the vector of CUs that define it.
+  static constexpr size_t kSlotSize = 2 * sizeof(uint32_t);
+
+  std::vector<uint64_t> cu_offsets_;
+  std::string_view symbol_table_;
+  std::string_view constant_pool_;
+};
+
+DwarfReader::~DwarfReader() = default;
+
+namespace {
+
+// Returns the name under which IndexDIEs() would index the DIE: the short name, qualified by
+// the enclosing namespaces and types (e.g. ns::Class::Method).
+std::string QualifiedName(const DWARFDie& die) {
+  // Out-of-line definitions refer to their declaration, which has the enclosing scopes.
+  DWARFDie scope_die = die.getAttributeValueAsReferencedDie(llvm::dwarf::DW_AT_specification);
+  if (!scope_die.isValid()) {
+    scope_die = die;
+  }
+
+  std::string name(GetShortName(die));
+  for (DWARFDie parent = scope_die.getParent(); parent.isValid(); parent = parent.getParent()) {
+    if (!IsIndexedType(parent.getTag()) && !IsNamespace(parent.getTag())) {
+      break;
+    }
+    std::string_view parent_name = GetShortName(parent);
+    if (parent_name.empty()) {
+      break;
+    }
+    name = absl::StrCat(parent_name, "::", name);
+  }
+  return name;
+}
+
+}  // namespace
+
+void DwarfReader::InitLazyIndexing() {
+  lazy_indexing_ = true;
+
+  const llvm::DWARFObject& dwarf_obj = dwarf_context_->getDWARFObj();
+
+  size_t num_indexed_cus = 0;
+  if (!dwarf_obj.getNamesSection().Data.empty()) {
+    for (const llvm::DWARFDebugNames::NameIndex& name_index : dwarf_context_->getDebugNames()) {
+      num_indexed_cus += name_index.getCUCount();
+    }
+  }
+
+  llvm::StringRef gdb_index_section = dwarf_obj.getGdbIndexSection();
+  if (!gdb_index_section.empty()) {
+    StatusOr<std::unique_ptr<GdbIndexView>> gdb_index_status =
+        GdbIndexView::Parse(std::string_view(gdb_index_section.data(), gdb_index_section.size()));
+    if (gdb_index_status.ok()) {
+      gdb_index_ = gdb_index_status.ConsumeValueOrDie();
+      num_indexed_cus = std::max(num_indexed_cus, gdb_index_->num_compile_units());
+    } else {
+      VLOG(1) << absl::Substitute("Ignoring .gdb_index: $0", gdb_index_status.msg());
+    }
+  }
+
+  accel_tables_complete_ =
+      num_indexed_cus != 0 && num_indexed_cus >= dwarf_context_->getNumCompileUnits();
+}
+
+std::vector<DWARFDie> DwarfReader::FindInAccelTables(std::string_view name,
+                                                     llvm::dwarf::Tag tag) {
+  // .debug_names lists DIEs by their unqualified names; .gdb_index lists C++ symbols by their
+  // qualified names. So look up both.
+  std::string_view short_name = name;
+  size_t pos = name.rfind("::");
+  if (pos != std::string_view::npos) {
+    short_name = name.substr(pos + 2);
+  }
+  std::vector<std::string_view> keys = {name};
+  if (short_name != name) {
+    keys.push_back(short_name);
+  }
+
+  std::vector<DWARFDie> dies;
+
+  const llvm::DWARFDebugNames& debug_names = dwarf_context_->getDebugNames();
+  for (std::string_view key : keys) {
+    for (const llvm::DWARFDebugNames::Entry& entry :
+         debug_names.equal_range(llvm::StringRef(key.data(), key.size()))) {
+      auto cu_offset = entry.getCUOffset();
+      auto die_offset = entry.getDIEUnitOffset();
+      if (!cu_offset || !die_offset) {
+        continue;
+      }
+      llvm::DWARFCompileUnit* cu = dwarf_context_->getCompileUnitForOffset(*cu_offset);
+      if (cu == nullptr) {
+        continue;
+      }
+      DWARFDie die = cu->getDIEForOffset(cu->getOffset() + *die_offset);
+      if (die.isValid()) {
+        dies.push_back(die);
+      }
+    }
+  }
+
+  if (gdb_index_ != nullptr) {
+    for (std::string_view key : keys) {
+      for (uint64_t cu_offset : gdb_index_->Lookup(key)) {
+        // The index only identifies the compilation unit; parse it to find the DIEs.
+        llvm::DWARFCompileUnit* cu = dwarf_context_->getCompileUnitForOffset(cu_offset);
+        if (cu == nullptr) {
+          continue;
+        }
+        for (const llvm::DWARFDebugInfoEntry& entry : cu->dies()) {
+          DWARFDie die = {cu, &entry};
+          if (IsMatchingDIE(short_name, tag, die)) {
+            dies.push_back(die);
+          }
+        }
+      }
+    }
+  }
+
+  // Keep the matches, in the order in which they appear in .debug_info, as IndexDIEs() would.
+  dies.erase(std::remove_if(dies.begin(), dies.end(),
+                            [&](const DWARFDie& die) {
+                              return die.getTag() != tag || QualifiedName(die) != name;
+                            }),
+             dies.end());
+  std::sort(dies.begin(), dies.end(),
+            [](const DWARFDie& a, const DWARFDie& b) { return a.getOffset() < b.getOffset(); });
+  dies.erase(std::unique(dies.begin(), dies.end(),
+                         [](const DWARFDie& a, const DWARFDie& b) {
+                           return a.getOffset() == b.getOffset();
+                         }),
+             dies.end());
+  return dies;
+}
+
+std::optional<DWARFDie> DwarfReader::LazyFindInDIEMap(const std::string& name,
+                                                      llvm::dwarf::Tag tag) {
+  std::optional<DWARFDie> die_opt = FindInDIEMap(name, tag);
+  if (die_opt.has_value() || lazy_misses_.contains({tag, name})) {
+    return die_opt;
+  }
+
+  std::vector<DWARFDie> dies = FindInAccelTables(name, tag);
+  if (!dies.empty()) {
+    // Like IndexDIEs(), prefer the function definition that refers to a declaration.
+    DWARFDie die = dies.front();
+    for (const DWARFDie& d : dies) {
+      if (d.find(llvm::dwarf::DW_AT_specification)) {
+        die = d;
+        break;
+      }
+    }
+    InsertToDIEMap(name, tag, die);
+    return die;
+  }
+
+  if (accel_tables_complete_) {
+    lazy_misses_.insert({tag, name});
+    return std::nullopt;
+  }
+
+  // The accelerator tables are missing (e.g. Go binaries do not have them),
+  // or do not cover all compilation units. Fall back to indexing everything.
+  VLOG(1) << "Accelerator tables cannot resolve symbol, indexing all DIEs: " << name;
+  lazy_indexing_ = false;
+  lazy_misses_.clear();
+  IndexDIEs(std::nullopt);
+  return FindInDIEMap(name, tag);
+}
+
 StatusOr<std::vector<DWARFDie>> DwarfReader::GetMatchingDIEs(
     std::string_view name, std::optional<llvm::dwarf::Tag> type_opt) {
   DCHECK(dwarf_context_ != nullptr);
 
   // Special case for types that are indexed.
+  if (type_opt.has_value() && IsIndexedType(type_opt.value()) && lazy_indexing_) {
+    auto die_opt = LazyFindInDIEMap(std::string(name), type_opt.value());
+    if (die_opt.has_value()) {
+      return std::vector<DWARFDie>{die_opt.value()};
+    }
+    return std::vector<DWARFDie>{};
+  }
   if (type_opt.has_value() && IsIndexedType(type_opt.value()) && !die_map_.empty()) {
     auto die_opt = FindInDIEMap(std::string(name), type_opt.value());
     if (die_opt.has_value()) {
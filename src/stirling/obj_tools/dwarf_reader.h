@@ -22,6 +22,7 @@
 #include <llvm/Support/TargetSelect.h>
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 
 #include <filesystem>
 #include <limits>
@@ -141,6 +142,9 @@ inline bool operator==(const StructSpecEntry& a, const StructSpecEntry& b) {
   return a.offset == b.offset && a.size == b.size && a.type_info == b.type_info && a.path == b.path;
 }
 
+// A parsed .gdb_index section. Defined in dwarf_reader.cc.
+class GdbIndexView;
+
 /**
  * Accepts an executable and reads DWARF information from it.
  * APIs are provided for accessing the needed data.
@@ -161,6 +165,17 @@ class DwarfReader {
   static StatusOr<std::unique_ptr<DwarfReader>> CreateWithSelectiveIndexing(
       const std::filesystem::path& path, const std::vector<SymbolSearchPattern>& symbol_patterns);
 
+  /**
+   * Like CreateIndexingAll(), but builds the index on demand. Lookups of indexed types go
+   * through the .debug_names and .gdb_index accelerator tables, if the binary has them,
+   * so only the compilation units that contain the requested symbols are parsed.
+   * Without (complete) accelerator tables, all DIEs are indexed on the first such lookup.
+   */
+  static StatusOr<std::unique_ptr<DwarfReader>> CreateWithLazyIndexing(
+      const std::filesystem::path& path);
+
+  ~DwarfReader();
+
   /**
    * Searches the debug information for Debugging information entries (DIEs)
    * that match the name.
@@ -294,6 +309,9 @@ class DwarfReader {
   const llvm::dwarf::SourceLanguage& source_language() const { return source_language_; }
   const std::string& compiler() const { return compiler_; }
 
+  // True if lookups are served from accelerator tables, without indexing all DIEs.
+  bool uses_accel_tables() const { return lazy_indexing_ && accel_tables_complete_; }
+
  private:
   DwarfReader(std::unique_ptr<llvm::MemoryBuffer> buffer,
               std::unique_ptr<llvm::DWARFContext> dwarf_context);
@@ -308,6 +326,16 @@ class DwarfReader {
   // Otherwise, only the ones whose names match are indexed.
   void IndexDIEs(const std::optional<std::vector<SymbolSearchPattern>>& symbol_search_patterns_opt);
 
+  // Prepares the accelerator tables for CreateWithLazyIndexing().
+  void InitLazyIndexing();
+
+  // Looks up an indexed type through the accelerator tables, and records the result in die_map_.
+  // Falls back to IndexDIEs() if the accelerator tables cannot answer the lookup.
+  std::optional<llvm::DWARFDie> LazyFindInDIEMap(const std::string& name, llvm::dwarf::Tag tag);
+
+  // Returns the DIEs that the accelerator tables list for the name.
+  std::vector<llvm::DWARFDie> FindInAccelTables(std::string_view name, llvm::dwarf::Tag tag);
+
   // Walks the struct_die for all members, recursively visiting any members which are also structs,
   // to capture information of all base type members of the struct in a flattened form.
   // See GetStructSpec() for the public interface, and the output format.
@@ -328,6 +356,15 @@ class DwarfReader {
 
   // Nested map: [tag][symbol_name] -> DWARFDie
   absl::flat_hash_map<llvm::dwarf::Tag, absl::flat_hash_map<std::string, llvm::DWARFDie>> die_map_;
+
+  // State for CreateWithLazyIndexing(). lazy_indexing_ is reset once all DIEs are indexed.
+  bool lazy_indexing_ = false;
+  std::unique_ptr<GdbIndexView> gdb_index_;
+  // True if the accelerator tables cover all compilation units,
+  // such that a symbol missing from them does not exist.
+  bool accel_tables_complete_ = false;
+  // Lookups that are known to have no match, so they need not be repeated.
+  absl::flat_hash_set<std::pair<llvm::dwarf::Tag, std::string>> lazy_misses_;
 };
 
 }  // namespace obj_tools
@@ -18,6 +18,10 @@
 
 #include <benchmark/benchmark.h>
 
+#include <unistd.h>
+
+#include <fstream>
+
 #include "src/common/base/base.h"
 #include "src/common/testing/test_environment.h"
 #include "src/stirling/obj_tools/dwarf_reader.h"
@@ -29,6 +33,18 @@ constexpr std::string_view kBinary =
     "src/stirling/testing/demo_apps/go_grpc_tls_pl/server/golang_1_16_grpc_tls_server_binary_/"
     "golang_1_16_grpc_tls_server_binary";
 
+// A C++ binary with a .debug_names accelerator table.
+constexpr std::string_view kCppBinary = "src/stirling/obj_tools/testdata/cc/test_exe_debug_names";
+
+// Returns the resident set size of this process, in bytes.
+int64_t ResidentBytes() {
+  std::ifstream statm("/proc/self/statm");
+  int64_t size_pages = 0;
+  int64_t resident_pages = 0;
+  statm >> size_pages >> resident_pages;
+  return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
 struct SymAddrs {
   // Members of net/http.http2serverConn.
   int32_t http2serverConn_conn_offset;
@@ -71,39 +87,79 @@ void GetSymAddrs(DwarfReader* dwarf_reader, SymAddrs* symaddrs) {
               "Fields");
 }
 
+struct CppSymAddrs {
+  int32_t OuterStruct_O1_offset;
+  int32_t MidStruct_M2_offset;
+  int32_t ABCSum32_x_size;
+};
+
+void GetCppSymAddrs(DwarfReader* dwarf_reader, CppSymAddrs* symaddrs) {
+  symaddrs->OuterStruct_O1_offset =
+      dwarf_reader->GetStructMemberOffset("OuterStruct", "O1").ValueOr(-1);
+  symaddrs->MidStruct_M2_offset =
+      dwarf_reader->GetStructMemberOffset("MidStruct", "M2").ValueOr(-1);
+  symaddrs->ABCSum32_x_size = dwarf_reader->GetArgumentTypeByteSize("ABCSum32", "x").ValueOr(-1);
+}
+
+using CreateFn = px::StatusOr<std::unique_ptr<DwarfReader>> (*)(const std::filesystem::path&);
+
+template <typename TSymAddrs>
 // NOLINTNEXTLINE : runtime/references.
-static void BM_noindex(benchmark::State& state) {
+void RunBenchmark(benchmark::State& state, std::string_view binary, CreateFn create_fn,
+                  void (*lookup_fn)(DwarfReader*, TSymAddrs*)) {
   size_t num_lookup_iterations = state.range(0);
+  const std::filesystem::path path = BazelRunfilePath(binary);
 
+  int64_t rss_increase = 0;
   for (auto _ : state) {
-    SymAddrs symaddrs;
+    TSymAddrs symaddrs;
+
+    const int64_t rss_before = ResidentBytes();
 
-    PL_ASSIGN_OR_EXIT(std::unique_ptr<DwarfReader> dwarf_reader,
-                      DwarfReader::CreateWithoutIndexing(kBinary));
+    PL_ASSIGN_OR_EXIT(std::unique_ptr<DwarfReader> dwarf_reader, create_fn(path));
 
     for (size_t i = 0; i < num_lookup_iterations; ++i) {
-      GetSymAddrs(dwarf_reader.get(), &symaddrs);
+      lookup_fn(dwarf_reader.get(), &symaddrs);
       benchmark::DoNotOptimize(symaddrs);
     }
+
+    rss_increase += ResidentBytes() - rss_before;
   }
+
+  // The memory held by the DwarfReader (parsed DIEs, the index, and touched pages of the mapped
+  // binary), averaged over iterations.
+  state.counters["rss_increase_bytes"] =
+      benchmark::Counter(rss_increase, benchmark::Counter::kAvgIterations);
+}
+
+// NOLINTNEXTLINE : runtime/references.
+static void BM_noindex(benchmark::State& state) {
+  RunBenchmark(state, kBinary, DwarfReader::CreateWithoutIndexing, GetSymAddrs);
 }
 
 // NOLINTNEXTLINE : runtime/references.
 static void BM_indexed(benchmark::State& state) {
-  size_t num_lookup_iterations = state.range(0);
+  RunBenchmark(state, kBinary, DwarfReader::CreateIndexingAll, GetSymAddrs);
+}
 
-  for (auto _ : state) {
-    SymAddrs symaddrs;
+// Go binaries have no accelerator tables, so this measures the fallback to indexing all DIEs.
+// NOLINTNEXTLINE : runtime/references.
+static void BM_lazy(benchmark::State& state) {
+  RunBenchmark(state, kBinary, DwarfReader::CreateWithLazyIndexing, GetSymAddrs);
+}
 
-    PL_ASSIGN_OR_EXIT(std::unique_ptr<DwarfReader> dwarf_reader,
-                      DwarfReader::CreateIndexingAll(kBinary));
+// NOLINTNEXTLINE : runtime/references.
+static void BM_cpp_indexed(benchmark::State& state) {
+  RunBenchmark(state, kCppBinary, DwarfReader::CreateIndexingAll, GetCppSymAddrs);
+}
 
-    for (size_t i = 0; i < num_lookup_iterations; ++i) {
-      GetSymAddrs(dwarf_reader.get(), &symaddrs);
-      benchmark::DoNotOptimize(symaddrs);
-    }
-  }
+// NOLINTNEXTLINE : runtime/references.
+static void BM_cpp_lazy(benchmark::State& state) {
+  RunBenchmark(state, kCppBinary, DwarfReader::CreateWithLazyIndexing, GetCppSymAddrs);
 }
 
 BENCHMARK(BM_noindex)->RangeMultiplier(2)->Range(1, 16);
 BENCHMARK(BM_indexed)->RangeMultiplier(2)->Range(1, 16);
+BENCHMARK(BM_lazy)->RangeMultiplier(2)->Range(1, 16);
+BENCHMARK(BM_cpp_indexed)->RangeMultiplier(2)->Range(1, 16);
+BENCHMARK(BM_cpp_lazy)->RangeMultiplier(2)->Range(1, 16);
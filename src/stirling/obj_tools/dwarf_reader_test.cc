@@ -34,6 +34,8 @@ constexpr std::string_view kGoGRPCServer =
     "src/stirling/testing/demo_apps/go_grpc_tls_pl/server/golang_1_16_grpc_tls_server_binary_/"
     "golang_1_16_grpc_tls_server_binary";
 constexpr std::string_view kCppBinary = "src/stirling/obj_tools/testdata/cc/test_exe";
+constexpr std::string_view kCppDebugNamesBinary =
+    "src/stirling/obj_tools/testdata/cc/test_exe_debug_names";
 constexpr std::string_view kGoBinaryUnconventional =
     "src/stirling/obj_tools/testdata/go/sockshop_payments_service";
 
@@ -52,15 +54,22 @@ using ::testing::UnorderedElementsAre;
 // Automatically converts ToString() to stream operator for gtest.
 using ::px::operator<<;
 
+enum class IndexMode { kNone, kAll, kLazy };
+
 struct DwarfReaderTestParam {
-  bool index;
+  IndexMode index;
 };
 
-auto CreateDwarfReader(const std::filesystem::path& path, bool indexing) {
-  if (indexing) {
-    return DwarfReader::CreateIndexingAll(path);
+auto CreateDwarfReader(const std::filesystem::path& path, IndexMode index) {
+  switch (index) {
+    case IndexMode::kAll:
+      return DwarfReader::CreateIndexingAll(path);
+    case IndexMode::kLazy:
+      return DwarfReader::CreateWithLazyIndexing(path);
+    case IndexMode::kNone:
+    default:
+      return DwarfReader::CreateWithoutIndexing(path);
   }
-  return DwarfReader::CreateWithoutIndexing(path);
 }
 
 // TODO(chengruizhe): Make binary path a parameter in the TEST_P for go 1.16, 1.17, and 1.18.
@@ -784,8 +793,38 @@ TEST_P(DwarfReaderTest, GoFunctionVarLocationConsistency) {
 }
 
 INSTANTIATE_TEST_SUITE_P(DwarfReaderParameterizedTest, DwarfReaderTest,
-                         ::testing::Values(DwarfReaderTestParam{true},
-                                           DwarfReaderTestParam{false}));
+                         ::testing::Values(DwarfReaderTestParam{IndexMode::kAll},
+                                           DwarfReaderTestParam{IndexMode::kNone},
+                                           DwarfReaderTestParam{IndexMode::kLazy}));
+
+// Tests that lazy indexing resolves symbols through .debug_names, without indexing all DIEs.
+TEST(DwarfReaderLazyIndexingTest, UsesDebugNames) {
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<DwarfReader> dwarf_reader,
+      DwarfReader::CreateWithLazyIndexing(px::testing::BazelRunfilePath(kCppDebugNamesBinary)));
+  EXPECT_TRUE(dwarf_reader->uses_accel_tables());
+
+  EXPECT_OK_AND_EQ(dwarf_reader->GetStructByteSize("ABCStruct32"), 12);
+  EXPECT_OK_AND_EQ(dwarf_reader->GetStructMemberOffset("OuterStruct", "O1"), 8);
+  EXPECT_OK_AND_EQ(dwarf_reader->GetFunctionRetValInfo("ABCSum32"),
+                   (RetValInfo{TypeInfo{VarType::kStruct, "ABCStruct32"}, 12}));
+  ASSERT_OK_AND_THAT(
+      dwarf_reader->GetMatchingDIEs("non-existent-name", llvm::dwarf::DW_TAG_structure_type),
+      IsEmpty());
+
+  // A symbol missing from complete accelerator tables does not exist, so there is no fallback.
+  EXPECT_TRUE(dwarf_reader->uses_accel_tables());
+}
+
+// Tests that lazy indexing falls back to indexing all DIEs for binaries without accelerator
+// tables, such as Go binaries.
+TEST(DwarfReaderLazyIndexingTest, FallsBackWithoutAccelTables) {
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<DwarfReader> dwarf_reader,
+      DwarfReader::CreateWithLazyIndexing(px::testing::BazelRunfilePath(kTestGoBinary)));
+  EXPECT_FALSE(dwarf_reader->uses_accel_tables());
+  EXPECT_OK_AND_EQ(dwarf_reader->GetStructByteSize("main.Vertex"), 16);
+}
 
 }  // namespace obj_tools
 }  // namespace stirling
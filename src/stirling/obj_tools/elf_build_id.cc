@@ -0,0 +1,192 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/obj_tools/elf_build_id.h"
+
+#include <elf.h>
+
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+#include "src/common/base/utils.h"
+
+// NOLINTNEXTLINE: build/include_subdir
+#include "xxhash.h"
+
+namespace px {
+namespace stirling {
+namespace obj_tools {
+
+namespace {
+struct LowercaseHex {
+  static inline constexpr std::string_view kCharFormat = "%02x";
+  static inline constexpr int kSizePerByte = 2;
+  static inline constexpr bool kKeepPrintableChars = false;
+};
+
+// The type of the note in which the Go linker records the Go build ID (in .note.go.buildid).
+constexpr uint32_t kGoBuildIDNoteType = 4;
+
+// Note sections are typically a few dozen bytes; anything much larger is not worth reading.
+constexpr size_t kMaxNoteSectionSize = 64 * 1024;
+
+template <typename T>
+Status ReadAt(std::ifstream* ifs, uint64_t offset, T* out) {
+  ifs->seekg(offset);
+  if (!ifs->read(reinterpret_cast<char*>(out), sizeof(T))) {
+    return error::Internal("Failed to read $0 bytes at offset $1.", sizeof(T), offset);
+  }
+  return Status::OK();
+}
+
+StatusOr<std::string> ContentHash(const std::filesystem::path& binary) {
+  std::ifstream ifs(binary, std::ios::binary);
+  if (!ifs) {
+    return error::Internal("Could not open $0.", binary.string());
+  }
+
+  XXH64_state_t* state = XXH64_createState();
+  DEFER(XXH64_freeState(state));
+  XXH64_reset(state, /*seed*/ 0);
+
+  constexpr size_t kChunkSize = 1024 * 1024;
+  std::string chunk(kChunkSize, '\0');
+  uint64_t size = 0;
+  while (ifs) {
+    ifs.read(chunk.data(), chunk.size());
+    const std::streamsize n = ifs.gcount();
+    XXH64_update(state, chunk.data(), n);
+    size += n;
+  }
+  if (!ifs.eof()) {
+    return error::Internal("Failed to read $0.", binary.string());
+  }
+
+  return absl::StrCat("xxh64-", size, "-", absl::Hex(XXH64_digest(state), absl::kZeroPad16));
+}
+
+// Returns the description of the first note with the given name and type.
+StatusOr<std::string> ReadELFNote(const std::filesystem::path& binary_path,
+                                  std::string_view note_name, uint32_t note_type) {
+  std::ifstream ifs(binary_path, std::ios::binary);
+  if (!ifs) {
+    return error::Internal("Could not open $0.", binary_path.string());
+  }
+
+  Elf64_Ehdr ehdr;
+  PL_RETURN_IF_ERROR(ReadAt(&ifs, 0, &ehdr));
+  if (memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0 || ehdr.e_ident[EI_CLASS] != ELFCLASS64) {
+    return error::InvalidArgument("$0 is not a 64-bit ELF file.", binary_path.string());
+  }
+  if (ehdr.e_shnum > 0 && ehdr.e_shentsize != sizeof(Elf64_Shdr)) {
+    return error::InvalidArgument("$0 has unexpected section header size $1.",
+                                  binary_path.string(), ehdr.e_shentsize);
+  }
+
+  // Go through all note sections, looking for the note.
+  // Matching on the note, rather than the section name, avoids reading the section name string
+  // table.
+  for (int i = 0; i < ehdr.e_shnum; ++i) {
+    Elf64_Shdr shdr;
+    PL_RETURN_IF_ERROR(ReadAt(&ifs, ehdr.e_shoff + i * sizeof(Elf64_Shdr), &shdr));
+    if (shdr.sh_type != SHT_NOTE || shdr.sh_size > kMaxNoteSectionSize) {
+      continue;
+    }
+
+    std::string note_data(shdr.sh_size, '\0');
+    ifs.seekg(shdr.sh_offset);
+    if (!ifs.read(note_data.data(), note_data.size())) {
+      return error::Internal("Failed to read note section of $0.", binary_path.string());
+    }
+
+    // Process the .note data as {name, description} pairs.
+    std::string_view notes(note_data);
+    while (notes.size() >= sizeof(Elf64_Nhdr)) {
+      Elf64_Nhdr nhdr;
+      memcpy(&nhdr, notes.data(), sizeof(nhdr));
+      notes.remove_prefix(sizeof(nhdr));
+
+      size_t padded_name_size = SnapUpToMultiple<size_t>(nhdr.n_namesz, sizeof(Elf64_Word));
+      size_t padded_desc_size = SnapUpToMultiple<size_t>(nhdr.n_descsz, sizeof(Elf64_Word));
+      if (padded_name_size + padded_desc_size > notes.size()) {
+        break;
+      }
+
+      std::string_view name = notes.substr(0, nhdr.n_namesz);
+      std::string_view desc = notes.substr(padded_name_size, nhdr.n_descsz);
+      notes.remove_prefix(padded_name_size + padded_desc_size);
+
+      if (nhdr.n_type == note_type && name == note_name) {
+        return std::string(desc);
+      }
+    }
+  }
+
+  return error::NotFound("No such note in $0.", binary_path.string());
+}
+}  // namespace
+
+StatusOr<std::string> ReadELFBuildID(const std::filesystem::path& binary_path) {
+  StatusOr<std::string> build_id =
+      ReadELFNote(binary_path, std::string_view("GNU\0", 4), NT_GNU_BUILD_ID);
+  if (error::IsNotFound(build_id.status())) {
+    return error::NotFound("No build-id in $0.", binary_path.string());
+  }
+  PL_RETURN_IF_ERROR(build_id);
+  return BytesToString<LowercaseHex>(build_id.ValueOrDie());
+}
+
+StatusOr<std::string> ReadGoBuildID(const std::filesystem::path& binary_path) {
+  StatusOr<std::string> build_id =
+      ReadELFNote(binary_path, std::string_view("Go\0\0", 4), kGoBuildIDNoteType);
+  if (error::IsNotFound(build_id.status())) {
+    return error::NotFound("No Go build ID in $0.", binary_path.string());
+  }
+  return build_id;
+}
+
+StatusOr<std::string> BinaryContentKey(const std::filesystem::path& binary_path) {
+  // Build IDs survive strip, so a stripped binary shares the build ID of its unstripped original.
+  // The file size tells the two apart.
+  std::error_code ec;
+  const uintmax_t size = std::filesystem::file_size(binary_path, ec);
+  if (ec) {
+    return error::Internal("Could not get the size of $0: $1.", binary_path.string(),
+                           ec.message());
+  }
+
+  StatusOr<std::string> build_id = ReadELFBuildID(binary_path);
+  if (build_id.ok()) {
+    return absl::StrCat("build-id-", build_id.ValueOrDie(), "-", size);
+  }
+  // Go binaries are often linked without a GNU build-id, but have a Go build ID, which includes
+  // a hash of the binary's contents.
+  StatusOr<std::string> go_build_id = ReadGoBuildID(binary_path);
+  if (go_build_id.ok()) {
+    // The Go build ID has '/' separators; hex encode it so that it can be used in file names.
+    return absl::StrCat("go-build-id-", BytesToString<LowercaseHex>(go_build_id.ValueOrDie()),
+                        "-", size);
+  }
+  // Hashing the binary is still much cheaper than analyzing its debug symbols.
+  return ContentHash(binary_path);
+}
+
+}  // namespace obj_tools
+}  // namespace stirling
+}  // namespace px
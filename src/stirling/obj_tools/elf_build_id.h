@@ -0,0 +1,57 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include "src/common/base/base.h"
+
+namespace px {
+namespace stirling {
+namespace obj_tools {
+
+/**
+ * Reads the GNU build-id of an ELF binary. Unlike ElfReader, only the section headers and
+ * the note sections are read, so this is cheap enough to run for every process.
+ *
+ * @param binary_path Path to the binary.
+ * @return The build-id as a lowercase hex string, or NotFound if the binary has none.
+ */
+StatusOr<std::string> ReadELFBuildID(const std::filesystem::path& binary_path);
+
+/**
+ * Reads the Go build ID that the Go linker records in the binary's .note.go.buildid section.
+ *
+ * @param binary_path Path to the binary.
+ * @return The Go build ID (as recorded, e.g. "<action-id>/<content-id>"), or NotFound.
+ */
+StatusOr<std::string> ReadGoBuildID(const std::filesystem::path& binary_path);
+
+/**
+ * Returns a key that identifies the contents of the binary: its build-id or Go build ID if it
+ * has one, otherwise a hash of the file contents. The file size is always part of the key, since
+ * stripping a binary keeps its build ID. Results derived only from the contents of a binary can
+ * be cached under this key.
+ */
+StatusOr<std::string> BinaryContentKey(const std::filesystem::path& binary_path);
+
+}  // namespace obj_tools
+}  // namespace stirling
+}  // namespace px
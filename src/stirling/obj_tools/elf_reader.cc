@@ -24,6 +24,10 @@
 #include <llvm/Support/TargetSelect.h>
 
 #include <absl/container/flat_hash_set.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
 #include <set>
 #include <utility>
 
@@ -47,7 +51,6 @@ struct LowercaseHex {
 }  // namespace
 
 Status ElfReader::LocateDebugSymbols(const std::filesystem::path& debug_file_dir) {
-  std::string build_id;
   std::string debug_link;
   bool found_symtab = false;
 
@@ -80,8 +83,8 @@ Status ElfReader::LocateDebugSymbols(const std::filesystem::path& debug_file_dir
       int32_t desc_pos = 3 * sizeof(int32_t) + name_size;
       std::string_view desc = std::string_view(psec->get_data() + desc_pos, desc_size);
 
-      build_id = BytesToString<LowercaseHex>(desc);
-      VLOG(1) << absl::Substitute("Found build-id: $0", build_id);
+      build_id_ = BytesToString<LowercaseHex>(desc);
+      VLOG(1) << absl::Substitute("Found build-id: $0", build_id_);
     }
 
     // Method 2: .gnu_debuglink.
@@ -109,10 +112,10 @@ Status ElfReader::LocateDebugSymbols(const std::filesystem::path& debug_file_dir
   }
 
   // Try using build-id first.
-  if (!build_id.empty()) {
+  if (!build_id_.empty()) {
     std::filesystem::path symbols_file;
     std::string loc =
-        absl::Substitute(".build-id/$0/$1.debug", build_id.substr(0, 2), build_id.substr(2));
+        absl::Substitute(".build-id/$0/$1.debug", build_id_.substr(0, 2), build_id_.substr(2));
     symbols_file = debug_file_dir / loc;
     VLOG(1) << absl::Substitute("Checking for debug symbols at $0", symbols_file.string());
     if (fs::Exists(symbols_file)) {
@@ -320,6 +323,42 @@ std::optional<int64_t> ElfReader::SymbolAddress(std::string_view symbol) {
   return std::nullopt;
 }
 
+StatusOr<absl::flat_hash_map<std::string, int64_t>> ElfReader::SymbolAddresses(
+    const absl::flat_hash_set<std::string>& search_symbols) {
+  PL_ASSIGN_OR_RETURN(ELFIO::section * symtab_section, SymtabSection());
+
+  absl::flat_hash_map<std::string, int64_t> symbol_addrs;
+  absl::flat_hash_set<std::string> duplicate_symbols;
+
+  const ELFIO::symbol_section_accessor symbols(elf_reader_, symtab_section);
+  for (unsigned int j = 0; j < symbols.get_symbols_num(); ++j) {
+    std::string name;
+    ELFIO::Elf64_Addr addr = 0;
+    ELFIO::Elf_Xword size = 0;
+    unsigned char bind = 0;
+    unsigned char type = ELFIO::STT_NOTYPE;
+    ELFIO::Elf_Half section_index;
+    unsigned char other;
+    symbols.get_symbol(j, name, addr, size, bind, type, section_index, other);
+
+    if (!search_symbols.contains(name)) {
+      continue;
+    }
+
+    auto [iter, inserted] = symbol_addrs.try_emplace(name, addr);
+    if (!inserted && iter->second != static_cast<int64_t>(addr)) {
+      duplicate_symbols.insert(std::move(name));
+    }
+  }
+
+  // Ambiguous symbols are dropped, so callers can fall back to a resolution that knows better.
+  for (const auto& name : duplicate_symbols) {
+    symbol_addrs.erase(name);
+  }
+
+  return symbol_addrs;
+}
+
 StatusOr<std::optional<std::string>> ElfReader::AddrToSymbol(size_t sym_addr) {
   PL_ASSIGN_OR_RETURN(ELFIO::section * symtab_section, SymtabSection());
 
@@ -391,33 +430,91 @@ StatusOr<std::unique_ptr<ElfReader::Symbolizer>> ElfReader::GetSymbolizer() {
     symbols.get_symbol(j, name, addr, size, bind, type, section_index, other);
 
     if (type == ELFIO::STT_FUNC) {
-      symbolizer->AddEntry(addr, size, llvm::demangle(name));
+      // Names are demangled lazily by the symbolizer, as most of them are never looked up.
+      symbolizer->AddEntry(addr, size, name);
     }
   }
+  symbolizer->SortEntries();
 
   return symbolizer;
 }
 
-void ElfReader::Symbolizer::AddEntry(size_t addr, size_t size, std::string name) {
-  symbols_.emplace(addr, SymbolAddrInfo{size, std::move(name)});
+void ElfReader::Symbolizer::AddEntry(uintptr_t addr, size_t size, std::string_view name) {
+  DCHECK_LE(string_table_.size() + name.size(), std::numeric_limits<uint32_t>::max());
+  if (!addrs_.empty() && addr <= addrs_.back()) {
+    sorted_ = false;
+  }
+  addrs_.push_back(addr);
+  entries_.push_back(SymbolAddrInfo{size, static_cast<uint32_t>(string_table_.size()),
+                                    static_cast<uint32_t>(name.size()), kNotDemangled});
+  string_table_.append(name);
 }
 
-std::string_view ElfReader::Symbolizer::Lookup(size_t addr) const {
+void ElfReader::Symbolizer::SortEntries() const {
+  if (sorted_) {
+    return;
+  }
+
+  std::vector<uint32_t> order(addrs_.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [this](uint32_t a, uint32_t b) { return addrs_[a] < addrs_[b]; });
+
+  std::vector<uintptr_t> addrs;
+  std::vector<SymbolAddrInfo> entries;
+  addrs.reserve(addrs_.size());
+  entries.reserve(entries_.size());
+  for (uint32_t i : order) {
+    // If an address has multiple symbols, keep the first one added.
+    if (!addrs.empty() && addrs.back() == addrs_[i]) {
+      continue;
+    }
+    addrs.push_back(addrs_[i]);
+    entries.push_back(entries_[i]);
+  }
+  addrs_ = std::move(addrs);
+  entries_ = std::move(entries);
+  sorted_ = true;
+}
+
+std::string_view ElfReader::Symbolizer::SymbolName(size_t idx) const {
+  SymbolAddrInfo& entry = entries_[idx];
+  std::string_view raw_name(string_table_.data() + entry.name_offset, entry.name_size);
+
+  if (entry.demangled_idx == kNotDemangled) {
+    std::string demangled = llvm::demangle(std::string(raw_name));
+    if (demangled == raw_name) {
+      entry.demangled_idx = kSameAsRaw;
+    } else {
+      entry.demangled_idx = demangled_names_.size();
+      demangled_names_.push_back(std::move(demangled));
+    }
+  }
+
+  if (entry.demangled_idx == kSameAsRaw) {
+    return raw_name;
+  }
+  return demangled_names_[entry.demangled_idx];
+}
+
+std::string_view ElfReader::Symbolizer::Lookup(uintptr_t addr) const {
   static std::string symbol_str;
 
+  SortEntries();
+
   // Find the first symbol for which the address_range_start > addr.
-  auto iter = symbols_.upper_bound(addr);
+  auto iter = std::upper_bound(addrs_.begin(), addrs_.end(), addr);
 
-  if (iter == symbols_.begin() || symbols_.empty()) {
+  if (iter == addrs_.begin()) {
     symbol_str = absl::StrFormat("0x%016llx", addr);
     return symbol_str;
   }
 
   // std::upper_bound will make us overshoot our potential match,
   // so go back by one, and check if it is indeed a match.
-  --iter;
-  if (addr >= iter->first && addr < iter->first + iter->second.size) {
-    return iter->second.name;
+  size_t idx = std::prev(iter) - addrs_.begin();
+  if (addr < addrs_[idx] + entries_[idx].size) {
+    return SymbolName(idx);
   }
 
   // Couldn't find the address.
@@ -425,6 +522,116 @@ std::string_view ElfReader::Symbolizer::Lookup(size_t addr) const {
   return symbol_str;
 }
 
+size_t ElfReader::Symbolizer::MemoryUsage() const {
+  size_t bytes = addrs_.capacity() * sizeof(uintptr_t) +
+                 entries_.capacity() * sizeof(SymbolAddrInfo) + string_table_.capacity();
+  for (const auto& name : demangled_names_) {
+    bytes += sizeof(std::string) + name.capacity();
+  }
+  return bytes;
+}
+
+namespace {
+
+// On-disk layout of a serialized symbol index:
+//   SerializedSymbolIndexHeader
+//   uint64_t addrs[num_symbols]
+//   SerializedSymbolEntry entries[num_symbols]
+//   char string_table[string_table_size]
+// All fields are in host byte order; the index is only meant to be read back on the same host.
+constexpr char kSymbolIndexMagic[8] = {'P', 'X', 'S', 'Y', 'M', 'I', 'D', 'X'};
+constexpr uint32_t kSymbolIndexVersion = 1;
+
+struct SerializedSymbolIndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t num_symbols;
+  uint64_t string_table_size;
+};
+
+struct SerializedSymbolEntry {
+  uint64_t size;
+  uint32_t name_offset;
+  uint32_t name_size;
+};
+
+}  // namespace
+
+std::string ElfReader::Symbolizer::Serialize() const {
+  SortEntries();
+
+  SerializedSymbolIndexHeader header = {};
+  memcpy(header.magic, kSymbolIndexMagic, sizeof(header.magic));
+  header.version = kSymbolIndexVersion;
+  header.num_symbols = addrs_.size();
+  header.string_table_size = string_table_.size();
+
+  std::string buf;
+  buf.reserve(sizeof(header) + addrs_.size() * (sizeof(uint64_t) + sizeof(SerializedSymbolEntry)) +
+              string_table_.size());
+  buf.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (uintptr_t addr : addrs_) {
+    uint64_t addr64 = addr;
+    buf.append(reinterpret_cast<const char*>(&addr64), sizeof(addr64));
+  }
+  for (const auto& entry : entries_) {
+    SerializedSymbolEntry serialized = {entry.size, entry.name_offset, entry.name_size};
+    buf.append(reinterpret_cast<const char*>(&serialized), sizeof(serialized));
+  }
+  buf.append(string_table_);
+  return buf;
+}
+
+StatusOr<std::unique_ptr<ElfReader::Symbolizer>> ElfReader::Symbolizer::Deserialize(
+    std::string_view buf) {
+  SerializedSymbolIndexHeader header;
+  if (buf.size() < sizeof(header)) {
+    return error::InvalidArgument("Symbol index is truncated.");
+  }
+  memcpy(&header, buf.data(), sizeof(header));
+  buf.remove_prefix(sizeof(header));
+
+  if (memcmp(header.magic, kSymbolIndexMagic, sizeof(header.magic)) != 0 ||
+      header.version != kSymbolIndexVersion) {
+    return error::InvalidArgument("Unrecognized symbol index format.");
+  }
+  const uint64_t n = header.num_symbols;
+  if (n > buf.size() || header.string_table_size > buf.size() ||
+      buf.size() != n * (sizeof(uint64_t) + sizeof(SerializedSymbolEntry)) +
+                         header.string_table_size) {
+    return error::InvalidArgument("Symbol index has inconsistent sizes.");
+  }
+
+  auto symbolizer = std::make_unique<Symbolizer>();
+  symbolizer->addrs_.resize(n);
+  symbolizer->entries_.reserve(n);
+
+  for (uint64_t i = 0; i < n; ++i) {
+    uint64_t addr;
+    memcpy(&addr, buf.data() + i * sizeof(uint64_t), sizeof(addr));
+    if (i > 0 && addr <= symbolizer->addrs_[i - 1]) {
+      return error::InvalidArgument("Symbol index addresses are not sorted.");
+    }
+    symbolizer->addrs_[i] = addr;
+  }
+  buf.remove_prefix(n * sizeof(uint64_t));
+
+  for (uint64_t i = 0; i < n; ++i) {
+    SerializedSymbolEntry entry;
+    memcpy(&entry, buf.data() + i * sizeof(entry), sizeof(entry));
+    if (static_cast<uint64_t>(entry.name_offset) + entry.name_size > header.string_table_size) {
+      return error::InvalidArgument("Symbol index name is out of bounds.");
+    }
+    symbolizer->entries_.push_back(
+        SymbolAddrInfo{entry.size, entry.name_offset, entry.name_size, kNotDemangled});
+  }
+  buf.remove_prefix(n * sizeof(SerializedSymbolEntry));
+
+  symbolizer->string_table_ = std::string(buf);
+  return symbolizer;
+}
+
 namespace {
 
 /**
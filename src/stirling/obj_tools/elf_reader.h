@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <deque>
 #include <filesystem>
 #include <memory>
 #include <string>
@@ -25,6 +26,7 @@
 
 #include <absl/container/btree_map.h>
 #include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 
 #include <elfio/elfio.hpp>
 
@@ -50,6 +52,11 @@ class ElfReader {
 
   std::filesystem::path& debug_symbols_path() { return debug_symbols_path_; }
 
+  /**
+   * The GNU build-id of the binary as a lowercase hex string, or empty if it has none.
+   */
+  const std::string& build_id() const { return build_id_; }
+
   struct SymbolInfo {
     std::string name;
     int type = -1;
@@ -95,6 +102,17 @@ class ElfReader {
    */
   std::optional<int64_t> SymbolAddress(std::string_view symbol);
 
+  /**
+   * Like SymbolAddress(), but looks up many symbols with a single pass over the symbol table,
+   * which is much cheaper than calling SymbolAddress() once per symbol on large binaries.
+   *
+   * @param symbols The symbols to search for, as exact matches.
+   * @return Map from symbol to address. Symbols that could not be found, or that are not unique
+   *         in the symbol table, are absent from the map.
+   */
+  StatusOr<absl::flat_hash_map<std::string, int64_t>> SymbolAddresses(
+      const absl::flat_hash_set<std::string>& symbols);
+
   /**
    * Looks up the symbol for an address.
    *
@@ -118,27 +136,77 @@ class ElfReader {
    */
   StatusOr<std::optional<std::string>> InstrAddrToSymbol(size_t addr);
 
+  /**
+   * Address to function name index for a binary.
+   *
+   * The index holds no per-process state, so a single instance can be shared by all processes
+   * running the same binary. Entries are kept in flat arrays sorted by address, with the names
+   * packed in a single string table. Names are demangled lazily, on first lookup.
+   *
+   * Not thread-safe: Lookup() sorts and demangles on demand.
+   */
   class Symbolizer {
    public:
     /**
      * Associate the address range [addr, addr+size] with the provided symbol name.
-     * No checking is performed for overlapping regions, which will result in undefined behavior.
+     * The name may be mangled. No checking is performed for overlapping regions,
+     * which will result in undefined behavior.
      */
-    void AddEntry(uintptr_t addr, size_t size, std::string name);
+    void AddEntry(uintptr_t addr, size_t size, std::string_view name);
 
     /**
      * Lookup the symbol for the specified address.
      */
     std::string_view Lookup(uintptr_t addr) const;
 
+    size_t num_symbols() const { return entries_.size(); }
+
+    /**
+     * Approximate heap memory used by the index, including demangled names produced so far.
+     */
+    size_t MemoryUsage() const;
+
+    /**
+     * Serializes the index into a flat, position-independent buffer, for persisting to disk.
+     * Names are stored as added (i.e. not demangled).
+     */
+    std::string Serialize() const;
+
+    /**
+     * Re-creates an index from the output of Serialize(). The buffer is copied, so it may be
+     * released after the call.
+     */
+    static StatusOr<std::unique_ptr<Symbolizer>> Deserialize(std::string_view buf);
+
    private:
     struct SymbolAddrInfo {
-      size_t size;
-      std::string name;
+      uint64_t size;
+      // Location of the raw (possibly mangled) name in string_table_.
+      uint32_t name_offset;
+      uint32_t name_size;
+      // Index into demangled_names_; kNotDemangled until the first lookup, and kSameAsRaw if
+      // demangling does not change the name.
+      int32_t demangled_idx;
     };
+    static constexpr int32_t kNotDemangled = -1;
+    static constexpr int32_t kSameAsRaw = -2;
+
+    // ElfReader sorts the entries once it has added all of them.
+    friend class ElfReader;
+
+    void SortEntries() const;
+    std::string_view SymbolName(size_t idx) const;
 
-    // Key is an address.
-    absl::btree_map<uintptr_t, SymbolAddrInfo> symbols_;
+    // Parallel arrays, sorted by address on first lookup. The address array is kept separately
+    // so that the binary search touches as little memory as possible.
+    mutable std::vector<uintptr_t> addrs_;
+    mutable std::vector<SymbolAddrInfo> entries_;
+    mutable bool sorted_ = true;
+
+    std::string string_table_;
+
+    // A deque, so that string_views handed out by Lookup() remain valid as names are added.
+    mutable std::deque<std::string> demangled_names_;
   };
 
   StatusOr<std::unique_ptr<Symbolizer>> GetSymbolizer();
@@ -181,6 +249,8 @@ class ElfReader {
 
   std::filesystem::path debug_symbols_path_;
 
+  std::string build_id_;
+
   // Set up an elf reader, so we can extract debug symbols.
   ELFIO::elfio elf_reader_;
 };
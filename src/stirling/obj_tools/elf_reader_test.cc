@@ -18,9 +18,11 @@
 
 #include "src/stirling/obj_tools/elf_reader.h"
 
+#include "src/common/base/file.h"
 #include "src/common/exec/exec.h"
 #include "src/common/testing/test_environment.h"
 #include "src/common/testing/testing.h"
+#include "src/stirling/obj_tools/elf_build_id.h"
 #include "src/stirling/obj_tools/testdata/cc/test_exe_fixture.h"
 
 namespace px {
@@ -141,6 +143,19 @@ TEST(ElfReaderTest, SymbolAddress) {
   }
 }
 
+TEST(ElfReaderTest, SymbolAddresses) {
+  const std::string path = kTestExeFixture.Path().string();
+  ASSERT_OK_AND_ASSIGN(const int64_t find_this_addr, NmSymbolNameToAddr(path, "CanYouFindThis"));
+  ASSERT_OK_AND_ASSIGN(const int64_t main_addr, NmSymbolNameToAddr(path, "main"));
+
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<ElfReader> elf_reader, ElfReader::Create(path));
+
+  ASSERT_OK_AND_ASSIGN(auto symbol_addrs,
+                       elf_reader->SymbolAddresses({"CanYouFindThis", "main", "bogus"}));
+  EXPECT_THAT(symbol_addrs, UnorderedElementsAre(Pair("CanYouFindThis", find_this_addr),
+                                                 Pair("main", main_addr)));
+}
+
 TEST(ElfReaderTest, AddrToSymbol) {
   const std::string path = kTestExeFixture.Path().string();
   const std::string kSymbolName = "CanYouFindThis";
@@ -203,6 +218,36 @@ TEST(ElfReaderTest, ExternalDebugSymbolsBuildID) {
                      ElementsAre(SymbolNameIs("CanYouFindThis")));
 }
 
+TEST(ElfReaderTest, ReadELFBuildID) {
+  const std::string stripped_bin =
+      px::testing::BazelRunfilePath("src/stirling/obj_tools/testdata/cc/stripped_test_exe");
+
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<ElfReader> elf_reader, ElfReader::Create(stripped_bin));
+  ASSERT_FALSE(elf_reader->build_id().empty());
+  EXPECT_OK_AND_EQ(ReadELFBuildID(stripped_bin), elf_reader->build_id());
+
+  EXPECT_NOT_OK(ReadELFBuildID("/bogus"));
+}
+
+// A stripped binary keeps the build-id of its original, so the key must also depend on the size.
+TEST(ElfReaderTest, BinaryContentKeyIncludesSize) {
+  const std::string stripped_bin =
+      px::testing::BazelRunfilePath("src/stirling/obj_tools/testdata/cc/stripped_test_exe");
+  ASSERT_OK_AND_ASSIGN(std::string build_id, ReadELFBuildID(stripped_bin));
+  ASSERT_OK_AND_ASSIGN(std::string key, BinaryContentKey(stripped_bin));
+  EXPECT_EQ(key,
+            absl::StrCat("build-id-", build_id, "-", std::filesystem::file_size(stripped_bin)));
+
+  // Same build-id, different contents.
+  px::testing::TempDir tmp_dir;
+  const std::filesystem::path padded_bin = tmp_dir.path() / "padded_test_exe";
+  ASSERT_OK_AND_ASSIGN(std::string contents, ReadFileToString(stripped_bin));
+  ASSERT_OK(WriteFileFromString(padded_bin.string(), absl::StrCat(contents, "padding")));
+  EXPECT_OK_AND_EQ(ReadELFBuildID(padded_bin), build_id);
+  ASSERT_OK_AND_ASSIGN(std::string padded_key, BinaryContentKey(padded_bin));
+  EXPECT_NE(padded_key, key);
+}
+
 TEST(ElfReaderTest, ExternalDebugSymbolsDebugLink) {
   const std::string stripped_bin =
       px::testing::BazelRunfilePath("src/stirling/obj_tools/testdata/cc/test_exe_debuglink");
@@ -271,6 +316,34 @@ TEST(ElfReaderTest, VersionedSymbolsInDynamicLibrary) {
                                           SymbolNameIs("foo@@VER_2"), SymbolNameIs("foo@VER_1")));
 }
 
+TEST(ElfReaderSymbolizerTest, LookupSortsAndDemanglesLazily) {
+  ElfReader::Symbolizer symbolizer;
+
+  // Entries are added out of order, as they appear in a symbol table.
+  symbolizer.AddEntry(0x2000, 0x10, "_ZN4test3barEv");
+  symbolizer.AddEntry(0x1000, 0x10, "main");
+  symbolizer.AddEntry(0x3000, 0x10, "_ZN4test3fooEv");
+  // Only the first symbol for an address is kept.
+  symbolizer.AddEntry(0x1000, 0x10, "alias_of_main");
+  EXPECT_EQ(symbolizer.num_symbols(), 4);
+
+  EXPECT_EQ(symbolizer.Lookup(0x1000), "main");
+  EXPECT_EQ(symbolizer.Lookup(0x100f), "main");
+  EXPECT_EQ(symbolizer.Lookup(0x2008), "test::bar()");
+  EXPECT_EQ(symbolizer.Lookup(0x3000), "test::foo()");
+  EXPECT_EQ(symbolizer.num_symbols(), 3);
+
+  // Addresses outside of any symbol.
+  EXPECT_EQ(symbolizer.Lookup(0x10), "0x0000000000000010");
+  EXPECT_EQ(symbolizer.Lookup(0x1010), "0x0000000000001010");
+  EXPECT_EQ(symbolizer.Lookup(0x4000), "0x0000000000004000");
+
+  // Names returned earlier remain valid as more names are demangled.
+  std::string_view bar = symbolizer.Lookup(0x2000);
+  symbolizer.Lookup(0x3000);
+  EXPECT_EQ(bar, "test::bar()");
+}
+
 }  // namespace obj_tools
 }  // namespace stirling
 }  // namespace px
@@ -39,6 +39,7 @@
 #include "src/stirling/source_connectors/dynamic_tracer/dynamic_tracing/dwarvifier.h"
 #include "src/stirling/source_connectors/dynamic_tracer/dynamic_tracing/ir/sharedpb/shared.pb.h"
 #include "src/stirling/source_connectors/dynamic_tracer/dynamic_tracing/probe_transformer.h"
+#include "src/stirling/source_connectors/dynamic_tracer/dynamic_tracing/program_cache.h"
 #include "src/stirling/utils/proc_path_tools.h"
 
 DEFINE_bool(debug_dt_pipeline, false, "Enable logging of the Dynamic Tracing pipeline IR graphs.");
@@ -114,24 +115,15 @@ StatusOr<ObjInfo> Prepare(const ir::logical::TracepointDeployment& input_program
 
   const auto& debug_symbols_path = obj_info.elf_reader->debug_symbols_path().string();
 
+  // Tracepoints typically need only a few symbols, so avoid indexing the whole binary when
+  // accelerator tables can locate them.
   obj_info.dwarf_reader =
-      DwarfReader::CreateIndexingAll(debug_symbols_path).ConsumeValueOr(nullptr);
+      DwarfReader::CreateWithLazyIndexing(debug_symbols_path).ConsumeValueOr(nullptr);
 
   return obj_info;
 }
 
-}  // namespace
-
-StatusOr<BCCProgram> CompileProgram(ir::logical::TracepointDeployment* input_program) {
-  if (input_program->deployment_spec().path().empty()) {
-    return error::InvalidArgument("Must have path resolved before compiling program");
-  }
-
-  if (input_program->tracepoints_size() != 1) {
-    return error::InvalidArgument("Only one tracepoint currently supported, got '$0'",
-                                  input_program->tracepoints_size());
-  }
-
+StatusOr<BCCProgram> Compile(ir::logical::TracepointDeployment* input_program) {
   // Get the ELF and DWARF readers for the program.
   PL_ASSIGN_OR_RETURN(ObjInfo obj_info, Prepare(*input_program));
 
@@ -205,6 +197,43 @@ StatusOr<BCCProgram> CompileProgram(ir::logical::TracepointDeployment* input_pro
   return bcc_program;
 }
 
+}  // namespace
+
+StatusOr<BCCProgram> CompileProgram(ir::logical::TracepointDeployment* input_program) {
+  if (input_program->deployment_spec().path().empty()) {
+    return error::InvalidArgument("Must have path resolved before compiling program");
+  }
+
+  if (input_program->tracepoints_size() != 1) {
+    return error::InvalidArgument("Only one tracepoint currently supported, got '$0'",
+                                  input_program->tracepoints_size());
+  }
+
+  const std::string binary_path = input_program->deployment_spec().path();
+
+  // Must be computed before compiling, which modifies the input program.
+  StatusOr<std::string> key = BCCProgramCache::Key(*input_program);
+  LOG_IF(WARNING, !key.ok()) << absl::Substitute(
+      "Dynamic tracing program for $0 will not be cached: $1", binary_path, key.ToString());
+
+  BCCProgramCache& cache = BCCProgramCache::Global();
+  if (key.ok()) {
+    std::optional<BCCProgram> cached = cache.Lookup(key.ValueOrDie(), binary_path);
+    if (cached.has_value()) {
+      LOG(INFO) << absl::Substitute("Reusing compiled dynamic tracing program $0 for $1.",
+                                    key.ValueOrDie(), binary_path);
+      return std::move(cached.value());
+    }
+  }
+
+  PL_ASSIGN_OR_RETURN(BCCProgram bcc_program, Compile(input_program));
+
+  if (key.ok()) {
+    cache.Insert(key.ValueOrDie(), bcc_program);
+  }
+  return bcc_program;
+}
+
 namespace {
 
 Status CheckPIDStartTime(const ProcParser& proc_parser, int32_t pid, int64_t spec_start_time) {
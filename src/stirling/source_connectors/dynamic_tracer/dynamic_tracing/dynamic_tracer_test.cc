@@ -105,7 +105,7 @@ class ResolveTargetObjPathTest : public ::testing::Test {
     ASSERT_OK(k8s_mds_.HandlePodUpdate(pod0_update));
     ASSERT_OK(k8s_mds_.HandlePodUpdate(pod1_update));
 
-    k8s_mds_.containers_by_id()["container0"]->mutable_active_upids()->emplace(
+    k8s_mds_.MutableContainerInfoByID("container0")->mutable_active_upids()->emplace(
         PIDToUPID(s_.child_pid()));
   }
 
@@ -0,0 +1,430 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/source_connectors/dynamic_tracer/dynamic_tracing/program_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "src/common/base/file.h"
+#include "src/common/fs/fs_wrapper.h"
+#include "src/stirling/obj_tools/elf_build_id.h"
+
+// NOLINTNEXTLINE: build/include_subdir
+#include "xxhash.h"
+
+DEFINE_string(stirling_dt_program_cache_dir, "",
+              "If set, compiled dynamic tracing programs are persisted in this directory "
+              "(keyed by the tracepoint specification and the target binary's build-id or "
+              "content hash), so they can be reused after a restart. Empty keeps the programs in "
+              "memory only.");
+DEFINE_uint64(stirling_dt_program_cache_max_bytes,
+              px::stirling::dynamic_tracing::BCCProgramCache::kDefaultMaxDiskBytes,
+              "Maximum total size of the programs in --stirling_dt_program_cache_dir. Least "
+              "recently used programs are removed when it is exceeded.");
+
+namespace px {
+namespace stirling {
+namespace dynamic_tracing {
+
+namespace {
+
+// Serialized format:
+//   SerializedProgramHeader
+//   char code[code_size]
+//   num_uprobes x {SerializedUProbe, char symbol[symbol_size], char probe_fn[probe_fn_size]}
+//   num_perf_buffers x {SerializedPerfBuffer, char name[name_size], char output[output_size]}
+// where output is the serialized ir::physical::Struct proto.
+// All fields are in host byte order; programs are only meant to be read back on the same host.
+constexpr char kProgramMagic[8] = {'P', 'X', 'D', 'T', 'P', 'R', 'O', 'G'};
+constexpr uint32_t kProgramVersion = 1;
+
+// Bump to invalidate cached programs when the compilation pipeline changes its output.
+constexpr std::string_view kKeyVersion = "v1";
+
+constexpr std::string_view kEntryExtension = ".dtprog";
+
+struct SerializedProgramHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_uprobes;
+  uint32_t num_perf_buffers;
+  uint32_t reserved;
+  uint64_t code_size;
+};
+
+struct SerializedUProbe {
+  uint64_t address;
+  uint32_t attach_type;
+  uint32_t symbol_size;
+  uint32_t probe_fn_size;
+  uint32_t reserved;
+};
+
+struct SerializedPerfBuffer {
+  uint32_t name_size;
+  uint32_t output_size;
+};
+
+template <typename T>
+void Append(const T& value, std::string* buf) {
+  buf->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+Status Consume(std::string_view* buf, T* value) {
+  if (buf->size() < sizeof(T)) {
+    return error::InvalidArgument("Dynamic tracing program is truncated.");
+  }
+  memcpy(value, buf->data(), sizeof(T));
+  buf->remove_prefix(sizeof(T));
+  return Status::OK();
+}
+
+Status ConsumeString(std::string_view* buf, size_t size, std::string* value) {
+  if (buf->size() < size) {
+    return error::InvalidArgument("Dynamic tracing program is truncated.");
+  }
+  value->assign(buf->data(), size);
+  buf->remove_prefix(size);
+  return Status::OK();
+}
+
+}  // namespace
+
+std::string BCCProgramCache::Serialize(const BCCProgram& program) {
+  SerializedProgramHeader header = {};
+  memcpy(header.magic, kProgramMagic, sizeof(header.magic));
+  header.version = kProgramVersion;
+  header.num_uprobes = program.uprobe_specs.size();
+  header.num_perf_buffers = program.perf_buffer_specs.size();
+  header.code_size = program.code.size();
+
+  std::string buf;
+  Append(header, &buf);
+  buf.append(program.code);
+
+  for (const auto& spec : program.uprobe_specs) {
+    SerializedUProbe serialized = {};
+    serialized.address = spec.address;
+    serialized.attach_type = static_cast<uint32_t>(spec.attach_type);
+    serialized.symbol_size = spec.symbol.size();
+    serialized.probe_fn_size = spec.probe_fn.size();
+    Append(serialized, &buf);
+    buf.append(spec.symbol);
+    buf.append(spec.probe_fn);
+  }
+
+  for (const auto& spec : program.perf_buffer_specs) {
+    const std::string output = spec.output.SerializeAsString();
+    SerializedPerfBuffer serialized = {};
+    serialized.name_size = spec.name.size();
+    serialized.output_size = output.size();
+    Append(serialized, &buf);
+    buf.append(spec.name);
+    buf.append(output);
+  }
+
+  return buf;
+}
+
+StatusOr<BCCProgram> BCCProgramCache::Deserialize(std::string_view buf) {
+  SerializedProgramHeader header;
+  PL_RETURN_IF_ERROR(Consume(&buf, &header));
+  if (memcmp(header.magic, kProgramMagic, sizeof(header.magic)) != 0 ||
+      header.version != kProgramVersion) {
+    return error::InvalidArgument("Unrecognized dynamic tracing program format.");
+  }
+  // Reject bogus counts before reserving space for them.
+  if (header.num_uprobes > buf.size() / sizeof(SerializedUProbe) ||
+      header.num_perf_buffers > buf.size() / sizeof(SerializedPerfBuffer)) {
+    return error::InvalidArgument("Dynamic tracing program has inconsistent counts.");
+  }
+
+  BCCProgram program;
+  PL_RETURN_IF_ERROR(ConsumeString(&buf, header.code_size, &program.code));
+
+  program.uprobe_specs.reserve(header.num_uprobes);
+  for (uint32_t i = 0; i < header.num_uprobes; ++i) {
+    SerializedUProbe serialized;
+    PL_RETURN_IF_ERROR(Consume(&buf, &serialized));
+    bpf_tools::UProbeSpec spec;
+    spec.address = serialized.address;
+    spec.attach_type = static_cast<bpf_tools::BPFProbeAttachType>(serialized.attach_type);
+    PL_RETURN_IF_ERROR(ConsumeString(&buf, serialized.symbol_size, &spec.symbol));
+    PL_RETURN_IF_ERROR(ConsumeString(&buf, serialized.probe_fn_size, &spec.probe_fn));
+    program.uprobe_specs.push_back(std::move(spec));
+  }
+
+  program.perf_buffer_specs.reserve(header.num_perf_buffers);
+  for (uint32_t i = 0; i < header.num_perf_buffers; ++i) {
+    SerializedPerfBuffer serialized;
+    PL_RETURN_IF_ERROR(Consume(&buf, &serialized));
+    BCCProgram::PerfBufferSpec spec;
+    PL_RETURN_IF_ERROR(ConsumeString(&buf, serialized.name_size, &spec.name));
+    std::string output;
+    PL_RETURN_IF_ERROR(ConsumeString(&buf, serialized.output_size, &output));
+    if (!spec.output.ParseFromString(output)) {
+      return error::InvalidArgument("Dynamic tracing program has a malformed output struct.");
+    }
+    program.perf_buffer_specs.push_back(std::move(spec));
+  }
+
+  if (!buf.empty()) {
+    return error::InvalidArgument("Dynamic tracing program has trailing bytes.");
+  }
+
+  return program;
+}
+
+BCCProgramCache::BCCProgramCache(std::filesystem::path dir, size_t max_in_memory_entries,
+                                 size_t max_disk_bytes)
+    : dir_(std::move(dir)),
+      max_in_memory_entries_(std::max<size_t>(max_in_memory_entries, 1)),
+      max_disk_bytes_(max_disk_bytes) {
+  if (dir_.empty()) {
+    return;
+  }
+  Status s = fs::CreateDirectories(dir_);
+  if (!s.ok()) {
+    LOG(WARNING) << absl::Substitute("Dynamic tracing programs will not be persisted: $0",
+                                     s.ToString());
+    return;
+  }
+  LoadDiskIndex();
+}
+
+BCCProgramCache& BCCProgramCache::Global() {
+  static BCCProgramCache cache(FLAGS_stirling_dt_program_cache_dir, kDefaultMaxInMemoryEntries,
+                               FLAGS_stirling_dt_program_cache_max_bytes);
+  return cache;
+}
+
+void BCCProgramCache::LoadDiskIndex() {
+  absl::MutexLock lock(&mutex_);
+  std::error_code ec;
+  for (const auto& dir_entry : std::filesystem::directory_iterator(dir_, ec)) {
+    const std::filesystem::path& path = dir_entry.path();
+    if (!dir_entry.is_regular_file(ec)) {
+      continue;
+    }
+    if (path.extension() != kEntryExtension) {
+      // Most likely a partial write from a previous run.
+      std::filesystem::remove(path, ec);
+      continue;
+    }
+    const size_t bytes = dir_entry.file_size(ec);
+    if (ec) {
+      continue;
+    }
+    disk_entries_[path.stem().string()] = DiskEntry{bytes, dir_entry.last_write_time(ec)};
+    disk_bytes_ += bytes;
+  }
+  LOG_IF(WARNING, ec) << absl::Substitute("Failed to list dynamic tracing programs in $0: $1",
+                                          dir_.string(), ec.message());
+  EvictFromDisk();
+}
+
+StatusOr<std::string> BCCProgramCache::Key(const ir::logical::TracepointDeployment& program) {
+  const std::string& binary_path = program.deployment_spec().path();
+  if (binary_path.empty()) {
+    return error::InvalidArgument("Must have path resolved before computing the cache key.");
+  }
+  PL_ASSIGN_OR_RETURN(std::string binary_key, obj_tools::BinaryContentKey(binary_path));
+
+  // The TTL does not affect compilation, and the target is already covered by the binary key.
+  ir::logical::TracepointDeployment spec = program;
+  spec.clear_ttl();
+  spec.clear_deployment_spec();
+
+  // Text format is deterministic (unlike the binary wire format, in the presence of maps).
+  const std::string spec_str = absl::StrCat(kKeyVersion, spec.ShortDebugString());
+  return absl::StrCat(binary_key, "-",
+                      absl::Hex(XXH64(spec_str.data(), spec_str.size(), /*seed*/ 0),
+                                absl::kZeroPad16));
+}
+
+std::filesystem::path BCCProgramCache::EntryPath(const std::string& key) const {
+  return dir_ / absl::StrCat(key, kEntryExtension);
+}
+
+std::optional<BCCProgram> BCCProgramCache::Lookup(const std::string& key,
+                                                  const std::string& binary_path) {
+  std::shared_ptr<const BCCProgram> program;
+  bool on_disk = false;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto iter = programs_.find(key);
+    if (iter != programs_.end()) {
+      iter->second.last_use = ++use_count_;
+      program = iter->second.program;
+    } else {
+      on_disk = disk_entries_.contains(key);
+    }
+  }
+
+  if (program == nullptr) {
+    if (!on_disk) {
+      return std::nullopt;
+    }
+    const std::filesystem::path path = EntryPath(key);
+    StatusOr<BCCProgram> program_or = error::NotFound("");
+    StatusOr<std::string> buf = ReadFileToString(path.string());
+    if (buf.ok()) {
+      program_or = Deserialize(buf.ValueOrDie());
+    } else {
+      program_or = buf.status();
+    }
+
+    absl::MutexLock lock(&mutex_);
+    if (!program_or.ok()) {
+      VLOG(1) << absl::Substitute("Ignoring dynamic tracing program $0: $1", path.string(),
+                                  program_or.ToString());
+      RemoveFromDisk(key);
+      return std::nullopt;
+    }
+    // Record the use, in memory and on disk, for LRU eviction.
+    auto disk_iter = disk_entries_.find(key);
+    if (disk_iter != disk_entries_.end()) {
+      std::error_code ec;
+      disk_iter->second.last_use = std::filesystem::file_time_type::clock::now();
+      std::filesystem::last_write_time(path, disk_iter->second.last_use, ec);
+    }
+    program = std::make_shared<const BCCProgram>(program_or.ConsumeValueOrDie());
+    Remember(key, program);
+  }
+
+  BCCProgram result = *program;
+  for (auto& spec : result.uprobe_specs) {
+    spec.binary_path = binary_path;
+  }
+  return result;
+}
+
+void BCCProgramCache::Insert(const std::string& key, const BCCProgram& program) {
+  BCCProgram entry = program;
+  // The binary path is filled back in on lookup.
+  for (auto& spec : entry.uprobe_specs) {
+    spec.binary_path.clear();
+  }
+  auto shared_entry = std::make_shared<const BCCProgram>(std::move(entry));
+
+  if (dir_.empty()) {
+    absl::MutexLock lock(&mutex_);
+    Remember(key, std::move(shared_entry));
+    return;
+  }
+
+  const std::string buf = Serialize(*shared_entry);
+  const std::filesystem::path path = EntryPath(key);
+  // Write to a temporary file first, so that a crash never leaves a partial program behind.
+  // The rename happens under the lock, so that it is ordered with evictions of the same key.
+  const std::filesystem::path tmp_path = absl::StrCat(
+      path.string(), ".", std::hash<std::thread::id>{}(std::this_thread::get_id()), ".tmp");
+  Status s = buf.size() <= max_disk_bytes_
+                 ? WriteFileFromString(tmp_path.string(), buf)
+                 : error::ResourceUnavailable("Program is larger than the cache [bytes=$0].",
+                                              buf.size());
+
+  absl::MutexLock lock(&mutex_);
+  std::error_code ec;
+  if (s.ok()) {
+    std::filesystem::rename(tmp_path, path, ec);
+  }
+  if (s.ok() && !ec) {
+    auto [iter, inserted] = disk_entries_.try_emplace(key, DiskEntry{0, {}});
+    disk_bytes_ -= iter->second.bytes;
+    iter->second = DiskEntry{buf.size(), std::filesystem::file_time_type::clock::now()};
+    disk_bytes_ += buf.size();
+    EvictFromDisk();
+  } else {
+    std::filesystem::remove(tmp_path, ec);
+    VLOG(1) << absl::Substitute("Failed to persist dynamic tracing program $0: $1",
+                                path.string(), s.ok() ? ec.message() : s.msg());
+  }
+  Remember(key, std::move(shared_entry));
+}
+
+void BCCProgramCache::Remember(const std::string& key,
+                               std::shared_ptr<const BCCProgram> program) {
+  programs_.insert_or_assign(key, MemoryEntry{std::move(program), ++use_count_});
+  // Lookups return copies, so evicted programs are never in use. The scan is linear, but only
+  // runs when a program is added, which follows a much more expensive compilation or file read.
+  while (programs_.size() > max_in_memory_entries_) {
+    auto lru = std::min_element(programs_.begin(), programs_.end(),
+                                [](const auto& a, const auto& b) {
+                                  return a.second.last_use < b.second.last_use;
+                                });
+    programs_.erase(lru);
+  }
+}
+
+void BCCProgramCache::RemoveFromDisk(const std::string& key) {
+  std::error_code ec;
+  std::filesystem::remove(EntryPath(key), ec);
+  auto iter = disk_entries_.find(key);
+  if (iter == disk_entries_.end()) {
+    return;
+  }
+  disk_bytes_ -= iter->second.bytes;
+  disk_entries_.erase(iter);
+}
+
+void BCCProgramCache::EvictFromDisk() {
+  if (disk_bytes_ <= max_disk_bytes_) {
+    return;
+  }
+
+  std::vector<std::pair<std::filesystem::file_time_type, std::string>> lru;
+  lru.reserve(disk_entries_.size());
+  for (const auto& [key, entry] : disk_entries_) {
+    lru.emplace_back(entry.last_use, key);
+  }
+  std::sort(lru.begin(), lru.end());
+
+  for (const auto& [last_use, key] : lru) {
+    if (disk_bytes_ <= max_disk_bytes_) {
+      break;
+    }
+    VLOG(1) << absl::Substitute("Evicting dynamic tracing program $0 from disk.", key);
+    RemoveFromDisk(key);
+  }
+}
+
+size_t BCCProgramCache::size() const {
+  absl::MutexLock lock(&mutex_);
+  return programs_.size();
+}
+
+size_t BCCProgramCache::num_disk_entries() const {
+  absl::MutexLock lock(&mutex_);
+  return disk_entries_.size();
+}
+
+size_t BCCProgramCache::disk_bytes() const {
+  absl::MutexLock lock(&mutex_);
+  return disk_bytes_;
+}
+
+}  // namespace dynamic_tracing
+}  // namespace stirling
+}  // namespace px
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+
+#include "src/common/base/base.h"
+#include "src/stirling/source_connectors/dynamic_tracer/dynamic_tracing/ir/logicalpb/logical.pb.h"
+#include "src/stirling/source_connectors/dynamic_tracer/dynamic_tracing/types.h"
+
+DECLARE_string(stirling_dt_program_cache_dir);
+DECLARE_uint64(stirling_dt_program_cache_max_bytes);
+
+namespace px {
+namespace stirling {
+namespace dynamic_tracing {
+
+/**
+ * Caches the output of CompileProgram(), so that re-deploying a tracepoint (e.g. when its TTL is
+ * renewed, or the same tracepoint is deployed to identical binaries) skips the DWARF analysis and
+ * code generation.
+ *
+ * Entries are content-addressed: the key covers the tracepoint specification and the contents of
+ * the target binary, but not its path, which is filled back in on lookup.
+ *
+ * Both the in-memory and the on-disk entries are bounded; the least recently used programs are
+ * evicted first.
+ *
+ * Thread-safe, since tracepoints are deployed from concurrent threads.
+ */
+class BCCProgramCache : public NotCopyMoveable {
+ public:
+  static constexpr size_t kDefaultMaxInMemoryEntries = 256;
+  static constexpr size_t kDefaultMaxDiskBytes = 64 * 1024 * 1024;
+
+  /**
+   * @param dir Directory in which programs are persisted; empty to only keep them in memory.
+   * @param max_in_memory_entries Beyond this, the least recently used programs are evicted from
+   *                              memory (but are still found in dir).
+   * @param max_disk_bytes Beyond this total size, the least recently used programs are removed
+   *                       from dir.
+   */
+  explicit BCCProgramCache(std::filesystem::path dir = {},
+                           size_t max_in_memory_entries = kDefaultMaxInMemoryEntries,
+                           size_t max_disk_bytes = kDefaultMaxDiskBytes);
+
+  /**
+   * The process-wide cache used by CompileProgram(), persisted in
+   * FLAGS_stirling_dt_program_cache_dir, up to FLAGS_stirling_dt_program_cache_max_bytes.
+   */
+  static BCCProgramCache& Global();
+
+  /**
+   * Returns the cache key of the program. The deployment_spec path must already be resolved.
+   */
+  static StatusOr<std::string> Key(const ir::logical::TracepointDeployment& program);
+
+  /**
+   * Returns the program with the given key, with its uprobes retargeted to binary_path,
+   * or nullopt if it is not cached.
+   */
+  std::optional<BCCProgram> Lookup(const std::string& key, const std::string& binary_path);
+
+  void Insert(const std::string& key, const BCCProgram& program);
+
+  /**
+   * Number of programs held in memory.
+   */
+  size_t size() const;
+
+  /**
+   * Number and total size of the programs persisted in dir.
+   */
+  size_t num_disk_entries() const;
+  size_t disk_bytes() const;
+
+  static std::string Serialize(const BCCProgram& program);
+  static StatusOr<BCCProgram> Deserialize(std::string_view buf);
+
+ private:
+  struct MemoryEntry {
+    std::shared_ptr<const BCCProgram> program;
+    uint64_t last_use;
+  };
+
+  struct DiskEntry {
+    size_t bytes;
+    std::filesystem::file_time_type last_use;
+  };
+
+  std::filesystem::path EntryPath(const std::string& key) const;
+
+  // Indexes the programs persisted by previous runs, and enforces max_disk_bytes_ on them.
+  void LoadDiskIndex();
+
+  // Records the program in memory, evicting the least recently used programs if needed.
+  void Remember(const std::string& key, std::shared_ptr<const BCCProgram> program)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  void RemoveFromDisk(const std::string& key) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Removes least recently used programs from dir until their total size is at most
+  // max_disk_bytes_.
+  void EvictFromDisk() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const std::filesystem::path dir_;
+  const size_t max_in_memory_entries_;
+  const size_t max_disk_bytes_;
+
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, MemoryEntry> programs_ ABSL_GUARDED_BY(mutex_);
+  uint64_t use_count_ ABSL_GUARDED_BY(mutex_) = 0;
+
+  absl::flat_hash_map<std::string, DiskEntry> disk_entries_ ABSL_GUARDED_BY(mutex_);
+  size_t disk_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace dynamic_tracing
+}  // namespace stirling
+}  // namespace px
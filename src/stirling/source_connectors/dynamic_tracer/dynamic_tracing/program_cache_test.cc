@@ -0,0 +1,232 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/source_connectors/dynamic_tracer/dynamic_tracing/program_cache.h"
+
+#include <string>
+
+#include "src/common/base/file.h"
+#include "src/common/testing/testing.h"
+
+namespace px {
+namespace stirling {
+namespace dynamic_tracing {
+
+using ::google::protobuf::TextFormat;
+using ::px::testing::proto::EqualsProto;
+using ::testing::SizeIs;
+using ::testing::StartsWith;
+
+namespace {
+
+constexpr std::string_view kTracepointDeployment = R"(
+name: "test_tracepoint"
+ttl { seconds: $0 }
+deployment_spec {
+  path: "$1"
+}
+tracepoints {
+  table_name: "$2"
+  program {
+    probes: {
+      name: "probe0"
+      tracepoint: {
+        symbol: "main.Foo"
+        type: LOGICAL
+      }
+    }
+  }
+}
+)";
+
+constexpr std::string_view kOutputStruct = R"(
+name: "probe0_output_t"
+fields {
+  name: "tgid_"
+  type: INT32
+}
+fields {
+  name: "f1"
+  type: STRING
+}
+)";
+
+ir::logical::TracepointDeployment Deployment(int ttl_seconds, const std::filesystem::path& path,
+                                             std::string_view table_name) {
+  ir::logical::TracepointDeployment deployment;
+  CHECK(TextFormat::ParseFromString(
+      absl::Substitute(kTracepointDeployment, ttl_seconds, path.string(), table_name),
+      &deployment));
+  return deployment;
+}
+
+BCCProgram SampleProgram(const std::string& binary_path) {
+  BCCProgram program;
+  program.code = "int probe0(struct pt_regs* ctx) { return 0; }";
+  program.uprobe_specs.push_back({binary_path, "main.Foo", /*address*/ 0,
+                                  bpf_tools::UProbeSpec::kDefaultPID,
+                                  bpf_tools::BPFProbeAttachType::kEntry, "probe0"});
+  program.uprobe_specs.push_back({binary_path, /*symbol*/ {}, /*address*/ 0x4a1b2c,
+                                  bpf_tools::UProbeSpec::kDefaultPID,
+                                  bpf_tools::BPFProbeAttachType::kEntry, "probe0_return"});
+  BCCProgram::PerfBufferSpec perf_buffer;
+  perf_buffer.name = "probe0_output";
+  CHECK(TextFormat::ParseFromString(std::string(kOutputStruct), &perf_buffer.output));
+  program.perf_buffer_specs.push_back(std::move(perf_buffer));
+  return program;
+}
+
+void ExpectEqual(const BCCProgram& expected, const BCCProgram& actual) {
+  EXPECT_EQ(actual.code, expected.code);
+  ASSERT_THAT(actual.uprobe_specs, SizeIs(expected.uprobe_specs.size()));
+  for (size_t i = 0; i < expected.uprobe_specs.size(); ++i) {
+    EXPECT_EQ(actual.uprobe_specs[i].ToString(), expected.uprobe_specs[i].ToString());
+  }
+  ASSERT_THAT(actual.perf_buffer_specs, SizeIs(expected.perf_buffer_specs.size()));
+  for (size_t i = 0; i < expected.perf_buffer_specs.size(); ++i) {
+    EXPECT_EQ(actual.perf_buffer_specs[i].name, expected.perf_buffer_specs[i].name);
+    EXPECT_THAT(actual.perf_buffer_specs[i].output,
+                EqualsProto(expected.perf_buffer_specs[i].output.DebugString()));
+  }
+}
+
+}  // namespace
+
+TEST(BCCProgramCacheTest, SerializeRoundTrip) {
+  // Binary paths are not serialized; they are filled back in on lookup.
+  const BCCProgram program = SampleProgram("");
+  ASSERT_OK_AND_ASSIGN(BCCProgram deserialized,
+                       BCCProgramCache::Deserialize(BCCProgramCache::Serialize(program)));
+  ExpectEqual(program, deserialized);
+}
+
+TEST(BCCProgramCacheTest, DeserializeRejectsCorruptData) {
+  const std::string buf = BCCProgramCache::Serialize(SampleProgram(""));
+  EXPECT_NOT_OK(BCCProgramCache::Deserialize(""));
+  EXPECT_NOT_OK(BCCProgramCache::Deserialize(std::string_view(buf).substr(0, buf.size() - 1)));
+  EXPECT_NOT_OK(BCCProgramCache::Deserialize(buf + "x"));
+  EXPECT_NOT_OK(BCCProgramCache::Deserialize(std::string(buf.size(), 'x')));
+}
+
+TEST(BCCProgramCacheTest, KeyCoversSpecAndBinaryContents) {
+  px::testing::TempDir tmp_dir;
+  const std::filesystem::path a = tmp_dir.path() / "a";
+  const std::filesystem::path b = tmp_dir.path() / "b";
+  const std::filesystem::path c = tmp_dir.path() / "c";
+  ASSERT_OK(WriteFileFromString(a.string(), "not an ELF file"));
+  ASSERT_OK(WriteFileFromString(b.string(), "not an ELF file"));
+  ASSERT_OK(WriteFileFromString(c.string(), "not an ELF file either"));
+
+  ASSERT_OK_AND_ASSIGN(std::string key, BCCProgramCache::Key(Deployment(10, a, "foo")));
+  EXPECT_THAT(key, StartsWith("xxh64-"));
+
+  // Neither the TTL nor the path of an identical binary affect compilation.
+  EXPECT_OK_AND_EQ(BCCProgramCache::Key(Deployment(20, a, "foo")), key);
+  EXPECT_OK_AND_EQ(BCCProgramCache::Key(Deployment(10, b, "foo")), key);
+
+  ASSERT_OK_AND_ASSIGN(std::string other_binary_key,
+                       BCCProgramCache::Key(Deployment(10, c, "foo")));
+  EXPECT_NE(other_binary_key, key);
+  ASSERT_OK_AND_ASSIGN(std::string other_spec_key, BCCProgramCache::Key(Deployment(10, a, "bar")));
+  EXPECT_NE(other_spec_key, key);
+
+  EXPECT_NOT_OK(BCCProgramCache::Key(Deployment(10, "", "foo")));
+}
+
+TEST(BCCProgramCacheTest, LookupRetargetsBinaryPath) {
+  BCCProgramCache cache;
+  EXPECT_FALSE(cache.Lookup("key", "/a").has_value());
+
+  cache.Insert("key", SampleProgram("/a"));
+  EXPECT_EQ(cache.size(), 1);
+
+  std::optional<BCCProgram> program = cache.Lookup("key", "/b");
+  ASSERT_TRUE(program.has_value());
+  ExpectEqual(SampleProgram("/b"), program.value());
+}
+
+TEST(BCCProgramCacheTest, PersistsAcrossInstances) {
+  px::testing::TempDir tmp_dir;
+
+  {
+    BCCProgramCache cache(tmp_dir.path());
+    cache.Insert("key", SampleProgram("/a"));
+  }
+
+  BCCProgramCache cache(tmp_dir.path());
+  EXPECT_EQ(cache.size(), 0);
+  std::optional<BCCProgram> program = cache.Lookup("key", "/a");
+  ASSERT_TRUE(program.has_value());
+  ExpectEqual(SampleProgram("/a"), program.value());
+  EXPECT_EQ(cache.size(), 1);
+
+  EXPECT_FALSE(cache.Lookup("other_key", "/a").has_value());
+}
+
+TEST(BCCProgramCacheTest, IgnoresCorruptEntries) {
+  px::testing::TempDir tmp_dir;
+  ASSERT_OK(WriteFileFromString((tmp_dir.path() / "key.dtprog").string(), "garbage"));
+
+  BCCProgramCache cache(tmp_dir.path());
+  EXPECT_FALSE(cache.Lookup("key", "/a").has_value());
+  EXPECT_FALSE(std::filesystem::exists(tmp_dir.path() / "key.dtprog"));
+}
+
+TEST(BCCProgramCacheTest, EvictsLeastRecentlyUsedFromMemory) {
+  BCCProgramCache cache(/*dir*/ {}, /*max_in_memory_entries*/ 2);
+  cache.Insert("a", SampleProgram("/a"));
+  cache.Insert("b", SampleProgram("/a"));
+  // Using a makes b the least recently used.
+  EXPECT_TRUE(cache.Lookup("a", "/a").has_value());
+  cache.Insert("c", SampleProgram("/a"));
+
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_TRUE(cache.Lookup("a", "/a").has_value());
+  EXPECT_FALSE(cache.Lookup("b", "/a").has_value());
+  EXPECT_TRUE(cache.Lookup("c", "/a").has_value());
+}
+
+TEST(BCCProgramCacheTest, CapsDiskUsage) {
+  px::testing::TempDir tmp_dir;
+  const size_t program_bytes = BCCProgramCache::Serialize(SampleProgram("")).size();
+
+  {
+    BCCProgramCache cache(tmp_dir.path(), /*max_in_memory_entries*/ 1,
+                          /*max_disk_bytes*/ 2 * program_bytes);
+    cache.Insert("a", SampleProgram("/a"));
+    cache.Insert("b", SampleProgram("/a"));
+    cache.Insert("c", SampleProgram("/a"));
+
+    EXPECT_EQ(cache.num_disk_entries(), 2);
+    EXPECT_EQ(cache.disk_bytes(), 2 * program_bytes);
+    EXPECT_FALSE(std::filesystem::exists(tmp_dir.path() / "a.dtprog"));
+    EXPECT_FALSE(cache.Lookup("a", "/a").has_value());
+    // b is no longer in memory, but is still found on disk.
+    EXPECT_TRUE(cache.Lookup("b", "/a").has_value());
+  }
+
+  // A smaller cap also applies to the programs persisted by a previous run.
+  BCCProgramCache cache(tmp_dir.path(), /*max_in_memory_entries*/ 1,
+                        /*max_disk_bytes*/ program_bytes);
+  EXPECT_EQ(cache.num_disk_entries(), 1);
+  EXPECT_EQ(cache.disk_bytes(), program_bytes);
+}
+
+}  // namespace dynamic_tracing
+}  // namespace stirling
+}  // namespace px
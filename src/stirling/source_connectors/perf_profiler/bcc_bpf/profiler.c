@@ -115,3 +115,160 @@ int sample_call_stack(struct bpf_perf_event_data* ctx) {
 
   return 0;
 }
+
+//-----------------------------------------------------------------------------
+// Blocked (off-CPU and futex wait) stack traces.
+//-----------------------------------------------------------------------------
+
+// The following probes are only attached when off-CPU or futex contention profiling is enabled.
+// They record the stack trace of a thread when it blocks, and charge the time it stays blocked to
+// that stack trace. Stack traces are recorded in the same stack trace maps as sampled stack
+// traces, and the blocked time is accumulated in the blocked_a or blocked_b map that belongs to
+// the same map set.
+
+// The maximum number of threads that can concurrently be tracked while blocked.
+#define kMaxBlockedThreads 65536
+
+// Cmd values of futex(2), see include/uapi/linux/futex.h.
+#define kFutexWait 0
+#define kFutexLockPI 6
+#define kFutexWaitBitset 9
+#define kFutexWaitRequeuePI 11
+#define kFutexLockPI2 13
+#define kFutexCmdMask 0x7f
+
+// Task states of threads that are switched out because they block, see include/linux/sched.h.
+// Preempted threads are still runnable: they report TASK_RUNNING (0), or TASK_REPORT_MAX since
+// kernel 4.14, so prev_state must be masked rather than compared to 0.
+#define kTaskInterruptible 0x1
+#define kTaskUninterruptible 0x2
+
+struct blocked_start_t {
+  uint64_t timestamp_ns;
+
+  // The transfer count when the thread blocked, which identifies the map set that holds the
+  // stack trace.
+  uint64_t transfer_count;
+
+  struct stack_trace_key_t stack_trace_key;
+};
+
+BPF_HASH(blocked_a, struct blocked_stack_trace_key_t, struct blocked_time_t,
+         CFG_BLOCKED_STACK_TRACE_ENTRIES);
+BPF_HASH(blocked_b, struct blocked_stack_trace_key_t, struct blocked_time_t,
+         CFG_BLOCKED_STACK_TRACE_ENTRIES);
+
+// Keyed by thread ID. LRU maps, so that threads that exit while blocked are eventually evicted.
+BPF_TABLE("lru_hash", uint32_t, struct blocked_start_t, off_cpu_start, kMaxBlockedThreads);
+BPF_TABLE("lru_hash", uint32_t, struct blocked_start_t, futex_wait_start, kMaxBlockedThreads);
+
+// Records the current thread's stack trace, and the current time, into start.
+// Returns false if the stack trace could not be recorded.
+static __inline bool record_blocked_start(void* ctx, struct blocked_start_t* start) {
+  int transfer_count_idx = kTransferCountIdx;
+  uint64_t* transfer_count_ptr = profiler_state.lookup(&transfer_count_idx);
+  if (transfer_count_ptr == NULL) {
+    return false;
+  }
+
+  __builtin_memset(start, 0, sizeof(*start));
+  start->timestamp_ns = bpf_ktime_get_ns();
+  start->transfer_count = *transfer_count_ptr;
+  start->stack_trace_key.upid.tgid = bpf_get_current_pid_tgid() >> 32;
+  start->stack_trace_key.upid.start_time_ticks = get_tgid_start_time();
+
+  if (start->transfer_count % 2 == 0) {
+    start->stack_trace_key.user_stack_id = stack_traces_a.get_stackid(ctx, BPF_F_USER_STACK);
+    start->stack_trace_key.kernel_stack_id = stack_traces_a.get_stackid(ctx, 0);
+  } else {
+    start->stack_trace_key.user_stack_id = stack_traces_b.get_stackid(ctx, BPF_F_USER_STACK);
+    start->stack_trace_key.kernel_stack_id = stack_traces_b.get_stackid(ctx, 0);
+  }
+
+  return start->stack_trace_key.user_stack_id >= 0 || start->stack_trace_key.kernel_stack_id >= 0;
+}
+
+// Charges the time since start to the stack trace recorded in start.
+static __inline void record_blocked_end(const struct blocked_start_t* start, uint32_t reason) {
+  int transfer_count_idx = kTransferCountIdx;
+  uint64_t* transfer_count_ptr = profiler_state.lookup(&transfer_count_idx);
+  if (transfer_count_ptr == NULL) {
+    return;
+  }
+
+  // If user-space has switched map sets since the thread blocked, the stack trace has been (or is
+  // being) consumed, and its stack-ids are no longer valid. Drop the blocked time.
+  if (*transfer_count_ptr != start->transfer_count) {
+    return;
+  }
+
+  struct blocked_stack_trace_key_t key;
+  __builtin_memset(&key, 0, sizeof(key));
+  key.stack_trace_key = start->stack_trace_key;
+  key.reason = reason;
+
+  struct blocked_time_t zero = {};
+  struct blocked_time_t* blocked_time = NULL;
+  if (start->transfer_count % 2 == 0) {
+    blocked_time = blocked_a.lookup_or_init(&key, &zero);
+  } else {
+    blocked_time = blocked_b.lookup_or_init(&key, &zero);
+  }
+  if (blocked_time == NULL) {
+    return;
+  }
+
+  __sync_fetch_and_add(&blocked_time->blocked_ns, bpf_ktime_get_ns() - start->timestamp_ns);
+  __sync_fetch_and_add(&blocked_time->count, 1);
+}
+
+// Off-CPU: the thread being switched out is still the current thread, so its stack trace is
+// recorded here; the thread being switched in is charged with the time it was off-CPU.
+TRACEPOINT_PROBE(sched, sched_switch) {
+  // Only account for threads that block; preempted threads are not blocked.
+  uint32_t prev_tid = args->prev_pid;
+  if (prev_tid != 0 && (args->prev_state & (kTaskInterruptible | kTaskUninterruptible)) != 0) {
+    struct blocked_start_t start;
+    if (record_blocked_start(args, &start)) {
+      off_cpu_start.update(&prev_tid, &start);
+    }
+  }
+
+  uint32_t next_tid = args->next_pid;
+  struct blocked_start_t* start = off_cpu_start.lookup(&next_tid);
+  if (start != NULL) {
+    record_blocked_end(start, kBlockedReasonOffCPU);
+    off_cpu_start.delete(&next_tid);
+  }
+
+  return 0;
+}
+
+// Futex contention: time spent in futex waits, i.e. waiting on contended user-space locks and
+// condition variables.
+TRACEPOINT_PROBE(syscalls, sys_enter_futex) {
+  int cmd = args->op & kFutexCmdMask;
+  if (cmd != kFutexWait && cmd != kFutexWaitBitset && cmd != kFutexLockPI &&
+      cmd != kFutexLockPI2 && cmd != kFutexWaitRequeuePI) {
+    return 0;
+  }
+
+  uint32_t tid = bpf_get_current_pid_tgid();
+  struct blocked_start_t start;
+  if (record_blocked_start(args, &start)) {
+    futex_wait_start.update(&tid, &start);
+  }
+
+  return 0;
+}
+
+TRACEPOINT_PROBE(syscalls, sys_exit_futex) {
+  uint32_t tid = bpf_get_current_pid_tgid();
+  struct blocked_start_t* start = futex_wait_start.lookup(&tid);
+  if (start != NULL) {
+    record_blocked_end(start, kBlockedReasonFutexWait);
+    futex_wait_start.delete(&tid);
+  }
+
+  return 0;
+}
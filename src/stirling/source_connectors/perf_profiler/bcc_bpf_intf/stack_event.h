@@ -50,6 +50,29 @@ struct stack_trace_key_t {
   int kernel_stack_id;
 };
 
+// Why a thread was blocked, for stack traces recorded with a blocked time.
+static const uint32_t kBlockedReasonOffCPU = 0;
+static const uint32_t kBlockedReasonFutexWait = 1;
+
+struct blocked_stack_trace_key_t {
+  // The stack trace of the thread, when it blocked.
+  struct stack_trace_key_t stack_trace_key;
+
+  // One of kBlockedReason*.
+  uint32_t reason;
+
+  // Explicit padding, so that the key can be zero-initialized as a BPF map key.
+  uint32_t unused;
+};
+
+struct blocked_time_t {
+  // Total time blocked, in nanoseconds.
+  uint64_t blocked_ns;
+
+  // Number of times the thread blocked.
+  uint64_t count;
+};
+
 // Bit positions in the error status bitfield:
 static const uint32_t kOverflowBitPos = 0;
 static const uint32_t kMapReadFailureBitPos = 1;
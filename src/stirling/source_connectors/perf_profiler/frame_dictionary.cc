@@ -0,0 +1,72 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/source_connectors/perf_profiler/frame_dictionary.h"
+
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_split.h>
+
+#include "src/stirling/source_connectors/perf_profiler/shared/symbolization.h"
+
+namespace px {
+namespace stirling {
+
+uint64_t FrameDictionary::Lookup(std::string_view frame, time_point now) {
+  auto iter = frames_.find(frame);
+  if (iter == frames_.end()) {
+    iter = frames_.emplace(std::string(frame), Frame{next_id_++, now, time_point{}, false}).first;
+  } else {
+    iter->second.referenced = now;
+    if (iter->second.pending || now - iter->second.published < republish_period_) {
+      return iter->second.id;
+    }
+  }
+
+  iter->second.pending = true;
+  pending_.push_back(iter->first);
+  return iter->second.id;
+}
+
+void FrameDictionary::EvictUnreferenced(time_point now) {
+  for (auto iter = frames_.begin(); iter != frames_.end();) {
+    const Frame& frame = iter->second;
+    if (!frame.pending && now - frame.referenced >= republish_period_) {
+      frames_.erase(iter++);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+std::string FrameDictionary::FrameIDs(std::string_view folded_stack_trace, time_point now) {
+  std::string frame_ids;
+  if (folded_stack_trace.empty()) {
+    return frame_ids;
+  }
+  frame_ids.reserve(folded_stack_trace.size() / 4);
+  for (std::string_view frame : absl::StrSplit(folded_stack_trace, symbolization::kSeparator)) {
+    if (!frame_ids.empty()) {
+      frame_ids.append(symbolization::kSeparator);
+    }
+    absl::StrAppend(&frame_ids, Lookup(frame, now));
+  }
+  return frame_ids;
+}
+
+}  // namespace stirling
+}  // namespace px
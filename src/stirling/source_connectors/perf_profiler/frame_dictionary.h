@@ -0,0 +1,103 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <absl/container/node_hash_map.h>
+
+namespace px {
+namespace stirling {
+
+// The FrameDictionary assigns an integer ID to each distinct stack frame (i.e. symbol), which
+// remains stable while the frame is in use. This allows stack traces to be recorded as short
+// lists of frame IDs, while the symbols themselves are recorded only once, in a separate table.
+//
+// Table store data eventually expires, so a frame that is referenced again after a long period
+// (the republish period) is recorded again. This keeps the symbols of recently referenced
+// frames available to queries.
+//
+// Frames that are not referenced for a republish period are evicted, so that the dictionary does
+// not grow with every symbol ever seen (e.g. JIT compiled code). An evicted frame that is
+// referenced again is assigned a new ID; IDs are never reused.
+class FrameDictionary {
+ public:
+  using time_point = std::chrono::steady_clock::time_point;
+
+  explicit FrameDictionary(std::chrono::nanoseconds republish_period)
+      : republish_period_(republish_period) {}
+
+  /**
+   * Returns the ID of the frame, assigning a new one if the frame was not seen before.
+   * Marks the frame to be published if it is new, or was last published too long ago.
+   */
+  uint64_t Lookup(std::string_view frame, time_point now);
+
+  /**
+   * Converts a folded stack trace string into the IDs of its frames, in the same order and
+   * using the same separator, e.g. "main;foo;bar" => "3;17;5".
+   */
+  std::string FrameIDs(std::string_view folded_stack_trace, time_point now);
+
+  /**
+   * Calls fn(frame_id, frame) for each frame that needs to be published, and marks it published.
+   */
+  template <typename TFn>
+  void ConsumePending(TFn fn, time_point now) {
+    for (const std::string_view symbol : pending_) {
+      Frame& frame = frames_.find(symbol)->second;
+      fn(frame.id, symbol);
+      frame.pending = false;
+      frame.published = now;
+    }
+    pending_.clear();
+  }
+
+  /**
+   * Removes the frames that have not been referenced for a republish period, and are not pending.
+   */
+  void EvictUnreferenced(time_point now);
+
+  size_t size() const { return frames_.size(); }
+  size_t num_pending() const { return pending_.size(); }
+
+ private:
+  struct Frame {
+    uint64_t id;
+    time_point referenced;
+    time_point published;
+    bool pending = false;
+  };
+
+  const std::chrono::nanoseconds republish_period_;
+
+  uint64_t next_id_ = 0;
+
+  // Keyed by symbol. A node map, so that the views of the keys held in pending_ remain valid.
+  absl::node_hash_map<std::string, Frame> frames_;
+
+  // Symbols of the frames to be published.
+  std::vector<std::string_view> pending_;
+};
+
+}  // namespace stirling
+}  // namespace px
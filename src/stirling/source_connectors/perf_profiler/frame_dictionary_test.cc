@@ -0,0 +1,100 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/common/testing/testing.h"
+#include "src/stirling/source_connectors/perf_profiler/frame_dictionary.h"
+
+namespace px {
+namespace stirling {
+
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+std::vector<std::pair<uint64_t, std::string>> ConsumePending(FrameDictionary* dict,
+                                                             FrameDictionary::time_point now) {
+  std::vector<std::pair<uint64_t, std::string>> frames;
+  dict->ConsumePending(
+      [&frames](uint64_t id, std::string_view frame) { frames.emplace_back(id, frame); }, now);
+  return frames;
+}
+
+TEST(FrameDictionary, FrameIDs) {
+  FrameDictionary dict(std::chrono::minutes(30));
+  const FrameDictionary::time_point now;
+
+  EXPECT_EQ(dict.FrameIDs("main;foo;bar", now), "0;1;2");
+  EXPECT_EQ(dict.FrameIDs("main;foo;baz;[k] do_syscall", now), "0;1;3;4");
+  EXPECT_EQ(dict.FrameIDs("", now), "");
+  EXPECT_EQ(dict.size(), 5);
+
+  EXPECT_THAT(ConsumePending(&dict, now),
+              ElementsAre(Pair(0, "main"), Pair(1, "foo"), Pair(2, "bar"), Pair(3, "baz"),
+                          Pair(4, "[k] do_syscall")));
+  EXPECT_EQ(dict.num_pending(), 0);
+}
+
+TEST(FrameDictionary, RepublishesAfterPeriod) {
+  FrameDictionary dict(std::chrono::minutes(30));
+  FrameDictionary::time_point now;
+
+  EXPECT_EQ(dict.Lookup("main", now), 0);
+  EXPECT_EQ(dict.Lookup("foo", now), 1);
+  EXPECT_EQ(ConsumePending(&dict, now).size(), 2);
+
+  // Recently published frames are not published again.
+  now += std::chrono::minutes(10);
+  EXPECT_EQ(dict.Lookup("main", now), 0);
+  EXPECT_EQ(dict.num_pending(), 0);
+
+  // After the republish period, referenced frames are published again, with the same ID.
+  now += std::chrono::minutes(30);
+  EXPECT_EQ(dict.Lookup("main", now), 0);
+  EXPECT_EQ(dict.Lookup("main", now), 0);
+  EXPECT_THAT(ConsumePending(&dict, now), ElementsAre(Pair(0, "main")));
+}
+
+TEST(FrameDictionary, EvictsUnreferencedFrames) {
+  FrameDictionary dict(std::chrono::minutes(30));
+  FrameDictionary::time_point now;
+
+  EXPECT_EQ(dict.FrameIDs("main;foo", now), "0;1");
+  EXPECT_EQ(ConsumePending(&dict, now).size(), 2);
+
+  now += std::chrono::minutes(20);
+  EXPECT_EQ(dict.FrameIDs("main;bar", now), "0;2");
+
+  // Frames that are not referenced for a republish period are evicted, unless still pending.
+  now += std::chrono::minutes(30);
+  dict.EvictUnreferenced(now);
+  EXPECT_EQ(dict.size(), 1);
+
+  EXPECT_THAT(ConsumePending(&dict, now), ElementsAre(Pair(2, "bar")));
+  dict.EvictUnreferenced(now);
+  EXPECT_EQ(dict.size(), 0);
+
+  // An evicted frame gets a new ID when referenced again.
+  EXPECT_EQ(dict.FrameIDs("main", now), "3");
+  EXPECT_THAT(ConsumePending(&dict, now), ElementsAre(Pair(3, "main")));
+}
+
+}  // namespace stirling
+}  // namespace px
@@ -27,9 +27,20 @@
 #include <vector>
 
 #include "src/stirling/bpf_tools/macros.h"
+#include "src/stirling/utils/monitor.h"
 
 BPF_SRC_STRVIEW(profiler_bcc_script, profiler);
 
+namespace {
+constexpr std::string_view kSamplingProbeFn = "sample_call_stack";
+
+const auto kOffCPUTracepointSpecs = MakeArray<px::stirling::bpf_tools::TracepointSpec>(
+    {{"sched:sched_switch", "tracepoint__sched__sched_switch"}});
+const auto kFutexContentionTracepointSpecs = MakeArray<px::stirling::bpf_tools::TracepointSpec>(
+    {{"syscalls:sys_enter_futex", "tracepoint__syscalls__sys_enter_futex"},
+     {"syscalls:sys_exit_futex", "tracepoint__syscalls__sys_exit_futex"}});
+}  // namespace
+
 DEFINE_string(stirling_profiler_symbolizer, "bcc",
               "Choice of which symbolizer to use. Options: bcc, elf");
 DEFINE_bool(stirling_profiler_cache_symbols, true, "Whether to cache symbols");
@@ -40,6 +51,29 @@ DEFINE_uint32(stirling_profiler_table_update_period_seconds,
               "Number of seconds between profiler table updates.");
 DEFINE_uint32(stirling_profiler_stack_trace_sample_period_ms, 11,
               "Number of milliseconds between stack trace samples.");
+DEFINE_double(stirling_profiler_overhead_budget_percent, 1.0,
+              "Budget for the profiler's user-space overhead, in percent of one CPU. When the "
+              "cost of processing stack traces exceeds it, the stack trace sampling period is "
+              "increased, up to stirling_profiler_max_stack_trace_sample_period_ms. "
+              "Zero keeps the sampling period fixed.");
+DEFINE_uint32(stirling_profiler_max_stack_trace_sample_period_ms, 100,
+              "Upper bound for the stack trace sampling period, when it is adapted to the "
+              "overhead budget.");
+DEFINE_bool(stirling_profiler_off_cpu, false,
+            "If true, the stack traces at which threads are switched off-CPU while blocked are "
+            "recorded, weighted by the time they stay blocked, in blocked_stack_traces.beta.");
+DEFINE_bool(stirling_profiler_futex_contention, false,
+            "If true, the stack traces at which threads wait on a futex (i.e. on a contended lock) "
+            "are recorded, weighted by the time they wait, in blocked_stack_traces.beta.");
+DEFINE_bool(stirling_profiler_normalized_stack_traces, false,
+            "If true, stack traces are recorded as lists of frame IDs, in "
+            "normalized_stack_traces.beta, with the frame symbols recorded once in "
+            "stack_frames.beta. Otherwise, stack traces are recorded as folded strings in "
+            "stack_traces.beta.");
+DEFINE_uint32(stirling_profiler_frame_republish_period_minutes, 30,
+              "Number of minutes after which a frame that is still in use is recorded again in "
+              "stack_frames.beta, so that it does not expire from the table store. Frames that "
+              "are not referenced for this period are dropped from the frame dictionary.");
 
 // Scaling factor is sized to avoid hash table collisions and timing variations.
 DEFINE_double(stirling_profiler_stack_trace_size_factor, 3.0,
@@ -58,9 +92,15 @@ PerfProfileConnector::PerfProfileConnector(std::string_view source_name)
     : SourceConnector(source_name, kTables),
       stack_trace_sampling_period_(
           std::chrono::milliseconds{FLAGS_stirling_profiler_stack_trace_sample_period_ms}),
+      sampling_period_controller_(
+          stack_trace_sampling_period_,
+          std::chrono::milliseconds{FLAGS_stirling_profiler_max_stack_trace_sample_period_ms},
+          FLAGS_stirling_profiler_overhead_budget_percent / 100.0),
       sampling_period_(
           std::chrono::milliseconds{1000 * FLAGS_stirling_profiler_table_update_period_seconds}),
       push_period_(sampling_period_ / 2),
+      frame_dictionary_(
+          std::chrono::minutes(FLAGS_stirling_profiler_frame_republish_period_minutes)),
       stats_log_interval_(std::chrono::minutes(FLAGS_stirling_profiler_log_period_minutes) /
                           sampling_period_) {
   constexpr auto kMaxSamplingPeriod = std::chrono::milliseconds{30000};
@@ -68,6 +108,25 @@ PerfProfileConnector::PerfProfileConnector(std::string_view source_name)
   DCHECK(sampling_period_ >= stack_trace_sampling_period_);
 }
 
+namespace {
+
+bool BlockedProfilingEnabled() {
+  return FLAGS_stirling_profiler_off_cpu || FLAGS_stirling_profiler_futex_contention;
+}
+
+std::string_view BlockedReasonName(uint32_t reason) {
+  switch (reason) {
+    case kBlockedReasonOffCPU:
+      return "off_cpu";
+    case kBlockedReasonFutexWait:
+      return "futex_wait";
+    default:
+      return "unknown";
+  }
+}
+
+}  // namespace
+
 Status PerfProfileConnector::InitImpl() {
   sampling_freq_mgr_.set_period(sampling_period_);
   push_freq_mgr_.set_period(push_period_);
@@ -75,6 +134,8 @@ Status PerfProfileConnector::InitImpl() {
   const size_t ncpus = get_nprocs_conf();
 
   // Compute sizes of eBPF data structures:
+  // The sizes are computed for the initial sampling period, which is also the shortest one the
+  // sampling period controller may pick, so they remain sufficient as the period adapts.
 
   // Given the targeted "transfer period" and the "stack trace sample period",
   // we can find the number of entries required to be allocated in each of the maps,
@@ -88,9 +149,11 @@ Status PerfProfileConnector::InitImpl() {
   // Include some margin to ensure that hash collisions and data races do not cause data drop:
   const double stack_traces_overprovision_factor = FLAGS_stirling_profiler_stack_trace_size_factor;
 
-  // Compute the size of the stack traces map.
-  const int32_t provisioned_stack_traces =
-      static_cast<int32_t>(stack_traces_overprovision_factor * expected_stack_traces);
+  // Compute the size of the stack traces map. Stack traces of blocked threads are recorded in
+  // the same map, so provision for as many of those as for sampled stack traces.
+  const int32_t blocked_factor = BlockedProfilingEnabled() ? 2 : 1;
+  const int32_t provisioned_stack_traces = static_cast<int32_t>(
+      blocked_factor * stack_traces_overprovision_factor * expected_stack_traces);
 
   // A threshold for checking that we've overrun the maps.
   // This should be higher than expected_stack_traces due to timing variations,
@@ -120,10 +183,11 @@ Status PerfProfileConnector::InitImpl() {
   const std::vector<std::string> defines = {
       absl::Substitute("-DCFG_STACK_TRACE_ENTRIES=$0", provisioned_stack_traces),
       absl::Substitute("-DCFG_OVERRUN_THRESHOLD=$0", overrun_threshold),
+      absl::Substitute("-DCFG_BLOCKED_STACK_TRACE_ENTRIES=$0", provisioned_stack_traces),
   };
 
   const auto probe_specs = MakeArray<bpf_tools::SamplingProbeSpec>(
-      {"sample_call_stack", static_cast<uint64_t>(stack_trace_sampling_period_.count())});
+      {kSamplingProbeFn, static_cast<uint64_t>(stack_trace_sampling_period_.count())});
 
   const auto perf_buffer_specs = MakeArray<bpf_tools::PerfBufferSpec>(
       {{"histogram_a", HandleHistoEvent, HandleHistoLoss, perf_buffer_size},
@@ -132,6 +196,14 @@ Status PerfProfileConnector::InitImpl() {
   PL_RETURN_IF_ERROR(InitBPFProgram(profiler_bcc_script, defines));
   PL_RETURN_IF_ERROR(AttachSamplingProbes(probe_specs));
   PL_RETURN_IF_ERROR(OpenPerfBuffers(perf_buffer_specs, this));
+  if (FLAGS_stirling_profiler_off_cpu) {
+    PL_RETURN_IF_ERROR(AttachTracepoints(kOffCPUTracepointSpecs));
+    LOG(INFO) << "PerfProfiler: Off-CPU profiling enabled.";
+  }
+  if (FLAGS_stirling_profiler_futex_contention) {
+    PL_RETURN_IF_ERROR(AttachTracepoints(kFutexContentionTracepointSpecs));
+    LOG(INFO) << "PerfProfiler: Futex contention profiling enabled.";
+  }
 
   stack_traces_a_ = std::make_unique<ebpf::BPFStackTable>(GetStackTable("stack_traces_a"));
   stack_traces_b_ = std::make_unique<ebpf::BPFStackTable>(GetStackTable("stack_traces_b"));
@@ -142,13 +214,30 @@ Status PerfProfileConnector::InitImpl() {
   profiler_state_ =
       std::make_unique<ebpf::BPFArrayTable<uint64_t>>(GetArrayTable<uint64_t>("profiler_state"));
 
+  blocked_a_ = std::make_unique<BlockedStackTraceTable>(
+      GetHashTable<blocked_stack_trace_key_t, blocked_time_t>("blocked_a"));
+  blocked_b_ = std::make_unique<BlockedStackTraceTable>(
+      GetHashTable<blocked_stack_trace_key_t, blocked_time_t>("blocked_b"));
+
   LOG(INFO) << "PerfProfiler: Stack trace profiling sampling probe successfully deployed.";
 
   // Create a symbolizer for user symbols.
   if (FLAGS_stirling_profiler_symbolizer == "bcc") {
     PL_ASSIGN_OR_RETURN(u_symbolizer_, BCCSymbolizer::Create());
   } else if (FLAGS_stirling_profiler_symbolizer == "elf") {
-    PL_ASSIGN_OR_RETURN(u_symbolizer_, ElfSymbolizer::Create());
+    std::unique_ptr<SymbolIndexDiskCache> disk_cache;
+    if (!FLAGS_stirling_profiler_symbol_disk_cache_dir.empty()) {
+      auto disk_cache_status =
+          SymbolIndexDiskCache::Open(FLAGS_stirling_profiler_symbol_disk_cache_dir,
+                                     FLAGS_stirling_profiler_symbol_disk_cache_max_bytes);
+      if (disk_cache_status.ok()) {
+        disk_cache = disk_cache_status.ConsumeValueOrDie();
+      } else {
+        LOG(WARNING) << absl::Substitute("Continuing without on-disk symbol cache: $0",
+                                         disk_cache_status.ToString());
+      }
+    }
+    PL_ASSIGN_OR_RETURN(u_symbolizer_, ElfSymbolizer::Create(std::move(disk_cache)));
   } else {
     return error::Internal("Unrecognized symbolizer $0", FLAGS_stirling_profiler_symbolizer);
   }
@@ -157,7 +246,8 @@ Status PerfProfileConnector::InitImpl() {
   // Kernel symbolizer always uses BCC symbolizer.
   PL_ASSIGN_OR_RETURN(k_symbolizer_, BCCSymbolizer::Create());
 
-  if (FLAGS_stirling_profiler_java_symbols) {
+  if (FLAGS_stirling_profiler_java_symbols &&
+      !StirlingMonitor::GetInstance()->java_symbols_disabled()) {
     LOG(INFO) << "PerfProfiler: Java symbolization enabled.";
     PL_ASSIGN_OR_RETURN(u_symbolizer_, JavaSymbolizer::Create(std::move(u_symbolizer_)));
   } else {
@@ -219,8 +309,40 @@ void PerfProfileConnector::CleanupSymbolizers(const absl::flat_hash_set<md::UPID
   }
 }
 
+namespace {
+
+// Returns the folded stack trace string of key, if its process is to be symbolized.
+std::string StackTraceString(const stack_trace_key_t& key, bool symbolize,
+                             Stringifier* stringifier, ebpf::BPFStackTable* stack_traces,
+                             absl::flat_hash_set<int>* k_stack_ids_to_remove) {
+  if (symbolize) {
+    // The stringifier clears stack-ids out of the stack traces table when it
+    // first encounters them. If a stack-id is reused by a different stack-trace-key,
+    // the stringifier returns its memoized stack trace string. Because the stack-ids
+    // are not stable across profiler iterations, we create and destroy a stringifer
+    // on each profiler iteration.
+    return stringifier->FoldedStackTraceString(key);
+  }
+
+  // If we do not stringifiy this stack trace, we still need to clear
+  // its entry from the stack traces table. It is safe to do so immediately
+  // for the user stack-id, but we need to allow the kernel stack-id to remain
+  // in the stack-traces table in case it gets used by a stack trace that we
+  // have not yet encountered on this iteration, but will need to symbolize.
+  if (key.user_stack_id >= 0) {
+    stack_traces->clear_stack_id(key.user_stack_id);
+  }
+  if (key.kernel_stack_id >= 0) {
+    k_stack_ids_to_remove->insert(key.kernel_stack_id);
+  }
+  return std::string(profiler::kNotSymbolizedMessage);
+}
+
+}  // namespace
+
 PerfProfileConnector::StackTraceHisto PerfProfileConnector::AggregateStackTraces(
-    ConnectorContext* ctx, ebpf::BPFStackTable* stack_traces) {
+    ConnectorContext* ctx, Stringifier* stringifier, ebpf::BPFStackTable* stack_traces,
+    absl::flat_hash_set<int>* k_stack_ids_to_remove) {
   // TODO(jps): switch from using get_table_offline() to directly stepping through
   // the histogram data structure. Inline populating our own data structures with this.
   // Avoid an unnecessary copy of the information in local stack_trace_keys_and_counts.
@@ -230,42 +352,12 @@ PerfProfileConnector::StackTraceHisto PerfProfileConnector::AggregateStackTraces
   const uint32_t asid = ctx->GetASID();
   const absl::flat_hash_set<md::UPID>& upids_for_symbolization = ctx->GetUPIDs();
 
-  // Cause symbolizers to perform any necessary updates before we put them to work.
-  u_symbolizer_->IterationPreTick();
-  k_symbolizer_->IterationPreTick();
-
-  // Create a new stringifier for this iteration of the continuous perf profiler.
-  Stringifier stringifier(u_symbolizer_.get(), k_symbolizer_.get(), stack_traces);
-
-  absl::flat_hash_set<int> k_stack_ids_to_remove;
-
   for (const auto& stack_trace_key : raw_histo_data_) {
-    std::string stack_trace_str;
-
     const md::UPID upid(asid, stack_trace_key.upid.pid, stack_trace_key.upid.start_time_ticks);
     const bool symbolize = upids_for_symbolization.contains(upid);
 
-    if (symbolize) {
-      // The stringifier clears stack-ids out of the stack traces table when it
-      // first encounters them. If a stack-id is reused by a different stack-trace-key,
-      // the stringifier returns its memoized stack trace string. Because the stack-ids
-      // are not stable across profiler iterations, we create and destroy a stringifer
-      // on each profiler iteration.
-      stack_trace_str = stringifier.FoldedStackTraceString(stack_trace_key);
-    } else {
-      // If we do not stringifiy this stack trace, we still need to clear
-      // its entry from the stack traces table. It is safe to do so immediately
-      // for the user stack-id, but we need to allow the kernel stack-id to remain
-      // in the stack-traces table in case it gets used by a stack trace that we
-      // have not yet encountered on this iteration, but will need to symbolize.
-      if (stack_trace_key.user_stack_id >= 0) {
-        stack_traces->clear_stack_id(stack_trace_key.user_stack_id);
-      }
-      if (stack_trace_key.kernel_stack_id >= 0) {
-        k_stack_ids_to_remove.insert(stack_trace_key.kernel_stack_id);
-      }
-      stack_trace_str = std::string(profiler::kNotSymbolizedMessage);
-    }
+    std::string stack_trace_str = StackTraceString(stack_trace_key, symbolize, stringifier,
+                                                   stack_traces, k_stack_ids_to_remove);
 
     profiler::SymbolicStackTrace symbolic_stack_trace = {upid, std::move(stack_trace_str)};
 
@@ -284,12 +376,6 @@ PerfProfileConnector::StackTraceHisto PerfProfileConnector::AggregateStackTraces
     // alternate impl. is a map from "stack-trace-id" => "count & symbolic-stack-trace"
   }
 
-  // Clear any kernel stack-ids, that were potentially not already cleared,
-  // out of the stack traces table.
-  for (const int k_stack_id : k_stack_ids_to_remove) {
-    stack_traces->clear_stack_id(k_stack_id);
-  }
-
   raw_histo_data_.clear();
 
   VLOG(1) << "PerfProfileConnector::AggregateStackTraces(): cum_sum_count: " << cum_sum_count;
@@ -297,43 +383,155 @@ PerfProfileConnector::StackTraceHisto PerfProfileConnector::AggregateStackTraces
   return symbolic_histogram;
 }
 
-void PerfProfileConnector::CreateRecords(ebpf::BPFStackTable* stack_traces, ConnectorContext* ctx,
-                                         DataTable* data_table) {
+PerfProfileConnector::BlockedStackTraceHisto PerfProfileConnector::AggregateBlockedStackTraces(
+    ConnectorContext* ctx, Stringifier* stringifier, ebpf::BPFStackTable* stack_traces,
+    BlockedStackTraceTable* blocked_stack_traces,
+    absl::flat_hash_set<int>* k_stack_ids_to_remove) {
+  BlockedStackTraceHisto symbolic_histogram;
+
+  const uint32_t asid = ctx->GetASID();
+  const absl::flat_hash_set<md::UPID>& upids_for_symbolization = ctx->GetUPIDs();
+
+  for (const auto& [key, blocked_time] : blocked_stack_traces->get_table_offline()) {
+    const stack_trace_key_t& stack_trace_key = key.stack_trace_key;
+    const md::UPID upid(asid, stack_trace_key.upid.pid, stack_trace_key.upid.start_time_ticks);
+    const bool symbolize = upids_for_symbolization.contains(upid);
+
+    std::string stack_trace_str = StackTraceString(stack_trace_key, symbolize, stringifier,
+                                                   stack_traces, k_stack_ids_to_remove);
+
+    blocked_time_t& histo_value = symbolic_histogram[std::make_pair(
+        profiler::SymbolicStackTrace{upid, std::move(stack_trace_str)}, key.reason)];
+    histo_value.blocked_ns += blocked_time.blocked_ns;
+    histo_value.count += blocked_time.count;
+  }
+
+  blocked_stack_traces->clear_table_non_atomic();
+
+  return symbolic_histogram;
+}
+
+void PerfProfileConnector::CreateRecords(ebpf::BPFStackTable* stack_traces,
+                                         BlockedStackTraceTable* blocked_stack_traces,
+                                         ConnectorContext* ctx,
+                                         const std::vector<DataTable*>& data_tables) {
   constexpr size_t kMaxSymbolSize = 512;
   constexpr size_t kMaxStackDepth = 64;
   constexpr size_t kMaxStackTraceSize = kMaxStackDepth * kMaxSymbolSize;
 
   const uint64_t timestamp_ns = AdjustedSteadyClockNowNS();
+  const int64_t sample_period_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(stack_trace_sampling_period_).count();
+
+  // Cause symbolizers to perform any necessary updates before we put them to work.
+  u_symbolizer_->IterationPreTick();
+  k_symbolizer_->IterationPreTick();
+
+  // Create a new stringifier for this iteration of the continuous perf profiler.
+  // Sampled and blocked stack traces share the stack traces table, and so the stringifier.
+  Stringifier stringifier(u_symbolizer_.get(), k_symbolizer_.get(), stack_traces);
+
+  absl::flat_hash_set<int> k_stack_ids_to_remove;
 
   // Stack traces from kernel/BPF are ordered lists of instruction pointers (addresses).
   // AggregateStackTraces() will collapse some of those into identical symbolic stack traces;
   // for example, consider the following two stack traces from BPF:
   // p0, p1, p2 => main;qux;baz   # both p2 & p3 point into baz.
   // p0, p1, p3 => main;qux;baz
+  StackTraceHisto stack_trace_histogram =
+      AggregateStackTraces(ctx, &stringifier, stack_traces, &k_stack_ids_to_remove);
 
-  StackTraceHisto stack_trace_histogram = AggregateStackTraces(ctx, stack_traces);
+  BlockedStackTraceHisto blocked_stack_trace_histogram;
+  if (BlockedProfilingEnabled()) {
+    blocked_stack_trace_histogram = AggregateBlockedStackTraces(
+        ctx, &stringifier, stack_traces, blocked_stack_traces, &k_stack_ids_to_remove);
+
+    // Also clear the stack trace of threads that blocked before the map switchover, and are
+    // still blocked; their blocked time will not be recorded.
+    stack_traces->clear_table_non_atomic();
+  } else {
+    // Clear any kernel stack-ids, that were potentially not already cleared,
+    // out of the stack traces table.
+    for (const int k_stack_id : k_stack_ids_to_remove) {
+      stack_traces->clear_stack_id(k_stack_id);
+    }
+  }
 
   constexpr auto age_tick_period = std::chrono::minutes(5);
   if (sampling_freq_mgr_.count() % (age_tick_period / sampling_period_) == 0) {
     stack_trace_ids_.AgeTick();
   }
 
+  if (data_tables[kBlockedStackTraceTableNum] != nullptr) {
+    for (const auto& [key, blocked_time] : blocked_stack_trace_histogram) {
+      const auto& [symbolic_stack_trace, reason] = key;
+      DataTable::RecordBuilder<&kBlockedStackTraceTable> r(
+          data_tables[kBlockedStackTraceTableNum], timestamp_ns);
+
+      r.Append<r.ColIndex("time_")>(timestamp_ns);
+      r.Append<r.ColIndex("upid")>(symbolic_stack_trace.upid.value());
+      r.Append<r.ColIndex("stack_trace_id")>(stack_trace_ids_.Lookup(symbolic_stack_trace));
+      r.Append<r.ColIndex("stack_trace")>(symbolic_stack_trace.stack_trace_str,
+                                          kMaxStackTraceSize);
+      r.Append<r.ColIndex("reason")>(std::string(BlockedReasonName(reason)));
+      r.Append<r.ColIndex("blocked_time")>(blocked_time.blocked_ns);
+      r.Append<r.ColIndex("count")>(blocked_time.count);
+    }
+  }
+
+  if (!FLAGS_stirling_profiler_normalized_stack_traces) {
+    for (const auto& [key, count] : stack_trace_histogram) {
+      DataTable::RecordBuilder<&kStackTraceTable> r(data_tables[kPerfProfileTableNum],
+                                                    timestamp_ns);
+
+      r.Append<r.ColIndex("time_")>(timestamp_ns);
+      r.Append<r.ColIndex("upid")>(key.upid.value());
+      r.Append<r.ColIndex("stack_trace_id")>(stack_trace_ids_.Lookup(key));
+      r.Append<r.ColIndex("stack_trace")>(key.stack_trace_str, kMaxStackTraceSize);
+      r.Append<r.ColIndex("count")>(count);
+      r.Append<r.ColIndex("sample_period")>(sample_period_ns);
+    }
+    return;
+  }
+
+  // Normalized form: each stack trace is a list of frame IDs, and only the frames that are new
+  // (or due to be republished) are recorded with their symbols.
+  const auto now = std::chrono::steady_clock::now();
   for (const auto& [key, count] : stack_trace_histogram) {
-    DataTable::RecordBuilder<&kStackTraceTable> r(data_table, timestamp_ns);
+    DataTable::RecordBuilder<&kNormalizedStackTraceTable> r(
+        data_tables[kNormalizedStackTraceTableNum], timestamp_ns);
 
     r.Append<r.ColIndex("time_")>(timestamp_ns);
     r.Append<r.ColIndex("upid")>(key.upid.value());
     r.Append<r.ColIndex("stack_trace_id")>(stack_trace_ids_.Lookup(key));
-    r.Append<r.ColIndex("stack_trace")>(key.stack_trace_str, kMaxStackTraceSize);
+    r.Append<r.ColIndex("frame_ids")>(frame_dictionary_.FrameIDs(key.stack_trace_str, now));
     r.Append<r.ColIndex("count")>(count);
+    r.Append<r.ColIndex("sample_period")>(sample_period_ns);
   }
+
+  const uint32_t asid = ctx->GetASID();
+  frame_dictionary_.ConsumePending(
+      [&](uint64_t frame_id, std::string_view frame) {
+        DataTable::RecordBuilder<&kStackFrameTable> r(data_tables[kStackFrameTableNum],
+                                                      timestamp_ns);
+        r.Append<r.ColIndex("time_")>(timestamp_ns);
+        r.Append<r.ColIndex("asid")>(asid);
+        r.Append<r.ColIndex("frame_id")>(frame_id);
+        r.Append<r.ColIndex("frame")>(std::string(frame), kMaxSymbolSize);
+      },
+      now);
+  frame_dictionary_.EvictUnreferenced(now);
 }
 
-void PerfProfileConnector::ProcessBPFStackTraces(ConnectorContext* ctx, DataTable* data_table) {
+void PerfProfileConnector::ProcessBPFStackTraces(ConnectorContext* ctx,
+                                                 const std::vector<DataTable*>& data_tables) {
+  const auto start_time = std::chrono::steady_clock::now();
+
   // Choose the maps to consume.
   const bool using_map_set_a = transfer_count_ % 2 == 0;
   auto& stack_traces = using_map_set_a ? stack_traces_a_ : stack_traces_b_;
   auto& histo_perf_buf = using_map_set_a ? histogram_a_perf_buffer_ : histogram_b_perf_buffer_;
+  auto& blocked_stack_traces = using_map_set_a ? blocked_a_ : blocked_b_;
   const uint32_t sample_count_idx = using_map_set_a ? kSampleCountAIdx : kSampleCountBIdx;
 
   // Read out the perf buffer that contains the histogram for this iteration.
@@ -348,23 +546,68 @@ void PerfProfileConnector::ProcessBPFStackTraces(ConnectorContext* ctx, DataTabl
   LOG_IF(ERROR, !s.ok()) << "Error writing transfer_count_";
 
   // Read BPF stack traces & histogram, build records, incorporate records to data table.
-  CreateRecords(stack_traces.get(), ctx, data_table);
+  CreateRecords(stack_traces.get(), blocked_stack_traces.get(), ctx, data_tables);
 
   // Now that we've consumed the data, reset the sample count in BPF.
   profiler_state_->update_value(sample_count_idx, 0);
+
+  UpdateSamplingPeriod(std::chrono::steady_clock::now() - start_time);
+}
+
+void PerfProfileConnector::UpdateSamplingPeriod(std::chrono::nanoseconds cost) {
+  const auto now = std::chrono::steady_clock::now();
+  const auto elapsed = last_transfer_time_ == std::chrono::steady_clock::time_point{}
+                           ? std::chrono::nanoseconds{0}
+                           : now - last_transfer_time_;
+  last_transfer_time_ = now;
+
+  const std::chrono::milliseconds period = sampling_period_controller_.Update(cost, elapsed);
+  if (period == stack_trace_sampling_period_) {
+    return;
+  }
+
+  LOG(INFO) << absl::Substitute(
+      "PerfProfiler: Changing stack trace sampling period from $0ms to $1ms [overhead=$2%].",
+      stack_trace_sampling_period_.count(), period.count(),
+      100 * sampling_period_controller_.overhead());
+
+  const bpf_tools::SamplingProbeSpec old_spec = {
+      kSamplingProbeFn, static_cast<uint64_t>(stack_trace_sampling_period_.count())};
+  const bpf_tools::SamplingProbeSpec new_spec = {kSamplingProbeFn,
+                                                 static_cast<uint64_t>(period.count())};
+  Status s = DetachSamplingProbe(old_spec);
+  if (!s.ok()) {
+    LOG(ERROR) << absl::Substitute("Failed to change the sampling period: $0", s.msg());
+    return;
+  }
+  s = AttachSamplingProbe(new_spec);
+  if (!s.ok()) {
+    // Restore the previous period, so that sampling continues.
+    LOG(ERROR) << absl::Substitute("Failed to change the sampling period: $0", s.msg());
+    s = AttachSamplingProbe(old_spec);
+    LOG_IF(DFATAL, !s.ok()) << absl::Substitute("Failed to re-attach sampling probe: $0",
+                                                s.msg());
+    return;
+  }
+
+  stack_trace_sampling_period_ = period;
+  stats_.Increment(StatKey::kSamplingPeriodChange);
 }
 
 void PerfProfileConnector::TransferDataImpl(ConnectorContext* ctx,
                                             const std::vector<DataTable*>& data_tables) {
-  DCHECK_EQ(data_tables.size(), 1);
+  DCHECK_EQ(data_tables.size(), kTables.size());
 
-  auto* data_table = data_tables[0];
-
-  if (data_table == nullptr) {
+  if (FLAGS_stirling_profiler_normalized_stack_traces) {
+    if (data_tables[kNormalizedStackTraceTableNum] == nullptr ||
+        data_tables[kStackFrameTableNum] == nullptr) {
+      return;
+    }
+  } else if (data_tables[kPerfProfileTableNum] == nullptr) {
     return;
   }
 
-  ProcessBPFStackTraces(ctx, data_table);
+  ProcessBPFStackTraces(ctx, data_tables);
 
   // Cleanup the symbolizer so we don't leak memory.
   proc_tracker_.Update(ctx->GetUPIDs());
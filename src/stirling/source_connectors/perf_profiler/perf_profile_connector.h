@@ -29,6 +29,8 @@
 #include "src/stirling/core/source_connector.h"
 #include "src/stirling/core/types.h"
 #include "src/stirling/source_connectors/perf_profiler/bcc_bpf_intf/stack_event.h"
+#include "src/stirling/source_connectors/perf_profiler/frame_dictionary.h"
+#include "src/stirling/source_connectors/perf_profiler/sampling_period_controller.h"
 #include "src/stirling/source_connectors/perf_profiler/shared/types.h"
 #include "src/stirling/source_connectors/perf_profiler/stack_trace_id_cache.h"
 #include "src/stirling/source_connectors/perf_profiler/stack_traces_table.h"
@@ -48,8 +50,14 @@ static constexpr std::string_view kNotSymbolizedMessage = "<not symbolized>";
 class PerfProfileConnector : public SourceConnector, public bpf_tools::BCCWrapper {
  public:
   static constexpr std::string_view kName = "perf_profiler";
-  static constexpr auto kTables = MakeArray(kStackTraceTable);
+  static constexpr auto kTables = MakeArray(kStackTraceTable, kNormalizedStackTraceTable,
+                                            kStackFrameTable, kBlockedStackTraceTable);
   static constexpr uint32_t kPerfProfileTableNum = TableNum(kTables, kStackTraceTable);
+  static constexpr uint32_t kNormalizedStackTraceTableNum =
+      TableNum(kTables, kNormalizedStackTraceTable);
+  static constexpr uint32_t kStackFrameTableNum = TableNum(kTables, kStackFrameTable);
+  static constexpr uint32_t kBlockedStackTraceTableNum =
+      TableNum(kTables, kBlockedStackTraceTable);
 
   static std::unique_ptr<PerfProfileConnector> Create(std::string_view name) {
     return std::unique_ptr<PerfProfileConnector>(new PerfProfileConnector(name));
@@ -68,13 +76,16 @@ class PerfProfileConnector : public SourceConnector, public bpf_tools::BCCWrappe
     kBPFMapSwitchoverEvent,
     kCumulativeSumOfAllStackTraces,
     kLossHistoEvent,
+    kSamplingPeriodChange,
   };
 
   utils::StatCounter<StatKey> stats() const { return stats_; }
 
  private:
   // The time interval between stack trace samples, i.e. the sample rate used inside of BPF.
-  const std::chrono::milliseconds stack_trace_sampling_period_;
+  // Adjusted by sampling_period_controller_ to keep the profiler's overhead within budget.
+  std::chrono::milliseconds stack_trace_sampling_period_;
+  SamplingPeriodController sampling_period_controller_;
 
   // Push period is set to 1/2 of the sample period such that we push each new
   // sample when it becomes available. This is a UX decision so that the user
@@ -88,18 +99,38 @@ class PerfProfileConnector : public SourceConnector, public bpf_tools::BCCWrappe
   // RawHistoData: a list of stack trace keys that will need to be histogrammed.
   using RawHistoData = std::vector<stack_trace_key_t>;
 
+  // BlockedStackTraceHisto: (SymbolicStackTrace, blocked reason) => blocked time & count.
+  using BlockedStackTraceHisto =
+      absl::flat_hash_map<std::pair<profiler::SymbolicStackTrace, uint32_t>, blocked_time_t>;
+
+  using BlockedStackTraceTable = ebpf::BPFHashTable<blocked_stack_trace_key_t, blocked_time_t>;
+
   explicit PerfProfileConnector(std::string_view source_name);
 
-  void ProcessBPFStackTraces(ConnectorContext* ctx, DataTable* data_table);
+  void ProcessBPFStackTraces(ConnectorContext* ctx, const std::vector<DataTable*>& data_tables);
 
-  // Read BPF data structures, build & incorporate records to the table.
-  void CreateRecords(ebpf::BPFStackTable* stack_traces, ConnectorContext* ctx,
-                     DataTable* data_table);
+  // Read BPF data structures, build & incorporate records to the tables.
+  void CreateRecords(ebpf::BPFStackTable* stack_traces,
+                     BlockedStackTraceTable* blocked_stack_traces, ConnectorContext* ctx,
+                     const std::vector<DataTable*>& data_tables);
 
-  StackTraceHisto AggregateStackTraces(ConnectorContext* ctx, ebpf::BPFStackTable* stack_traces);
+  // The Aggregate functions symbolize stack traces, and clear their stack-ids out of
+  // the stack traces table; except for kernel stack-ids that are not symbolized, which are
+  // added to k_stack_ids_to_remove, for the caller to clear once all stack traces are aggregated.
+  StackTraceHisto AggregateStackTraces(ConnectorContext* ctx, Stringifier* stringifier,
+                                       ebpf::BPFStackTable* stack_traces,
+                                       absl::flat_hash_set<int>* k_stack_ids_to_remove);
+  BlockedStackTraceHisto AggregateBlockedStackTraces(
+      ConnectorContext* ctx, Stringifier* stringifier, ebpf::BPFStackTable* stack_traces,
+      BlockedStackTraceTable* blocked_stack_traces,
+      absl::flat_hash_set<int>* k_stack_ids_to_remove);
 
   void CleanupSymbolizers(const absl::flat_hash_set<md::UPID>& deleted_upids);
 
+  // Feeds the cost of the last transfer to the sampling period controller, and re-attaches the
+  // sampling probe if the controller picks a new period.
+  void UpdateSamplingPeriod(std::chrono::nanoseconds cost);
+
   void PrintStats() const;
 
   // data structures shared with BPF:
@@ -108,12 +139,22 @@ class PerfProfileConnector : public SourceConnector, public bpf_tools::BCCWrappe
 
   std::unique_ptr<ebpf::BPFArrayTable<uint64_t>> profiler_state_;
 
+  // Time spent blocked, per stack trace; only populated in off-CPU or futex contention mode.
+  std::unique_ptr<BlockedStackTraceTable> blocked_a_;
+  std::unique_ptr<BlockedStackTraceTable> blocked_b_;
+
   // Number of iterations, where each iteration is drains the information collectid in BPF.
   uint64_t transfer_count_ = 0;
 
+  // When the last transfer started; used to measure the overhead of transfers.
+  std::chrono::steady_clock::time_point last_transfer_time_;
+
   // Tracks unique stack trace ids, for the lifetime of Stirling:
   StackTraceIDCache stack_trace_ids_;
 
+  // Assigns IDs to stack frames, when stack traces are recorded in normalized form.
+  FrameDictionary frame_dictionary_;
+
   // The raw histogram from BPF; it is populated on each iteration by a call to PollPerfBuffer().
   RawHistoData raw_histo_data_;
 
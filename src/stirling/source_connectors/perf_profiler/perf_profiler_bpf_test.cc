@@ -43,6 +43,8 @@ DECLARE_bool(stirling_profiler_java_symbols);
 DECLARE_string(stirling_profiler_java_agent_libs);
 DECLARE_uint32(stirling_profiler_table_update_period_seconds);
 DECLARE_uint32(stirling_profiler_stack_trace_sample_period_ms);
+DECLARE_double(stirling_profiler_overhead_budget_percent);
+DECLARE_bool(stirling_profiler_off_cpu);
 
 namespace px {
 namespace stirling {
@@ -197,6 +199,8 @@ class PerfProfileBPFTest : public ::testing::TestWithParam<std::filesystem::path
     FLAGS_number_attach_attempts_per_iteration = kNumSubProcesses;
     FLAGS_stirling_profiler_table_update_period_seconds = 5;
     FLAGS_stirling_profiler_stack_trace_sample_period_ms = 7;
+    // The expected sample counts assume a fixed sampling period.
+    FLAGS_stirling_profiler_overhead_budget_percent = 0;
 
     source_ = PerfProfileConnector::Create("perf_profile_connector");
     ASSERT_OK(source_->Init());
@@ -376,7 +380,8 @@ class PerfProfileBPFTest : public ::testing::TestWithParam<std::filesystem::path
   std::unique_ptr<PerfProfilerTestSubProcesses> sub_processes_;
   std::unique_ptr<StandaloneContext> ctx_;
   DataTable data_table_;
-  const std::vector<DataTable*> data_tables_{&data_table_};
+  // Only the folded stack traces table is populated by default.
+  const std::vector<DataTable*> data_tables_{&data_table_, nullptr, nullptr, nullptr};
 
   bool column_ptrs_populated_ = false;
   std::shared_ptr<types::ColumnWrapper> trace_ids_column_;
@@ -556,6 +561,52 @@ std::vector<std::filesystem::path> GetJavaImagePaths() {
   return image_paths;
 }
 
+// Checks that the time a process spends sleeping is recorded against its off-CPU stack traces.
+TEST(PerfProfileOffCPUBPFTest, RecordsBlockedTime) {
+  // Restores the flags when the test ends, even if an assertion fails.
+  gflags::FlagSaver flag_saver;
+  FLAGS_stirling_profiler_off_cpu = true;
+  FLAGS_stirling_profiler_table_update_period_seconds = 5;
+  FLAGS_stirling_profiler_overhead_budget_percent = 0;
+
+  auto source = PerfProfileConnector::Create("perf_profile_connector");
+  ASSERT_OK(source->Init());
+
+  DataTable stack_trace_table(/*id*/ 0, kStackTraceTable);
+  DataTable blocked_stack_trace_table(/*id*/ 1, kBlockedStackTraceTable);
+  const std::vector<DataTable*> data_tables{&stack_trace_table, nullptr, nullptr,
+                                            &blocked_stack_trace_table};
+  StandaloneContext ctx(absl::flat_hash_set<md::UPID>{});
+
+  // A process that blocks, i.e. spends almost all of its time off-CPU.
+  SubProcess sleeper;
+  ASSERT_OK(sleeper.Start({"/bin/sh", "-c", "while true; do sleep 0.1; done"}));
+
+  // Transfer once to start recording in a fresh map set, then let the sleeper block for a while.
+  source->TransferData(&ctx, data_tables);
+  std::this_thread::sleep_for(std::chrono::seconds(3));
+  source->TransferData(&ctx, data_tables);
+
+  sleeper.Kill();
+  sleeper.Wait();
+  ASSERT_OK(source->Stop());
+
+  types::ColumnWrapperRecordBatch columns;
+  const std::vector<TaggedRecordBatch> tablets = blocked_stack_trace_table.ConsumeRecords();
+  ASSERT_NOT_EMPTY_AND_GET_RECORDS(columns, tablets);
+
+  int64_t blocked_ns = 0;
+  for (const size_t idx :
+       FindRecordIdxMatchesPIDs(columns, kBlockedStackTraceUPIDIdx, {sleeper.child_pid()})) {
+    EXPECT_EQ(columns[kBlockedStackTraceReasonIdx]->Get<types::StringValue>(idx), "off_cpu");
+    EXPECT_GT(columns[kBlockedStackTraceCountIdx]->Get<types::Int64Value>(idx).val, 0);
+    blocked_ns += columns[kBlockedStackTraceBlockedTimeIdx]->Get<types::Int64Value>(idx).val;
+  }
+
+  // The shell spends most of its time waiting for its sleep child processes to exit.
+  EXPECT_GT(blocked_ns, std::chrono::nanoseconds(std::chrono::seconds(1)).count());
+}
+
 INSTANTIATE_TEST_SUITE_P(PerfProfileJavaTests, PerfProfileBPFTest,
                          ::testing::ValuesIn(GetJavaImagePaths()));
 
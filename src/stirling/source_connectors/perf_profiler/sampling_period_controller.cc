@@ -0,0 +1,57 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/source_connectors/perf_profiler/sampling_period_controller.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace px {
+namespace stirling {
+
+SamplingPeriodController::SamplingPeriodController(std::chrono::milliseconds min_period,
+                                                   std::chrono::milliseconds max_period,
+                                                   double budget)
+    : min_period_(min_period),
+      max_period_(std::max(min_period, max_period)),
+      budget_(budget),
+      period_(min_period) {}
+
+std::chrono::milliseconds SamplingPeriodController::Update(std::chrono::nanoseconds cost,
+                                                           std::chrono::nanoseconds elapsed) {
+  if (budget_ <= 0 || elapsed.count() <= 0) {
+    return period_;
+  }
+
+  const double sample = static_cast<double>(cost.count()) / static_cast<double>(elapsed.count());
+  overhead_ = overhead_ < 0 ? sample : kSmoothing * sample + (1 - kSmoothing) * overhead_;
+
+  const double ratio = overhead_ / budget_;
+  if (ratio >= kLowWatermark && ratio <= 1.0) {
+    return period_;
+  }
+
+  const double factor = std::clamp(ratio / kTarget, 0.5, 2.0);
+  const auto period = std::chrono::milliseconds(
+      static_cast<int64_t>(std::lround(static_cast<double>(period_.count()) * factor)));
+  period_ = std::clamp(period, min_period_, max_period_);
+  return period_;
+}
+
+}  // namespace stirling
+}  // namespace px
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <chrono>
+
+namespace px {
+namespace stirling {
+
+// The SamplingPeriodController adapts the stack trace sampling period of the profiler so that
+// its user-space overhead (draining the BPF maps, symbolizing, and building records) stays
+// within a budget, expressed as a fraction of one CPU.
+//
+// The overhead grows roughly linearly with the sampling rate, so when the measured overhead
+// leaves the band [kLowWatermark * budget, budget], the period is scaled to bring it back to
+// kTarget * budget. Each adjustment is limited to a factor of 2, and the period always stays
+// within [min_period, max_period]. The measured overhead is smoothed, to ignore one-off spikes.
+class SamplingPeriodController {
+ public:
+  static constexpr double kLowWatermark = 0.5;
+  static constexpr double kTarget = 0.75;
+  static constexpr double kSmoothing = 0.5;
+
+  /**
+   * @param min_period The shortest (and initial) sampling period.
+   * @param max_period The longest sampling period.
+   * @param budget The overhead budget as a fraction of one CPU; zero disables adaptation.
+   */
+  SamplingPeriodController(std::chrono::milliseconds min_period,
+                           std::chrono::milliseconds max_period, double budget);
+
+  /**
+   * Records the cost of processing the samples of one transfer period, and returns the
+   * sampling period to use from now on.
+   *
+   * @param cost Time spent processing the samples.
+   * @param elapsed Time since the samples were last processed.
+   */
+  std::chrono::milliseconds Update(std::chrono::nanoseconds cost,
+                                   std::chrono::nanoseconds elapsed);
+
+  std::chrono::milliseconds period() const { return period_; }
+  double overhead() const { return overhead_; }
+
+ private:
+  const std::chrono::milliseconds min_period_;
+  const std::chrono::milliseconds max_period_;
+  const double budget_;
+
+  std::chrono::milliseconds period_;
+
+  // Smoothed overhead, as a fraction of one CPU. Negative until the first update.
+  double overhead_ = -1;
+};
+
+}  // namespace stirling
+}  // namespace px
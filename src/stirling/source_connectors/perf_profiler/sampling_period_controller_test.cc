@@ -0,0 +1,62 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/source_connectors/perf_profiler/sampling_period_controller.h"
+
+#include "src/common/testing/testing.h"
+
+namespace px {
+namespace stirling {
+
+using std::chrono::milliseconds;
+
+constexpr auto kElapsed = std::chrono::seconds(30);
+
+TEST(SamplingPeriodController, StaysWithinBudgetBand) {
+  // 1% of a CPU.
+  SamplingPeriodController controller(milliseconds(10), milliseconds(100), 0.01);
+  EXPECT_EQ(controller.period(), milliseconds(10));
+
+  // 0.6% overhead is within the band.
+  EXPECT_EQ(controller.Update(milliseconds(180), kElapsed), milliseconds(10));
+
+  // Far over budget: the period grows, by at most 2x per update.
+  EXPECT_EQ(controller.Update(milliseconds(3000), kElapsed), milliseconds(20));
+  EXPECT_EQ(controller.Update(milliseconds(3000), kElapsed), milliseconds(40));
+}
+
+TEST(SamplingPeriodController, ReturnsToMinPeriodWhenIdle) {
+  SamplingPeriodController controller(milliseconds(10), milliseconds(100), 0.01);
+  for (int i = 0; i < 10; ++i) {
+    controller.Update(milliseconds(3000), kElapsed);
+  }
+  EXPECT_EQ(controller.period(), milliseconds(100));
+
+  for (int i = 0; i < 20; ++i) {
+    controller.Update(milliseconds(0), kElapsed);
+  }
+  EXPECT_EQ(controller.period(), milliseconds(10));
+}
+
+TEST(SamplingPeriodController, Disabled) {
+  SamplingPeriodController controller(milliseconds(10), milliseconds(100), 0);
+  EXPECT_EQ(controller.Update(milliseconds(30000), kElapsed), milliseconds(10));
+}
+
+}  // namespace stirling
+}  // namespace px
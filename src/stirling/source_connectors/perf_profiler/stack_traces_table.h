@@ -42,7 +42,12 @@ static constexpr DataElement kElements[] = {
      types::DataType::STRING, types::SemanticType::ST_NONE, types::PatternType::GENERAL},
     {"count",
      "Number of times the stack trace has been sampled.",
-     types::DataType::INT64, types::SemanticType::ST_NONE, types::PatternType::METRIC_GAUGE}
+     types::DataType::INT64, types::SemanticType::ST_NONE, types::PatternType::METRIC_GAUGE},
+    {"sample_period",
+     "The time between stack trace samples when the samples were taken. The sampling period "
+     "adapts to the profiler's overhead, so weigh counts by it when aggregating over time.",
+     types::DataType::INT64, types::SemanticType::ST_DURATION_NS,
+     types::PatternType::METRIC_GAUGE}
 };
 
 constexpr auto kStackTraceTable = DataTableSchema(
@@ -54,11 +59,106 @@ constexpr auto kStackTraceTable = DataTableSchema(
 // clang-format on
 DEFINE_PRINT_TABLE(StackTrace)
 
+// clang-format off
+static constexpr DataElement kNormalizedStackTraceElements[] = {
+    canonical_data_elements::kTime,
+    canonical_data_elements::kUPID,
+    {"stack_trace_id",
+     "A unique identifier of the stack trace, for script-writing convenience.",
+     types::DataType::INT64, types::SemanticType::ST_NONE, types::PatternType::GENERAL},
+    {"frame_ids",
+     "The frames of a stack trace within the sampled process, as frame IDs separated by "
+     "semicolons, ordered from the root of the stack. Frame IDs are assigned by each agent, so "
+     "they are resolved to symbols by the `stack_frames.beta` rows with the same asid as the "
+     "upid.",
+     types::DataType::STRING, types::SemanticType::ST_NONE, types::PatternType::GENERAL},
+    {"count",
+     "Number of times the stack trace has been sampled.",
+     types::DataType::INT64, types::SemanticType::ST_NONE, types::PatternType::METRIC_GAUGE},
+    {"sample_period",
+     "The time between stack trace samples when the samples were taken. The sampling period "
+     "adapts to the profiler's overhead, so weigh counts by it when aggregating over time.",
+     types::DataType::INT64, types::SemanticType::ST_DURATION_NS,
+     types::PatternType::METRIC_GAUGE}
+};
+
+constexpr auto kNormalizedStackTraceTable = DataTableSchema(
+        "normalized_stack_traces.beta",
+        "Sampled stack traces of applications, with frames recorded as IDs into the "
+        "`stack_frames.beta` table. Only populated when normalized stack traces are enabled.",
+        kNormalizedStackTraceElements
+);
+
+static constexpr DataElement kStackFrameElements[] = {
+    canonical_data_elements::kTime,
+    {"asid",
+     "The ID of the agent that assigned the frame ID.",
+     types::DataType::INT64, types::SemanticType::ST_ASID, types::PatternType::GENERAL},
+    {"frame_id",
+     "The ID of the frame, as referenced by `normalized_stack_traces.beta`. "
+     "IDs are assigned by each agent, and are stable while the frame is in use.",
+     types::DataType::INT64, types::SemanticType::ST_NONE, types::PatternType::GENERAL},
+    {"frame",
+     "The symbol of the frame. If the symbol cannot be resolved, the address is populated instead.",
+     types::DataType::STRING, types::SemanticType::ST_NONE, types::PatternType::GENERAL},
+};
+
+constexpr auto kStackFrameTable = DataTableSchema(
+        "stack_frames.beta",
+        "The dictionary of stack frames referenced by `normalized_stack_traces.beta`. "
+        "Frames are recorded when first seen, and again periodically while still in use.",
+        kStackFrameElements
+);
+
+static constexpr DataElement kBlockedStackTraceElements[] = {
+    canonical_data_elements::kTime,
+    canonical_data_elements::kUPID,
+    {"stack_trace_id",
+     "A unique identifier of the stack trace, for script-writing convenience. "
+     "String representation is in the `stack_trace` column.",
+     types::DataType::INT64, types::SemanticType::ST_NONE, types::PatternType::GENERAL},
+    {"stack_trace",
+     "The stack trace of a thread at the point it blocked, in folded format. "
+     "The call stack symbols are separated by semicolons. "
+     "If symbols cannot be resolved, addresses are populated instead.",
+     types::DataType::STRING, types::SemanticType::ST_NONE, types::PatternType::GENERAL},
+    {"reason",
+     "Why the thread was blocked: off_cpu (descheduled while waiting, e.g. on I/O or a lock), "
+     "or futex_wait (waiting in a futex, i.e. on a contended user-space lock).",
+     types::DataType::STRING, types::SemanticType::ST_NONE, types::PatternType::GENERAL_ENUM},
+    {"blocked_time",
+     "Total time that threads were blocked in the stack trace.",
+     types::DataType::INT64, types::SemanticType::ST_DURATION_NS,
+     types::PatternType::METRIC_GAUGE},
+    {"count",
+     "Number of times threads blocked in the stack trace.",
+     types::DataType::INT64, types::SemanticType::ST_NONE, types::PatternType::METRIC_GAUGE},
+};
+
+constexpr auto kBlockedStackTraceTable = DataTableSchema(
+        "blocked_stack_traces.beta",
+        "Stack traces at which application threads blocked, weighted by the time they stayed "
+        "blocked. Identifies latency that is not spent on CPU, such as lock contention and I/O "
+        "waits. Only populated when off-CPU or futex contention profiling is enabled.",
+        kBlockedStackTraceElements
+);
+// clang-format on
+DEFINE_PRINT_TABLE(NormalizedStackTrace)
+DEFINE_PRINT_TABLE(StackFrame)
+DEFINE_PRINT_TABLE(BlockedStackTrace)
+
 constexpr int kStackTraceTimeIdx = kStackTraceTable.ColIndex("time_");
 constexpr int kStackTraceUPIDIdx = kStackTraceTable.ColIndex("upid");
 constexpr int kStackTraceStackTraceIDIdx = kStackTraceTable.ColIndex("stack_trace_id");
 constexpr int kStackTraceStackTraceStrIdx = kStackTraceTable.ColIndex("stack_trace");
 constexpr int kStackTraceCountIdx = kStackTraceTable.ColIndex("count");
+constexpr int kStackTraceSamplePeriodIdx = kStackTraceTable.ColIndex("sample_period");
+
+constexpr int kBlockedStackTraceUPIDIdx = kBlockedStackTraceTable.ColIndex("upid");
+constexpr int kBlockedStackTraceStackTraceStrIdx = kBlockedStackTraceTable.ColIndex("stack_trace");
+constexpr int kBlockedStackTraceReasonIdx = kBlockedStackTraceTable.ColIndex("reason");
+constexpr int kBlockedStackTraceBlockedTimeIdx = kBlockedStackTraceTable.ColIndex("blocked_time");
+constexpr int kBlockedStackTraceCountIdx = kBlockedStackTraceTable.ColIndex("count");
 
 }  // namespace stirling
 }  // namespace px
@@ -16,10 +16,17 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <sys/stat.h>
+
+#include <filesystem>
 #include <memory>
+#include <string>
+#include <utility>
 
 #include <absl/functional/bind_front.h>
 
+#include "src/common/fs/fs_wrapper.h"
+#include "src/stirling/obj_tools/elf_build_id.h"
 #include "src/stirling/obj_tools/elf_reader.h"
 #include "src/stirling/source_connectors/perf_profiler/symbolizers/elf_symbolizer.h"
 #include "src/stirling/utils/proc_path_tools.h"
@@ -29,26 +36,119 @@ using ::px::stirling::obj_tools::ElfReader;
 namespace px {
 namespace stirling {
 
-StatusOr<std::unique_ptr<Symbolizer>> ElfSymbolizer::Create() {
-  ElfSymbolizer* elf_symbolizer = new ElfSymbolizer();
+StatusOr<std::unique_ptr<Symbolizer>> ElfSymbolizer::Create(
+    std::unique_ptr<SymbolIndexDiskCache> disk_cache) {
+  ElfSymbolizer* elf_symbolizer = new ElfSymbolizer(std::move(disk_cache));
   auto symbolizer = std::unique_ptr<Symbolizer>(elf_symbolizer);
   return symbolizer;
 }
 
-void ElfSymbolizer::DeleteUPID(const struct upid_t& upid) { symbolizers_.erase(upid); }
+void ElfSymbolizer::DeleteUPID(const struct upid_t& upid) {
+  auto iter = symbolizers_.find(upid);
+  if (iter == symbolizers_.end()) {
+    return;
+  }
+  const bool last_user = iter->second.use_count() == 1;
+  symbolizers_.erase(iter);
+
+  if (last_user) {
+    // Drop the cache entries of indexes that are no longer used by any UPID.
+    for (auto index_iter = symbol_indexes_.begin(); index_iter != symbol_indexes_.end();) {
+      if (index_iter->second.expired()) {
+        symbol_indexes_.erase(index_iter++);
+      } else {
+        ++index_iter;
+      }
+    }
+  }
+}
+
+namespace {
 
-StatusOr<std::unique_ptr<ElfReader::Symbolizer>> CreateUPIDSymbolizer(const struct upid_t& upid) {
+StatusOr<std::filesystem::path> HostExePath(const struct upid_t& upid) {
   PL_ASSIGN_OR_RETURN(std::unique_ptr<FilePathResolver> fp_resolver,
                       FilePathResolver::Create(upid.pid));
   // TODO(yzhao): Might need to check the start time.
   PL_ASSIGN_OR_RETURN(std::filesystem::path proc_exe,
                       system::ProcParser(system::Config::GetInstance()).GetExePath(upid.pid));
   PL_ASSIGN_OR_RETURN(std::filesystem::path host_proc_exe, fp_resolver->ResolvePath(proc_exe));
-  host_proc_exe = system::Config::GetInstance().ToHostPath(host_proc_exe);
-  PL_ASSIGN_OR_RETURN(std::unique_ptr<ElfReader> elf_reader, ElfReader::Create(host_proc_exe));
-  PL_ASSIGN_OR_RETURN(std::unique_ptr<ElfReader::Symbolizer> upid_symbolizer,
-                      elf_reader->GetSymbolizer());
-  return upid_symbolizer;
+  return system::Config::GetInstance().ToHostPath(host_proc_exe);
+}
+
+// Identifies the contents of a binary, so that processes of the same binary can share symbols,
+// even when they run in different containers. A stripped binary keeps the build-id of the
+// original, so the file size is part of the key too.
+std::string SymbolIndexKey(const std::filesystem::path& binary_path, const struct stat& st,
+                           const StatusOr<std::string>& build_id) {
+  if (build_id.ok()) {
+    return absl::Substitute("build-id:$0:$1", build_id.ValueOrDie(), st.st_size);
+  }
+  return absl::Substitute("file:$0:$1:$2:$3.$4", binary_path.string(), st.st_dev, st.st_ino,
+                          st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+}
+
+StatusOr<std::unique_ptr<ElfReader::Symbolizer>> CreateSymbolIndex(
+    const std::filesystem::path& binary_path) {
+  PL_ASSIGN_OR_RETURN(std::unique_ptr<ElfReader> elf_reader,
+                      ElfReader::Create(binary_path.string()));
+  return elf_reader->GetSymbolizer();
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<ElfSymbolizer::SymbolIndex>> ElfSymbolizer::LoadOrCreateSymbolIndex(
+    const std::filesystem::path& binary_path, size_t binary_size,
+    const StatusOr<std::string>& build_id) {
+  // Without a build-id, there is no safe way to tell whether a cached index matches the binary.
+  if (disk_cache_ == nullptr || !build_id.ok()) {
+    return CreateSymbolIndex(binary_path);
+  }
+
+  const std::string disk_cache_key = SymbolIndexDiskCache::Key(build_id.ValueOrDie(), binary_size);
+  StatusOr<std::unique_ptr<SymbolIndex>> cached_index = disk_cache_->Load(disk_cache_key);
+  if (cached_index.ok()) {
+    return cached_index;
+  }
+  if (!error::IsNotFound(cached_index.status())) {
+    VLOG(1) << absl::Substitute("Discarded cached symbol index of $0 [error=$1]",
+                                binary_path.string(), cached_index.ToString());
+  }
+
+  PL_ASSIGN_OR_RETURN(std::unique_ptr<SymbolIndex> index, CreateSymbolIndex(binary_path));
+  Status s = disk_cache_->Store(disk_cache_key, *index);
+  if (!s.ok()) {
+    VLOG(1) << absl::Substitute("Failed to cache symbol index of $0 [error=$1]",
+                                binary_path.string(), s.ToString());
+  }
+  return index;
+}
+
+StatusOr<std::shared_ptr<ElfSymbolizer::SymbolIndex>> ElfSymbolizer::GetOrCreateSymbolIndex(
+    const struct upid_t& upid) {
+  PL_ASSIGN_OR_RETURN(std::filesystem::path binary_path, HostExePath(upid));
+  PL_ASSIGN_OR_RETURN(struct stat st, fs::Stat(binary_path));
+  const StatusOr<std::string> build_id = obj_tools::ReadELFBuildID(binary_path);
+  const std::string key = SymbolIndexKey(binary_path, st, build_id);
+
+  std::weak_ptr<SymbolIndex>& cached_index = symbol_indexes_[key];
+  std::shared_ptr<SymbolIndex> index = cached_index.lock();
+  if (index != nullptr) {
+    return index;
+  }
+
+  StatusOr<std::unique_ptr<SymbolIndex>> index_status =
+      LoadOrCreateSymbolIndex(binary_path, st.st_size, build_id);
+  if (!index_status.ok()) {
+    symbol_indexes_.erase(key);
+    return index_status.status();
+  }
+
+  index = std::shared_ptr<SymbolIndex>(index_status.ConsumeValueOrDie());
+  VLOG(1) << absl::Substitute("Created symbol index for $0 [key=$1 symbols=$2 bytes=$3]",
+                              binary_path.string(), key, index->num_symbols(),
+                              index->MemoryUsage());
+  cached_index = index;
+  return index;
 }
 
 std::string_view EmptySymbolizerFn(const uintptr_t addr) {
@@ -65,10 +165,9 @@ profiler::SymbolizerFn ElfSymbolizer::GetSymbolizerFn(const struct upid_t& upid)
     return profiler::SymbolizerFn(&(BogusKernelSymbolizerFn));
   }
 
-  std::unique_ptr<ElfReader::Symbolizer>& upid_symbolizer = symbolizers_[upid];
+  std::shared_ptr<SymbolIndex>& upid_symbolizer = symbolizers_[upid];
   if (upid_symbolizer == nullptr) {
-    StatusOr<std::unique_ptr<ElfReader::Symbolizer>> upid_symbolizer_status =
-        CreateUPIDSymbolizer(upid);
+    StatusOr<std::shared_ptr<SymbolIndex>> upid_symbolizer_status = GetOrCreateSymbolIndex(upid);
     if (!upid_symbolizer_status.ok()) {
       VLOG(1) << absl::Substitute("Failed to create Symbolizer function for $0 [error=$1]",
                                   upid.pid, upid_symbolizer_status.ToString());
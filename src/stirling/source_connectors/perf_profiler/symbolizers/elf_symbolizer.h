@@ -18,8 +18,12 @@
 
 #pragma once
 
+#include <filesystem>
 #include <memory>
+#include <string>
+#include <utility>
 
+#include "src/stirling/source_connectors/perf_profiler/symbolizers/symbol_index_disk_cache.h"
 #include "src/stirling/source_connectors/perf_profiler/symbolizers/symbolizer.h"
 
 namespace px {
@@ -30,20 +34,46 @@ namespace stirling {
  */
 class ElfSymbolizer : public Symbolizer, public NotCopyMoveable {
  public:
-  static StatusOr<std::unique_ptr<Symbolizer>> Create();
+  /**
+   * @param disk_cache If not null, symbol indexes of binaries with a build-id are loaded from,
+   *                   and saved to, this on-disk cache.
+   */
+  static StatusOr<std::unique_ptr<Symbolizer>> Create(
+      std::unique_ptr<SymbolIndexDiskCache> disk_cache = nullptr);
 
   profiler::SymbolizerFn GetSymbolizerFn(const struct upid_t& upid) override;
   void IterationPreTick() override {}
   void DeleteUPID(const struct upid_t& upid) override;
   bool Uncacheable(const struct upid_t& /*upid*/) override { return false; }
 
+  /**
+   * Number of distinct binaries for which a symbol index is currently held.
+   */
+  size_t num_symbol_indexes() const { return symbol_indexes_.size(); }
+
  private:
-  ElfSymbolizer() = default;
+  using SymbolIndex = px::stirling::obj_tools::ElfReader::Symbolizer;
+
+  explicit ElfSymbolizer(std::unique_ptr<SymbolIndexDiskCache> disk_cache)
+      : disk_cache_(std::move(disk_cache)) {}
+
+  // Returns the symbol index of the UPID's binary, creating it if no other process is using it.
+  StatusOr<std::shared_ptr<SymbolIndex>> GetOrCreateSymbolIndex(const struct upid_t& upid);
+
+  // Reads the symbol index of a binary from the disk cache, or from the binary itself.
+  StatusOr<std::unique_ptr<SymbolIndex>> LoadOrCreateSymbolIndex(
+      const std::filesystem::path& binary_path, size_t binary_size,
+      const StatusOr<std::string>& build_id);
+
+  // The symbol index used by each UPID. Processes running the same binary share one index.
+  absl::flat_hash_map<struct upid_t, std::shared_ptr<SymbolIndex>> symbolizers_;
+
+  // Symbol indexes keyed by the build-id and size of the binary, or by its path, inode and mtime
+  // when it has no build-id. Held weakly, so an index is released along with the last UPID
+  // using it.
+  absl::flat_hash_map<std::string, std::weak_ptr<SymbolIndex>> symbol_indexes_;
 
-  // A symbolizer per UPID.
-  absl::flat_hash_map<struct upid_t,
-                      std::unique_ptr<px::stirling::obj_tools::ElfReader::Symbolizer>>
-      symbolizers_;
+  std::unique_ptr<SymbolIndexDiskCache> disk_cache_;
 };
 
 }  // namespace stirling
@@ -413,10 +413,10 @@ profiler::SymbolizerFn JavaSymbolizer::GetSymbolizerFn(const struct upid_t& upid
   // When we get here, we know that it is a Java process, and if we want symbols,
   // we need to inject the JVMTI symbolization agent.
 
-  if (!FLAGS_stirling_profiler_java_symbols) {
+  if (!FLAGS_stirling_profiler_java_symbols || monitor_.java_symbols_disabled()) {
     // The perf profile source connector was instantiated with Java symbolization enabled,
-    // but now it is disabled. The contract in this scenario is that we do not
-    // attempt to attach any more JVMTI agents.
+    // but now it is disabled (e.g. because a Java process crashed after an agent attach).
+    // The contract in this scenario is that we do not attempt to attach any more JVMTI agents.
     LOG_FIRST_N(INFO, 1) << "New Java process detected, but Java symbols disabled.";
     symbolizer_functions_[upid] = native_symbolizer_fn;
     return native_symbolizer_fn;
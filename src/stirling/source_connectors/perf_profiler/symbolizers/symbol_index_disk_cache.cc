@@ -0,0 +1,194 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/source_connectors/perf_profiler/symbolizers/symbol_index_disk_cache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <utility>
+#include <vector>
+
+#include "src/common/base/file.h"
+#include "src/common/fs/fs_wrapper.h"
+
+DEFINE_string(stirling_profiler_symbol_disk_cache_dir,
+              gflags::StringFromEnv("PL_PROFILER_SYMBOL_DISK_CACHE_DIR", ""),
+              "If set, the ELF symbolizer persists symbol indexes (keyed by build-id and binary "
+              "size) in this directory, so they can be reused after a restart. Empty disables "
+              "the cache. Only used with --stirling_profiler_symbolizer=elf; the default bcc "
+              "symbolizer keeps its own in-memory symbol cache.");
+DEFINE_uint64(stirling_profiler_symbol_disk_cache_max_bytes, 256 * 1024 * 1024,
+              "Maximum total size of the on-disk symbol cache. Least recently used symbol indexes "
+              "are removed when it is exceeded.");
+
+namespace px {
+namespace stirling {
+
+namespace {
+
+constexpr std::string_view kEntryExtension = ".symidx";
+
+// Keys are used as file names, so they are limited to alphanumerics and '-'.
+bool IsValidKey(const std::string& key) {
+  return !key.empty() && std::all_of(key.begin(), key.end(), [](unsigned char c) {
+           return std::isalnum(c) || c == '-';
+         });
+}
+
+StatusOr<std::unique_ptr<SymbolIndexDiskCache::SymbolIndex>> LoadFile(
+    const std::filesystem::path& path) {
+  // The index keeps mutable lazy-demangling state next to the names, so it can't be used from a
+  // read-only mapping of the file; a plain read is as cheap as copying out of one.
+  PL_ASSIGN_OR_RETURN(std::string buf, ReadFileToString(path.string()));
+  if (buf.empty()) {
+    return error::InvalidArgument("$0 is empty.", path.string());
+  }
+  return SymbolIndexDiskCache::SymbolIndex::Deserialize(buf);
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<SymbolIndexDiskCache>> SymbolIndexDiskCache::Open(
+    const std::filesystem::path& dir, size_t max_bytes) {
+  PL_RETURN_IF_ERROR(fs::CreateDirectories(dir));
+
+  auto cache = std::unique_ptr<SymbolIndexDiskCache>(new SymbolIndexDiskCache(dir, max_bytes));
+
+  std::error_code ec;
+  for (const auto& dir_entry : std::filesystem::directory_iterator(dir, ec)) {
+    const std::filesystem::path& path = dir_entry.path();
+    if (!dir_entry.is_regular_file(ec)) {
+      continue;
+    }
+    if (path.extension() != kEntryExtension) {
+      // Most likely a partial write from a previous run.
+      std::filesystem::remove(path, ec);
+      continue;
+    }
+    const std::string key = path.stem().string();
+    const size_t bytes = dir_entry.file_size(ec);
+    if (ec || !IsValidKey(key)) {
+      continue;
+    }
+    cache->entries_[key] = Entry{bytes, dir_entry.last_write_time(ec)};
+    cache->total_bytes_ += bytes;
+  }
+  if (ec) {
+    return error::Internal("Failed to list symbol cache directory $0: $1", dir.string(),
+                           ec.message());
+  }
+
+  cache->EvictTo(max_bytes);
+  LOG(INFO) << absl::Substitute("Opened on-disk symbol cache $0 [entries=$1 bytes=$2]",
+                                dir.string(), cache->num_entries(), cache->total_bytes());
+  return cache;
+}
+
+std::filesystem::path SymbolIndexDiskCache::EntryPath(const std::string& key) const {
+  return dir_ / absl::StrCat(key, kEntryExtension);
+}
+
+StatusOr<std::unique_ptr<SymbolIndexDiskCache::SymbolIndex>> SymbolIndexDiskCache::Load(
+    const std::string& key) {
+  auto iter = entries_.find(key);
+  if (iter == entries_.end()) {
+    return error::NotFound("Symbol index $0 is not cached.", key);
+  }
+
+  const std::filesystem::path path = EntryPath(key);
+  StatusOr<std::unique_ptr<SymbolIndex>> index = LoadFile(path);
+  if (!index.ok()) {
+    // Drop unreadable or corrupt entries, so they are rewritten with a fresh index.
+    Remove(key);
+    return index.status();
+  }
+
+  // Record the use, in memory and on disk, for LRU eviction.
+  std::error_code ec;
+  iter->second.last_use = std::filesystem::file_time_type::clock::now();
+  std::filesystem::last_write_time(path, iter->second.last_use, ec);
+
+  return index;
+}
+
+Status SymbolIndexDiskCache::Store(const std::string& key, const SymbolIndex& index) {
+  if (!IsValidKey(key)) {
+    return error::InvalidArgument("Invalid symbol index key '$0'.", key);
+  }
+
+  const std::string buf = index.Serialize();
+  if (buf.size() > max_bytes_) {
+    VLOG(1) << absl::Substitute("Symbol index $0 is too large to cache [bytes=$1].", key,
+                                buf.size());
+    return Status::OK();
+  }
+
+  // Write to a temporary file first, so that a crash never leaves a partial index behind.
+  const std::filesystem::path path = EntryPath(key);
+  const std::filesystem::path tmp_path = absl::StrCat(path.string(), ".tmp");
+  PL_RETURN_IF_ERROR(WriteFileFromString(tmp_path.string(), buf));
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) {
+    std::filesystem::remove(tmp_path, ec);
+    return error::Internal("Failed to write $0: $1", path.string(), ec.message());
+  }
+
+  auto [iter, inserted] = entries_.try_emplace(key, Entry{0, {}});
+  total_bytes_ -= iter->second.bytes;
+  iter->second = Entry{buf.size(), std::filesystem::file_time_type::clock::now()};
+  total_bytes_ += buf.size();
+
+  EvictTo(max_bytes_);
+  return Status::OK();
+}
+
+void SymbolIndexDiskCache::Remove(const std::string& key) {
+  auto iter = entries_.find(key);
+  if (iter == entries_.end()) {
+    return;
+  }
+  std::error_code ec;
+  std::filesystem::remove(EntryPath(key), ec);
+  total_bytes_ -= iter->second.bytes;
+  entries_.erase(iter);
+}
+
+void SymbolIndexDiskCache::EvictTo(size_t max_bytes) {
+  if (total_bytes_ <= max_bytes) {
+    return;
+  }
+
+  std::vector<std::pair<std::filesystem::file_time_type, std::string>> lru;
+  lru.reserve(entries_.size());
+  for (const auto& [key, entry] : entries_) {
+    lru.emplace_back(entry.last_use, key);
+  }
+  std::sort(lru.begin(), lru.end());
+
+  for (const auto& [last_use, key] : lru) {
+    if (total_bytes_ <= max_bytes) {
+      break;
+    }
+    VLOG(1) << absl::Substitute("Evicting symbol index $0 from disk cache.", key);
+    Remove(key);
+  }
+}
+
+}  // namespace stirling
+}  // namespace px
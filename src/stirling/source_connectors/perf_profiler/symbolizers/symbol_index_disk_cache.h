@@ -0,0 +1,104 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <absl/container/flat_hash_map.h>
+
+#include "src/common/base/base.h"
+#include "src/stirling/obj_tools/elf_reader.h"
+
+DECLARE_string(stirling_profiler_symbol_disk_cache_dir);
+DECLARE_uint64(stirling_profiler_symbol_disk_cache_max_bytes);
+
+namespace px {
+namespace stirling {
+
+/**
+ * A directory of serialized ELF symbol indexes, keyed by the build-id and size of the binary,
+ * that survives restarts of the profiler. Loading an index from here is much cheaper than reading
+ * and parsing the binary.
+ *
+ * The total size of the directory is bounded; when it is exceeded, the least recently used
+ * indexes are removed. File modification times record the last use, so the LRU order also
+ * survives restarts.
+ */
+class SymbolIndexDiskCache : public NotCopyMoveable {
+ public:
+  using SymbolIndex = obj_tools::ElfReader::Symbolizer;
+
+  /**
+   * Opens (creating if needed) the cache directory, and trims it down to max_bytes.
+   */
+  static StatusOr<std::unique_ptr<SymbolIndexDiskCache>> Open(const std::filesystem::path& dir,
+                                                              size_t max_bytes);
+
+  /**
+   * Returns the cache key of a binary. The build-id alone does not tell a stripped binary from
+   * its unstripped original.
+   */
+  static std::string Key(std::string_view build_id, size_t binary_size) {
+    return absl::StrCat(build_id, "-", binary_size);
+  }
+
+  /**
+   * Loads the symbol index stored under the given key (see Key()).
+   * @return NotFound if the index is not in the cache.
+   */
+  StatusOr<std::unique_ptr<SymbolIndex>> Load(const std::string& key);
+
+  /**
+   * Writes the symbol index under the given key (see Key()), evicting older indexes if needed.
+   * Indexes larger than the cache size are not stored.
+   */
+  Status Store(const std::string& key, const SymbolIndex& index);
+
+  size_t num_entries() const { return entries_.size(); }
+  size_t total_bytes() const { return total_bytes_; }
+
+ private:
+  struct Entry {
+    size_t bytes;
+    std::filesystem::file_time_type last_use;
+  };
+
+  SymbolIndexDiskCache(std::filesystem::path dir, size_t max_bytes)
+      : dir_(std::move(dir)), max_bytes_(max_bytes) {}
+
+  std::filesystem::path EntryPath(const std::string& key) const;
+
+  void Remove(const std::string& key);
+
+  // Removes least recently used entries until the total size is at most max_bytes.
+  void EvictTo(size_t max_bytes);
+
+  const std::filesystem::path dir_;
+  const size_t max_bytes_;
+
+  absl::flat_hash_map<std::string, Entry> entries_;
+  size_t total_bytes_ = 0;
+};
+
+}  // namespace stirling
+}  // namespace px
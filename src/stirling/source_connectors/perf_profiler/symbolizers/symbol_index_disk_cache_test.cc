@@ -0,0 +1,116 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/source_connectors/perf_profiler/symbolizers/symbol_index_disk_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "src/common/base/file.h"
+#include "src/common/testing/temp_dir.h"
+#include "src/common/testing/testing.h"
+
+namespace px {
+namespace stirling {
+
+using SymbolIndex = SymbolIndexDiskCache::SymbolIndex;
+
+std::unique_ptr<SymbolIndex> MakeSymbolIndex(int num_symbols) {
+  auto index = std::make_unique<SymbolIndex>();
+  for (int i = 0; i < num_symbols; ++i) {
+    index->AddEntry(0x1000 * (i + 1), 0x100, absl::StrCat("fn", i));
+  }
+  return index;
+}
+
+TEST(SymbolIndexDiskCacheTest, StoreAndLoad) {
+  px::testing::TempDir tmp_dir;
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<SymbolIndexDiskCache> cache,
+                       SymbolIndexDiskCache::Open(tmp_dir.path(), 1024 * 1024));
+
+  EXPECT_NOT_OK(cache->Load("abcd"));
+  EXPECT_OK(cache->Store("abcd", *MakeSymbolIndex(3)));
+  EXPECT_NOT_OK(cache->Store("../abcd", *MakeSymbolIndex(3)));
+
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<SymbolIndex> index, cache->Load("abcd"));
+  EXPECT_EQ(index->num_symbols(), 3);
+  EXPECT_EQ(index->Lookup(0x2050), "fn1");
+  EXPECT_EQ(index->Lookup(0x3000), "fn2");
+
+  // A new instance, as after a restart, finds the same entries.
+  cache.reset();
+  ASSERT_OK_AND_ASSIGN(cache, SymbolIndexDiskCache::Open(tmp_dir.path(), 1024 * 1024));
+  EXPECT_EQ(cache->num_entries(), 1);
+  ASSERT_OK_AND_ASSIGN(index, cache->Load("abcd"));
+  EXPECT_EQ(index->Lookup(0x1000), "fn0");
+}
+
+// A stripped binary has the build-id of its original, but not the same symbols.
+TEST(SymbolIndexDiskCacheTest, KeyIncludesBinarySize) {
+  px::testing::TempDir tmp_dir;
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<SymbolIndexDiskCache> cache,
+                       SymbolIndexDiskCache::Open(tmp_dir.path(), 1024 * 1024));
+
+  const std::string unstripped_key = SymbolIndexDiskCache::Key("abcd", 4096);
+  const std::string stripped_key = SymbolIndexDiskCache::Key("abcd", 1024);
+  EXPECT_OK(cache->Store(unstripped_key, *MakeSymbolIndex(3)));
+  EXPECT_OK(cache->Load(unstripped_key));
+  EXPECT_NOT_OK(cache->Load(stripped_key));
+}
+
+TEST(SymbolIndexDiskCacheTest, EvictsLeastRecentlyUsed) {
+  px::testing::TempDir tmp_dir;
+  const size_t entry_bytes = MakeSymbolIndex(10)->Serialize().size();
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<SymbolIndexDiskCache> cache,
+                       SymbolIndexDiskCache::Open(tmp_dir.path(), 2 * entry_bytes));
+
+  EXPECT_OK(cache->Store("aa", *MakeSymbolIndex(10)));
+  EXPECT_OK(cache->Store("bb", *MakeSymbolIndex(10)));
+  EXPECT_OK(cache->Load("aa"));
+  EXPECT_OK(cache->Store("cc", *MakeSymbolIndex(10)));
+
+  EXPECT_EQ(cache->num_entries(), 2);
+  EXPECT_EQ(cache->total_bytes(), 2 * entry_bytes);
+  EXPECT_OK(cache->Load("aa"));
+  EXPECT_NOT_OK(cache->Load("bb"));
+  EXPECT_OK(cache->Load("cc"));
+  EXPECT_FALSE(std::filesystem::exists(tmp_dir.path() / "bb.symidx"));
+
+  // Opening with a smaller size limit trims the directory.
+  cache.reset();
+  ASSERT_OK_AND_ASSIGN(cache, SymbolIndexDiskCache::Open(tmp_dir.path(), entry_bytes));
+  EXPECT_EQ(cache->num_entries(), 1);
+}
+
+TEST(SymbolIndexDiskCacheTest, DropsCorruptEntries) {
+  px::testing::TempDir tmp_dir;
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<SymbolIndexDiskCache> cache,
+                       SymbolIndexDiskCache::Open(tmp_dir.path(), 1024 * 1024));
+  EXPECT_OK(cache->Store("abcd", *MakeSymbolIndex(3)));
+
+  const std::filesystem::path path = tmp_dir.path() / "abcd.symidx";
+  ASSERT_OK_AND_ASSIGN(std::string contents, ReadFileToString(path.string()));
+  ASSERT_OK(WriteFileFromString(path.string(), contents.substr(0, contents.size() / 2)));
+
+  EXPECT_NOT_OK(cache->Load("abcd"));
+  EXPECT_EQ(cache->num_entries(), 0);
+  EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+}  // namespace stirling
+}  // namespace px
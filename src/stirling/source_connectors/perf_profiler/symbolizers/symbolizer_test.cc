@@ -78,6 +78,29 @@ TYPED_TEST(SymbolizerTest, UserSymbols) {
   EXPECT_EQ(symbolize(2), std::string("0x0000000000000002"));
 }
 
+// Tests that processes running the same binary share a single symbol index.
+TEST_F(ElfSymbolizerTest, SharesSymbolIndexAcrossUPIDs) {
+  auto* elf_symbolizer = static_cast<ElfSymbolizer*>(symbolizer_.get());
+
+  // Two UPIDs that resolve to the same binary.
+  const struct upid_t upid0 = {{static_cast<uint32_t>(getpid())}, 0};
+  const struct upid_t upid1 = {{static_cast<uint32_t>(getpid())}, 1};
+
+  auto symbolize0 = elf_symbolizer->GetSymbolizerFn(upid0);
+  auto symbolize1 = elf_symbolizer->GetSymbolizerFn(upid1);
+  EXPECT_EQ(elf_symbolizer->num_symbol_indexes(), 1);
+  EXPECT_EQ(symbolize0(kFooAddr), "test::foo()");
+  EXPECT_EQ(symbolize1(kFooAddr), "test::foo()");
+
+  // The index stays alive as long as one of the UPIDs uses it.
+  elf_symbolizer->DeleteUPID(upid0);
+  EXPECT_EQ(elf_symbolizer->num_symbol_indexes(), 1);
+  EXPECT_EQ(symbolize1(kBarAddr), "test::bar()");
+
+  elf_symbolizer->DeleteUPID(upid1);
+  EXPECT_EQ(elf_symbolizer->num_symbol_indexes(), 0);
+}
+
 TEST_F(BCCSymbolizerTest, KernelSymbols) {
   ASSERT_OK_AND_ASSIGN(std::unique_ptr<Symbolizer> symbolizer, BCCSymbolizer::Create());
 
@@ -196,8 +219,8 @@ TEST_F(BCCSymbolizerTest, DisableJavaSymbols) {
   EXPECT_FALSE(fs::Exists(artifacts_path_1));
 
   // Expect that JVMTI agent injection tracking includes sub-proc-0 but not sub-proc-1.
-  EXPECT_TRUE(JavaProfilingProcTracker::GetSingleton()->upids().contains(child_upid_0));
-  EXPECT_FALSE(JavaProfilingProcTracker::GetSingleton()->upids().contains(child_upid_1));
+  EXPECT_TRUE(JavaProfilingProcTracker::GetSingleton()->Contains(child_upid_0));
+  EXPECT_FALSE(JavaProfilingProcTracker::GetSingleton()->Contains(child_upid_1));
 }
 
 // Test the symbolizer with caching enabled and disabled.
@@ -355,7 +378,7 @@ TEST_F(BCCSymbolizerTest, JavaProcessBeingTracked) {
   const struct upid_t child_upid = {{child_pid}, start_time_ns};
   symbolizer->IterationPreTick();
   symbolizer->GetSymbolizerFn(child_upid);
-  EXPECT_TRUE(JavaProfilingProcTracker::GetSingleton()->upids().contains(child_upid));
+  EXPECT_TRUE(JavaProfilingProcTracker::GetSingleton()->Contains(child_upid));
 }
 
 }  // namespace stirling
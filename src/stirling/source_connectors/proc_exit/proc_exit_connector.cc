@@ -136,9 +136,9 @@ void ProcExitConnector::TransferDataImpl(ConnectorContext* ctx,
   events_.clear();
 }
 
-void ProcExitConnector::UpdateCrashedJavaProcCounters(
-    uint32_t asid, const proc_exit_event_t& event,
-    const absl::flat_hash_map<md::UPID, md::PIDInfoUPtr>& upid_pid_info_map) {
+void ProcExitConnector::UpdateCrashedJavaProcCounters(uint32_t asid,
+                                                      const proc_exit_event_t& event,
+                                                      const md::PIDInfoMap& upid_pid_info_map) {
   const uint8_t exit_signal = GetExitSignal(event.exit_code);
 
   const bool is_sig_abrt = exit_signal == SIGABRT;
@@ -171,7 +171,7 @@ void ProcExitConnector::UpdateCrashedJavaProcCounters(
   java_proc_crashed_counter_.Increment();
   monitor_.NotifyJavaProcessCrashed(event.upid);
 
-  if (JavaProfilingProcTracker::GetSingleton()->upids().contains(event.upid)) {
+  if (JavaProfilingProcTracker::GetSingleton()->Contains(event.upid)) {
     java_proc_crashed_with_profiler_counter_.Increment();
   } else {
     java_proc_crashed_without_profiler_counter_.Increment();
@@ -0,0 +1,123 @@
+/*
+ * This code runs using bpf in the Linux kernel.
+ * Copyright 2018- The Pixie Authors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ */
+
+// LINT_C_FILE: Do not remove this line. It ensures cpplint treats this as a C file.
+
+#include <linux/mm_types.h>
+#include <linux/sched.h>
+#include <linux/sched/signal.h>
+#include <linux/version.h>
+
+#include "src/stirling/bpf_tools/bcc_bpf/utils.h"
+#include "src/stirling/source_connectors/process_stats/bcc_bpf_intf/task_stats.h"
+
+// The context of task iterator programs. The kernel defines these in kernel/bpf/task_iter.c and
+// include/linux/bpf.h, which are not usable here, so they are mirrored under different names.
+struct pl_bpf_iter_meta {
+  struct seq_file* seq;
+  uint64_t session_id;
+  uint64_t seq_num;
+};
+
+struct pl_bpf_iter_task_ctx {
+  struct pl_bpf_iter_meta* meta;
+  struct task_struct* task;
+};
+
+static __inline uint64_t read_u64(const void* ptr) {
+  uint64_t val = 0;
+  bpf_probe_read_kernel(&val, sizeof(val), ptr);
+  return val;
+}
+
+// Mirrors get_mm_counter(), which clamps the transiently negative values to 0.
+static __inline uint64_t read_mm_counter(const struct mm_struct* mm, int member) {
+  int64_t val = 0;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0)
+  bpf_probe_read_kernel(&val, sizeof(val), &mm->rss_stat[member].count);
+#else
+  bpf_probe_read_kernel(&val, sizeof(val), &mm->rss_stat.count[member].counter);
+#endif
+  return val > 0 ? val : 0;
+}
+
+// Adds the I/O counters, as reported by /proc/<pid>/io.
+static __inline void add_ioac(const struct task_io_accounting* ioac, struct task_stats_t* stats) {
+#ifdef CONFIG_TASK_XACCT
+  stats->rchar_bytes += read_u64(&ioac->rchar);
+  stats->wchar_bytes += read_u64(&ioac->wchar);
+#endif
+#ifdef CONFIG_TASK_IO_ACCOUNTING
+  stats->read_bytes += read_u64(&ioac->read_bytes);
+  stats->write_bytes += read_u64(&ioac->write_bytes);
+#endif
+}
+
+// Called by the kernel for every task when user-space reads the iterator.
+// BCC attaches it to the task iterator based on its name.
+int bpf_iter__task(struct pl_bpf_iter_task_ctx* ctx) {
+  struct seq_file* seq = ctx->meta->seq;
+  struct task_struct* task = ctx->task;
+  // The program is called one last time with a NULL task at the end of the iteration.
+  if (task == NULL) {
+    return 0;
+  }
+
+  struct task_stats_t stats = {};
+  BPF_PROBE_READ_KERNEL_VAR(stats.tgid, &task->tgid);
+  BPF_PROBE_READ_KERNEL_VAR(stats.pid, &task->pid);
+
+  stats.minor_faults = read_u64(&task->min_flt);
+  stats.major_faults = read_u64(&task->maj_flt);
+  stats.utime_ns = read_u64(&task->utime);
+  stats.stime_ns = read_u64(&task->stime);
+  stats.runtime_ns = read_u64(&task->se.sum_exec_runtime);
+  add_ioac(&task->ioac, &stats);
+
+  if (stats.pid == stats.tgid) {
+    // Counters of the exited threads are folded into the signal_struct, shared by all threads.
+    struct signal_struct* sig = NULL;
+    BPF_PROBE_READ_KERNEL_VAR(sig, &task->signal);
+    if (sig != NULL) {
+      int nr_threads = 0;
+      BPF_PROBE_READ_KERNEL_VAR(nr_threads, &sig->nr_threads);
+      stats.num_threads = nr_threads;
+      stats.minor_faults += read_u64(&sig->min_flt);
+      stats.major_faults += read_u64(&sig->maj_flt);
+      stats.utime_ns += read_u64(&sig->utime);
+      stats.stime_ns += read_u64(&sig->stime);
+      stats.runtime_ns += read_u64(&sig->sum_sched_runtime);
+      add_ioac(&sig->ioac, &stats);
+    }
+
+    // Kernel threads have no mm.
+    struct mm_struct* mm = NULL;
+    BPF_PROBE_READ_KERNEL_VAR(mm, &task->mm);
+    if (mm != NULL) {
+      stats.vsize_pages = read_u64(&mm->total_vm);
+      stats.rss_pages = read_mm_counter(mm, MM_FILEPAGES) + read_mm_counter(mm, MM_ANONPAGES) +
+                        read_mm_counter(mm, MM_SHMEMPAGES);
+    }
+  }
+
+  bpf_seq_write(seq, &stats, sizeof(stats));
+  return 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+// A record written by the task iterator for each task (i.e. thread) in the system.
+// The counters of a process are the sum of the counters of its threads.
+struct task_stats_t {
+  uint32_t tgid;
+  uint32_t pid;
+
+  // Per-thread counters. For the thread group leader, these also include the counters
+  // accumulated by the threads of the group that have already exited.
+  uint64_t minor_faults;
+  uint64_t major_faults;
+  uint64_t utime_ns;
+  uint64_t stime_ns;
+  uint64_t runtime_ns;
+  uint64_t rchar_bytes;
+  uint64_t wchar_bytes;
+  uint64_t read_bytes;
+  uint64_t write_bytes;
+
+  // Process-wide values, only set for the thread group leader.
+  uint64_t num_threads;
+  uint64_t vsize_pages;
+  uint64_t rss_pages;
+};
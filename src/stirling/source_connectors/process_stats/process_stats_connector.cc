@@ -24,52 +24,100 @@
 #include <string>
 
 #include "src/common/base/base.h"
-#include "src/common/system/proc_parser.h"
 #include "src/shared/metadata/metadata.h"
 
+DEFINE_int32(stirling_process_stats_threads, 1,
+             "The number of threads used to read /proc when collecting process stats.");
+DEFINE_int32(stirling_process_stats_max_open_pids, 1024,
+             "The maximum number of processes whose /proc files are kept open between samples. "
+             "Each process takes 2 file descriptors; the number is further capped to a quarter of "
+             "the open files limit.");
+DEFINE_bool(stirling_process_stats_use_bpf_iter,
+            gflags::BoolFromEnv("PL_STIRLING_PROCESS_STATS_USE_BPF_ITER", true),
+            "If true, collect process stats with a BPF task iterator where the kernel supports it, "
+            "instead of reading /proc for each process.");
+
 namespace px {
 namespace stirling {
 
-using system::ProcParser;
-
 Status ProcessStatsConnector::InitImpl() {
+  proc_stats_sampler_ = std::make_unique<system::ProcStatsSampler>(
+      sysconfig_, FLAGS_stirling_process_stats_threads, FLAGS_stirling_process_stats_max_open_pids);
+
+  if (FLAGS_stirling_process_stats_use_bpf_iter) {
+    auto iter_or = TaskStatsIterator::Create(sysconfig_.PageSizeBytes(),
+                                             sysconfig_.KernelTickTimeNS());
+    if (iter_or.ok()) {
+      task_stats_iterator_ = iter_or.ConsumeValueOrDie();
+      LOG(INFO) << "Collecting process stats with a BPF task iterator.";
+    } else {
+      LOG(INFO) << absl::Substitute(
+          "BPF task iterator is not available, collecting process stats from /proc. Reason: $0",
+          iter_or.msg());
+    }
+  }
+
   sampling_freq_mgr_.set_period(kSamplingPeriod);
   push_freq_mgr_.set_period(kPushPeriod);
   return Status::OK();
 }
 
-Status ProcessStatsConnector::StopImpl() { return Status::OK(); }
+Status ProcessStatsConnector::StopImpl() {
+  task_stats_iterator_.reset();
+  return Status::OK();
+}
+
+void ProcessStatsConnector::SampleProcessStats() {
+  if (task_stats_iterator_ != nullptr) {
+    Status s = task_stats_iterator_->Sample(&task_stats_);
+    if (s.ok()) {
+      samples_.resize(pids_.size());
+      for (size_t i = 0; i < pids_.size(); ++i) {
+        auto it = task_stats_.find(pids_[i]);
+        if (it == task_stats_.end()) {
+          samples_[i].status = error::NotFound("PID not found by the BPF task iterator.");
+          continue;
+        }
+        samples_[i].status = Status::OK();
+        samples_[i].stats = it->second;
+      }
+      return;
+    }
+    LOG_FIRST_N(WARNING, 10) << absl::Substitute(
+        "Failed to run the BPF task iterator, falling back to /proc. Error=\"$0\"", s.msg());
+  }
+
+  proc_stats_sampler_->Sample(pids_, &samples_);
+}
 
 void ProcessStatsConnector::TransferProcessStatsTable(ConnectorContext* ctx,
                                                       DataTable* data_table) {
-  const absl::flat_hash_map<md::UPID, md::PIDInfoUPtr>& pid_info_by_upid = ctx->GetPIDInfoMap();
+  const md::PIDInfoMap& pid_info_by_upid = ctx->GetPIDInfoMap();
 
   int64_t timestamp = AdjustedSteadyClockNowNS();
 
+  upids_.clear();
+  pids_.clear();
   for (const auto& [upid, pid_info] : pid_info_by_upid) {
     // TODO(zasgar): Fix condition for dead pids after helper function is added.
     if (pid_info == nullptr || pid_info->stop_time_ns() > 0) {
       // PID has been stopped.
       continue;
     }
+    upids_.push_back(upid);
+    pids_.push_back(upid.pid());
+  }
 
-    ProcParser::ProcessStats stats;
-    int32_t pid = upid.pid();
-    // TODO(zasgar): We should double check the process start time to make sure it still the same
-    // PID.
-    auto s1 =
-        proc_parser_->ParseProcPIDStat(pid, system::Config::GetInstance().PageSizeBytes(),
-                                       system::Config::GetInstance().KernelTickTimeNS(), &stats);
-    if (!s1.ok()) {
-      VLOG(1) << absl::Substitute(
-          "Failed to fetch cpu stat info for PID ($0). Error=\"$1\" skipping.", pid, s1.msg());
-      continue;
-    }
+  // TODO(zasgar): We should double check the process start time to make sure it still the same
+  // PID.
+  SampleProcessStats();
 
-    auto s2 = proc_parser_->ParseProcPIDStatIO(pid, &stats);
-    if (!s2.ok()) {
-      VLOG(1) << absl::Substitute(
-          "Failed to fetch IO stat info for PID ($0). Error=\"$1\" skipping.", pid, s2.msg());
+  for (size_t i = 0; i < samples_.size(); ++i) {
+    const md::UPID& upid = upids_[i];
+    const auto& [status, stats] = samples_[i];
+    if (!status.ok()) {
+      VLOG(1) << absl::Substitute("Failed to fetch stats for PID ($0). Error=\"$1\" skipping.",
+                                  upid.pid(), status.msg());
       continue;
     }
 
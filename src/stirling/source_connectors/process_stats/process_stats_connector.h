@@ -25,11 +25,13 @@
 #include <vector>
 
 #include "src/common/base/base.h"
+#include "src/common/system/proc_stats_sampler.h"
 #include "src/common/system/system.h"
 #include "src/shared/metadata/metadata.h"
 #include "src/stirling/core/canonical_types.h"
 #include "src/stirling/core/source_connector.h"
 #include "src/stirling/source_connectors/process_stats/process_stats_table.h"
+#include "src/stirling/source_connectors/process_stats/task_stats_iterator.h"
 
 namespace px {
 namespace stirling {
@@ -57,14 +59,24 @@ class ProcessStatsConnector : public SourceConnector {
 
  protected:
   explicit ProcessStatsConnector(std::string_view source_name)
-      : SourceConnector(source_name, kTables) {
-    proc_parser_ = std::make_unique<system::ProcParser>(sysconfig_);
-  }
+      : SourceConnector(source_name, kTables) {}
 
  private:
   void TransferProcessStatsTable(ConnectorContext* ctx, DataTable* data_table);
 
-  std::unique_ptr<system::ProcParser> proc_parser_;
+  // Reads the stats of pids_ into samples_.
+  void SampleProcessStats();
+
+  std::unique_ptr<system::ProcStatsSampler> proc_stats_sampler_;
+
+  // Used instead of proc_stats_sampler_ when the kernel supports BPF task iterators.
+  std::unique_ptr<TaskStatsIterator> task_stats_iterator_;
+  absl::flat_hash_map<int32_t, system::ProcParser::ProcessStats> task_stats_;
+
+  // Reused across iterations to avoid reallocations.
+  std::vector<md::UPID> upids_;
+  std::vector<int32_t> pids_;
+  std::vector<system::ProcStatsSampler::PIDSample> samples_;
 };
 
 }  // namespace stirling
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/source_connectors/process_stats/task_stats_iterator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "src/stirling/bpf_tools/macros.h"
+#include "src/stirling/utils/linux_headers.h"
+
+BPF_SRC_STRVIEW(task_stats_iter_bcc_script, task_stats_iter);
+
+namespace px {
+namespace stirling {
+
+namespace {
+
+constexpr char kTaskIteratorFn[] = "bpf_iter__task";
+
+// BPF task iterators were introduced in Linux 5.8.
+constexpr uint32_t kLinux5p8VersionCode = 329728;
+
+}  // namespace
+
+void TaskStatsAggregator::Add(const struct task_stats_t& task_stats) {
+  Totals& totals = totals_[task_stats.tgid];
+  struct task_stats_t& stats = totals.stats;
+  stats.tgid = task_stats.tgid;
+  stats.minor_faults += task_stats.minor_faults;
+  stats.major_faults += task_stats.major_faults;
+  stats.utime_ns += task_stats.utime_ns;
+  stats.stime_ns += task_stats.stime_ns;
+  stats.runtime_ns += task_stats.runtime_ns;
+  stats.rchar_bytes += task_stats.rchar_bytes;
+  stats.wchar_bytes += task_stats.wchar_bytes;
+  stats.read_bytes += task_stats.read_bytes;
+  stats.write_bytes += task_stats.write_bytes;
+
+  if (task_stats.pid == task_stats.tgid) {
+    stats.pid = task_stats.pid;
+    stats.num_threads = task_stats.num_threads;
+    stats.vsize_pages = task_stats.vsize_pages;
+    stats.rss_pages = task_stats.rss_pages;
+    totals.has_leader = true;
+  }
+}
+
+TaskStatsAggregator::CPUTime TaskStatsAggregator::AdjustCPUTime(
+    uint32_t tgid, const struct task_stats_t& totals) {
+  CPUTime& prev = prev_cputime_[tgid];
+  const uint64_t rtime = totals.runtime_ns;
+  uint64_t utime = totals.utime_ns;
+  uint64_t stime = totals.stime_ns;
+
+  // The runtime can lag behind the tick-sampled times, in which case the previous values stand.
+  if (prev.utime_ns + prev.stime_ns >= rtime) {
+    return prev;
+  }
+
+  if (stime == 0) {
+    utime = rtime;
+  } else if (utime == 0) {
+    stime = rtime;
+  } else {
+    stime = static_cast<uint64_t>(static_cast<unsigned __int128>(stime) * rtime / (stime + utime));
+  }
+
+  // Neither value may go backwards, while their sum must be the runtime.
+  stime = std::max(stime, prev.stime_ns);
+  utime = rtime - stime;
+  if (utime < prev.utime_ns) {
+    utime = prev.utime_ns;
+    stime = rtime - utime;
+  }
+
+  prev = {utime, stime};
+  return prev;
+}
+
+void TaskStatsAggregator::Finish(
+    absl::flat_hash_map<int32_t, system::ProcParser::ProcessStats>* out) {
+  DCHECK(out != nullptr);
+  out->clear();
+  out->reserve(totals_.size());
+
+  for (const auto& [tgid, totals] : totals_) {
+    // A group without a leader was caught mid-exit; /proc would not report it either.
+    if (!totals.has_leader) {
+      continue;
+    }
+    const struct task_stats_t& stats = totals.stats;
+    const CPUTime cputime = AdjustCPUTime(tgid, stats);
+
+    system::ProcParser::ProcessStats& process_stats = (*out)[tgid];
+    process_stats.pid = tgid;
+    process_stats.minor_faults = stats.minor_faults;
+    process_stats.major_faults = stats.major_faults;
+    // Truncate to kernel ticks, the unit in which /proc reports CPU times.
+    process_stats.utime_ns = cputime.utime_ns / kernel_tick_time_ns_ * kernel_tick_time_ns_;
+    process_stats.ktime_ns = cputime.stime_ns / kernel_tick_time_ns_ * kernel_tick_time_ns_;
+    process_stats.num_threads = stats.num_threads;
+    process_stats.vsize_bytes = stats.vsize_pages * page_size_bytes_;
+    process_stats.rss_bytes = stats.rss_pages * page_size_bytes_;
+    process_stats.rchar_bytes = stats.rchar_bytes;
+    process_stats.wchar_bytes = stats.wchar_bytes;
+    process_stats.read_bytes = stats.read_bytes;
+    process_stats.write_bytes = stats.write_bytes;
+  }
+  totals_.clear();
+
+  // Forget the CPU times of processes that are gone.
+  for (auto it = prev_cputime_.begin(); it != prev_cputime_.end();) {
+    if (!out->contains(it->first)) {
+      prev_cputime_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+StatusOr<std::unique_ptr<TaskStatsIterator>> TaskStatsIterator::Create(
+    int64_t page_size_bytes, int64_t kernel_tick_time_ns) {
+  if (utils::GetCachedKernelVersion().code() < kLinux5p8VersionCode) {
+    return error::Unimplemented("BPF task iterators require Linux 5.8+.");
+  }
+
+  std::unique_ptr<TaskStatsIterator> iter(
+      new TaskStatsIterator(page_size_bytes, kernel_tick_time_ns));
+  PL_RETURN_IF_ERROR(iter->InitBPFProgram(task_stats_iter_bcc_script));
+
+  // The task_struct offset overrides of BCCWrapper only cover a couple of fields, not the many
+  // fields read here, so packaged headers cannot be trusted to match the running kernel.
+  if (utils::g_packaged_headers_installed) {
+    return error::FailedPrecondition("BPF task iterator requires the host's Linux headers.");
+  }
+
+  PL_RETURN_IF_ERROR(iter->AttachIterator(kTaskIteratorFn));
+  return iter;
+}
+
+Status TaskStatsIterator::Sample(
+    absl::flat_hash_map<int32_t, system::ProcParser::ProcessStats>* out) {
+  PL_RETURN_IF_ERROR(ReadIterator(kTaskIteratorFn, &buf_));
+
+  if (buf_.size() % sizeof(struct task_stats_t) != 0) {
+    return error::Internal("Unexpected task iterator output size: $0", buf_.size());
+  }
+
+  for (size_t offset = 0; offset < buf_.size(); offset += sizeof(struct task_stats_t)) {
+    struct task_stats_t task_stats;
+    std::memcpy(&task_stats, buf_.data() + offset, sizeof(task_stats));
+    aggregator_.Add(task_stats);
+  }
+  aggregator_.Finish(out);
+
+  return Status::OK();
+}
+
+}  // namespace stirling
+}  // namespace px
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <absl/container/flat_hash_map.h>
+
+#include "src/common/base/base.h"
+#include "src/common/system/proc_parser.h"
+#include "src/stirling/bpf_tools/bcc_wrapper.h"
+#include "src/stirling/source_connectors/process_stats/bcc_bpf_intf/task_stats.h"
+
+namespace px {
+namespace stirling {
+
+/**
+ * Folds the per-thread records of the task iterator into per-process stats, computed the same way
+ * as /proc/<pid>/stat and /proc/<pid>/io compute them.
+ */
+class TaskStatsAggregator {
+ public:
+  TaskStatsAggregator(int64_t page_size_bytes, int64_t kernel_tick_time_ns)
+      : page_size_bytes_(page_size_bytes), kernel_tick_time_ns_(kernel_tick_time_ns) {}
+
+  /**
+   * Adds the record of one thread to the totals of its process.
+   */
+  void Add(const struct task_stats_t& task_stats);
+
+  /**
+   * Moves the totals of all processes added since the last call into the output, keyed by PID.
+   */
+  void Finish(absl::flat_hash_map<int32_t, system::ProcParser::ProcessStats>* out);
+
+ private:
+  struct CPUTime {
+    uint64_t utime_ns = 0;
+    uint64_t stime_ns = 0;
+  };
+
+  struct Totals {
+    struct task_stats_t stats = {};
+    bool has_leader = false;
+  };
+
+  // Splits the precise runtime of a process between user and system time, in the proportion of
+  // the tick-sampled utime and stime. Mirrors cputime_adjust() in kernel/sched/cputime.c,
+  // including keeping each value monotonic across calls.
+  CPUTime AdjustCPUTime(uint32_t tgid, const struct task_stats_t& totals);
+
+  const int64_t page_size_bytes_;
+  const int64_t kernel_tick_time_ns_;
+
+  absl::flat_hash_map<uint32_t, Totals> totals_;
+  absl::flat_hash_map<uint32_t, CPUTime> prev_cputime_;
+};
+
+/**
+ * Collects the stats of all processes in one pass of a BPF task iterator (Linux 5.8+), instead of
+ * reading /proc/<pid>/stat and /proc/<pid>/io for each process.
+ */
+class TaskStatsIterator : public bpf_tools::BCCWrapper {
+ public:
+  /**
+   * Compiles and attaches the task iterator.
+   * @return error if the kernel does not support task iterators, or if the Linux headers are not
+   *               the host's own, since the iterator reads kernel structs through their layout.
+   */
+  static StatusOr<std::unique_ptr<TaskStatsIterator>> Create(int64_t page_size_bytes,
+                                                             int64_t kernel_tick_time_ns);
+
+  /**
+   * Collects the stats of all processes, keyed by PID. Previous contents of out are discarded.
+   */
+  Status Sample(absl::flat_hash_map<int32_t, system::ProcParser::ProcessStats>* out);
+
+ private:
+  TaskStatsIterator(int64_t page_size_bytes, int64_t kernel_tick_time_ns)
+      : aggregator_(page_size_bytes, kernel_tick_time_ns) {}
+
+  TaskStatsAggregator aggregator_;
+  std::string buf_;
+};
+
+}  // namespace stirling
+}  // namespace px
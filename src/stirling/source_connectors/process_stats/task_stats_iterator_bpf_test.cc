@@ -0,0 +1,85 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/source_connectors/process_stats/task_stats_iterator.h"
+
+#include <unistd.h>
+
+#include <memory>
+#include <utility>
+
+#include "src/common/system/config.h"
+#include "src/common/system/proc_parser.h"
+#include "src/common/testing/testing.h"
+
+namespace px {
+namespace stirling {
+
+using ::testing::Ge;
+using ::testing::Le;
+
+// Compares the stats of this process, as reported by the task iterator and by /proc.
+TEST(TaskStatsIteratorTest, MatchesProcParser) {
+  const system::Config& sysconfig = system::Config::GetInstance();
+  auto iter_or = TaskStatsIterator::Create(sysconfig.PageSizeBytes(), sysconfig.KernelTickTimeNS());
+  if (error::IsUnimplemented(iter_or.status())) {
+    GTEST_SKIP() << iter_or.msg();
+  }
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<TaskStatsIterator> iter, std::move(iter_or));
+
+  system::ProcParser proc_parser(sysconfig);
+  system::ProcParser::ProcessStats before;
+  ASSERT_OK(proc_parser.ParseProcPIDStat(getpid(), sysconfig.PageSizeBytes(),
+                                         sysconfig.KernelTickTimeNS(), &before));
+  ASSERT_OK(proc_parser.ParseProcPIDStatIO(getpid(), &before));
+
+  absl::flat_hash_map<int32_t, system::ProcParser::ProcessStats> task_stats;
+  ASSERT_OK(iter->Sample(&task_stats));
+
+  system::ProcParser::ProcessStats after;
+  ASSERT_OK(proc_parser.ParseProcPIDStat(getpid(), sysconfig.PageSizeBytes(),
+                                         sysconfig.KernelTickTimeNS(), &after));
+  ASSERT_OK(proc_parser.ParseProcPIDStatIO(getpid(), &after));
+
+  ASSERT_TRUE(task_stats.contains(getpid()));
+  const system::ProcParser::ProcessStats& stats = task_stats[getpid()];
+
+  // The counters only move forward, so the iterator's must be between the two /proc samples.
+  EXPECT_THAT(stats.minor_faults, Ge(before.minor_faults));
+  EXPECT_THAT(stats.minor_faults, Le(after.minor_faults));
+  EXPECT_THAT(stats.major_faults, Ge(before.major_faults));
+  EXPECT_THAT(stats.major_faults, Le(after.major_faults));
+  EXPECT_THAT(stats.utime_ns + stats.ktime_ns,
+              Ge(before.utime_ns + before.ktime_ns - sysconfig.KernelTickTimeNS()));
+  EXPECT_THAT(stats.utime_ns + stats.ktime_ns,
+              Le(after.utime_ns + after.ktime_ns + sysconfig.KernelTickTimeNS()));
+  EXPECT_THAT(stats.rchar_bytes, Ge(before.rchar_bytes));
+  EXPECT_THAT(stats.rchar_bytes, Le(after.rchar_bytes));
+  EXPECT_THAT(stats.wchar_bytes, Ge(before.wchar_bytes));
+  EXPECT_THAT(stats.wchar_bytes, Le(after.wchar_bytes));
+  EXPECT_EQ(stats.num_threads, after.num_threads);
+  EXPECT_GT(stats.vsize_bytes, 0);
+  EXPECT_GT(stats.rss_bytes, 0);
+
+  // Kernel threads (kthreadd) are reported too, with no memory.
+  ASSERT_TRUE(task_stats.contains(2));
+  EXPECT_EQ(task_stats[2].vsize_bytes, 0);
+}
+
+}  // namespace stirling
+}  // namespace px
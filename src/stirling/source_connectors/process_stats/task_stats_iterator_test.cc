@@ -0,0 +1,126 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/source_connectors/process_stats/task_stats_iterator.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "src/common/testing/testing.h"
+
+namespace px {
+namespace stirling {
+
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+
+constexpr int64_t kPageSizeBytes = 4096;
+constexpr int64_t kKernelTickTimeNS = 10'000'000;
+
+struct task_stats_t TaskStats(uint32_t tgid, uint32_t pid) {
+  struct task_stats_t stats = {};
+  stats.tgid = tgid;
+  stats.pid = pid;
+  stats.minor_faults = 10;
+  stats.major_faults = 1;
+  stats.utime_ns = 30 * kKernelTickTimeNS;
+  stats.stime_ns = 10 * kKernelTickTimeNS;
+  stats.runtime_ns = 40 * kKernelTickTimeNS;
+  stats.rchar_bytes = 100;
+  stats.wchar_bytes = 200;
+  stats.read_bytes = 4096;
+  stats.write_bytes = 8192;
+  if (tgid == pid) {
+    stats.num_threads = 2;
+    stats.vsize_pages = 1000;
+    stats.rss_pages = 100;
+  }
+  return stats;
+}
+
+TEST(TaskStatsAggregatorTest, SumsThreadsIntoProcesses) {
+  TaskStatsAggregator aggregator(kPageSizeBytes, kKernelTickTimeNS);
+  aggregator.Add(TaskStats(100, 100));
+  aggregator.Add(TaskStats(100, 101));
+  aggregator.Add(TaskStats(200, 200));
+
+  absl::flat_hash_map<int32_t, system::ProcParser::ProcessStats> out;
+  aggregator.Finish(&out);
+  ASSERT_THAT(out, SizeIs(2));
+
+  const system::ProcParser::ProcessStats& stats = out[100];
+  EXPECT_EQ(stats.pid, 100);
+  EXPECT_EQ(stats.minor_faults, 20);
+  EXPECT_EQ(stats.major_faults, 2);
+  EXPECT_EQ(stats.utime_ns, 60 * kKernelTickTimeNS);
+  EXPECT_EQ(stats.ktime_ns, 20 * kKernelTickTimeNS);
+  EXPECT_EQ(stats.num_threads, 2);
+  EXPECT_EQ(stats.vsize_bytes, 1000 * kPageSizeBytes);
+  EXPECT_EQ(stats.rss_bytes, 100 * kPageSizeBytes);
+  EXPECT_EQ(stats.rchar_bytes, 200);
+  EXPECT_EQ(stats.wchar_bytes, 400);
+  EXPECT_EQ(stats.read_bytes, 8192);
+  EXPECT_EQ(stats.write_bytes, 16384);
+
+  EXPECT_EQ(out[200].minor_faults, 10);
+
+  // The totals are reset by Finish().
+  aggregator.Finish(&out);
+  EXPECT_THAT(out, IsEmpty());
+}
+
+TEST(TaskStatsAggregatorTest, DropsProcessesWithoutLeader) {
+  TaskStatsAggregator aggregator(kPageSizeBytes, kKernelTickTimeNS);
+  aggregator.Add(TaskStats(100, 101));
+
+  absl::flat_hash_map<int32_t, system::ProcParser::ProcessStats> out;
+  aggregator.Finish(&out);
+  EXPECT_THAT(out, IsEmpty());
+}
+
+TEST(TaskStatsAggregatorTest, AdjustsCPUTimeToRuntime) {
+  TaskStatsAggregator aggregator(kPageSizeBytes, kKernelTickTimeNS);
+  absl::flat_hash_map<int32_t, system::ProcParser::ProcessStats> out;
+
+  // 3:1 user to system ticks, over a precise runtime of 80 ticks.
+  struct task_stats_t stats = TaskStats(100, 100);
+  stats.runtime_ns = 80 * kKernelTickTimeNS;
+  aggregator.Add(stats);
+  aggregator.Finish(&out);
+  EXPECT_EQ(out[100].utime_ns, 60 * kKernelTickTimeNS);
+  EXPECT_EQ(out[100].ktime_ns, 20 * kKernelTickTimeNS);
+
+  // Runtime lagging behind the previous split keeps the previous values.
+  stats.runtime_ns = 70 * kKernelTickTimeNS;
+  aggregator.Add(stats);
+  aggregator.Finish(&out);
+  EXPECT_EQ(out[100].utime_ns, 60 * kKernelTickTimeNS);
+  EXPECT_EQ(out[100].ktime_ns, 20 * kKernelTickTimeNS);
+
+  // A shift towards user time must not decrease the system time.
+  stats.utime_ns = 99 * kKernelTickTimeNS;
+  stats.stime_ns = 1 * kKernelTickTimeNS;
+  stats.runtime_ns = 100 * kKernelTickTimeNS;
+  aggregator.Add(stats);
+  aggregator.Finish(&out);
+  EXPECT_EQ(out[100].utime_ns, 80 * kKernelTickTimeNS);
+  EXPECT_EQ(out[100].ktime_ns, 20 * kKernelTickTimeNS);
+}
+
+}  // namespace stirling
+}  // namespace px
@@ -109,6 +109,18 @@ BPF_PERCPU_ARRAY(conn_stats_event_buffer_heap, struct conn_stats_event_t, 1);
 // number of arrays with only 1 element.
 BPF_PERCPU_ARRAY(control_values, int64_t, kNumControlValues);
 
+// Per-protocol connection sampling rates, which override kConnSamplingRateIndex in
+// control_values. Data is traced for 1 in N connections of the protocol; 0 means no override.
+BPF_PERCPU_ARRAY(protocol_sampling_rate_map, uint32_t, kNumProtocols);
+
+// Per-process connection sampling rates, which override the per-protocol and default rates.
+// Key is the TGID of the process; Value is N, to trace data for 1 in N connections.
+BPF_HASH(pid_sampling_rate_map, uint32_t, uint32_t, 1024);
+
+// Remote ports whose connections should not have their data traced.
+// Key is the port in network byte order; Value is unused.
+BPF_HASH(ignored_ports_map, uint16_t, bool, 1024);
+
 /***********************************************************
  * General helper functions
  ***********************************************************/
@@ -213,12 +225,69 @@ static __inline bool should_trace_protocol_data(const struct conn_info_t* conn_i
     return false;
   }
 
+  if (conn_info->sampled_out) {
+    return false;
+  }
+
   uint32_t protocol = conn_info->protocol;
   uint64_t kZero = 0;
   uint64_t control = *control_map.lookup_or_init(&protocol, &kZero);
   return control & conn_info->role;
 }
 
+static __inline uint32_t get_conn_sampling_rate(const struct conn_info_t* conn_info) {
+  uint32_t tgid = conn_info->conn_id.upid.tgid;
+  uint32_t* pid_rate = pid_sampling_rate_map.lookup(&tgid);
+  if (pid_rate != NULL) {
+    return *pid_rate;
+  }
+
+  uint32_t protocol = conn_info->protocol;
+  uint32_t* protocol_rate = protocol_sampling_rate_map.lookup(&protocol);
+  if (protocol_rate != NULL && *protocol_rate != 0) {
+    return *protocol_rate;
+  }
+
+  int idx = kConnSamplingRateIndex;
+  int64_t* default_rate = control_values.lookup(&idx);
+  if (default_rate != NULL && *default_rate > 0) {
+    return *default_rate;
+  }
+
+  return 1;
+}
+
+// Decides, once per connection, whether the connection's data should be traced.
+// Must be called after the protocol of the connection has been inferred.
+static __inline bool should_sample_conn(const struct conn_info_t* conn_info) {
+  uint32_t rate = get_conn_sampling_rate(conn_info);
+  if (rate <= 1) {
+    return true;
+  }
+  return bpf_get_prandom_u32() % rate == 0;
+}
+
+static __inline bool is_ignored_port(const union sockaddr_t* addr) {
+  uint16_t port = 0;
+  if (addr->sa.sa_family == AF_INET) {
+    port = addr->in4.sin_port;
+  } else if (addr->sa.sa_family == AF_INET6) {
+    port = addr->in6.sin6_port;
+  } else {
+    return false;
+  }
+  return ignored_ports_map.lookup(&port) != NULL;
+}
+
+static __inline int64_t get_max_msg_bytes() {
+  int idx = kMaxMsgBytesIndex;
+  int64_t* max_msg_bytes = control_values.lookup(&idx);
+  if (max_msg_bytes == NULL) {
+    return 0;
+  }
+  return *max_msg_bytes;
+}
+
 static __inline bool is_stirling_tgid(const uint32_t tgid) {
   int idx = kStirlingTGIDIndex;
   int64_t* stirling_tgid = control_values.lookup(&idx);
@@ -272,6 +341,11 @@ static __inline void update_traffic_class(struct conn_info_t* conn_info,
   // Update protocol if not set.
   if (conn_info->protocol == kProtocolUnknown) {
     conn_info->protocol = inferred_protocol.protocol;
+    // The sampling decision is made once per connection, as soon as its protocol is known,
+    // so that either all or none of the connection's data is sent to user-space.
+    if (!should_sample_conn(conn_info)) {
+      conn_info->sampled_out = true;
+    }
   }
 
   // Update role if not set.
@@ -331,6 +405,8 @@ static __inline void submit_new_conn(struct pt_regs* ctx, uint32_t tgid, int32_t
     read_sockaddr_kernel(&conn_info, socket);
   }
   conn_info.role = role;
+  conn_info.ignored_port = is_ignored_port(&conn_info.addr);
+  conn_info.sampled_out = conn_info.ignored_port;
 
   uint64_t tgid_fd = gen_tgid_fd(tgid, fd);
   conn_info_map.update(&tgid_fd, &conn_info);
@@ -369,13 +445,18 @@ static __inline void submit_close_event(struct pt_regs* ctx, struct conn_info_t*
 // Writes the input buf to event, and submits the event to the corresponding perf buffer.
 // Returns the bytes output from the input buf. Note that is not the total bytes submitted to the
 // perf buffer, which includes additional metadata.
+// At most copy_limit bytes of buf are copied; the remainder is only accounted for in msg_size.
 static __inline void perf_submit_buf(struct pt_regs* ctx, const enum traffic_direction_t direction,
-                                     const char* buf, size_t buf_size,
+                                     const char* buf, size_t buf_size, size_t copy_limit,
                                      struct conn_info_t* conn_info,
                                      struct socket_data_event_t* event) {
   // Record original size of packet. This may get truncated below before submit.
   event->attr.msg_size = buf_size;
 
+  if (buf_size > copy_limit) {
+    buf_size = copy_limit;
+  }
+
   // This rest of this function has been written carefully to keep the BPF verifier happy in older
   // kernels, so please take care when modifying.
   //
@@ -444,15 +525,23 @@ static __inline void perf_submit_wrapper(struct pt_regs* ctx,
                                          const enum traffic_direction_t direction, const char* buf,
                                          const size_t buf_size, struct conn_info_t* conn_info,
                                          struct socket_data_event_t* event) {
+  // Only the first max_msg_bytes of a message over the configured limit are copied. The chunk
+  // that reaches the limit also accounts for the rest of the message in its msg_size.
+  const int64_t max_msg_bytes = get_max_msg_bytes();
+  const size_t copy_size =
+      (max_msg_bytes > 0 && buf_size > max_msg_bytes) ? max_msg_bytes : buf_size;
+
   int bytes_sent = 0;
   unsigned int i;
 
 #pragma unroll
   for (i = 0; i < CHUNK_LIMIT; ++i) {
-    const int bytes_remaining = buf_size - bytes_sent;
+    const int bytes_remaining = copy_size - bytes_sent;
     const size_t current_size =
         (bytes_remaining > MAX_MSG_SIZE && (i != CHUNK_LIMIT - 1)) ? MAX_MSG_SIZE : bytes_remaining;
-    perf_submit_buf(ctx, direction, buf + bytes_sent, current_size, conn_info, event);
+    const size_t msg_size =
+        (bytes_sent + current_size == copy_size) ? buf_size - bytes_sent : current_size;
+    perf_submit_buf(ctx, direction, buf + bytes_sent, msg_size, current_size, conn_info, event);
     bytes_sent += current_size;
 
     // Move the position for the next event.
@@ -469,6 +558,14 @@ static __inline void perf_submit_iovecs(struct pt_regs* ctx,
   // array order. That means they read or fill iov[0], then iov[1], and so on. They return the total
   // size of the written or read data. Therefore, when loop through the buffers, both the number of
   // buffers and the total size need to be checked. More details can be found on their man pages.
+  //
+  // The configured limit applies to the whole message, not to each buffer: only the first
+  // max_msg_bytes of the message are copied, and the event that reaches the limit also accounts
+  // for the rest of the message in its msg_size.
+  const int64_t max_msg_bytes = get_max_msg_bytes();
+  const size_t copy_size =
+      (max_msg_bytes > 0 && total_size > max_msg_bytes) ? max_msg_bytes : total_size;
+
   int bytes_sent = 0;
 #pragma unroll
   for (int i = 0; i < LOOP_LIMIT && i < iovlen && bytes_sent < total_size; ++i) {
@@ -477,14 +574,16 @@ static __inline void perf_submit_iovecs(struct pt_regs* ctx,
 
     const int bytes_remaining = total_size - bytes_sent;
     const size_t iov_size = min_size_t(iov_cpy.iov_len, bytes_remaining);
+    const size_t copy_limit = copy_size - bytes_sent;
+    const size_t msg_size = (iov_size >= copy_limit) ? bytes_remaining : iov_size;
 
     // TODO(oazizi/yzhao): Should switch this to go through perf_submit_wrapper.
     //                     We don't have the BPF instruction count to do so right now.
-    perf_submit_buf(ctx, direction, iov_cpy.iov_base, iov_size, conn_info, event);
-    bytes_sent += iov_size;
+    perf_submit_buf(ctx, direction, iov_cpy.iov_base, msg_size, copy_limit, conn_info, event);
+    bytes_sent += msg_size;
 
     // Move the position for the next event.
-    event->attr.pos += iov_size;
+    event->attr.pos += msg_size;
   }
 
   // TODO(oazizi): If there is data left after the loop limit, we should still report the remainder
@@ -869,7 +968,13 @@ static __inline void process_syscall_close(struct pt_regs* ctx, uint64_t id,
   // This is to avoid polluting the perf buffer.
   if (should_trace_sockaddr_family(conn_info->addr.sa.sa_family) || conn_info->wr_bytes != 0 ||
       conn_info->rd_bytes != 0) {
-    submit_close_event(ctx, conn_info, kSyscallClose);
+    // Connections on ignored ports never had data sent to user-space, so their close event is
+    // not needed either. The final conn stats event below still reports the close.
+    // The decision made when the connection was opened is used, since the ignore list may have
+    // changed since, and a connection that was traced must still get its close event.
+    if (!conn_info->ignored_port) {
+      submit_close_event(ctx, conn_info, kSyscallClose);
+    }
 
     // Report final conn stats event for this connection.
     struct conn_stats_event_t* event = fill_conn_stats_event(conn_info);
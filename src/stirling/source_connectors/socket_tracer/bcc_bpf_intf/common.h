@@ -89,5 +89,11 @@ enum control_value_index_t {
   // * Support efficient lookup inside bpf to minimize overhead.
   kTargetTGIDIndex = 0,
   kStirlingTGIDIndex,
+  // Default connection sampling rate: data is traced for 1 in N connections.
+  // Values <= 1 mean all connections are traced. Can be overridden per protocol and per UPID.
+  kConnSamplingRateIndex,
+  // Maximum number of bytes copied to user-space for each message. Truncated bytes are accounted
+  // for in user-space with filler events. Values <= 0 mean no limit beyond MAX_MSG_SIZE.
+  kMaxMsgBytesIndex,
   kNumControlValues,
 };
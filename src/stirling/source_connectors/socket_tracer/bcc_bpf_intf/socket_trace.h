@@ -28,6 +28,9 @@
 
 const char kControlMapName[] = "control_map";
 const char kControlValuesArrayName[] = "control_values";
+const char kProtocolSamplingRateMapName[] = "protocol_sampling_rate_map";
+const char kPIDSamplingRateMapName[] = "pid_sampling_rate_map";
+const char kIgnoredPortsMapName[] = "ignored_ports_map";
 
 const int64_t kTraceAllTGIDs = -1;
 
@@ -85,6 +88,15 @@ struct conn_info_t {
   size_t prev_count;
   char prev_buf[4];
   bool prepend_length_header;
+
+  // Whether the connection was excluded by the sampling or port filter policy.
+  // Data of such connections is not sent to user-space, but conn stats are still reported.
+  bool sampled_out;
+
+  // Whether the remote port was on the ignore list when the connection was opened.
+  // Such connections also have no close event sent to user-space. The decision is kept here,
+  // so that changes to the ignore list only apply to new connections.
+  bool ignored_port;
 };
 
 // This struct is a subset of conn_info_t. It is used to communicate connect/accept events.
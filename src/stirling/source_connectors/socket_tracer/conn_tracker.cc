@@ -79,6 +79,7 @@ ConnTracker::~ConnTracker() {
   if (conn_info_map_mgr_ != nullptr) {
     conn_info_map_mgr_->ReleaseResources(conn_id_);
   }
+  RecycleProtocolState();
 }
 
 void ConnTracker::AddControlEvent(const socket_control_event_t& event) {
@@ -211,6 +212,13 @@ void ConnTracker::AddConnStats(const conn_stats_event_t& event) {
     conn_stats_.set_bytes_sent(event.wr_bytes);
     conn_stats_.set_closed(event.conn_events & CONN_CLOSE);
 
+    // BPF suppresses the close event of connections whose data is never traced (e.g. those on
+    // ignored ports), so the final conn stats event is what retires their tracker.
+    if (conn_stats_.closed() && close_info_.timestamp_ns == 0 &&
+        stats_.Get(StatKey::kDataEventSent) == 0 && stats_.Get(StatKey::kDataEventRecv) == 0) {
+      MarkForDeath();
+    }
+
     last_conn_stats_update_ = event.timestamp_ns;
   } else {
     DCHECK_LE(static_cast<bool>(event.conn_events & CONN_CLOSE), conn_stats_.closed());
@@ -403,6 +411,14 @@ void ConnTracker::Reset() {
   send_data_.Reset();
   recv_data_.Reset();
 
+  RecycleProtocolState();
+}
+
+void ConnTracker::RecycleProtocolState() {
+  if (protocol_state_recycler_ != nullptr && protocol_state_.has_value()) {
+    protocol_state_recycler_(&protocol_state_);
+  }
+  protocol_state_recycler_ = nullptr;
   protocol_state_.reset();
 }
 
@@ -828,6 +844,39 @@ void ConnTracker::IterationPostTick() {
   }
 }
 
+bool ConnTracker::HasPendingWork() const {
+  return death_countdown_ > 0 || send_data_.HasPendingData() || recv_data_.HasPendingData() ||
+         !http2_client_streams_.streams().empty() || !http2_server_streams_.streams().empty();
+}
+
+int ConnTracker::IdleIterationsUntilProcCheck() const {
+  if (!FLAGS_stirling_check_proc_for_conn_close || IsZombie()) {
+    return -1;
+  }
+  return std::max(idle_iteration_threshold_ - idle_iteration_count_, 1);
+}
+
+void ConnTracker::CatchUpIdleIterations(
+    std::chrono::time_point<std::chrono::steady_clock> iteration_time, int num_iterations) {
+  if (num_iterations <= 0) {
+    return;
+  }
+
+  set_current_time(iteration_time);
+
+  if (death_countdown_ > 0) {
+    death_countdown_ = std::max(death_countdown_ - num_iterations, 0);
+  }
+  idle_iteration_count_ += num_iterations;
+
+  // Any /proc check that would have been due during the skipped iterations is done by the
+  // caller scheduling a visit for it, so only the inactivity timeout needs to be applied here.
+  if (current_time_ > last_activity_timestamp_ + InactivityDuration()) {
+    Reset();
+    last_activity_timestamp_ = current_time_;
+  }
+}
+
 void ConnTracker::CheckProcForConnClose() {
   const auto& sysconfig = system::Config::GetInstance();
   std::filesystem::path fd_file = sysconfig.proc_path() / std::to_string(conn_id().upid.pid) /
@@ -23,6 +23,7 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <variant>
@@ -41,6 +42,7 @@
 #include "src/stirling/source_connectors/socket_tracer/socket_trace_bpf_tables.h"
 // Include all specializations of the StitchFrames() template specializations for all protocols.
 #include "src/stirling/source_connectors/socket_tracer/protocols/stitchers.h"
+#include "src/stirling/utils/obj_pool.h"
 #include "src/stirling/utils/stat_counter.h"
 
 DECLARE_bool(treat_loopback_as_in_cluster);
@@ -462,6 +464,28 @@ class ConnTracker : NotCopyMoveable {
    */
   void IterationPostTick();
 
+  /**
+   * Returns true if the tracker must be visited on every iteration, even if it receives no new
+   * events: it is holding unprocessed data or parsed frames, or is counting down to its death.
+   * Trackers without pending work only need to be visited when they receive events,
+   * or when an idleness check is due (see IdleIterationsUntilProcCheck()).
+   */
+  bool HasPendingWork() const;
+
+  /**
+   * Returns the number of idle iterations after which IterationPostTick() will check /proc
+   * for whether the connection has closed, or -1 if no such check is pending.
+   */
+  int IdleIterationsUntilProcCheck() const;
+
+  /**
+   * Brings a tracker that was not visited for some iterations up to date, as though
+   * IterationPreTick() and IterationPostTick() had been called on each of those iterations.
+   * The skipped iterations are by definition idle, and the last one ended at iteration_time.
+   */
+  void CatchUpIdleIterations(std::chrono::time_point<std::chrono::steady_clock> iteration_time,
+                             int num_iterations);
+
   /**
    * Sets the duration after which a connection is deemed to be inactive.
    * After becoming inactive, the connection may either (1) have its buffers purged,
@@ -507,11 +531,25 @@ class ConnTracker : NotCopyMoveable {
     if constexpr (!std::is_same_v<TStateType, protocols::NoState>) {
       TStateType* state_types_ptr = std::any_cast<TStateType>(&protocol_state_);
       if (state_types_ptr == nullptr) {
-        protocol_state_.emplace<TStateType>();
+        RecycleProtocolState();
+        // Reuse the state object (and its heap allocation) of a previous connection if possible.
+        std::optional<std::any> recycled = ProtocolStatePool<TStateType>().Pop();
+        if (recycled.has_value()) {
+          protocol_state_ = std::move(recycled.value());
+        } else {
+          protocol_state_.emplace<TStateType>();
+        }
+        protocol_state_recycler_ = &RecycleProtocolStateOfType<TStateType>;
       }
     }
   }
 
+  /**
+   * Hit/miss statistics of the protocol state objects recycled across ConnTrackers, summed over
+   * all protocols. The pools are per-thread, so these are the statistics of the calling thread.
+   */
+  static const PoolStats& ProtocolStatePoolStats() { return MutableProtocolStatePoolStats(); }
+
   /**
    * Returns the current protocol state for a protocol.
    */
@@ -542,13 +580,15 @@ class ConnTracker : NotCopyMoveable {
     }
 
     auto* state = protocol_state<TStateType>();
-    if (send_data_.CleanupEvents(buffer_size_limit_bytes, buffer_expiry_timestamp)) {
+    if (send_data_.CleanupEvents(send_data_.AdaptiveRetentionSize(buffer_size_limit_bytes),
+                                 buffer_expiry_timestamp)) {
       if (state != nullptr) {
         state->global = {};
         state->send = {};
       }
     }
-    if (recv_data_.CleanupEvents(buffer_size_limit_bytes, buffer_expiry_timestamp)) {
+    if (recv_data_.CleanupEvents(recv_data_.AdaptiveRetentionSize(buffer_size_limit_bytes),
+                                 buffer_expiry_timestamp)) {
       if (state != nullptr) {
         state->global = {};
         state->recv = {};
@@ -588,6 +628,26 @@ class ConnTracker : NotCopyMoveable {
   void set_is_tracked_upid() { is_tracked_upid_ = true; }
   bool is_tracked_upid() const { return is_tracked_upid_; }
 
+  /**
+   * Returns the memory allocated by the raw data buffers of both directions.
+   * Unlike MemUsage(), this does not depend on the protocol.
+   */
+  size_t DataBufferMemUsage() const {
+    return send_data_.data_buffer().capacity() + recv_data_.data_buffer().capacity();
+  }
+
+  /**
+   * Drops the unprocessed raw data of both directions and releases the buffers' memory.
+   * The protocol state is reset too, as in Cleanup(), since the parsers can't resume from the
+   * dropped data.
+   * @return The number of bytes released.
+   */
+  size_t ReleaseDataBuffers() {
+    size_t released_bytes = send_data_.ReleaseBuffer() + recv_data_.ReleaseBuffer();
+    RecycleProtocolState();
+    return released_bytes;
+  }
+
   template <typename TProtocolTraits>
   size_t MemUsage() const {
     using TFrameType = typename TProtocolTraits::frame_type;
@@ -729,6 +789,14 @@ class ConnTracker : NotCopyMoveable {
   int idle_iteration_count_ = 0;
   int idle_iteration_threshold_ = 2;
 
+  // The ConnTrackersManager iteration in which this tracker was last visited, and the one in
+  // which it is next scheduled to be visited, if it receives no events before then.
+  uint64_t last_visit_iteration_ = 0;
+  uint64_t next_visit_iteration_ = 0;
+
+  // The DataBufferMemUsage() last added to the ConnTrackersManager's running total.
+  size_t accounted_data_buffer_bytes_ = 0;
+
   State state_ = State::kCollecting;
 
   std::string disable_reason_;
@@ -754,6 +822,32 @@ class ConnTracker : NotCopyMoveable {
   //    similar way as std::variant.
   std::any protocol_state_;
 
+  // Returns protocol_state_ to the pool of its type. Set whenever protocol_state_ is initialized.
+  void (*protocol_state_recycler_)(std::any*) = nullptr;
+
+  // Number of state objects kept per protocol state type.
+  static constexpr size_t kProtocolStatePoolCapacity = 256;
+
+  static PoolStats& MutableProtocolStatePoolStats() {
+    static thread_local PoolStats stats;
+    return stats;
+  }
+
+  template <typename TStateType>
+  static ValuePool<std::any>& ProtocolStatePool() {
+    static thread_local ValuePool<std::any> pool(kProtocolStatePoolCapacity,
+                                                 &MutableProtocolStatePoolStats());
+    return pool;
+  }
+
+  template <typename TStateType>
+  static void RecycleProtocolStateOfType(std::any* state) {
+    *std::any_cast<TStateType>(state) = TStateType();
+    ProtocolStatePool<TStateType>().Recycle(std::move(*state));
+  }
+
+  void RecycleProtocolState();
+
   template <typename TProtocolTraits>
   friend std::string DebugString(const ConnTracker& c, std::string_view prefix);
 
@@ -18,9 +18,18 @@
 
 #include "src/stirling/source_connectors/socket_tracer/conn_trackers_manager.h"
 
+#include <algorithm>
+
 DEFINE_double(
     stirling_conn_tracker_cleanup_threshold, 0.2,
     "Percentage of trackers that are ready for destruction that will trigger a memory cleanup");
+DEFINE_bool(stirling_conn_trackers_skip_idle, true,
+            "If true, only process the connection trackers that received events or have pending "
+            "work in each iteration. If false, process all trackers in every iteration.");
+DEFINE_uint64(stirling_conn_trackers_max_buffer_bytes, 512 * 1024 * 1024,
+              "The memory budget for the raw data buffers of all connection trackers. When "
+              "exceeded, the buffers of the least recently active connections are released. "
+              "0 disables the budget.");
 
 namespace px {
 namespace stirling {
@@ -116,16 +125,28 @@ ConnTracker& ConnTrackersManager::GetOrCreateConnTracker(struct conn_id_t conn_i
   DCHECK_NE(conn_map_key, 0) << "Connection map key cannot be 0, pid must be wrong";
 
   ConnTrackerGenerations& conn_trackers = conn_id_tracker_generations_[conn_map_key];
+
+  // A new generation marks an older one for death, which must then be visited to count down.
+  // Bring the older generations up to date first, so that their countdown starts from now.
+  if (!conn_trackers.Contains(conn_id.tsid)) {
+    for (const auto& [tsid, tracker] : conn_trackers.generations()) {
+      TouchTracker(tracker.get());
+    }
+  }
+
   auto [conn_tracker_ptr, created] = conn_trackers.GetOrCreate(conn_id, &trackers_pool_);
 
   if (created) {
     active_trackers_.push_back(conn_tracker_ptr);
     conn_tracker_ptr->manager_ = this;
+    conn_tracker_ptr->last_visit_iteration_ = iteration_;
 
     stats_.Increment(StatKey::kTotal);
     stats_.Increment(StatKey::kCreated);
   }
 
+  TouchTracker(conn_tracker_ptr);
+
   DebugChecks();
   return *conn_tracker_ptr;
 }
@@ -150,12 +171,124 @@ StatusOr<const ConnTracker*> ConnTrackersManager::GetConnTracker(uint32_t pid, i
   return tracker_generations.GetActive();
 }
 
+void ConnTrackersManager::TouchTracker(ConnTracker* tracker) {
+  if (tracker->last_visit_iteration_ < iteration_) {
+    // The tracker was skipped in the last iterations. Bring it up to date before it is changed
+    // by the new event, so that the event is not mistaken for being stale.
+    tracker->CatchUpIdleIterations(last_iteration_time_,
+                                   iteration_ - tracker->last_visit_iteration_);
+    tracker->last_visit_iteration_ = iteration_;
+  }
+
+  if (!tracker->ReadyForDestruction()) {
+    touched_trackers_.insert(tracker);
+  }
+}
+
+ConnTracker* ConnTrackersManager::FindTracker(const struct conn_id_t& conn_id) const {
+  auto iter = conn_id_tracker_generations_.find(GetConnMapKey(conn_id.upid.pid, conn_id.fd));
+  if (iter == conn_id_tracker_generations_.end()) {
+    return nullptr;
+  }
+
+  const auto& generations = iter->second.generations();
+  auto gen_iter = generations.find(conn_id.tsid);
+  if (gen_iter == generations.end()) {
+    return nullptr;
+  }
+  return gen_iter->second.get();
+}
+
+std::vector<ConnTracker*> ConnTrackersManager::TrackersToProcess(
+    std::chrono::time_point<std::chrono::steady_clock> iteration_time) {
+  ++iteration_;
+
+  std::vector<ConnTracker*> trackers;
+
+  if (!FLAGS_stirling_conn_trackers_skip_idle) {
+    trackers.assign(active_trackers_.begin(), active_trackers_.end());
+    for (auto* tracker : trackers) {
+      tracker->last_visit_iteration_ = iteration_;
+    }
+  } else {
+    for (auto* tracker : touched_trackers_) {
+      if (!tracker->ReadyForDestruction()) {
+        tracker->last_visit_iteration_ = iteration_;
+        trackers.push_back(tracker);
+      }
+    }
+
+    due_visits_.clear();
+    visit_wheel_.Advance(iteration_, &due_visits_);
+    for (const auto& [conn_id, visit_iteration] : due_visits_) {
+      ConnTracker* tracker = FindTracker(conn_id);
+      // Skip visits that were superseded by a later schedule, or that are already happening
+      // because the tracker received events.
+      if (tracker == nullptr || tracker->next_visit_iteration_ != visit_iteration ||
+          tracker->last_visit_iteration_ == iteration_ || tracker->ReadyForDestruction()) {
+        continue;
+      }
+      tracker->CatchUpIdleIterations(last_iteration_time_,
+                                     iteration_ - 1 - tracker->last_visit_iteration_);
+      tracker->last_visit_iteration_ = iteration_;
+      trackers.push_back(tracker);
+    }
+  }
+  touched_trackers_.clear();
+
+  for (auto* tracker : trackers) {
+    tracker->next_visit_iteration_ = 0;
+  }
+  last_iteration_time_ = iteration_time;
+
+  stats_.Reset(StatKey::kVisited);
+  stats_.Increment(StatKey::kVisited, trackers.size());
+
+  return trackers;
+}
+
+void ConnTrackersManager::ScheduleNextVisit(ConnTracker* tracker) {
+  if (!FLAGS_stirling_conn_trackers_skip_idle || tracker->ReadyForDestruction()) {
+    return;
+  }
+
+  uint64_t next_visit_iteration = 0;
+  if (tracker->HasPendingWork()) {
+    next_visit_iteration = iteration_ + 1;
+  } else if (int n = tracker->IdleIterationsUntilProcCheck(); n > 0) {
+    next_visit_iteration = iteration_ + n;
+  } else {
+    // Nothing to do until the tracker receives an event.
+    return;
+  }
+
+  tracker->next_visit_iteration_ = next_visit_iteration;
+  visit_wheel_.Schedule(tracker->conn_id(), next_visit_iteration);
+}
+
+void ConnTrackersManager::VisitAllTrackers() {
+  for (ConnTracker* tracker : active_trackers_) {
+    TouchTracker(tracker);
+  }
+}
+
 void ConnTrackersManager::CleanupTrackers() {
+  // Trackers that are ready for destruction may be destroyed below, so stop referencing them.
+  for (auto iter = touched_trackers_.begin(); iter != touched_trackers_.end();) {
+    if ((*iter)->ReadyForDestruction()) {
+      touched_trackers_.erase(iter++);
+    } else {
+      ++iter;
+    }
+  }
+
   {
     auto iter = active_trackers_.begin();
     while (iter != active_trackers_.end()) {
       const auto& tracker = *iter;
       if (tracker->ReadyForDestruction()) {
+        stats_.Decrement(StatKey::kDataBufferBytes, tracker->accounted_data_buffer_bytes_);
+        tracker->accounted_data_buffer_bytes_ = 0;
         active_trackers_.erase(iter++);
         stats_.Increment(StatKey::kReadyForDestruction);
       } else {
@@ -194,6 +327,47 @@ void ConnTrackersManager::CleanupTrackers() {
   DebugChecks();
 }
 
+void ConnTrackersManager::UpdateDataBufferMemUsage(ConnTracker* tracker) {
+  const size_t usage = tracker->DataBufferMemUsage();
+  stats_.Decrement(StatKey::kDataBufferBytes, tracker->accounted_data_buffer_bytes_);
+  stats_.Increment(StatKey::kDataBufferBytes, usage);
+  tracker->accounted_data_buffer_bytes_ = usage;
+}
+
+size_t ConnTrackersManager::EnforceMemoryBudget(size_t budget_bytes) {
+  const size_t total_bytes = stats_.Get(StatKey::kDataBufferBytes);
+  if (budget_bytes == 0 || total_bytes <= budget_bytes) {
+    return 0;
+  }
+
+  std::vector<ConnTracker*> candidates;
+  candidates.reserve(active_trackers_.size());
+  for (auto* tracker : active_trackers_) {
+    if (tracker->DataBufferMemUsage() > 0) {
+      candidates.push_back(tracker);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(), [](ConnTracker* a, ConnTracker* b) {
+    return a->last_update_timestamp() < b->last_update_timestamp();
+  });
+
+  size_t released_bytes = 0;
+  for (auto* tracker : candidates) {
+    if (total_bytes - released_bytes <= budget_bytes) {
+      break;
+    }
+    released_bytes += tracker->ReleaseDataBuffers();
+    UpdateDataBufferMemUsage(tracker);
+    stats_.Increment(StatKey::kBudgetReleasedTrackers);
+  }
+
+  VLOG(1) << absl::Substitute("Released $0 bytes of ConnTracker data buffers (budget=$1 total=$2).",
+                              released_bytes, budget_bytes, total_bytes);
+
+  stats_.Increment(StatKey::kBudgetReleasedBytes, released_bytes);
+  return released_bytes;
+}
+
 void ConnTrackersManager::DebugChecks() const {
   DCHECK_EQ(stats_.Get(StatKey::kTotal),
             active_trackers_.size() + stats_.Get(StatKey::kReadyForDestruction));
@@ -218,6 +392,22 @@ std::string ConnTrackersManager::StatsString() const {
   return absl::StrCat(stats_.Print(), protocol_stats_.Print());
 }
 
+void ConnTrackersManager::ComputePoolStats() {
+  auto set_pool_stats = [this](StatKey hits_key, StatKey misses_key, const PoolStats& pool_stats) {
+    stats_.Reset(hits_key);
+    stats_.Increment(hits_key, pool_stats.hits);
+    stats_.Reset(misses_key);
+    stats_.Increment(misses_key, pool_stats.misses);
+  };
+  set_pool_stats(StatKey::kTrackerPoolHits, StatKey::kTrackerPoolMisses, trackers_pool_.stats());
+  set_pool_stats(StatKey::kFramesPoolHits, StatKey::kFramesPoolMisses,
+                 DataStream::FramesPoolStats());
+  set_pool_stats(StatKey::kProtocolStatePoolHits, StatKey::kProtocolStatePoolMisses,
+                 ConnTracker::ProtocolStatePoolStats());
+  set_pool_stats(StatKey::kDataBufferPoolHits, StatKey::kDataBufferPoolMisses,
+                 protocols::DataStreamBuffer::StoragePoolStats());
+}
+
 void ConnTrackersManager::ComputeProtocolStats() {
   absl::flat_hash_map<traffic_protocol_t, int> protocol_count;
   for (const auto* tracker : active_trackers_) {
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <list>
 #include <map>
 #include <memory>
@@ -26,11 +27,16 @@
 #include <utility>
 #include <vector>
 
+#include <absl/container/flat_hash_set.h>
+
 #include "src/stirling/source_connectors/socket_tracer/conn_tracker.h"
 #include "src/stirling/utils/obj_pool.h"
 #include "src/stirling/utils/stat_counter.h"
+#include "src/stirling/utils/timer_wheel.h"
 
 DECLARE_double(stirling_conn_tracker_cleanup_threshold);
+DECLARE_uint64(stirling_conn_trackers_max_buffer_bytes);
+DECLARE_bool(stirling_conn_trackers_skip_idle);
 
 namespace px {
 namespace stirling {
@@ -95,6 +101,22 @@ class ConnTrackersManager {
     kCreated,
     kDestroyed,
     kDestroyedGens,
+
+    kVisited,
+
+    kDataBufferBytes,
+    kBudgetReleasedTrackers,
+    kBudgetReleasedBytes,
+
+    // Hits and misses of the pools that recycle allocations across ConnTracker lifetimes.
+    kTrackerPoolHits,
+    kTrackerPoolMisses,
+    kFramesPoolHits,
+    kFramesPoolMisses,
+    kProtocolStatePoolHits,
+    kProtocolStatePoolMisses,
+    kDataBufferPoolHits,
+    kDataBufferPoolMisses,
   };
 
   ConnTrackersManager();
@@ -107,6 +129,29 @@ class ConnTrackersManager {
 
   const std::list<ConnTracker*>& active_trackers() const { return active_trackers_; }
 
+  /**
+   * Returns the trackers that need to be processed (IterationPreTick(), transfer,
+   * IterationPostTick()) in a new iteration: those that received events since the last iteration,
+   * and those whose scheduled visit is due. Trackers that are idle and have nothing pending are
+   * skipped, and brought up to date when they are next returned.
+   *
+   * Call ScheduleNextVisit() on each returned tracker once it has been processed.
+   */
+  std::vector<ConnTracker*> TrackersToProcess(
+      std::chrono::time_point<std::chrono::steady_clock> iteration_time);
+
+  /**
+   * Schedules the next visit of a tracker returned by TrackersToProcess(), in case it does not
+   * receive any events before then.
+   */
+  void ScheduleNextVisit(ConnTracker* tracker);
+
+  /**
+   * Makes the next call to TrackersToProcess() return all active trackers, including idle ones.
+   * Use this when state that applies to all trackers changes (e.g. the cluster CIDRs).
+   */
+  void VisitAllTrackers();
+
   /**
    * Returns the latest generation of a connection tracker for the given pid and fd.
    * If there is no tracker for {pid, fd}, returns error::NotFound.
@@ -120,6 +165,25 @@ class ConnTrackersManager {
    */
   void CleanupTrackers();
 
+  /**
+   * Updates the running total of the memory held by the raw data buffers of active trackers
+   * with the current usage of the tracker. Call this on each tracker returned by
+   * TrackersToProcess() once it has been processed; a tracker's buffers change size only when it
+   * receives events, or when it is processed.
+   */
+  void UpdateDataBufferMemUsage(ConnTracker* tracker);
+
+  /**
+   * Enforces a ceiling on the memory held by the raw data buffers of all active trackers.
+   * If the running total (see UpdateDataBufferMemUsage()) exceeds budget_bytes, the buffers of
+   * the least recently updated trackers are released until the total is back within budget.
+   * Busy trackers are therefore the last to be affected. Trackers are only scanned when over
+   * budget. A budget of 0 disables the check.
+   *
+   * @return The number of bytes released.
+   */
+  size_t EnforceMemoryBudget(size_t budget_bytes);
+
   /**
    * Returns extensive debug information about the connection trackers.
    */
@@ -130,6 +194,12 @@ class ConnTrackersManager {
    */
   void ComputeProtocolStats();
 
+  /**
+   * Copies the hit/miss counts of the ConnTracker, frames, protocol state and data buffer pools
+   * into stats_. Must be called from the thread that processes the trackers.
+   */
+  void ComputePoolStats();
+
   /**
    * Returns a string representing the stats of ConnTracker objects.
    */
@@ -139,6 +209,12 @@ class ConnTrackersManager {
   // Simple consistency DCHECKs meant for enforcing invariants.
   void DebugChecks() const;
 
+  // Records that a tracker received an event, so it is processed in the next iteration.
+  void TouchTracker(ConnTracker* tracker);
+
+  // Returns the tracker for the exact conn_id (PID+FD+TSID), or nullptr if it does not exist.
+  ConnTracker* FindTracker(const struct conn_id_t& conn_id) const;
+
   // A map from conn_id (PID+FD+TSID) to tracker. This is for easy update on BPF events.
   // Structured as two nested maps to be explicit about "generations" of trackers per PID+FD.
   // Key is {PID, FD} for outer map, and tsid for inner map.
@@ -146,6 +222,18 @@ class ConnTrackersManager {
 
   std::list<ConnTracker*> active_trackers_;
 
+  // The number of calls to TrackersToProcess(), and the time of the last one.
+  uint64_t iteration_ = 0;
+  std::chrono::time_point<std::chrono::steady_clock> last_iteration_time_;
+
+  // Trackers that received events since the last call to TrackersToProcess().
+  absl::flat_hash_set<ConnTracker*> touched_trackers_;
+
+  // Scheduled visits of trackers, in units of iterations. Trackers are referenced by conn_id,
+  // rather than by pointer, because they may be destroyed while a visit is scheduled.
+  TimerWheel<struct conn_id_t> visit_wheel_;
+  std::vector<std::pair<struct conn_id_t, uint64_t>> due_visits_;
+
   // A pool of unused trackers that can be recycled.
   // This is useful for avoiding memory reallocations.
   ConnTrackerPool trackers_pool_;
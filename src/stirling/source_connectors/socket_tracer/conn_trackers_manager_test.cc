@@ -16,16 +16,22 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <algorithm>
 #include <random>
+#include <vector>
 
 #include "src/common/testing/testing.h"
 #include "src/stirling/source_connectors/socket_tracer/conn_trackers_manager.h"
+#include "src/stirling/source_connectors/socket_tracer/testing/event_generator.h"
 
 namespace px {
 namespace stirling {
 
+using ::testing::ElementsAre;
 using ::testing::HasSubstr;
+using ::testing::IsEmpty;
 using ::testing::StrEq;
+using ::testing::UnorderedElementsAre;
 
 class ConnTrackersManagerTest : public ::testing::Test {
  protected:
@@ -115,6 +121,217 @@ TEST_F(ConnTrackersManagerTest, DebugInfo) {
                         "ready_for_destruction=false\n"));
 }
 
+// Tests that EnforceMemoryBudget() releases the buffers of the least recently active trackers
+// first, and only as many as needed to get back within budget.
+TEST_F(ConnTrackersManagerTest, EnforceMemoryBudget) {
+  testing::MockClock mock_clock;
+  std::vector<ConnTracker*> trackers;
+
+  for (int fd = 1; fd <= 3; ++fd) {
+    testing::EventGenerator event_gen(&mock_clock, /*pid*/ 1, fd);
+    struct socket_control_event_t conn = event_gen.InitConn();
+
+    ConnTracker& tracker = trackers_mgr_.GetOrCreateConnTracker(conn.conn_id);
+    tracker.set_current_time(testing::NanosToTimePoint(mock_clock.now()));
+    tracker.AddControlEvent(conn);
+    tracker.AddDataEvent(event_gen.InitSendEvent<kProtocolHTTP>(testing::kHTTPIncompleteResp));
+    trackers_mgr_.UpdateDataBufferMemUsage(&tracker);
+    trackers.push_back(&tracker);
+  }
+
+  const size_t kRetainedBytes = testing::kHTTPIncompleteResp.size();
+
+  size_t total_bytes = 0;
+  for (const auto* tracker : trackers) {
+    ASSERT_GE(tracker->DataBufferMemUsage(), kRetainedBytes);
+    total_bytes += tracker->DataBufferMemUsage();
+  }
+
+  // Within budget, or no budget: nothing is released.
+  EXPECT_EQ(trackers_mgr_.EnforceMemoryBudget(total_bytes), 0);
+  EXPECT_EQ(trackers_mgr_.EnforceMemoryBudget(0), 0);
+
+  // Just over budget: only the oldest tracker is released.
+  size_t oldest_bytes = trackers[0]->DataBufferMemUsage();
+  size_t released_bytes = trackers_mgr_.EnforceMemoryBudget(total_bytes - 1);
+  EXPECT_LT(trackers[0]->DataBufferMemUsage(), kRetainedBytes);
+  EXPECT_EQ(released_bytes, oldest_bytes - trackers[0]->DataBufferMemUsage());
+  EXPECT_GE(trackers[1]->DataBufferMemUsage(), kRetainedBytes);
+  EXPECT_GE(trackers[2]->DataBufferMemUsage(), kRetainedBytes);
+
+  // A tiny budget forces all buffers to be released.
+  trackers_mgr_.EnforceMemoryBudget(1);
+  for (const auto* tracker : trackers) {
+    EXPECT_LT(tracker->DataBufferMemUsage(), kRetainedBytes);
+  }
+
+  // Once within budget, the running total avoids scanning the trackers again.
+  size_t remaining_bytes = 0;
+  for (const auto* tracker : trackers) {
+    remaining_bytes += tracker->DataBufferMemUsage();
+  }
+  EXPECT_EQ(trackers_mgr_.EnforceMemoryBudget(std::max<size_t>(remaining_bytes, 1)), 0);
+}
+
+// Tests that the running total of buffered bytes follows buffer growth and tracker removal.
+TEST_F(ConnTrackersManagerTest, DataBufferMemUsageRunningTotal) {
+  testing::MockClock mock_clock;
+  testing::EventGenerator event_gen(&mock_clock, /*pid*/ 1, /*fd*/ 1);
+  struct socket_control_event_t conn = event_gen.InitConn();
+
+  ConnTracker& tracker = trackers_mgr_.GetOrCreateConnTracker(conn.conn_id);
+  tracker.set_current_time(testing::NanosToTimePoint(mock_clock.now()));
+  tracker.AddControlEvent(conn);
+  tracker.AddDataEvent(event_gen.InitSendEvent<kProtocolHTTP>(testing::kHTTPIncompleteResp));
+  trackers_mgr_.UpdateDataBufferMemUsage(&tracker);
+
+  const size_t usage = tracker.DataBufferMemUsage();
+  ASSERT_GT(usage, 0);
+  EXPECT_THAT(trackers_mgr_.StatsString(),
+              HasSubstr(absl::StrCat("kDataBufferBytes=", usage, " ")));
+
+  // A tracker that is destroyed no longer counts.
+  tracker.MarkForDeath(0);
+  tracker.MarkFinalConnStatsReported();
+  CleanupTrackers();
+  EXPECT_THAT(trackers_mgr_.StatsString(), HasSubstr("kDataBufferBytes=0 "));
+}
+
+// Runs one iteration of tracker processing, as done by SocketTraceConnector::TransferStreams(),
+// and returns the trackers that were visited.
+std::vector<ConnTracker*> ProcessIteration(ConnTrackersManager* trackers_mgr,
+                                           std::chrono::steady_clock::time_point iteration_time) {
+  std::vector<ConnTracker*> trackers = trackers_mgr->TrackersToProcess(iteration_time);
+  for (auto* tracker : trackers) {
+    tracker->IterationPreTick(iteration_time, /*cluster_cidrs*/ {}, /*proc_parser*/ nullptr,
+                              /*socket_info_mgr*/ nullptr);
+    tracker->IterationPostTick();
+    trackers_mgr->ScheduleNextVisit(tracker);
+  }
+  return trackers;
+}
+
+// Tests that idle trackers with no pending work are skipped until they receive events.
+TEST_F(ConnTrackersManagerTest, SkipsIdleTrackers) {
+  const auto orig_check_proc = FLAGS_stirling_check_proc_for_conn_close;
+  FLAGS_stirling_check_proc_for_conn_close = false;
+  DEFER(FLAGS_stirling_check_proc_for_conn_close = orig_check_proc);
+
+  testing::MockClock mock_clock;
+  testing::EventGenerator event_gen1(&mock_clock, /*pid*/ 1, /*fd*/ 1);
+  testing::EventGenerator event_gen2(&mock_clock, /*pid*/ 1, /*fd*/ 2);
+  struct socket_control_event_t conn1 = event_gen1.InitConn();
+  struct socket_control_event_t conn2 = event_gen2.InitConn();
+
+  ConnTracker& tracker1 = trackers_mgr_.GetOrCreateConnTracker(conn1.conn_id);
+  ConnTracker& tracker2 = trackers_mgr_.GetOrCreateConnTracker(conn2.conn_id);
+
+  auto now = [&mock_clock]() { return testing::NanosToTimePoint(mock_clock.now()); };
+
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()),
+              UnorderedElementsAre(&tracker1, &tracker2));
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()), IsEmpty());
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()), IsEmpty());
+
+  // An event brings the tracker back.
+  trackers_mgr_.GetOrCreateConnTracker(conn2.conn_id);
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()), ElementsAre(&tracker2));
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()), IsEmpty());
+
+  // A tracker counting down to its death is visited every iteration until the countdown ends.
+  trackers_mgr_.GetOrCreateConnTracker(conn1.conn_id);
+  tracker1.MarkForDeath(2);
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()), ElementsAre(&tracker1));
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()), ElementsAre(&tracker1));
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()), IsEmpty());
+}
+
+// Tests that all trackers, including idle ones, are visited after VisitAllTrackers().
+TEST_F(ConnTrackersManagerTest, VisitAllTrackers) {
+  const auto orig_check_proc = FLAGS_stirling_check_proc_for_conn_close;
+  FLAGS_stirling_check_proc_for_conn_close = false;
+  DEFER(FLAGS_stirling_check_proc_for_conn_close = orig_check_proc);
+
+  testing::MockClock mock_clock;
+  testing::EventGenerator event_gen1(&mock_clock, /*pid*/ 1, /*fd*/ 1);
+  testing::EventGenerator event_gen2(&mock_clock, /*pid*/ 1, /*fd*/ 2);
+  struct socket_control_event_t conn1 = event_gen1.InitConn();
+  struct socket_control_event_t conn2 = event_gen2.InitConn();
+
+  ConnTracker& tracker1 = trackers_mgr_.GetOrCreateConnTracker(conn1.conn_id);
+  ConnTracker& tracker2 = trackers_mgr_.GetOrCreateConnTracker(conn2.conn_id);
+
+  auto now = [&mock_clock]() { return testing::NanosToTimePoint(mock_clock.now()); };
+
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()),
+              UnorderedElementsAre(&tracker1, &tracker2));
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()), IsEmpty());
+
+  trackers_mgr_.VisitAllTrackers();
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()),
+              UnorderedElementsAre(&tracker1, &tracker2));
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()), IsEmpty());
+}
+
+// Tests that idle trackers are still visited when their /proc check is due, and that the
+// skipped iterations count towards the idle iterations.
+TEST_F(ConnTrackersManagerTest, VisitsIdleTrackersForProcCheck) {
+  const auto orig_check_proc = FLAGS_stirling_check_proc_for_conn_close;
+  FLAGS_stirling_check_proc_for_conn_close = true;
+  DEFER(FLAGS_stirling_check_proc_for_conn_close = orig_check_proc);
+
+  // A PID that cannot exist, so that the /proc check finds the connection closed.
+  const uint32_t impossible_pid = 1 << 23;
+
+  testing::MockClock mock_clock;
+  testing::EventGenerator event_gen(&mock_clock, impossible_pid, /*fd*/ 1);
+  struct socket_control_event_t conn = event_gen.InitConn();
+  ConnTracker& tracker = trackers_mgr_.GetOrCreateConnTracker(conn.conn_id);
+
+  auto now = [&mock_clock]() { return testing::NanosToTimePoint(mock_clock.now()); };
+
+  // First idle iteration.
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()), ElementsAre(&tracker));
+  EXPECT_FALSE(tracker.IsZombie());
+
+  // Second idle iteration reaches the idle threshold, and the /proc check marks it for death.
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()), ElementsAre(&tracker));
+  EXPECT_TRUE(tracker.IsZombie());
+
+  // Nothing more to do for the tracker.
+  EXPECT_THAT(ProcessIteration(&trackers_mgr_, now()), IsEmpty());
+}
+
+// Tests that trackers and their protocol state are recycled across tracker lifetimes.
+TEST_F(ConnTrackersManagerTest, RecyclesAcrossTrackerLifetimes) {
+  using protocols::http::StateWrapper;
+
+  struct conn_id_t conn_id = {};
+  conn_id.upid.pid = 1;
+  conn_id.upid.start_time_ticks = 1;
+  conn_id.fd = 1;
+  conn_id.tsid = 1;
+
+  ConnTracker& tracker1 = trackers_mgr_.GetOrCreateConnTracker(conn_id);
+  tracker1.InitProtocolState<StateWrapper>();
+  tracker1.protocol_state<StateWrapper>()->global.conn_closed = true;
+  tracker1.MarkForDeath(0);
+  tracker1.MarkFinalConnStatsReported();
+  CleanupTrackers();
+
+  const uint64_t state_hits_before = ConnTracker::ProtocolStatePoolStats().hits;
+
+  conn_id.fd = 2;
+  ConnTracker& tracker2 = trackers_mgr_.GetOrCreateConnTracker(conn_id);
+  tracker2.InitProtocolState<StateWrapper>();
+  // The recycled state must not leak anything from its previous owner.
+  EXPECT_FALSE(tracker2.protocol_state<StateWrapper>()->global.conn_closed);
+  EXPECT_EQ(ConnTracker::ProtocolStatePoolStats().hits, state_hits_before + 1);
+
+  trackers_mgr_.ComputePoolStats();
+  EXPECT_THAT(trackers_mgr_.StatsString(), HasSubstr("kTrackerPoolHits=1 kTrackerPoolMisses=1"));
+}
+
 class ConnTrackerGenerationsTest : public ::testing::Test {
  protected:
   ConnTrackerGenerationsTest() : tracker_pool(1024) {
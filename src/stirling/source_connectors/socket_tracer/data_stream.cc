@@ -17,6 +17,8 @@
  */
 
 #include <gflags/gflags.h>
+#include <algorithm>
+#include <type_traits>
 #include <utility>
 
 #include "src/stirling/source_connectors/socket_tracer/data_stream.h"
@@ -35,6 +37,10 @@ DEFINE_uint32(datastream_buffer_allow_before_gap_size,
               "After a PL_DATASTREAM_BUFFER_MAX_GAP_SIZE gap occurs, we allow for this amount of "
               "data to come in before (byte position wise) the event that caused the large gap.");
 
+DEFINE_uint32(datastream_buffer_min_retention_size, 64 * 1024,
+              "The lower bound of the per-connection retention size, which is otherwise adapted "
+              "to the sizes of the messages observed on the connection.");
+
 DEFINE_uint32(buffer_resync_duration_secs, 5,
               "The duration, in seconds, after which a buffer resync will happen if there has been "
               "no progress in the parser.");
@@ -46,6 +52,48 @@ DEFINE_uint32(
 namespace px {
 namespace stirling {
 
+namespace {
+
+// HTTP messages with large bodies are decoded across several calls to the parser (see
+// http::PartialMessage). Such a message can't be completed once the stream skips over bytes that
+// the parser never saw, so it is dropped.
+template <typename TStateType>
+void ResetPartialFrame(message_type_t type, TStateType* state) {
+  if constexpr (std::is_same_v<TStateType, protocols::http::StateWrapper>) {
+    if (state != nullptr) {
+      state->global.partial_msg(type)->reset();
+    }
+  }
+}
+
+// Gives a message that is decoded across several calls the timestamp of its first part, which
+// ended at end_position of the buffer head. ParseFrames() keeps that timestamp once the message
+// is complete.
+//
+// Note that this differs from messages parsed in one call, which get the timestamp of the event
+// holding their last byte. For a streamed response, the latency computed from it is therefore the
+// time until the headers and the start of the body arrived (close to a time-to-first-byte); it
+// excludes the time taken to transfer the rest of the body. For a streamed request, the latency
+// includes the time taken to upload the rest of the body.
+template <typename TStateType>
+void SetPartialFrameTimestamp(message_type_t type, const protocols::DataStreamBuffer& data_buffer,
+                              size_t end_position, TStateType* state) {
+  if constexpr (std::is_same_v<TStateType, protocols::http::StateWrapper>) {
+    if (state == nullptr || end_position == 0) {
+      return;
+    }
+    auto* partial = state->global.partial_msg(type);
+    if (partial->has_value() && partial->value().msg.timestamp_ns == 0) {
+      StatusOr<uint64_t> timestamp_ns =
+          data_buffer.GetTimestamp(data_buffer.position() + end_position - 1);
+      LOG_IF(ERROR, !timestamp_ns.ok()) << timestamp_ns.ToString();
+      partial->value().msg.timestamp_ns = timestamp_ns.ValueOr(0);
+    }
+  }
+}
+
+}  // namespace
+
 void DataStream::AddData(std::unique_ptr<SocketDataEvent> event) {
   LOG_IF(WARNING, event->attr.msg_size > event->msg.size() && !event->msg.empty())
       << absl::Substitute("Message truncated, original size: $0, transferred size: $1",
@@ -78,6 +126,12 @@ void DataStream::ProcessBytesToFrames(message_type_t type, TStateType* state) {
 
   const size_t orig_pos = data_buffer_.position();
 
+  // Bytes were dropped since the last call, e.g. by CleanupEvents() or on arrival of an event
+  // beyond the maximum gap size.
+  if (orig_pos != last_processed_pos_) {
+    ResetPartialFrame(type, state);
+  }
+
   // A description of some key variables in this function:
   //
   // - last_progress_time_: The timestamp of when progress was made in the parser. It's used to
@@ -108,6 +162,8 @@ void DataStream::ProcessBytesToFrames(message_type_t type, TStateType* state) {
   parse_result.end_position = 0;
 
   size_t frame_bytes = 0;
+  size_t ignored_bytes = 0;
+  size_t max_frame_bytes = 0;
 
   while (keep_processing && !data_buffer_.empty()) {
     size_t contiguous_bytes = data_buffer_.Head().size();
@@ -115,12 +171,14 @@ void DataStream::ProcessBytesToFrames(message_type_t type, TStateType* state) {
     // Now parse the raw data.
     parse_result =
         protocols::ParseFrames(type, &data_buffer_, &typed_messages, IsSyncRequired(), state);
+    SetPartialFrameTimestamp(type, data_buffer_, parse_result.end_position, state);
     if (contiguous_bytes != data_buffer_.size()) {
       // We weren't able to submit all bytes, which means we ran into a missing event.
       // We don't expect missing events to arrive in the future, so just cut our losses.
       // Drop all events up to this point, and then try to resume.
       data_buffer_.RemovePrefix(contiguous_bytes);
       data_buffer_.Trim();
+      ResetPartialFrame(type, state);
 
       keep_processing = (parse_result.state != ParseState::kEOS);
     } else {
@@ -139,6 +197,20 @@ void DataStream::ProcessBytesToFrames(message_type_t type, TStateType* state) {
     stat_raw_data_gaps_ += keep_processing;
 
     frame_bytes += parse_result.frame_bytes;
+    ignored_bytes += parse_result.ignored_bytes;
+    for (const auto& pos : parse_result.frame_positions) {
+      max_frame_bytes = std::max(max_frame_bytes, pos.end - pos.start + 1);
+    }
+  }
+
+  // Track the frame sizes seen on this stream, so that retention can be sized to fit them.
+  // Ignored bytes (e.g. streamed HTTP body parts) are left out: they are consumed as they arrive,
+  // so the buffer never has to retain them.
+  // The high-water mark follows the largest frame, not the average one, so that a few large
+  // frames among many small ones are still retained. It decays by 1/8 per update, so a burst of
+  // large frames is not remembered forever.
+  if (max_frame_bytes > 0) {
+    frame_size_hwm_ = std::max(max_frame_bytes, frame_size_hwm_ - frame_size_hwm_ / 8);
   }
 
   // Check to see if we are blocked on parsing.
@@ -164,10 +236,12 @@ void DataStream::ProcessBytesToFrames(message_type_t type, TStateType* state) {
   }
 
   // Keep track of "lost" data in prometheus. "lost" data includes any gaps in the data stream as
-  // well as data that wasn't able to be successfully parsed.
+  // well as data that wasn't able to be successfully parsed. Bytes of ignored frames were parsed,
+  // so they are not lost.
   ssize_t num_bytes_advanced = data_buffer_.position() - last_processed_pos_;
-  if (num_bytes_advanced > 0 && static_cast<size_t>(num_bytes_advanced) > frame_bytes) {
-    size_t bytes_lost = num_bytes_advanced - frame_bytes;
+  size_t parsed_bytes = frame_bytes + ignored_bytes;
+  if (num_bytes_advanced > 0 && static_cast<size_t>(num_bytes_advanced) > parsed_bytes) {
+    size_t bytes_lost = num_bytes_advanced - parsed_bytes;
     SocketTracerMetrics::GetProtocolMetrics(protocol_).data_loss_bytes.Increment(bytes_lost);
   }
   last_processed_pos_ = data_buffer_.position();
@@ -207,6 +281,21 @@ void DataStream::Reset() {
   has_new_events_ = false;
   UpdateLastProgressTime();
 
+  RecycleFrames();
+}
+
+void DataStream::RecycleFrames() {
+  if (!frames_.valueless_by_exception()) {
+    std::visit(
+        [](auto& frames) {
+          using TFramesType = std::decay_t<decltype(frames)>;
+          if constexpr (!std::is_same_v<TFramesType, std::monostate>) {
+            frames.clear();
+            FramesPool<typename TFramesType::value_type>().Recycle(std::move(frames));
+          }
+        },
+        frames_);
+  }
   frames_ = std::monostate();
 }
 
@@ -22,15 +22,20 @@
 #include <deque>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
+#include <type_traits>
+#include <variant>
 
 #include "src/stirling/source_connectors/socket_tracer/bcc_bpf_intf/socket_trace.hpp"
 #include "src/stirling/source_connectors/socket_tracer/protocols/common/data_stream_buffer.h"
 #include "src/stirling/source_connectors/socket_tracer/protocols/types.h"
+#include "src/stirling/utils/obj_pool.h"
 
 DECLARE_uint32(datastream_buffer_spike_size);
 DECLARE_uint32(datastream_buffer_max_gap_size);
 DECLARE_uint32(datastream_buffer_allow_before_gap_size);
+DECLARE_uint32(datastream_buffer_min_retention_size);
 
 DECLARE_uint32(buffer_resync_duration_secs);
 DECLARE_uint32(buffer_expiration_duration_secs);
@@ -55,6 +60,8 @@ class DataStream : NotCopyMoveable {
              uint32_t allow_before_gap_size = FLAGS_datastream_buffer_allow_before_gap_size)
       : data_buffer_(spike_capacity, max_gap_size, allow_before_gap_size) {}
 
+  ~DataStream() { RecycleFrames(); }
+
   /**
    * Adds a raw (unparsed) chunk of data into the stream.
    */
@@ -81,8 +88,13 @@ class DataStream : NotCopyMoveable {
                "I.e., ConnTracker cannot change the type it holds during runtime. $0 -> $1",
                frames_.index(), typeid(TFrameType).name());
     if (std::holds_alternative<std::monostate>(frames_)) {
-      // Reset the type to the expected type.
-      frames_ = std::deque<TFrameType>();
+      // Reset the type to the expected type, reusing a deque from a previous connection if any.
+      std::optional<std::deque<TFrameType>> recycled = FramesPool<TFrameType>().Pop();
+      if (recycled.has_value()) {
+        frames_ = std::move(recycled.value());
+      } else {
+        frames_ = std::deque<TFrameType>();
+      }
       LOG_IF(ERROR, frames_.valueless_by_exception())
           << absl::Substitute("valueless_by_exception() triggered by initializing to type: $0",
                               typeid(TFrameType).name());
@@ -130,6 +142,12 @@ class DataStream : NotCopyMoveable {
    */
   void Reset();
 
+  /**
+   * Hit/miss statistics of the frame deques recycled across DataStreams, summed over all frame
+   * types. The pools are per-thread, so these are the statistics of the calling thread.
+   */
+  static const PoolStats& FramesPoolStats() { return MutableFramesPoolStats(); }
+
   /**
    * Checks if the DataStream is empty of both raw events and parsed messages.
    * @return true if empty of all data.
@@ -140,6 +158,26 @@ class DataStream : NotCopyMoveable {
                                     std::get<std::deque<TFrameType>>(frames_).empty());
   }
 
+  /**
+   * Checks if the DataStream holds any raw events or parsed frames,
+   * without needing to know the frame type.
+   * @return true if there is any data that has not been consumed.
+   */
+  bool HasPendingData() const {
+    if (!data_buffer_.empty()) {
+      return true;
+    }
+    return std::visit(
+        [](const auto& frames) {
+          if constexpr (std::is_same_v<std::decay_t<decltype(frames)>, std::monostate>) {
+            return false;
+          } else {
+            return !frames.empty();
+          }
+        },
+        frames_);
+  }
+
   /**
    * If buffer has not been successfully processed in the past kSyncTimeout duration,
    * run ParseFrames() with a search for a new message boundary.
@@ -248,10 +286,65 @@ class DataStream : NotCopyMoveable {
     return false;
   }
 
+  /**
+   * Returns the number of raw bytes to retain between cycles for this stream, scaled to the
+   * sizes of the frames observed on it, and bounded by
+   * [FLAGS_datastream_buffer_min_retention_size, max_retention_bytes].
+   * Streams that have not produced any frames yet retain up to max_retention_bytes, since
+   * nothing is known about their message sizes.
+   */
+  size_t AdaptiveRetentionSize(size_t max_retention_bytes) const {
+    // Retain enough for a few frames of the largest recently observed size, so that a partial
+    // frame at the head of the buffer survives until the rest of it arrives.
+    constexpr size_t kFrameSizeMultiplier = 4;
+
+    if (frame_size_hwm_ == 0) {
+      return max_retention_bytes;
+    }
+    size_t retention_bytes = std::max<size_t>(kFrameSizeMultiplier * frame_size_hwm_,
+                                              FLAGS_datastream_buffer_min_retention_size);
+    return std::min(retention_bytes, max_retention_bytes);
+  }
+
+  /**
+   * Drops all unprocessed raw data and releases the buffer's memory.
+   * Used to enforce the global memory budget on idle connections.
+   * @return The number of bytes of allocated capacity that were released.
+   */
+  size_t ReleaseBuffer() {
+    size_t orig_capacity = data_buffer_.capacity();
+    data_buffer_.RemovePrefix(data_buffer_.size());
+    data_buffer_.ShrinkToFit();
+    return orig_capacity - data_buffer_.capacity();
+  }
+
+  /**
+   * A decaying high-water mark of the largest frame size parsed from this stream.
+   */
+  size_t frame_size_hwm() const { return frame_size_hwm_; }
+
   const protocols::DataStreamBuffer& data_buffer() const { return data_buffer_; }
   protocols::DataStreamBuffer& data_buffer() { return data_buffer_; }
 
  private:
+  // Number of cleared deques kept per frame type.
+  static constexpr size_t kFramesPoolCapacity = 256;
+
+  static PoolStats& MutableFramesPoolStats() {
+    static thread_local PoolStats stats;
+    return stats;
+  }
+
+  template <typename TFrameType>
+  static ValuePool<std::deque<TFrameType>>& FramesPool() {
+    static thread_local ValuePool<std::deque<TFrameType>> pool(kFramesPoolCapacity,
+                                                               &MutableFramesPoolStats());
+    return pool;
+  }
+
+  // Clears the parsed frames and hands the deque to the pool of its frame type.
+  void RecycleFrames();
+
   template <typename TFrameType>
   static void EraseExpiredFrames(
       std::chrono::time_point<std::chrono::steady_clock> expiry_timestamp,
@@ -310,6 +403,9 @@ class DataStream : NotCopyMoveable {
   // A copy of the parse state from the last call to ProcessToRecords().
   ParseState last_parse_state_ = ParseState::kInvalid;
 
+  // Decaying high-water mark of observed frame sizes. Used by AdaptiveRetentionSize().
+  size_t frame_size_hwm_ = 0;
+
   // Keep track of the byte position after the last processed position, in order to measure data
   // loss.
   size_t last_processed_pos_ = 0;
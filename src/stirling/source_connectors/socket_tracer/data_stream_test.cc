@@ -25,6 +25,7 @@
 
 #include "src/common/testing/testing.h"
 #include "src/stirling/source_connectors/socket_tracer/metrics.h"
+#include "src/stirling/source_connectors/socket_tracer/protocols/http/parse.h"
 #include "src/stirling/source_connectors/socket_tracer/testing/event_generator.h"
 #include "src/stirling/testing/common.h"
 
@@ -42,6 +43,7 @@ using testing::kHTTPReq0;
 using testing::kHTTPReq1;
 using testing::kHTTPReq2;
 using testing::kHTTPResp0;
+using testing::kHTTPResp1;
 
 class DataStreamTest : public ::testing::Test {
  protected:
@@ -98,6 +100,79 @@ TEST_F(DataStreamTest, LostEvent) {
             SocketTracerMetrics::GetProtocolMetrics(kProtocolHTTP).data_loss_bytes.Value());
 }
 
+// A large body that is decoded across several calls keeps the timestamp of its first part.
+TEST_F(DataStreamTest, StreamedHTTPBody) {
+  const uint32_t orig_threshold = FLAGS_http_body_streaming_threshold_bytes;
+  DEFER(FLAGS_http_body_streaming_threshold_bytes = orig_threshold);
+  FLAGS_http_body_streaming_threshold_bytes = 1024;
+
+  const std::string resp_head =
+      absl::StrCat("HTTP/1.1 200 OK\r\nContent-Length: 4096\r\n\r\n", std::string(2048, 'x'));
+  const std::string resp_tail(2048, 'y');
+
+  std::unique_ptr<SocketDataEvent> resp0_head =
+      event_gen_.InitRecvEvent<kProtocolHTTP>(resp_head);
+  std::unique_ptr<SocketDataEvent> resp0_tail =
+      event_gen_.InitRecvEvent<kProtocolHTTP>(resp_tail);
+  const uint64_t head_timestamp_ns = resp0_head->attr.timestamp_ns;
+  protocols::http::StateWrapper state{};
+
+  DataStream stream;
+  stream.set_protocol(kProtocolHTTP);
+
+  stream.AddData(std::move(resp0_head));
+  stream.ProcessBytesToFrames<http::Message>(message_type_t::kResponse, &state);
+  EXPECT_THAT(stream.Frames<http::Message>(), IsEmpty());
+  EXPECT_TRUE(stream.data_buffer().empty());
+  EXPECT_TRUE(state.global.partial_resp.has_value());
+
+  stream.AddData(std::move(resp0_tail));
+  stream.ProcessBytesToFrames<http::Message>(message_type_t::kResponse, &state);
+  const auto& responses = stream.Frames<http::Message>();
+  ASSERT_THAT(responses, SizeIs(1));
+  EXPECT_EQ(responses[0].body_size, 4096);
+  EXPECT_EQ(responses[0].timestamp_ns, head_timestamp_ns);
+  EXPECT_FALSE(state.global.partial_resp.has_value());
+}
+
+// A body being decoded across several calls can't be completed after a lost event,
+// so it is dropped rather than completed with the bytes that follow the gap.
+TEST_F(DataStreamTest, StreamedHTTPBodyDroppedOnLostEvent) {
+  const uint32_t orig_threshold = FLAGS_http_body_streaming_threshold_bytes;
+  DEFER(FLAGS_http_body_streaming_threshold_bytes = orig_threshold);
+  FLAGS_http_body_streaming_threshold_bytes = 1024;
+
+  const std::string resp_head =
+      absl::StrCat("HTTP/1.1 200 OK\r\nContent-Length: 6144\r\n\r\n", std::string(2048, 'x'));
+  const std::string resp_body(2048, 'y');
+
+  std::unique_ptr<SocketDataEvent> resp0_head =
+      event_gen_.InitRecvEvent<kProtocolHTTP>(resp_head);
+  std::unique_ptr<SocketDataEvent> resp0_middle =
+      event_gen_.InitRecvEvent<kProtocolHTTP>(resp_body);
+  std::unique_ptr<SocketDataEvent> resp0_tail =
+      event_gen_.InitRecvEvent<kProtocolHTTP>(resp_body);
+  std::unique_ptr<SocketDataEvent> resp1 = event_gen_.InitRecvEvent<kProtocolHTTP>(kHTTPResp0);
+  protocols::http::StateWrapper state{};
+
+  DataStream stream;
+  stream.set_protocol(kProtocolHTTP);
+
+  stream.AddData(std::move(resp0_head));
+  stream.ProcessBytesToFrames<http::Message>(message_type_t::kResponse, &state);
+  EXPECT_TRUE(state.global.partial_resp.has_value());
+
+  PL_UNUSED(resp0_middle);  // Lost event.
+  stream.AddData(std::move(resp0_tail));
+  stream.AddData(std::move(resp1));
+  stream.ProcessBytesToFrames<http::Message>(message_type_t::kResponse, &state);
+
+  const auto& responses = stream.Frames<http::Message>();
+  ASSERT_THAT(responses, SizeIs(1));
+  EXPECT_EQ(responses[0].body, "pixie");
+  EXPECT_FALSE(state.global.partial_resp.has_value());
+}
+
 TEST_F(DataStreamTest, StuckTemporarily) {
   std::unique_ptr<SocketDataEvent> req0a =
       event_gen_.InitSendEvent<kProtocolHTTP>(kHTTPReq0.substr(0, kHTTPReq0.length() - 10));
@@ -425,6 +500,49 @@ TEST_F(DataStreamTest, SpikeCapacityWithLargeDataChunk) {
             SocketTracerMetrics::GetProtocolMetrics(kProtocolHTTP).data_loss_bytes.Value());
 }
 
+TEST_F(DataStreamTest, AdaptiveRetentionSize) {
+  constexpr size_t kMaxRetentionBytes = 1024 * 1024;
+
+  DataStream stream;
+  stream.set_protocol(kProtocolHTTP);
+
+  // No frames observed yet, so nothing is known about the message sizes.
+  EXPECT_EQ(stream.AdaptiveRetentionSize(kMaxRetentionBytes), kMaxRetentionBytes);
+
+  // The high-water mark follows the largest frame, even among many smaller ones.
+  static_assert(kHTTPResp1.size() < kHTTPResp0.size());
+  stream.AddData(event_gen_.InitRecvEvent<kProtocolHTTP>(kHTTPResp1));
+  stream.AddData(event_gen_.InitRecvEvent<kProtocolHTTP>(kHTTPResp0));
+  stream.AddData(event_gen_.InitRecvEvent<kProtocolHTTP>(kHTTPResp1));
+  stream.AddData(event_gen_.InitRecvEvent<kProtocolHTTP>(kHTTPResp1));
+
+  protocols::http::StateWrapper state{};
+  stream.ProcessBytesToFrames<http::Message>(message_type_t::kResponse, &state);
+  ASSERT_THAT(stream.Frames<http::Message>(), SizeIs(4));
+  EXPECT_EQ(stream.frame_size_hwm(), kHTTPResp0.size());
+
+  size_t expected = std::max<size_t>(4 * kHTTPResp0.size(),
+                                     FLAGS_datastream_buffer_min_retention_size);
+  EXPECT_EQ(stream.AdaptiveRetentionSize(kMaxRetentionBytes), expected);
+
+  // The upper bound always wins.
+  EXPECT_EQ(stream.AdaptiveRetentionSize(16), 16);
+}
+
+TEST_F(DataStreamTest, ReleaseBuffer) {
+  DataStream stream;
+  stream.set_protocol(kProtocolHTTP);
+  stream.AddData(event_gen_.InitRecvEvent<kProtocolHTTP>(kHTTPIncompleteResp));
+
+  size_t capacity = stream.data_buffer().capacity();
+  ASSERT_GE(capacity, kHTTPIncompleteResp.size());
+
+  size_t released_bytes = stream.ReleaseBuffer();
+  EXPECT_TRUE(stream.data_buffer().empty());
+  EXPECT_LT(stream.data_buffer().capacity(), kHTTPIncompleteResp.size());
+  EXPECT_EQ(released_bytes, capacity - stream.data_buffer().capacity());
+}
+
 TEST_F(DataStreamTest, ResyncCausesDuplicateEventBug) {
   // Test to catch regression on a bug. The bug occured when a resync occurs in ParseFrames, leading
   // to an invalid state where the data stream buffer still had data that had already been
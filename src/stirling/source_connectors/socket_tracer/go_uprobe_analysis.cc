@@ -0,0 +1,289 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/stirling/source_connectors/socket_tracer/go_uprobe_analysis.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "src/common/base/file.h"
+#include "src/common/fs/fs_wrapper.h"
+#include "src/stirling/obj_tools/elf_build_id.h"
+
+DEFINE_string(stirling_uprobe_analysis_cache_dir, "",
+              "If set, the results of analyzing Go binaries for uprobe deployment are persisted "
+              "in this directory (keyed by the binary's build-id or content hash), so they can be "
+              "reused after a restart. Empty keeps the results in memory only.");
+
+namespace px {
+namespace stirling {
+
+namespace {
+
+// Serialized format:
+//   SerializedAnalysisHeader
+//   go_common_symaddrs_t, go_tls_symaddrs_t, go_http2_symaddrs_t
+//   3 x uprobe lists (runtime, tls, http2), each:
+//     uint32_t num_uprobes
+//     num_uprobes x {SerializedUProbe, char symbol[symbol_size], char probe_fn[probe_fn_size]}
+// All fields are in host byte order; the analysis is only meant to be read back on the same host.
+// The symaddrs struct sizes are recorded, so that a change in their layout invalidates old entries.
+constexpr char kAnalysisMagic[8] = {'P', 'X', 'G', 'O', 'P', 'R', 'B', 'E'};
+constexpr uint32_t kAnalysisVersion = 1;
+
+constexpr std::string_view kEntryExtension = ".goprobes";
+
+struct SerializedAnalysisHeader {
+  char magic[8];
+  uint32_t version;
+  uint8_t probeable;
+  uint8_t has_tls_symaddrs;
+  uint8_t has_http2_symaddrs;
+  uint8_t reserved;
+  uint32_t common_symaddrs_size;
+  uint32_t tls_symaddrs_size;
+  uint32_t http2_symaddrs_size;
+  uint32_t reserved2;
+};
+
+struct SerializedUProbe {
+  uint64_t address;
+  uint32_t attach_type;
+  uint32_t symbol_size;
+  uint32_t probe_fn_size;
+  uint32_t reserved;
+};
+
+template <typename T>
+void Append(const T& value, std::string* buf) {
+  buf->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+Status Consume(std::string_view* buf, T* value) {
+  if (buf->size() < sizeof(T)) {
+    return error::InvalidArgument("Go uprobe analysis is truncated.");
+  }
+  memcpy(value, buf->data(), sizeof(T));
+  buf->remove_prefix(sizeof(T));
+  return Status::OK();
+}
+
+Status ConsumeString(std::string_view* buf, size_t size, std::string* value) {
+  if (buf->size() < size) {
+    return error::InvalidArgument("Go uprobe analysis is truncated.");
+  }
+  value->assign(buf->data(), size);
+  buf->remove_prefix(size);
+  return Status::OK();
+}
+
+void AppendUProbes(const std::vector<bpf_tools::UProbeSpec>& specs, std::string* buf) {
+  Append(static_cast<uint32_t>(specs.size()), buf);
+  for (const auto& spec : specs) {
+    SerializedUProbe serialized = {};
+    serialized.address = spec.address;
+    serialized.attach_type = static_cast<uint32_t>(spec.attach_type);
+    serialized.symbol_size = spec.symbol.size();
+    serialized.probe_fn_size = spec.probe_fn.size();
+    Append(serialized, buf);
+    buf->append(spec.symbol);
+    buf->append(spec.probe_fn);
+  }
+}
+
+Status ConsumeUProbes(std::string_view* buf, std::vector<bpf_tools::UProbeSpec>* specs) {
+  uint32_t num_uprobes;
+  PL_RETURN_IF_ERROR(Consume(buf, &num_uprobes));
+  // Each uprobe takes at least sizeof(SerializedUProbe) bytes; reject bogus counts early.
+  if (num_uprobes > buf->size() / sizeof(SerializedUProbe)) {
+    return error::InvalidArgument("Go uprobe analysis has an inconsistent uprobe count.");
+  }
+  specs->reserve(num_uprobes);
+  for (uint32_t i = 0; i < num_uprobes; ++i) {
+    SerializedUProbe serialized;
+    PL_RETURN_IF_ERROR(Consume(buf, &serialized));
+    bpf_tools::UProbeSpec spec;
+    spec.address = serialized.address;
+    spec.attach_type = static_cast<bpf_tools::BPFProbeAttachType>(serialized.attach_type);
+    PL_RETURN_IF_ERROR(ConsumeString(buf, serialized.symbol_size, &spec.symbol));
+    PL_RETURN_IF_ERROR(ConsumeString(buf, serialized.probe_fn_size, &spec.probe_fn));
+    specs->push_back(std::move(spec));
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+std::string GoUProbeAnalysis::Serialize() const {
+  SerializedAnalysisHeader header = {};
+  memcpy(header.magic, kAnalysisMagic, sizeof(header.magic));
+  header.version = kAnalysisVersion;
+  header.probeable = probeable;
+  header.has_tls_symaddrs = tls_symaddrs.has_value();
+  header.has_http2_symaddrs = http2_symaddrs.has_value();
+  header.common_symaddrs_size = sizeof(struct go_common_symaddrs_t);
+  header.tls_symaddrs_size = sizeof(struct go_tls_symaddrs_t);
+  header.http2_symaddrs_size = sizeof(struct go_http2_symaddrs_t);
+
+  std::string buf;
+  Append(header, &buf);
+  Append(common_symaddrs, &buf);
+  Append(tls_symaddrs.value_or(go_tls_symaddrs_t{}), &buf);
+  Append(http2_symaddrs.value_or(go_http2_symaddrs_t{}), &buf);
+  AppendUProbes(runtime_uprobes, &buf);
+  AppendUProbes(tls_uprobes, &buf);
+  AppendUProbes(http2_uprobes, &buf);
+  return buf;
+}
+
+StatusOr<GoUProbeAnalysis> GoUProbeAnalysis::Deserialize(std::string_view buf) {
+  SerializedAnalysisHeader header;
+  PL_RETURN_IF_ERROR(Consume(&buf, &header));
+  if (memcmp(header.magic, kAnalysisMagic, sizeof(header.magic)) != 0 ||
+      header.version != kAnalysisVersion ||
+      header.common_symaddrs_size != sizeof(struct go_common_symaddrs_t) ||
+      header.tls_symaddrs_size != sizeof(struct go_tls_symaddrs_t) ||
+      header.http2_symaddrs_size != sizeof(struct go_http2_symaddrs_t)) {
+    return error::InvalidArgument("Unrecognized Go uprobe analysis format.");
+  }
+
+  GoUProbeAnalysis analysis;
+  analysis.probeable = header.probeable;
+
+  struct go_tls_symaddrs_t tls_symaddrs;
+  struct go_http2_symaddrs_t http2_symaddrs;
+  PL_RETURN_IF_ERROR(Consume(&buf, &analysis.common_symaddrs));
+  PL_RETURN_IF_ERROR(Consume(&buf, &tls_symaddrs));
+  PL_RETURN_IF_ERROR(Consume(&buf, &http2_symaddrs));
+  if (header.has_tls_symaddrs) {
+    analysis.tls_symaddrs = tls_symaddrs;
+  }
+  if (header.has_http2_symaddrs) {
+    analysis.http2_symaddrs = http2_symaddrs;
+  }
+
+  PL_RETURN_IF_ERROR(ConsumeUProbes(&buf, &analysis.runtime_uprobes));
+  PL_RETURN_IF_ERROR(ConsumeUProbes(&buf, &analysis.tls_uprobes));
+  PL_RETURN_IF_ERROR(ConsumeUProbes(&buf, &analysis.http2_uprobes));
+  if (!buf.empty()) {
+    return error::InvalidArgument("Go uprobe analysis has trailing bytes.");
+  }
+
+  return analysis;
+}
+
+GoUProbeAnalysisCache::GoUProbeAnalysisCache(std::filesystem::path dir,
+                                             std::string probes_fingerprint,
+                                             size_t max_in_memory_entries)
+    : dir_(std::move(dir)),
+      probes_fingerprint_(std::move(probes_fingerprint)),
+      max_in_memory_entries_(std::max<size_t>(max_in_memory_entries, 1)) {
+  if (dir_.empty()) {
+    return;
+  }
+  Status s = fs::CreateDirectories(dir_);
+  LOG_IF(WARNING, !s.ok()) << absl::Substitute(
+      "Go uprobe analyses will not be persisted: $0", s.ToString());
+}
+
+StatusOr<std::string> GoUProbeAnalysisCache::BinaryKey(
+    const std::filesystem::path& binary) const {
+  PL_ASSIGN_OR_RETURN(std::string key, obj_tools::BinaryContentKey(binary));
+  if (!probes_fingerprint_.empty()) {
+    absl::StrAppend(&key, "-probes-", probes_fingerprint_);
+  }
+  return key;
+}
+
+std::filesystem::path GoUProbeAnalysisCache::EntryPath(const std::string& key) const {
+  return dir_ / absl::StrCat(key, kEntryExtension);
+}
+
+std::shared_ptr<const GoUProbeAnalysis> GoUProbeAnalysisCache::Lookup(const std::string& key) {
+  auto iter = analyses_.find(key);
+  if (iter != analyses_.end()) {
+    return iter->second;
+  }
+
+  if (dir_.empty()) {
+    return nullptr;
+  }
+
+  const std::filesystem::path path = EntryPath(key);
+  if (!fs::Exists(path)) {
+    return nullptr;
+  }
+  StatusOr<GoUProbeAnalysis> analysis = error::NotFound("");
+  StatusOr<std::string> buf = ReadFileToString(path.string());
+  if (buf.ok()) {
+    analysis = GoUProbeAnalysis::Deserialize(buf.ValueOrDie());
+  } else {
+    analysis = buf.status();
+  }
+  if (!analysis.ok()) {
+    VLOG(1) << absl::Substitute("Ignoring Go uprobe analysis $0: $1", path.string(),
+                                analysis.ToString());
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return nullptr;
+  }
+
+  auto ptr = std::make_shared<const GoUProbeAnalysis>(analysis.ConsumeValueOrDie());
+  Remember(key, ptr);
+  return ptr;
+}
+
+void GoUProbeAnalysisCache::Insert(const std::string& key,
+                                   std::shared_ptr<const GoUProbeAnalysis> analysis) {
+  if (!dir_.empty()) {
+    // Write to a temporary file first, so that a crash never leaves a partial analysis behind.
+    const std::filesystem::path path = EntryPath(key);
+    const std::filesystem::path tmp_path = absl::StrCat(path.string(), ".tmp");
+    Status s = WriteFileFromString(tmp_path.string(), analysis->Serialize());
+    std::error_code ec;
+    if (s.ok()) {
+      std::filesystem::rename(tmp_path, path, ec);
+    }
+    if (!s.ok() || ec) {
+      std::filesystem::remove(tmp_path, ec);
+      VLOG(1) << absl::Substitute("Failed to persist Go uprobe analysis $0", path.string());
+    }
+  }
+
+  Remember(key, std::move(analysis));
+}
+
+void GoUProbeAnalysisCache::Remember(const std::string& key,
+                                     std::shared_ptr<const GoUProbeAnalysis> analysis) {
+  const bool inserted = analyses_.insert_or_assign(key, std::move(analysis)).second;
+  if (!inserted) {
+    return;
+  }
+  keys_.push_back(key);
+  // Callers hold on to shared_ptrs, so evicted analyses stay valid while they are in use.
+  while (keys_.size() > max_in_memory_entries_) {
+    analyses_.erase(keys_.front());
+    keys_.pop_front();
+  }
+}
+
+}  // namespace stirling
+}  // namespace px
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <absl/container/flat_hash_map.h>
+
+#include "src/common/base/base.h"
+#include "src/stirling/bpf_tools/bcc_wrapper.h"
+#include "src/stirling/source_connectors/socket_tracer/bcc_bpf_intf/symaddrs.h"
+
+DECLARE_string(stirling_uprobe_analysis_cache_dir);
+
+namespace px {
+namespace stirling {
+
+/**
+ * The results of analyzing a Go binary for uprobe deployment: the symbol addresses that are
+ * communicated to BPF, and the uprobes to attach. These depend only on the contents of the
+ * binary, so identical binaries (e.g. in different pods, or across restarts) need only be
+ * analyzed once.
+ */
+struct GoUProbeAnalysis {
+  // False if the binary is not a Go binary, has no debug symbols, or lacks the symbols that are
+  // mandatory for Go tracing. The remaining fields are empty in that case.
+  bool probeable = false;
+
+  struct go_common_symaddrs_t common_symaddrs = {};
+
+  // Not set if the binary does not use Go TLS (or HTTP2, respectively).
+  std::optional<struct go_tls_symaddrs_t> tls_symaddrs;
+  std::optional<struct go_http2_symaddrs_t> http2_symaddrs;
+
+  // The uprobes to attach, with an empty binary_path, to be filled in by the caller.
+  std::vector<bpf_tools::UProbeSpec> runtime_uprobes;
+  std::vector<bpf_tools::UProbeSpec> tls_uprobes;
+  std::vector<bpf_tools::UProbeSpec> http2_uprobes;
+
+  std::string Serialize() const;
+  static StatusOr<GoUProbeAnalysis> Deserialize(std::string_view buf);
+};
+
+/**
+ * Caches GoUProbeAnalysis results by the contents of the binary they were computed from,
+ * in memory, and optionally in a directory that survives restarts.
+ *
+ * Not thread-safe, except for BinaryKey().
+ */
+class GoUProbeAnalysisCache : public NotCopyMoveable {
+ public:
+  static constexpr size_t kDefaultMaxInMemoryEntries = 1024;
+
+  /**
+   * @param dir Directory in which analyses are persisted; empty to only keep them in memory.
+   * @param probes_fingerprint Identifies the set of probes that analyses are computed for, so
+   *                           that analyses of an older set of probes are not reused.
+   * @param max_in_memory_entries Beyond this, the oldest analyses are evicted from memory
+   *                              (but are still found in dir).
+   */
+  explicit GoUProbeAnalysisCache(std::filesystem::path dir = {},
+                                 std::string probes_fingerprint = {},
+                                 size_t max_in_memory_entries = kDefaultMaxInMemoryEntries);
+
+  /**
+   * Returns a key that identifies the contents of the binary (its build-id and size if it has a
+   * build-id, otherwise a hash of the file contents), and the set of probes.
+   * Safe to call concurrently, since it does not touch the cached analyses.
+   */
+  StatusOr<std::string> BinaryKey(const std::filesystem::path& binary) const;
+
+  /**
+   * Returns the analysis for the binary with the given key, or nullptr if it is not cached.
+   */
+  std::shared_ptr<const GoUProbeAnalysis> Lookup(const std::string& key);
+
+  void Insert(const std::string& key, std::shared_ptr<const GoUProbeAnalysis> analysis);
+
+  size_t size() const { return analyses_.size(); }
+
+ private:
+  std::filesystem::path EntryPath(const std::string& key) const;
+
+  // Records the analysis in memory, evicting the oldest analyses if needed.
+  void Remember(const std::string& key, std::shared_ptr<const GoUProbeAnalysis> analysis);
+
+  const std::filesystem::path dir_;
+  const std::string probes_fingerprint_;
+  const size_t max_in_memory_entries_;
+
+  absl::flat_hash_map<std::string, std::shared_ptr<const GoUProbeAnalysis>> analyses_;
+
+  // Keys of analyses_, in the order they were added.
+  std::deque<std::string> keys_;
+};
+
+}  // namespace stirling
+}  // namespace px
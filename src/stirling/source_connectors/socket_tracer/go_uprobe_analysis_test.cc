@@ -0,0 +1,195 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <memory>
+#include <string>
+
+#include "src/common/base/file.h"
+#include "src/common/testing/testing.h"
+#include "src/stirling/source_connectors/socket_tracer/go_uprobe_analysis.h"
+
+namespace px {
+namespace stirling {
+
+using ::testing::StartsWith;
+
+namespace {
+
+GoUProbeAnalysis SampleAnalysis() {
+  GoUProbeAnalysis analysis;
+  analysis.probeable = true;
+  analysis.common_symaddrs.FD_Sysfd_offset = 16;
+  analysis.common_symaddrs.g_goid_offset = 152;
+
+  struct go_tls_symaddrs_t tls_symaddrs = {};
+  tls_symaddrs.Write_b_loc = {.type = kLocationTypeRegisters, .offset = 8};
+  analysis.tls_symaddrs = tls_symaddrs;
+
+  analysis.runtime_uprobes.push_back({/*binary_path*/ {}, "runtime.casgstatus", /*address*/ 0,
+                                      bpf_tools::UProbeSpec::kDefaultPID,
+                                      bpf_tools::BPFProbeAttachType::kEntry,
+                                      "probe_runtime_casgstatus"});
+  analysis.tls_uprobes.push_back({/*binary_path*/ {}, /*symbol*/ {}, /*address*/ 0x4a1b2c,
+                                  bpf_tools::UProbeSpec::kDefaultPID,
+                                  bpf_tools::BPFProbeAttachType::kEntry,
+                                  "probe_return_tls_conn_write"});
+  return analysis;
+}
+
+void ExpectEqual(const GoUProbeAnalysis& expected, const GoUProbeAnalysis& actual) {
+  EXPECT_EQ(actual.probeable, expected.probeable);
+  EXPECT_EQ(actual.common_symaddrs.FD_Sysfd_offset, expected.common_symaddrs.FD_Sysfd_offset);
+  EXPECT_EQ(actual.common_symaddrs.g_goid_offset, expected.common_symaddrs.g_goid_offset);
+  ASSERT_EQ(actual.tls_symaddrs.has_value(), expected.tls_symaddrs.has_value());
+  if (expected.tls_symaddrs.has_value()) {
+    EXPECT_EQ(actual.tls_symaddrs->Write_b_loc, expected.tls_symaddrs->Write_b_loc);
+  }
+  EXPECT_EQ(actual.http2_symaddrs.has_value(), expected.http2_symaddrs.has_value());
+
+  auto specs_to_strings = [](const std::vector<bpf_tools::UProbeSpec>& specs) {
+    std::vector<std::string> out;
+    for (const auto& spec : specs) {
+      out.push_back(spec.ToString());
+    }
+    return out;
+  };
+  EXPECT_EQ(specs_to_strings(actual.runtime_uprobes), specs_to_strings(expected.runtime_uprobes));
+  EXPECT_EQ(specs_to_strings(actual.tls_uprobes), specs_to_strings(expected.tls_uprobes));
+  EXPECT_EQ(specs_to_strings(actual.http2_uprobes), specs_to_strings(expected.http2_uprobes));
+}
+
+}  // namespace
+
+TEST(GoUProbeAnalysisTest, SerializeRoundTrip) {
+  GoUProbeAnalysis analysis = SampleAnalysis();
+  ASSERT_OK_AND_ASSIGN(GoUProbeAnalysis restored,
+                       GoUProbeAnalysis::Deserialize(analysis.Serialize()));
+  ExpectEqual(analysis, restored);
+
+  GoUProbeAnalysis not_probeable;
+  ASSERT_OK_AND_ASSIGN(restored, GoUProbeAnalysis::Deserialize(not_probeable.Serialize()));
+  ExpectEqual(not_probeable, restored);
+}
+
+TEST(GoUProbeAnalysisTest, DeserializeRejectsCorruptData) {
+  std::string buf = SampleAnalysis().Serialize();
+
+  EXPECT_NOT_OK(GoUProbeAnalysis::Deserialize(""));
+  EXPECT_NOT_OK(GoUProbeAnalysis::Deserialize(std::string_view(buf).substr(0, buf.size() - 1)));
+  EXPECT_NOT_OK(GoUProbeAnalysis::Deserialize(buf + "x"));
+
+  std::string bad_magic = buf;
+  bad_magic[0] = 'X';
+  EXPECT_NOT_OK(GoUProbeAnalysis::Deserialize(bad_magic));
+}
+
+TEST(GoUProbeAnalysisCacheTest, InMemory) {
+  GoUProbeAnalysisCache cache;
+  EXPECT_EQ(cache.Lookup("build-id-abc"), nullptr);
+
+  cache.Insert("build-id-abc", std::make_shared<const GoUProbeAnalysis>(SampleAnalysis()));
+  EXPECT_EQ(cache.size(), 1);
+  std::shared_ptr<const GoUProbeAnalysis> analysis = cache.Lookup("build-id-abc");
+  ASSERT_NE(analysis, nullptr);
+  ExpectEqual(SampleAnalysis(), *analysis);
+}
+
+TEST(GoUProbeAnalysisCacheTest, PersistsAcrossInstances) {
+  px::testing::TempDir tmp_dir;
+
+  {
+    GoUProbeAnalysisCache cache(tmp_dir.path());
+    cache.Insert("build-id-abc", std::make_shared<const GoUProbeAnalysis>(SampleAnalysis()));
+  }
+
+  GoUProbeAnalysisCache cache(tmp_dir.path());
+  EXPECT_EQ(cache.size(), 0);
+  std::shared_ptr<const GoUProbeAnalysis> analysis = cache.Lookup("build-id-abc");
+  ASSERT_NE(analysis, nullptr);
+  ExpectEqual(SampleAnalysis(), *analysis);
+  EXPECT_EQ(cache.size(), 1);
+
+  EXPECT_EQ(cache.Lookup("build-id-def"), nullptr);
+}
+
+TEST(GoUProbeAnalysisCacheTest, IgnoresCorruptEntries) {
+  px::testing::TempDir tmp_dir;
+  ASSERT_OK(WriteFileFromString((tmp_dir.path() / "build-id-abc.goprobes").string(), "garbage"));
+
+  GoUProbeAnalysisCache cache(tmp_dir.path());
+  EXPECT_EQ(cache.Lookup("build-id-abc"), nullptr);
+  EXPECT_FALSE(std::filesystem::exists(tmp_dir.path() / "build-id-abc.goprobes"));
+}
+
+TEST(GoUProbeAnalysisCacheTest, BinaryKeyDependsOnContents) {
+  px::testing::TempDir tmp_dir;
+  const std::filesystem::path a = tmp_dir.path() / "a";
+  const std::filesystem::path b = tmp_dir.path() / "b";
+  const std::filesystem::path c = tmp_dir.path() / "c";
+  ASSERT_OK(WriteFileFromString(a.string(), "not an ELF file"));
+  ASSERT_OK(WriteFileFromString(b.string(), "not an ELF file"));
+  ASSERT_OK(WriteFileFromString(c.string(), "not an ELF file either"));
+
+  GoUProbeAnalysisCache cache;
+  ASSERT_OK_AND_ASSIGN(std::string key_a, cache.BinaryKey(a));
+  ASSERT_OK_AND_ASSIGN(std::string key_b, cache.BinaryKey(b));
+  ASSERT_OK_AND_ASSIGN(std::string key_c, cache.BinaryKey(c));
+  EXPECT_THAT(key_a, StartsWith("xxh64-"));
+  EXPECT_EQ(key_a, key_b);
+  EXPECT_NE(key_a, key_c);
+
+  EXPECT_NOT_OK(cache.BinaryKey(tmp_dir.path() / "missing"));
+}
+
+TEST(GoUProbeAnalysisCacheTest, BinaryKeyDependsOnProbes) {
+  px::testing::TempDir tmp_dir;
+  const std::filesystem::path a = tmp_dir.path() / "a";
+  ASSERT_OK(WriteFileFromString(a.string(), "not an ELF file"));
+
+  GoUProbeAnalysisCache cache1(/*dir*/ {}, "probes1");
+  GoUProbeAnalysisCache cache2(/*dir*/ {}, "probes2");
+  ASSERT_OK_AND_ASSIGN(std::string key1, cache1.BinaryKey(a));
+  ASSERT_OK_AND_ASSIGN(std::string key2, cache2.BinaryKey(a));
+  EXPECT_NE(key1, key2);
+}
+
+TEST(GoUProbeAnalysisCacheTest, EvictsOldestInMemory) {
+  px::testing::TempDir tmp_dir;
+  GoUProbeAnalysisCache cache(tmp_dir.path(), /*probes_fingerprint*/ {},
+                              /*max_in_memory_entries*/ 2);
+  auto analysis = std::make_shared<const GoUProbeAnalysis>(SampleAnalysis());
+  cache.Insert("build-id-a", analysis);
+  cache.Insert("build-id-b", analysis);
+  cache.Insert("build-id-c", analysis);
+  EXPECT_EQ(cache.size(), 2);
+
+  // Evicted analyses are still found on disk.
+  EXPECT_NE(cache.Lookup("build-id-a"), nullptr);
+  EXPECT_EQ(cache.size(), 2);
+
+  GoUProbeAnalysisCache in_memory_cache(/*dir*/ {}, /*probes_fingerprint*/ {},
+                                        /*max_in_memory_entries*/ 1);
+  in_memory_cache.Insert("build-id-a", analysis);
+  in_memory_cache.Insert("build-id-b", analysis);
+  EXPECT_EQ(in_memory_cache.size(), 1);
+  EXPECT_EQ(in_memory_cache.Lookup("build-id-a"), nullptr);
+  EXPECT_NE(in_memory_cache.Lookup("build-id-b"), nullptr);
+}
+
+}  // namespace stirling
+}  // namespace px
@@ -62,5 +62,24 @@ void SocketTracerMetrics::TestOnlyResetProtocolMetrics(traffic_protocol_t protoc
   ResetProtocolMetrics(protocol);
 }
 
+UProbeDeployMetrics::UProbeDeployMetrics(prometheus::Registry* registry)
+    : deferred_pids(prometheus::BuildCounter()
+                        .Name("uprobe_deferred_pids")
+                        .Help("Total number of new processes whose uprobe deployment was deferred "
+                              "until they reached the minimum process age.")
+                        .Register(*registry)
+                        .Add({})),
+      short_lived_pids(prometheus::BuildCounter()
+                           .Name("uprobe_short_lived_pids")
+                           .Help("Total number of processes that exited before reaching the "
+                                 "minimum process age, and so never had uprobes deployed.")
+                           .Register(*registry)
+                           .Add({})) {}
+
+UProbeDeployMetrics& UProbeDeployMetrics::Get() {
+  static UProbeDeployMetrics metrics(&GetMetricsRegistry());
+  return metrics;
+}
+
 }  // namespace stirling
 }  // namespace px
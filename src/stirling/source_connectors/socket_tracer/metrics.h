@@ -37,5 +37,17 @@ struct SocketTracerMetrics {
   static void TestOnlyResetProtocolMetrics(traffic_protocol_t protocol);
 };
 
+/**
+ * Counters for the deferral of uprobe deployment to new processes
+ * (see FLAGS_stirling_uprobe_min_process_age_ms).
+ */
+struct UProbeDeployMetrics {
+  explicit UProbeDeployMetrics(prometheus::Registry* registry);
+  prometheus::Counter& deferred_pids;
+  prometheus::Counter& short_lived_pids;
+
+  static UProbeDeployMetrics& Get();
+};
+
 }  // namespace stirling
 }  // namespace px
@@ -18,6 +18,10 @@
 
 #include "src/stirling/source_connectors/socket_tracer/protocols/common/always_contiguous_data_stream_buffer_impl.h"
 
+#include <optional>
+#include <string>
+#include <utility>
+
 namespace px {
 namespace stirling {
 namespace protocols {
@@ -38,6 +42,50 @@ typename TMapType::const_iterator MapLE(const TMapType& map, size_t key) {
 
 }  // namespace
 
+ValuePool<std::string>& AlwaysContiguousDataStreamBufferImpl::StoragePool() {
+  static thread_local ValuePool<std::string> pool(kStoragePoolCapacity);
+  return pool;
+}
+
+AlwaysContiguousDataStreamBufferImpl::~AlwaysContiguousDataStreamBufferImpl() {
+  buffer_.clear();
+  ReleaseStorage();
+}
+
+const PoolStats& AlwaysContiguousDataStreamBufferImpl::StoragePoolStats() {
+  return StoragePool().stats();
+}
+
+void AlwaysContiguousDataStreamBufferImpl::AcquireStorage(size_t size) {
+  DCHECK(buffer_.empty());
+  if (buffer_.capacity() >= size) {
+    return;
+  }
+  std::optional<std::string> storage = StoragePool().Pop();
+  if (storage.has_value()) {
+    buffer_.swap(storage.value());
+  }
+}
+
+void AlwaysContiguousDataStreamBufferImpl::ReleaseStorage() {
+  DCHECK(buffer_.empty());
+  std::string storage;
+  storage.swap(buffer_);
+  if (storage.capacity() >= kMinPooledStorageBytes &&
+      storage.capacity() <= kMaxPooledStorageBytes) {
+    StoragePool().Recycle(std::move(storage));
+  }
+}
+
+void AlwaysContiguousDataStreamBufferImpl::ShrinkToFit() {
+  if (buffer_.empty()) {
+    // Nothing to keep, so give the storage to the next buffer that needs it instead of freeing it.
+    ReleaseStorage();
+    return;
+  }
+  buffer_.shrink_to_fit();
+}
+
 void AlwaysContiguousDataStreamBufferImpl::Reset() {
   buffer_.clear();
   chunks_.clear();
@@ -217,6 +265,9 @@ void AlwaysContiguousDataStreamBufferImpl::Add(size_t pos, std::string_view data
     DCHECK_LE(new_size, capacity_);
     DCHECK_GE(new_size, 0);
 
+    if (buffer_.empty()) {
+      AcquireStorage(new_size);
+    }
     buffer_.resize(new_size);
 
     DCHECK_GE(buffer_.size(), 0);
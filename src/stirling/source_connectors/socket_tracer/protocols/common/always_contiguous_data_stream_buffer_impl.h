@@ -22,6 +22,7 @@
 #include <string>
 
 #include "src/stirling/source_connectors/socket_tracer/protocols/common/data_stream_buffer.h"
+#include "src/stirling/utils/obj_pool.h"
 
 namespace px {
 namespace stirling {
@@ -35,6 +36,8 @@ class AlwaysContiguousDataStreamBufferImpl : public DataStreamBufferImpl {
         max_gap_size_(max_gap_size),
         allow_before_gap_size_(allow_before_gap_size) {}
 
+  ~AlwaysContiguousDataStreamBufferImpl() override;
+
   void Add(size_t pos, std::string_view data, uint64_t timestamp) override;
 
   std::string_view Head() override { return Get(position_); }
@@ -57,9 +60,29 @@ class AlwaysContiguousDataStreamBufferImpl : public DataStreamBufferImpl {
 
   void Reset() override;
 
-  void ShrinkToFit() override { buffer_.shrink_to_fit(); }
+  void ShrinkToFit() override;
+
+  /**
+   * Hit/miss statistics of the pool that recycles buffer storage across buffers.
+   * The pool is per-thread, so these are the statistics of the calling thread.
+   */
+  static const PoolStats& StoragePoolStats();
 
  private:
+  // Storage outside of this range is not worth recycling: small buffers are cheap to allocate,
+  // and large buffers would pin too much memory in the pool.
+  static constexpr size_t kMinPooledStorageBytes = 256;
+  static constexpr size_t kMaxPooledStorageBytes = 64 * 1024;
+  static constexpr size_t kStoragePoolCapacity = 128;
+
+  static ValuePool<std::string>& StoragePool();
+
+  // Takes recycled storage for an empty buffer that is about to grow to `size` bytes.
+  void AcquireStorage(size_t size);
+
+  // Hands the storage of an empty buffer back to the pool (or frees it).
+  void ReleaseStorage();
+
   std::map<size_t, size_t>::const_iterator GetChunkForPos(size_t pos) const;
   void AddNewChunk(size_t pos, size_t size);
   void AddNewTimestamp(size_t pos, uint64_t timestamp);
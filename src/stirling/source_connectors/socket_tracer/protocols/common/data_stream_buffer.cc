@@ -50,6 +50,10 @@ DataStreamBuffer::DataStreamBuffer(size_t max_capacity, size_t max_gap_size,
   }
 }
 
+const PoolStats& DataStreamBuffer::StoragePoolStats() {
+  return AlwaysContiguousDataStreamBufferImpl::StoragePoolStats();
+}
+
 }  // namespace protocols
 }  // namespace stirling
 }  // namespace px
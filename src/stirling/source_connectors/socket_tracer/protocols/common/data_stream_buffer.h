@@ -25,6 +25,7 @@
 #include <string>
 
 #include "src/common/base/base.h"
+#include "src/stirling/utils/obj_pool.h"
 
 DECLARE_bool(stirling_data_stream_buffer_always_contiguous_buffer);
 
@@ -146,6 +147,11 @@ class DataStreamBuffer {
    */
   void ShrinkToFit() { impl_->ShrinkToFit(); }
 
+  /**
+   * Hit/miss statistics of the storage recycled across buffers on the calling thread.
+   */
+  static const PoolStats& StoragePoolStats();
+
  private:
   std::unique_ptr<DataStreamBufferImpl> impl_;
 };
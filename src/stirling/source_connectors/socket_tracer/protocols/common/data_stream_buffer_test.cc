@@ -18,6 +18,8 @@
 
 #include "src/stirling/source_connectors/socket_tracer/protocols/common/data_stream_buffer.h"
 
+#include <string>
+
 #include "src/common/testing/testing.h"
 
 namespace px {
@@ -278,6 +280,29 @@ INSTANTIATE_TEST_SUITE_P(DataStreamBufferImplTest, DataStreamBufferTest,
                            }
                          });
 
+TEST(AlwaysContiguousDataStreamBufferTest, StorageRecycledAcrossBuffers) {
+  const bool old_flag_val = FLAGS_stirling_data_stream_buffer_always_contiguous_buffer;
+  FLAGS_stirling_data_stream_buffer_always_contiguous_buffer = true;
+  DEFER(FLAGS_stirling_data_stream_buffer_always_contiguous_buffer = old_flag_val);
+
+  const std::string data(1000, 'x');
+
+  {
+    DataStreamBuffer stream_buffer(4096, 4096, 4096);
+    stream_buffer.Add(0, data, 0);
+    stream_buffer.RemovePrefix(data.size());
+    // Releases the now unused storage into the pool.
+    stream_buffer.ShrinkToFit();
+    EXPECT_LT(stream_buffer.capacity(), data.size());
+  }
+  const uint64_t hits_before = DataStreamBuffer::StoragePoolStats().hits;
+
+  DataStreamBuffer stream_buffer(4096, 4096, 4096);
+  stream_buffer.Add(0, data, 0);
+  EXPECT_EQ(stream_buffer.Head(), data);
+  EXPECT_EQ(DataStreamBuffer::StoragePoolStats().hits, hits_before + 1);
+}
+
 }  // namespace protocols
 }  // namespace stirling
 }  // namespace px
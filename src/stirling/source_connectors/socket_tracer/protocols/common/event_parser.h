@@ -79,6 +79,10 @@ struct ParseResult {
   int invalid_frames;
   // Total number of bytes parsed into valid frames.
   size_t frame_bytes;
+  // Total number of bytes consumed by ignored frames (e.g. the parts of a streamed HTTP body).
+  // These bytes were parsed successfully, so they are not lost, but they are not part of any
+  // frame in frame_positions.
+  size_t ignored_bytes;
 };
 
 /**
@@ -135,6 +139,10 @@ ParseResult ParseFrames(message_type_t type, DataStreamBuffer* data_stream_buffe
     f.end += start_pos;
 
     auto& msg = (*frames)[prev_size + i];
+    // Frames decoded across several calls already carry the timestamp of their first part.
+    if (msg.timestamp_ns != 0) {
+      continue;
+    }
     StatusOr<uint64_t> timestamp_ns_status =
         data_stream_buffer->GetTimestamp(data_stream_buffer->position() + f.end);
     LOG_IF(ERROR, !timestamp_ns_status.ok()) << timestamp_ns_status.ToString();
@@ -167,6 +175,7 @@ ParseResult ParseFramesLoop(message_type_t type, std::string_view buf,
   ParseState s = ParseState::kSuccess;
   size_t bytes_processed = 0;
   size_t frame_bytes = 0;
+  size_t ignored_bytes = 0;
   int invalid_count = 0;
 
   while (!buf.empty() && s != ParseState::kEOS) {
@@ -223,9 +232,12 @@ ParseResult ParseFramesLoop(message_type_t type, std::string_view buf,
       frame_positions.push_back({start_position, end_position});
       frame_bytes += (end_position - start_position) + 1;
       frames->push_back(std::move(frame));
+    } else if (s == ParseState::kIgnored) {
+      ignored_bytes += (end_position - start_position) + 1;
     }
   }
-  return ParseResult{std::move(frame_positions), bytes_processed, s, invalid_count, frame_bytes};
+  return ParseResult{std::move(frame_positions), bytes_processed, s, invalid_count, frame_bytes,
+                     ignored_bytes};
 }
 
 }  // namespace protocols
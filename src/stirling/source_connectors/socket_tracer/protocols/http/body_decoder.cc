@@ -118,6 +118,47 @@ ParseState ExtractChunkData(std::string_view* data, size_t chunk_len, std::strin
   *out = chunk_data;
   return ParseState::kSuccess;
 }
+
+/**
+ * Extracts the optional trailers and the final \r\n that follow the last chunk of an HTTP
+ * chunked-encoding message body.
+ *
+ * @param data Data buffer starting right after the last (zero-length) chunk header.
+ *             The bytes of this string_view are consumed upon success.
+ * @return ParseState::kInvalid if message is malformed.
+ *         ParseState::kNeedsMoreData if the message is incomplete.
+ *         ParseState::kSuccess if the end of the body was found.
+ */
+ParseState ExtractTrailers(std::string_view* data) {
+  // Two scenarios to wrap up:
+  //   No trailers (common case): Immediately expect one more \r\n
+  //   Trailers: End on next \r\n\r\n.
+  if (data->length() >= kDelimiterLen && (*data)[0] == '\r' && (*data)[1] == '\n') {
+    data->remove_prefix(kDelimiterLen);
+    return ParseState::kSuccess;
+  }
+
+  // HTTP doesn't specify a limit on how big headers and trailers can be.
+  // 8K is the maximum headers size in many popular HTTP servers (like Apache),
+  // so use that as a proxy of the maximum trailer size we can expect.
+  constexpr int kSearchWindow = 8192;
+
+  size_t pos = data->substr(0, kSearchWindow).find("\r\n\r\n");
+  if (pos == data->npos) {
+    return data->length() > kSearchWindow ? ParseState::kInvalid : ParseState::kNeedsMoreData;
+  }
+
+  data->remove_prefix(pos + 4);
+  return ParseState::kSuccess;
+}
+
+// Appends data to result, without growing result beyond size_limit.
+void AppendBounded(std::string_view data, size_t size_limit, std::string* result) {
+  if (result->size() < size_limit) {
+    result->append(data.substr(0, size_limit - result->size()));
+  }
+}
+
 }  // namespace
 
 // This is an alternative to the picohttpparser implementation,
@@ -166,23 +207,9 @@ ParseState CustomParseChunked(std::string_view* buf, size_t body_size_limit_byte
     total_bytes += chunk_data.size();
   }
 
-  // Two scenarios to wrap up:
-  //   No trailers (common case): Immediately expect one more \r\n
-  //   Trailers: End on next \r\n\r\n.
-  if (data.length() >= kDelimiterLen && data[0] == '\r' && data[1] == '\n') {
-    data.remove_prefix(kDelimiterLen);
-  } else {
-    // HTTP doesn't specify a limit on how big headers and trailers can be.
-    // 8K is the maximum headers size in many popular HTTP servers (like Apache),
-    // so use that as a proxy of the maximum trailer size we can expect.
-    constexpr int kSearchWindow = 8192;
-
-    size_t pos = data.substr(0, kSearchWindow).find("\r\n\r\n");
-    if (pos == data.npos) {
-      return data.length() > kSearchWindow ? ParseState::kInvalid : ParseState::kNeedsMoreData;
-    }
-
-    data.remove_prefix(pos + 4);
+  s = ExtractTrailers(&data);
+  if (s != ParseState::kSuccess) {
+    return s;
   }
 
   *result = absl::StrJoin(chunks, "");
@@ -194,6 +221,66 @@ ParseState CustomParseChunked(std::string_view* buf, size_t body_size_limit_byte
   return ParseState::kSuccess;
 }
 
+ParseState StreamParseChunked(std::string_view* buf, size_t body_size_limit_bytes,
+                              BodyDecoderState* state, std::string* result, size_t* body_size) {
+  using ChunkedPhase = BodyDecoderState::ChunkedPhase;
+
+  while (true) {
+    switch (state->chunked_phase) {
+      case ChunkedPhase::kChunkHeader: {
+        size_t chunk_len = 0;
+        ParseState s = ExtractChunkLength(buf, &chunk_len);
+        if (s != ParseState::kSuccess) {
+          return s;
+        }
+        // A length of zero marks the end of data.
+        if (chunk_len == 0) {
+          state->chunked_phase = ChunkedPhase::kTrailers;
+        } else {
+          state->bytes_remaining = chunk_len;
+          state->chunked_phase = ChunkedPhase::kChunkData;
+        }
+      } break;
+      case ChunkedPhase::kChunkData: {
+        if (buf->empty()) {
+          return ParseState::kNeedsMoreData;
+        }
+        size_t n = std::min(buf->size(), state->bytes_remaining);
+        AppendBounded(buf->substr(0, n), body_size_limit_bytes, result);
+        buf->remove_prefix(n);
+        *body_size += n;
+        state->bytes_remaining -= n;
+        if (state->bytes_remaining == 0) {
+          state->chunked_phase = ChunkedPhase::kChunkDataDelimiter;
+        }
+      } break;
+      case ChunkedPhase::kChunkDataDelimiter: {
+        if (buf->size() < kDelimiterLen) {
+          return ParseState::kNeedsMoreData;
+        }
+        // Expect a \r\n to terminate the data chunk.
+        if ((*buf)[0] != '\r' || (*buf)[1] != '\n') {
+          return ParseState::kInvalid;
+        }
+        buf->remove_prefix(kDelimiterLen);
+        state->chunked_phase = ChunkedPhase::kChunkHeader;
+      } break;
+      case ChunkedPhase::kTrailers:
+        return ExtractTrailers(buf);
+    }
+  }
+}
+
+ParseState StreamParseContent(std::string_view* buf, size_t body_size_limit_bytes,
+                              BodyDecoderState* state, std::string* result, size_t* body_size) {
+  size_t n = std::min(buf->size(), state->bytes_remaining);
+  AppendBounded(buf->substr(0, n), body_size_limit_bytes, result);
+  buf->remove_prefix(n);
+  *body_size += n;
+  state->bytes_remaining -= n;
+  return (state->bytes_remaining == 0) ? ParseState::kSuccess : ParseState::kNeedsMoreData;
+}
+
 // Parse an HTTP chunked body using pico's parser. This implementation
 // has the disadvantage that it incurs a potentially expensive copy even when
 // the final result is kNeedsMoreData.
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
 #include "src/stirling/utils/parse_state.h"
 
@@ -43,6 +44,53 @@ namespace http {
 ParseState ParseChunked(std::string_view* buf, size_t body_size_limit_bytes, std::string* result,
                         size_t* body_size);
 
+/**
+ * Progress of an HTTP body that is decoded incrementally, across multiple calls to
+ * StreamParseContent() or StreamParseChunked(). This allows the bytes of large bodies to be
+ * consumed as they arrive, instead of being held in the input buffer until the body is complete.
+ */
+struct BodyDecoderState {
+  enum class ChunkedPhase {
+    // Expecting a chunk header (length and optional extensions).
+    kChunkHeader,
+    // Inside the data of a chunk; bytes_remaining holds the number of data bytes left.
+    kChunkData,
+    // Expecting the \r\n that terminates the data of a chunk.
+    kChunkDataDelimiter,
+    // The last (zero-length) chunk was seen; expecting optional trailers and the final \r\n.
+    kTrailers,
+  };
+
+  ChunkedPhase chunked_phase = ChunkedPhase::kChunkHeader;
+
+  // For Content-Length bodies, the number of body bytes left.
+  // For chunked bodies, the number of data bytes left in the current chunk.
+  size_t bytes_remaining = 0;
+};
+
+/**
+ * Incrementally parse an HTTP chunked body.
+ *
+ * Unlike ParseChunked(), bytes are consumed from buf as soon as they are decoded. Decoded data is
+ * appended to result, up to a total of body_size_limit_bytes; the rest is skipped without being
+ * copied. body_size is incremented by the number of decoded data bytes, including skipped bytes.
+ *
+ * @return ParseState::kInvalid if message is malformed.
+ *         ParseState::kNeedsMoreData if the body is incomplete. Decodable bytes were consumed,
+ *                                    and the progress was recorded in state.
+ *         ParseState::kSuccess if the end of the body was reached.
+ */
+ParseState StreamParseChunked(std::string_view* buf, size_t body_size_limit_bytes,
+                              BodyDecoderState* state, std::string* result, size_t* body_size);
+
+/**
+ * Incrementally parse an HTTP body based on Content-Length.
+ * state->bytes_remaining must be initialized to the content length before the first call.
+ * See StreamParseChunked() for the meaning of the arguments and return values.
+ */
+ParseState StreamParseContent(std::string_view* buf, size_t body_size_limit_bytes,
+                              BodyDecoderState* state, std::string* result, size_t* body_size);
+
 /**
  * Parse an HTTP body based on Content-Length.
  *
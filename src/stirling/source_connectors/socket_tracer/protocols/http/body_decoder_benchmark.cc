@@ -18,14 +18,18 @@
 
 #include <picohttpparser.h>
 
+#include <algorithm>
 #include <random>
+#include <string>
 
 #include <benchmark/benchmark.h>
 
 #include "src/common/base/base.h"
 #include "src/stirling/source_connectors/socket_tracer/protocols/http/body_decoder.h"
 
+using px::stirling::protocols::http::BodyDecoderState;
 using px::stirling::protocols::http::ParseChunked;
+using px::stirling::protocols::http::StreamParseChunked;
 
 const size_t kBodyLimitSizeBytes = 1000000;
 
@@ -91,5 +95,61 @@ static void BM_pico_body_parser(benchmark::State& state) {
   }
 }
 
+// The following benchmarks model a body that arrives in pieces of state.range(0) bytes,
+// with a parse attempted after each piece, as happens across DataStream iterations.
+// The retained_bytes counter reports the peak number of bytes that had to stay buffered.
+
+// NOLINTNEXTLINE(runtime/references)
+static void BM_custom_body_parser_incremental(benchmark::State& state) {
+  FLAGS_use_pico_chunked_decoder = false;
+  const size_t piece_size = state.range(0);
+  size_t max_retained_bytes = 0;
+
+  for (auto _ : state) {
+    std::string result;
+    size_t body_size;
+    px::stirling::ParseState parse_state = px::stirling::ParseState::kNeedsMoreData;
+    for (size_t end = piece_size; parse_state == px::stirling::ParseState::kNeedsMoreData;
+         end += piece_size) {
+      // Nothing is consumed until the body is complete, so the whole prefix is retained.
+      std::string_view data_view = std::string_view(data).substr(0, end);
+      max_retained_bytes = std::max(max_retained_bytes, data_view.size());
+      parse_state = ParseChunked(&data_view, kBodyLimitSizeBytes, &result, &body_size);
+    }
+    CHECK(parse_state == px::stirling::ParseState::kSuccess);
+    benchmark::DoNotOptimize(result);
+  }
+  state.counters["retained_bytes"] = max_retained_bytes;
+}
+
+// NOLINTNEXTLINE(runtime/references)
+static void BM_streaming_body_parser_incremental(benchmark::State& state) {
+  const size_t piece_size = state.range(0);
+  size_t max_retained_bytes = 0;
+
+  for (auto _ : state) {
+    BodyDecoderState decoder_state;
+    std::string result;
+    size_t body_size = 0;
+    std::string pending;
+    px::stirling::ParseState parse_state = px::stirling::ParseState::kNeedsMoreData;
+    for (size_t pos = 0; parse_state == px::stirling::ParseState::kNeedsMoreData;
+         pos += piece_size) {
+      pending.append(data.substr(pos, piece_size));
+      max_retained_bytes = std::max(max_retained_bytes, pending.size());
+      std::string_view data_view(pending);
+      parse_state =
+          StreamParseChunked(&data_view, kBodyLimitSizeBytes, &decoder_state, &result, &body_size);
+      // Only the bytes that could not be decoded yet are retained.
+      pending.erase(0, pending.size() - data_view.size());
+    }
+    CHECK(parse_state == px::stirling::ParseState::kSuccess);
+    benchmark::DoNotOptimize(result);
+  }
+  state.counters["retained_bytes"] = max_retained_bytes;
+}
+
 BENCHMARK(BM_custom_body_parser);
 BENCHMARK(BM_pico_body_parser);
+BENCHMARK(BM_custom_body_parser_incremental)->Arg(4096)->Arg(32768);
+BENCHMARK(BM_streaming_body_parser_incremental)->Arg(4096)->Arg(32768);
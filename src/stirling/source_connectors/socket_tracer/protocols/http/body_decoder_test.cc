@@ -238,6 +238,117 @@ TEST_P(ChunkedDecoderTest, Trailers) {
   EXPECT_EQ(body, "");
 }
 
+// Feeds the body to the streaming decoder in pieces of the given size, retaining only the bytes
+// the decoder did not consume, as the DataStream buffer would.
+ParseState StreamParseChunkedInPieces(std::string_view body, size_t piece_size,
+                                      size_t body_size_limit_bytes, std::string* out,
+                                      size_t* body_size, std::string* leftover) {
+  BodyDecoderState state;
+  ParseState s = ParseState::kNeedsMoreData;
+  std::string pending;
+  for (size_t pos = 0; pos < body.size() && s == ParseState::kNeedsMoreData; pos += piece_size) {
+    pending.append(body.substr(pos, piece_size));
+    std::string_view buf(pending);
+    s = StreamParseChunked(&buf, body_size_limit_bytes, &state, out, body_size);
+    pending = std::string(buf);
+  }
+  *leftover = pending;
+  return s;
+}
+
+TEST(StreamParseChunkedTest, AnyPieceSize) {
+  std::string_view body =
+      "9\r\n"
+      "pixielabs\r\n"
+      "C;ext=1\r\n"
+      " is awesome!\r\n"
+      "0\r\n"
+      "Trailer: abcd\r\n"
+      "\r\n";
+
+  for (size_t piece_size = 1; piece_size <= body.size(); ++piece_size) {
+    std::string out;
+    size_t body_size = 0;
+    std::string leftover;
+    ParseState result = StreamParseChunkedInPieces(body, piece_size, kBodySizeLimitBytes, &out,
+                                                   &body_size, &leftover);
+
+    EXPECT_EQ(result, ParseState::kSuccess) << piece_size;
+    EXPECT_EQ(out, "pixielabs is awesome!") << piece_size;
+    EXPECT_EQ(body_size, 21) << piece_size;
+    EXPECT_EQ(leftover, "") << piece_size;
+  }
+}
+
+TEST(StreamParseChunkedTest, RetainsOnlyBodyLimit) {
+  std::string_view body =
+      "9\r\n"
+      "pixielabs\r\n"
+      "C\r\n"
+      " is awesome!\r\n"
+      "0\r\n"
+      "\r\n";
+
+  std::string out;
+  size_t body_size = 0;
+  std::string leftover;
+  ParseState result = StreamParseChunkedInPieces(body, 4, /*body_size_limit_bytes*/ 5, &out,
+                                                 &body_size, &leftover);
+
+  EXPECT_EQ(result, ParseState::kSuccess);
+  EXPECT_EQ(out, "pixie");
+  EXPECT_EQ(body_size, 21);
+}
+
+TEST(StreamParseChunkedTest, ConsumesPartialChunkData) {
+  std::string_view body =
+      "9\r\n"
+      "pixie";
+
+  BodyDecoderState state;
+  std::string out;
+  size_t body_size = 0;
+  ParseState result = StreamParseChunked(&body, kBodySizeLimitBytes, &state, &out, &body_size);
+
+  EXPECT_EQ(result, ParseState::kNeedsMoreData);
+  EXPECT_EQ(out, "pixie");
+  EXPECT_EQ(body, "");
+  EXPECT_EQ(state.chunked_phase, BodyDecoderState::ChunkedPhase::kChunkData);
+  EXPECT_EQ(state.bytes_remaining, 4);
+}
+
+TEST(StreamParseChunkedTest, UnexpectedTerminatorInData) {
+  std::string_view body =
+      "9\r\n"
+      "pixielabs!!";
+
+  BodyDecoderState state;
+  std::string out;
+  size_t body_size = 0;
+  ParseState result = StreamParseChunked(&body, kBodySizeLimitBytes, &state, &out, &body_size);
+
+  EXPECT_EQ(result, ParseState::kInvalid);
+}
+
+TEST(StreamParseContentTest, Basic) {
+  BodyDecoderState state;
+  state.bytes_remaining = 10;
+  std::string out;
+  size_t body_size = 0;
+
+  std::string_view data = "01234";
+  EXPECT_EQ(StreamParseContent(&data, /*body_size_limit_bytes*/ 3, &state, &out, &body_size),
+            ParseState::kNeedsMoreData);
+  EXPECT_EQ(data, "");
+
+  data = "56789next";
+  EXPECT_EQ(StreamParseContent(&data, /*body_size_limit_bytes*/ 3, &state, &out, &body_size),
+            ParseState::kSuccess);
+  EXPECT_EQ(data, "next");
+  EXPECT_EQ(out, "012");
+  EXPECT_EQ(body_size, 10);
+}
+
 }  // namespace http
 }  // namespace protocols
 }  // namespace stirling
@@ -27,6 +27,10 @@
 
 DEFINE_int32(http_body_limit_bytes, 1024,
              "The amount of an HTTP body that will be returned on a parse");
+DEFINE_uint32(http_body_streaming_threshold_bytes, 16 * 1024,
+              "Incomplete HTTP bodies with at least this many bytes buffered are decoded "
+              "incrementally, so that their bytes are released from the buffer as they arrive. "
+              "A value of 0 disables incremental decoding.");
 
 namespace px {
 namespace stirling {
@@ -86,7 +90,73 @@ HeadersMap GetHTTPHeadersMap(const phr_header* headers, size_t num_headers) {
 
 }  // namespace pico_wrapper
 
-ParseState ParseRequestBody(std::string_view* buf, Message* result) {
+// Decodes as much of the body of the partial message as is available in buf.
+ParseState StreamParseBody(std::string_view* buf, PartialMessage* partial) {
+  Message& msg = partial->msg;
+  return partial->chunked ? StreamParseChunked(buf, FLAGS_http_body_limit_bytes,
+                                               &partial->body_decoder, &msg.body, &msg.body_size)
+                          : StreamParseContent(buf, FLAGS_http_body_limit_bytes,
+                                               &partial->body_decoder, &msg.body, &msg.body_size);
+}
+
+// Called when the body of a message is incomplete. If a large enough part of the body is already
+// buffered, switches to incremental decoding: the available bytes are consumed, and the message
+// is kept in the state until the rest of its body arrives. Otherwise, waits for more data.
+//
+// Small bodies are not streamed, because the complete message is then parsed from scratch,
+// which keeps corner cases such as responses to HEAD requests working.
+ParseState MaybeStreamParseBody(std::string_view* buf, bool chunked, Message* result,
+                                State* state) {
+  if (FLAGS_http_body_streaming_threshold_bytes == 0 ||
+      buf->size() < FLAGS_http_body_streaming_threshold_bytes) {
+    return ParseState::kNeedsMoreData;
+  }
+
+  PartialMessage partial;
+  partial.chunked = chunked;
+  if (!chunked) {
+    // Content-Length was already validated by ParseContent().
+    const auto content_length_iter = result->headers.find(kContentLength);
+    DCHECK(content_length_iter != result->headers.end());
+    if (!absl::SimpleAtoi(content_length_iter->second, &partial.body_decoder.bytes_remaining)) {
+      return ParseState::kInvalid;
+    }
+  }
+  partial.msg = std::move(*result);
+  partial.msg.body.clear();
+  partial.msg.body_size = 0;
+
+  ParseState s = StreamParseBody(buf, &partial);
+  if (s != ParseState::kNeedsMoreData) {
+    // A complete body would have been parsed without streaming, so this must be an invalid one.
+    DCHECK(s == ParseState::kInvalid);
+    return ParseState::kInvalid;
+  }
+
+  *state->partial_msg(partial.msg.type) = std::move(partial);
+  return ParseState::kIgnored;
+}
+
+// Continues incremental decoding of the body of a partial message.
+ParseState ContinueStreamParseBody(std::string_view* buf, std::optional<PartialMessage>* partial,
+                                   Message* result) {
+  const size_t orig_size = buf->size();
+  ParseState s = StreamParseBody(buf, &partial->value());
+  switch (s) {
+    case ParseState::kSuccess:
+      *result = std::move(partial->value().msg);
+      partial->reset();
+      return ParseState::kSuccess;
+    case ParseState::kNeedsMoreData:
+      // Report any progress as an ignored frame, so the consumed bytes are released.
+      return (buf->size() < orig_size) ? ParseState::kIgnored : ParseState::kNeedsMoreData;
+    default:
+      partial->reset();
+      return s;
+  }
+}
+
+ParseState ParseRequestBody(std::string_view* buf, Message* result, State* state) {
   // From https://tools.ietf.org/html/rfc7230:
   //  A sender MUST NOT send a Content-Length header field in any message
   //  that contains a Transfer-Encoding header field.
@@ -107,6 +177,9 @@ ParseState ParseRequestBody(std::string_view* buf, Message* result) {
     auto r = ParseContent(content_len_str, buf, FLAGS_http_body_limit_bytes, &result->body,
                           &result->body_size);
     DCHECK_LE(result->body.size(), FLAGS_http_body_limit_bytes);
+    if (r == ParseState::kNeedsMoreData) {
+      return MaybeStreamParseBody(buf, /*chunked*/ false, result, state);
+    }
     return r;
   }
 
@@ -116,6 +189,9 @@ ParseState ParseRequestBody(std::string_view* buf, Message* result) {
       transfer_encoding_iter->second == "chunked") {
     auto s = ParseChunked(buf, FLAGS_http_body_limit_bytes, &result->body, &result->body_size);
     DCHECK_LE(result->body.size(), FLAGS_http_body_limit_bytes);
+    if (s == ParseState::kNeedsMoreData) {
+      return MaybeStreamParseBody(buf, /*chunked*/ true, result, state);
+    }
     return s;
   }
 
@@ -157,6 +233,9 @@ ParseState ParseResponseBody(std::string_view* buf, Message* result, State* stat
     auto s = ParseContent(content_len_str, buf, FLAGS_http_body_limit_bytes, &result->body,
                           &result->body_size);
     DCHECK_LE(result->body.size(), FLAGS_http_body_limit_bytes);
+    if (s == ParseState::kNeedsMoreData) {
+      return MaybeStreamParseBody(buf, /*chunked*/ false, result, state);
+    }
     return s;
   }
 
@@ -166,6 +245,9 @@ ParseState ParseResponseBody(std::string_view* buf, Message* result, State* stat
       transfer_encoding_iter->second == "chunked") {
     auto s = ParseChunked(buf, FLAGS_http_body_limit_bytes, &result->body, &result->body_size);
     DCHECK_LE(result->body.size(), FLAGS_http_body_limit_bytes);
+    if (s == ParseState::kNeedsMoreData) {
+      return MaybeStreamParseBody(buf, /*chunked*/ true, result, state);
+    }
     return s;
   }
 
@@ -210,7 +292,7 @@ ParseState ParseResponseBody(std::string_view* buf, Message* result, State* stat
   return ParseState::kNeedsMoreData;
 }
 
-ParseState ParseRequest(std::string_view* buf, Message* result) {
+ParseState ParseRequest(std::string_view* buf, Message* result, State* state) {
   pico_wrapper::HTTPRequest req;
   int retval = pico_wrapper::ParseRequest(*buf, &req);
 
@@ -224,7 +306,7 @@ ParseState ParseRequest(std::string_view* buf, Message* result) {
     result->req_path = std::string(req.path, req.path_len);
     result->headers_byte_size = retval;
 
-    return ParseRequestBody(buf, result);
+    return ParseRequestBody(buf, result, state);
   }
   if (retval == -2) {
     return ParseState::kNeedsMoreData;
@@ -265,9 +347,14 @@ ParseState ParseResponse(std::string_view* buf, Message* result, State* state) {
  * @return parse state indicating how the parse progressed.
  */
 ParseState ParseFrame(message_type_t type, std::string_view* buf, Message* result, State* state) {
+  std::optional<PartialMessage>* partial = state->partial_msg(type);
+  if (partial->has_value()) {
+    return ContinueStreamParseBody(buf, partial, result);
+  }
+
   switch (type) {
     case message_type_t::kRequest:
-      return ParseRequest(buf, result);
+      return ParseRequest(buf, result, state);
     case message_type_t::kResponse:
       return ParseResponse(buf, result, state);
     default:
@@ -362,7 +449,12 @@ ParseState ParseFrame(message_type_t type, std::string_view* buf, http::Message*
 
 template <>
 size_t FindFrameBoundary<http::Message>(message_type_t type, std::string_view buf, size_t start_pos,
-                                        http::StateWrapper* /*state*/) {
+                                        http::StateWrapper* state) {
+  // Looking for a new frame boundary means the stream is being resynced,
+  // so any body that was being decoded can no longer be trusted.
+  if (state != nullptr) {
+    state->global.partial_msg(type)->reset();
+  }
   return http::FindFrameBoundary(type, buf, start_pos);
 }
 
@@ -25,6 +25,7 @@
 #include "src/stirling/source_connectors/socket_tracer/protocols/http/types.h"
 
 DECLARE_int32(http_body_limit_bytes);
+DECLARE_uint32(http_body_streaming_threshold_bytes);
 
 namespace px {
 namespace stirling {
@@ -333,6 +333,46 @@ TEST_F(HTTPParserTest, PartialBody) {
   EXPECT_THAT(parsed_messages, IsEmpty());
 }
 
+// A large incomplete body is decoded incrementally, so the buffered bytes are consumed
+// before the message is complete.
+TEST_F(HTTPParserTest, StreamedLargeBody) {
+  const uint32_t orig_threshold = FLAGS_http_body_streaming_threshold_bytes;
+  DEFER(FLAGS_http_body_streaming_threshold_bytes = orig_threshold);
+  FLAGS_http_body_streaming_threshold_bytes = 1024;
+
+  StateWrapper state{};
+  std::string headers =
+      "HTTP/1.1 200 OK\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n";
+  std::string body_part1 = absl::StrCat("1000\r\n", std::string(2048, 'x'));
+  std::string body_part2 = absl::StrCat(std::string(2048, 'y'), "\r\n0\r\n\r\n");
+
+  std::string data1 = absl::StrCat(headers, body_part1);
+
+  std::deque<Message> parsed_messages;
+  ParseResult result = ParseFramesLoop(message_type_t::kResponse, data1, &parsed_messages, &state);
+
+  EXPECT_EQ(ParseState::kIgnored, result.state);
+  EXPECT_EQ(data1.size(), result.end_position);
+  EXPECT_EQ(data1.size(), result.ignored_bytes);
+  EXPECT_EQ(0, result.frame_bytes);
+  EXPECT_THAT(parsed_messages, IsEmpty());
+  EXPECT_TRUE(state.global.partial_resp.has_value());
+
+  result = ParseFramesLoop(message_type_t::kResponse, body_part2, &parsed_messages, &state);
+
+  EXPECT_EQ(ParseState::kSuccess, result.state);
+  EXPECT_EQ(body_part2.size(), result.end_position);
+  EXPECT_EQ(body_part2.size(), result.frame_bytes);
+  EXPECT_EQ(0, result.ignored_bytes);
+  ASSERT_EQ(parsed_messages.size(), 1);
+  EXPECT_EQ(parsed_messages[0].resp_status, 200);
+  EXPECT_EQ(parsed_messages[0].body, std::string(FLAGS_http_body_limit_bytes, 'x'));
+  EXPECT_EQ(parsed_messages[0].body_size, 4096);
+  EXPECT_FALSE(state.global.partial_resp.has_value());
+}
+
 TEST_F(HTTPParserTest, Status101) {
   StateWrapper state{};
   std::string switch_protocol_msg =
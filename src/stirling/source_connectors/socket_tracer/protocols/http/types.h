@@ -19,10 +19,12 @@
 #pragma once
 
 #include <chrono>
+#include <optional>
 #include <string>
 
 #include "src/common/base/utils.h"
 #include "src/stirling/source_connectors/socket_tracer/protocols/common/event_parser.h"  // For FrameBase
+#include "src/stirling/source_connectors/socket_tracer/protocols/http/body_decoder.h"
 
 namespace px {
 namespace stirling {
@@ -100,8 +102,25 @@ struct Record {
   }
 };
 
+// A message whose headers have been parsed, but whose body is still being decoded.
+// Large bodies are decoded incrementally, so their bytes need not be held in the DataStream buffer.
+struct PartialMessage {
+  Message msg;
+  bool chunked = false;
+  BodyDecoderState body_decoder;
+};
+
 struct State {
   bool conn_closed = false;
+
+  // Messages with an in-progress body. A stream carries either requests or responses,
+  // so there is at most one of each.
+  std::optional<PartialMessage> partial_req;
+  std::optional<PartialMessage> partial_resp;
+
+  std::optional<PartialMessage>* partial_msg(message_type_t type) {
+    return (type == message_type_t::kRequest) ? &partial_req : &partial_resp;
+  }
 };
 
 struct StateWrapper {
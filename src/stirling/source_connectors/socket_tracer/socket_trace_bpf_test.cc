@@ -16,6 +16,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <arpa/inet.h>
 #include <fcntl.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -879,6 +880,52 @@ TEST_F(UDPSocketTraceBPFTest, NonBlockingRecv) {
   EXPECT_EQ(tracker->remote_endpoint().AddrStr(), "127.0.0.1");
 }
 
+// Tests that connections to an ignored remote port send neither data nor close events to
+// user-space, while their conn stats are still reported.
+TEST_F(SocketTraceBPFTest, IgnoredPortDataAndCloseNotTraced) {
+  using Stat = ConnTracker::StatKey;
+
+  ConfigureBPFCapture(kProtocolHTTP, kRoleClient | kRoleServer);
+
+  TCPSocket client;
+  TCPSocket server;
+
+  server.BindAndListen();
+  ASSERT_OK(source_->UpdateBPFIgnoredPort(ntohs(server.port()), true));
+
+  client.Connect(server);
+  auto server_endpoint = server.Accept();
+
+  ASSERT_TRUE(client.Write(kHTTPReqMsg1));
+  std::string msg;
+  ASSERT_TRUE(server_endpoint->Recv(&msg));
+
+  ASSERT_TRUE(server_endpoint->Send(kHTTPRespMsg1));
+  ASSERT_TRUE(client.Recv(&msg));
+
+  const int client_fd = client.sockfd();
+  client.Close();
+  server_endpoint->Close();
+
+  source_->PollPerfBuffers();
+
+  // The client connects to the ignored port, so only its conn stats reach user-space.
+  ASSERT_OK_AND_ASSIGN(ConnTracker * client_side_tracker,
+                       GetMutableConnTracker(getpid(), client_fd));
+  EXPECT_EQ(client_side_tracker->GetStat(Stat::kDataEventSent), 0);
+  EXPECT_EQ(client_side_tracker->GetStat(Stat::kDataEventRecv), 0);
+  EXPECT_TRUE(client_side_tracker->send_data().data_buffer().empty());
+  EXPECT_TRUE(client_side_tracker->recv_data().data_buffer().empty());
+  EXPECT_EQ(client_side_tracker->conn_stats().bytes_sent(), kHTTPReqMsg1.size());
+  EXPECT_EQ(client_side_tracker->conn_stats().bytes_recv(), kHTTPRespMsg1.size());
+  EXPECT_TRUE(client_side_tracker->conn_stats().closed());
+  // No close event was received, but the final conn stats event still retires the tracker.
+  EXPECT_FALSE(client_side_tracker->AllEventsReceived());
+  EXPECT_TRUE(client_side_tracker->IsZombie());
+
+  ASSERT_OK(source_->UpdateBPFIgnoredPort(ntohs(server.port()), false));
+}
+
 class SocketTraceServerSideBPFTest
     : public testing::SocketTraceBPFTestFixture</* TClientSideTracing */ false> {};
 
@@ -18,15 +18,20 @@
 
 #include "src/stirling/source_connectors/socket_tracer/socket_trace_connector.h"
 
+#include <arpa/inet.h>
 #include <sys/sysinfo.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include <filesystem>
+#include <limits>
 #include <utility>
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/strings/match.h>
+#include <absl/strings/ascii.h>
+#include <absl/strings/numbers.h>
+#include <absl/strings/str_split.h>
 #include <google/protobuf/text_format.h>
 #include <google/protobuf/util/delimited_message_util.h>
 #include <magic_enum.hpp>
@@ -97,6 +102,19 @@ DEFINE_int32(stirling_enable_mux_tracing,
 DEFINE_bool(stirling_disable_self_tracing, true,
             "If true, stirling will not trace and process syscalls made by itself.");
 
+DEFINE_uint32(stirling_socket_tracer_conn_sampling_rate, 1,
+              "Trace data for 1 in N connections. Sampled-out connections still report conn stats. "
+              "Values <= 1 trace all connections.");
+DEFINE_string(stirling_socket_tracer_protocol_sampling_rates, "",
+              "Comma-separated list of <protocol>:<N> pairs that override "
+              "stirling_socket_tracer_conn_sampling_rate for specific protocols. "
+              "Example: 'HTTP:10,DNS:2'.");
+DEFINE_string(stirling_socket_tracer_ignored_ports, "",
+              "Comma-separated list of remote ports whose connections are not data traced.");
+DEFINE_uint32(stirling_socket_tracer_max_msg_bytes, 0,
+              "If non-zero, the maximum number of bytes of each message sent from BPF to "
+              "user-space. The rest of the message is accounted for, but not copied.");
+
 // Assume a moderate default network bandwidth peak of 100MiB/s across socket connections for data.
 DEFINE_uint32(stirling_socket_tracer_target_data_bw_percpu, 100 * 1024 * 1024,
               "Target bytes/sec of data per CPU");
@@ -154,6 +172,42 @@ constexpr size_t kMaxHTTPHeadersBytes = 8192;
 // Protobuf printer will limit strings to this length.
 constexpr size_t kMaxPBStringLen = 64;
 
+StatusOr<absl::flat_hash_map<traffic_protocol_t, uint32_t>> ParseProtocolSamplingRates(
+    std::string_view str) {
+  absl::flat_hash_map<traffic_protocol_t, uint32_t> rates;
+  for (std::string_view entry : absl::StrSplit(str, ',', absl::SkipWhitespace())) {
+    std::vector<std::string_view> parts = absl::StrSplit(entry, ':');
+    if (parts.size() != 2) {
+      return error::InvalidArgument("Expected <protocol>:<rate>, got '$0'", entry);
+    }
+    std::string_view protocol_name = absl::StripAsciiWhitespace(parts[0]);
+    std::optional<traffic_protocol_t> protocol =
+        magic_enum::enum_cast<traffic_protocol_t>(absl::StrCat("kProtocol", protocol_name));
+    if (!protocol.has_value() || protocol.value() == kProtocolUnknown) {
+      return error::InvalidArgument("Unknown protocol '$0'", protocol_name);
+    }
+    uint32_t rate;
+    if (!absl::SimpleAtoi(parts[1], &rate)) {
+      return error::InvalidArgument("Invalid sampling rate '$0' for protocol $1", parts[1],
+                                    protocol_name);
+    }
+    rates[protocol.value()] = rate;
+  }
+  return rates;
+}
+
+StatusOr<std::vector<uint16_t>> ParsePortList(std::string_view str) {
+  std::vector<uint16_t> ports;
+  for (std::string_view entry : absl::StrSplit(str, ',', absl::SkipWhitespace())) {
+    uint32_t port;
+    if (!absl::SimpleAtoi(entry, &port) || port > std::numeric_limits<uint16_t>::max()) {
+      return error::InvalidArgument("Invalid port '$0'", entry);
+    }
+    ports.push_back(static_cast<uint16_t>(port));
+  }
+  return ports;
+}
+
 SocketTraceConnector::SocketTraceConnector(std::string_view source_name)
     : SourceConnector(source_name, kTables), conn_stats_(&conn_trackers_mgr_), uprobe_mgr_(this) {
   proc_parser_ = std::make_unique<system::ProcParser>(system::Config::GetInstance());
@@ -405,6 +459,8 @@ Status SocketTraceConnector::InitBPF() {
     }
   }
 
+  PL_RETURN_IF_ERROR(InitBPFSamplingPolicy());
+
   PL_RETURN_IF_ERROR(TestOnlySetTargetPID(FLAGS_test_only_socket_trace_target_pid));
   if (FLAGS_stirling_disable_self_tracing) {
     PL_RETURN_IF_ERROR(DisableSelfTracing());
@@ -416,6 +472,36 @@ Status SocketTraceConnector::InitBPF() {
   return Status::OK();
 }
 
+Status SocketTraceConnector::InitBPFSamplingPolicy() {
+  PL_RETURN_IF_ERROR(UpdateBPFConnSamplingRate(FLAGS_stirling_socket_tracer_conn_sampling_rate));
+  PL_RETURN_IF_ERROR(UpdateBPFMaxMsgBytes(FLAGS_stirling_socket_tracer_max_msg_bytes));
+
+  PL_ASSIGN_OR_RETURN(
+      auto protocol_rates,
+      ParseProtocolSamplingRates(FLAGS_stirling_socket_tracer_protocol_sampling_rates));
+  for (const auto& [protocol, rate] : protocol_rates) {
+    PL_RETURN_IF_ERROR(UpdateBPFProtocolSamplingRate(protocol, rate));
+  }
+
+  PL_ASSIGN_OR_RETURN(std::vector<uint16_t> ports,
+                      ParsePortList(FLAGS_stirling_socket_tracer_ignored_ports));
+  for (uint16_t port : ports) {
+    PL_RETURN_IF_ERROR(UpdateBPFIgnoredPort(port, true));
+  }
+
+  if (FLAGS_stirling_socket_tracer_conn_sampling_rate > 1 || !protocol_rates.empty() ||
+      !ports.empty() || FLAGS_stirling_socket_tracer_max_msg_bytes > 0) {
+    LOG(INFO) << absl::Substitute(
+        "Socket tracer sampling policy: default_rate=$0 protocol_rates=[$1] ignored_ports=[$2] "
+        "max_msg_bytes=$3",
+        FLAGS_stirling_socket_tracer_conn_sampling_rate,
+        FLAGS_stirling_socket_tracer_protocol_sampling_rates,
+        FLAGS_stirling_socket_tracer_ignored_ports, FLAGS_stirling_socket_tracer_max_msg_bytes);
+  }
+
+  return Status::OK();
+}
+
 Status SocketTraceConnector::InitImpl() {
   sampling_freq_mgr_.set_period(kSamplingPeriod);
   push_freq_mgr_.set_period(kPushPeriod);
@@ -574,6 +660,32 @@ void SocketTraceConnector::UpdateCommonState(ConnectorContext* ctx) {
   }
 }
 
+void SocketTraceConnector::AddSourceStatsImpl(SourceStatsRecord* record) {
+  const int64_t data_loss_events =
+      stats_.Get(StatKey::kLossSocketDataEvent) + stats_.Get(StatKey::kLossSocketControlEvent) +
+      stats_.Get(StatKey::kLossConnStatsEvent) + stats_.Get(StatKey::kLossMMapEvent) +
+      stats_.Get(StatKey::kLossHTTP2Event);
+  record->data_loss_events = data_loss_events - reported_data_loss_events_;
+  reported_data_loss_events_ = data_loss_events;
+
+  // Only protocols with activity since the last push are reported, e.g.:
+  // {"kProtocolHTTP":{"parse_errors":1,"records":20}}
+  std::map<std::string_view, std::map<std::string_view, int>> protocol_stats;
+  for (auto protocol : magic_enum::enum_values<traffic_protocol_t>()) {
+    const int64_t records = protocol_records_.Get(protocol);
+    const int64_t parse_errors = protocol_parse_errors_.Get(protocol);
+    if (records == 0 && parse_errors == 0) {
+      continue;
+    }
+    auto& stats = protocol_stats[magic_enum::enum_name(protocol)];
+    stats["records"] = records;
+    stats["parse_errors"] = parse_errors;
+    protocol_records_.Reset(protocol);
+    protocol_parse_errors_.Reset(protocol);
+  }
+  record->info = ToJSONString(protocol_stats);
+}
+
 void SocketTraceConnector::UpdateTrackerTraceLevel(ConnTracker* tracker) {
   if (pids_to_trace_.contains(tracker->conn_id().upid.pid)) {
     tracker->SetDebugTrace(2);
@@ -597,6 +709,7 @@ void SocketTraceConnector::TransferDataImpl(ConnectorContext* ctx,
 
   if ((sampling_freq_mgr_.count() + 1) % FLAGS_stirling_socket_tracer_stats_logging_ratio == 0) {
     conn_trackers_mgr_.ComputeProtocolStats();
+    conn_trackers_mgr_.ComputePoolStats();
     LOG(INFO) << "ConnTracker statistics: " << conn_trackers_mgr_.StatsString();
     LOG(INFO) << "SocketTracer statistics: " << stats_.Print();
   }
@@ -611,6 +724,13 @@ void SocketTraceConnector::TransferDataImpl(ConnectorContext* ctx,
 
   std::vector<CIDRBlock> cluster_cidrs = ctx->GetClusterCIDRs();
 
+  // Changes that apply to all trackers must also reach the idle ones, which are otherwise skipped.
+  if (trace_levels_changed_ || cluster_cidrs != cluster_cidrs_) {
+    conn_trackers_mgr_.VisitAllTrackers();
+    trace_levels_changed_ = false;
+    cluster_cidrs_ = cluster_cidrs;
+  }
+
   for (size_t i = 0; i < data_tables.size(); ++i) {
     DataTable* data_table = data_tables[i];
 
@@ -622,7 +742,8 @@ void SocketTraceConnector::TransferDataImpl(ConnectorContext* ctx,
     }
   }
 
-  for (const auto& conn_tracker : conn_trackers_mgr_.active_trackers()) {
+  // Only trackers with new events or pending work are visited; see TrackersToProcess().
+  for (ConnTracker* conn_tracker : conn_trackers_mgr_.TrackersToProcess(iteration_time_)) {
     const auto& transfer_spec = protocol_transfer_specs_[conn_tracker->protocol()];
 
     DataTable* data_table = nullptr;
@@ -655,9 +776,15 @@ void SocketTraceConnector::TransferDataImpl(ConnectorContext* ctx,
     }
 
     conn_tracker->IterationPostTick();
+    conn_trackers_mgr_.UpdateDataBufferMemUsage(conn_tracker);
+    conn_trackers_mgr_.ScheduleNextVisit(conn_tracker);
   }
 
+  // Cleanup above bounds each connection individually; this bounds the sum over all connections.
+  conn_trackers_mgr_.EnforceMemoryBudget(FLAGS_stirling_conn_trackers_max_buffer_bytes);
+
   // Once we've cleared all the debug trace levels for this pid, we can remove it from the list.
+  // All trackers were visited this iteration, since the disable triggered VisitAllTrackers().
   pids_to_trace_disable_.clear();
 }
 
@@ -668,6 +795,48 @@ Status SocketTraceConnector::UpdateBPFProtocolTraceRole(traffic_protocol_t proto
                                            &control_map_handle);
 }
 
+Status SocketTraceConnector::UpdateBPFConnSamplingRate(uint32_t rate) {
+  auto control_map_handle = GetPerCPUArrayTable<int64_t>(kControlValuesArrayName);
+  return bpf_tools::UpdatePerCPUArrayValue(kConnSamplingRateIndex, static_cast<int64_t>(rate),
+                                           &control_map_handle);
+}
+
+Status SocketTraceConnector::UpdateBPFProtocolSamplingRate(traffic_protocol_t protocol,
+                                                           uint32_t rate) {
+  auto rate_map_handle = GetPerCPUArrayTable<uint32_t>(kProtocolSamplingRateMapName);
+  return bpf_tools::UpdatePerCPUArrayValue(static_cast<int>(protocol), rate, &rate_map_handle);
+}
+
+Status SocketTraceConnector::UpdateBPFPIDSamplingRate(uint32_t pid, uint32_t rate) {
+  auto rate_map_handle = GetHashTable<uint32_t, uint32_t>(kPIDSamplingRateMapName);
+  ebpf::StatusTuple s =
+      (rate == 0) ? rate_map_handle.remove_value(pid) : rate_map_handle.update_value(pid, rate);
+  // Removing a non-existent override is not an error.
+  if (!s.ok() && rate != 0) {
+    return error::Internal("Failed to set sampling rate for pid=$0, error message: $1", pid,
+                           s.msg());
+  }
+  return Status::OK();
+}
+
+Status SocketTraceConnector::UpdateBPFIgnoredPort(uint16_t port, bool ignored) {
+  auto ports_map_handle = GetHashTable<uint16_t, bool>(kIgnoredPortsMapName);
+  // BPF compares against the port as stored in sockaddr, which is in network byte order.
+  const uint16_t key = htons(port);
+  ebpf::StatusTuple s =
+      ignored ? ports_map_handle.update_value(key, true) : ports_map_handle.remove_value(key);
+  if (!s.ok() && ignored) {
+    return error::Internal("Failed to ignore port $0, error message: $1", port, s.msg());
+  }
+  return Status::OK();
+}
+
+Status SocketTraceConnector::UpdateBPFMaxMsgBytes(uint32_t max_msg_bytes) {
+  auto control_map_handle = GetPerCPUArrayTable<int64_t>(kControlValuesArrayName);
+  return bpf_tools::UpdatePerCPUArrayValue(
+      kMaxMsgBytesIndex, static_cast<int64_t>(max_msg_bytes), &control_map_handle);
+}
+
 Status SocketTraceConnector::TestOnlySetTargetPID(int64_t pid) {
   if (pid != kTraceAllTGIDs) {
     LOG(WARNING) << absl::Substitute(
@@ -1265,7 +1434,12 @@ void SocketTraceConnector::TransferStream(ConnectorContext* ctx, ConnTracker* tr
   if (data_table != nullptr && tracker->state() == ConnTracker::State::kTransferring) {
     // ProcessToRecords() parses raw events and produces messages in format that are expected by
     // table store. But those messages are not cached inside ConnTracker.
+    const int64_t prev_parse_errors = tracker->GetStat(ConnTracker::StatKey::kInvalidRecords);
     auto records = tracker->ProcessToRecords<TProtocolTraits>();
+    const int64_t parse_errors =
+        tracker->GetStat(ConnTracker::StatKey::kInvalidRecords) - prev_parse_errors;
+    protocol_records_.Increment(tracker->protocol(), records.size());
+    protocol_parse_errors_.Increment(tracker->protocol(), parse_errors);
     for (auto& record : records) {
       TProtocolTraits::ConvertTimestamps(
           &record, [&](uint64_t mono_time) { return ConvertToRealTime(mono_time); });
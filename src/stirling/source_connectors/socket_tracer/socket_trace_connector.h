@@ -63,6 +63,11 @@ DECLARE_int32(stirling_enable_mux_tracing);
 DECLARE_bool(stirling_disable_self_tracing);
 DECLARE_string(stirling_role_to_trace);
 
+DECLARE_uint32(stirling_socket_tracer_conn_sampling_rate);
+DECLARE_string(stirling_socket_tracer_protocol_sampling_rates);
+DECLARE_string(stirling_socket_tracer_ignored_ports);
+DECLARE_uint32(stirling_socket_tracer_max_msg_bytes);
+
 DECLARE_uint32(stirling_socket_tracer_target_data_bw_percpu);
 DECLARE_uint32(stirling_socket_tracer_target_control_bw_percpu);
 
@@ -76,6 +81,18 @@ DECLARE_uint64(max_body_bytes);
 namespace px {
 namespace stirling {
 
+/**
+ * Parses a comma-separated list of <protocol>:<rate> pairs (e.g. "HTTP:10,DNS:2"),
+ * where protocol is a traffic_protocol_t name without the kProtocol prefix.
+ */
+StatusOr<absl::flat_hash_map<traffic_protocol_t, uint32_t>> ParseProtocolSamplingRates(
+    std::string_view str);
+
+/**
+ * Parses a comma-separated list of port numbers (e.g. "9090,9091").
+ */
+StatusOr<std::vector<uint16_t>> ParsePortList(std::string_view str);
+
 // Whether the protocol traced is turned on, off, or on but only for newer kernels.
 enum TraceMode : int32_t {
   Off = 0,
@@ -113,6 +130,7 @@ class SocketTraceConnector : public SourceConnector, public bpf_tools::BCCWrappe
   Status StopImpl() override;
   void InitContextImpl(ConnectorContext* ctx) override;
   void TransferDataImpl(ConnectorContext* ctx, const std::vector<DataTable*>& data_tables) override;
+  void AddSourceStatsImpl(SourceStatsRecord* record) override;
 
   // Perform actions that are not specifically targeting a table.
   // For example, drain perf buffers, deploy new uprobes, and update socket info manager.
@@ -127,12 +145,36 @@ class SocketTraceConnector : public SourceConnector, public bpf_tools::BCCWrappe
   // Role_mask a bit mask, and represents the endpoint_role_t roles that are allowed to transfer
   // data from inside BPF to user-space.
   Status UpdateBPFProtocolTraceRole(traffic_protocol_t protocol, uint64_t role_mask);
+
+  // Updates the in-kernel sampling and filtering policy. Sampling decisions are made once per
+  // connection when its protocol is inferred; sampled-out connections still report conn stats.
+  // These can be called at any time to update the policy of a live BPF program.
+
+  // Sets the default rate: data is traced for 1 in `rate` connections.
+  Status UpdateBPFConnSamplingRate(uint32_t rate);
+  // Overrides the default rate for a protocol. A rate of 0 removes the override.
+  Status UpdateBPFProtocolSamplingRate(traffic_protocol_t protocol, uint32_t rate);
+  // Overrides the protocol and default rates for a process. A rate of 0 removes the override.
+  // The caller is responsible for removing the override when the process terminates.
+  Status UpdateBPFPIDSamplingRate(uint32_t pid, uint32_t rate);
+  // Disables data tracing of connections to/from the given remote port.
+  // Only applies to connections opened after the update.
+  Status UpdateBPFIgnoredPort(uint16_t port, bool ignored);
+  // Limits the bytes of each message sent to user-space. A value of 0 means no limit.
+  Status UpdateBPFMaxMsgBytes(uint32_t max_msg_bytes);
+
   Status TestOnlySetTargetPID(int64_t pid);
   Status DisableSelfTracing();
 
+  void EnablePIDTrace(int pid) override {
+    SourceConnector::EnablePIDTrace(pid);
+    trace_levels_changed_ = true;
+  }
+
   void DisablePIDTrace(int pid) override {
     SourceConnector::DisablePIDTrace(pid);
     pids_to_trace_disable_.insert(pid);
+    trace_levels_changed_ = true;
   }
 
   /**
@@ -165,6 +207,7 @@ class SocketTraceConnector : public SourceConnector, public bpf_tools::BCCWrappe
   explicit SocketTraceConnector(std::string_view source_name);
 
   Status InitBPF();
+  Status InitBPFSamplingPolicy();
   auto InitPerfBufferSpecs();
   void InitProtocolTransferSpecs();
 
@@ -207,6 +250,11 @@ class SocketTraceConnector : public SourceConnector, public bpf_tools::BCCWrappe
 
   absl::flat_hash_set<int> pids_to_trace_disable_;
 
+  // Idle trackers are not visited every iteration, so changes to the debug trace levels or to the
+  // cluster CIDRs trigger a visit of all trackers, to apply them to all trackers.
+  bool trace_levels_changed_ = false;
+  std::vector<CIDRBlock> cluster_cidrs_;
+
   std::function<std::chrono::steady_clock::time_point()> now_fn_ = std::chrono::steady_clock::now;
 
   struct TransferSpec {
@@ -274,6 +322,14 @@ class SocketTraceConnector : public SourceConnector, public bpf_tools::BCCWrappe
 
   utils::StatCounter<StatKey> stats_;
 
+  // Per-protocol count of records and parse errors since the last push,
+  // reported in the stirling_source_stats table.
+  utils::StatCounter<traffic_protocol_t> protocol_records_;
+  utils::StatCounter<traffic_protocol_t> protocol_parse_errors_;
+
+  // Total perf buffer losses as of the last push.
+  int64_t reported_data_loss_events_ = 0;
+
   friend class SocketTraceConnectorFriend;
   friend class SocketTraceBPFTest;
 };
@@ -934,5 +934,26 @@ TEST_F(SocketTraceConnectorTest, UntrackedUPIDDoesNotTransferData) {
   ASSERT_TRUE(http_table_->ConsumeRecords().empty());
 }
 
+TEST(ParseProtocolSamplingRatesTest, Basic) {
+  ASSERT_OK_AND_ASSIGN(auto rates, ParseProtocolSamplingRates("HTTP:10, DNS:2"));
+  EXPECT_THAT(rates, ::testing::UnorderedElementsAre(::testing::Pair(kProtocolHTTP, 10),
+                                                     ::testing::Pair(kProtocolDNS, 2)));
+
+  ASSERT_OK_AND_ASSIGN(rates, ParseProtocolSamplingRates(""));
+  EXPECT_TRUE(rates.empty());
+
+  EXPECT_NOT_OK(ParseProtocolSamplingRates("HTTP"));
+  EXPECT_NOT_OK(ParseProtocolSamplingRates("Gopher:10"));
+  EXPECT_NOT_OK(ParseProtocolSamplingRates("Unknown:10"));
+  EXPECT_NOT_OK(ParseProtocolSamplingRates("HTTP:ten"));
+}
+
+TEST(ParsePortListTest, Basic) {
+  EXPECT_OK_AND_THAT(ParsePortList("80, 9090"), ElementsAre(80, 9090));
+  EXPECT_OK_AND_THAT(ParsePortList(""), ::testing::IsEmpty());
+  EXPECT_NOT_OK(ParsePortList("65536"));
+  EXPECT_NOT_OK(ParsePortList("http"));
+}
+
 }  // namespace stirling
 }  // namespace px
@@ -47,6 +47,9 @@ class SocketTraceBPFTestFixture : public ::testing::Test {
     //               Change this paradigm.
     FLAGS_treat_loopback_as_in_cluster = !TEnableClientSideTracing;
 
+    // Tests exercise their servers right after launching them, so deploy uprobes immediately.
+    FLAGS_stirling_uprobe_min_process_age_ms = 0;
+
     auto source_connector = SocketTraceConnector::Create("socket_trace_connector");
 
     source_.reset(dynamic_cast<SocketTraceConnector*>(source_connector.release()));
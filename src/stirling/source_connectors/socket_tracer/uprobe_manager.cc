@@ -22,25 +22,40 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
 #include <filesystem>
+#include <functional>
 #include <map>
+#include <thread>
 
 #include "src/common/base/base.h"
 #include "src/common/base/utils.h"
 #include "src/common/exec/subprocess.h"
 #include "src/common/fs/fs_wrapper.h"
+#include "src/common/system/clock.h"
+#include "src/common/system/config.h"
 #include "src/stirling/bpf_tools/macros.h"
 #include "src/stirling/obj_tools/dwarf_reader.h"
 #include "src/stirling/obj_tools/go_syms.h"
 #include "src/stirling/source_connectors/socket_tracer/bcc_bpf_intf/symaddrs.h"
+#include "src/stirling/source_connectors/socket_tracer/metrics.h"
 #include "src/stirling/utils/proc_path_tools.h"
 
+// NOLINTNEXTLINE: build/include_subdir
+#include "xxhash.h"
+
 DEFINE_bool(stirling_rescan_for_dlopen, false,
             "If enabled, Stirling will use mmap tracing information to rescan binaries for delay "
             "loaded libraries like OpenSSL");
 DEFINE_double(stirling_rescan_exp_backoff_factor, 2.0,
               "Exponential backoff factor used in decided how often to rescan binaries for "
               "dynamically loaded libraries");
+DEFINE_int32(stirling_uprobe_analysis_threads, 4,
+             "Number of threads used to analyze new binaries for uprobe deployment. Each thread "
+             "may hold the debug symbols of one binary in memory.");
+DEFINE_int32(stirling_uprobe_min_process_age_ms, 1000,
+             "Minimum age of a process before uprobes are deployed to it. Deferring new processes "
+             "avoids spending CPU on attaching uprobes to short-lived processes (e.g. cronjobs).");
 
 namespace px {
 namespace stirling {
@@ -48,7 +63,9 @@ namespace stirling {
 using ::px::stirling::obj_tools::DwarfReader;
 using ::px::stirling::obj_tools::ElfReader;
 
-UProbeManager::UProbeManager(bpf_tools::BCCWrapper* bcc) : bcc_(bcc) {
+UProbeManager::UProbeManager(bpf_tools::BCCWrapper* bcc)
+    : bcc_(bcc),
+      go_analysis_cache_(FLAGS_stirling_uprobe_analysis_cache_dir, GoUProbeTmplsFingerprint()) {
   proc_parser_ = std::make_unique<system::ProcParser>(system::Config::GetInstance());
 }
 
@@ -85,14 +102,13 @@ Status UProbeManager::LogAndAttachUProbe(const bpf_tools::UProbeSpec& spec) {
   return s;
 }
 
-StatusOr<int> UProbeManager::AttachUProbeTmpl(const ArrayView<UProbeTmpl>& probe_tmpls,
-                                              const std::string& binary,
-                                              obj_tools::ElfReader* elf_reader) {
+StatusOr<std::vector<bpf_tools::UProbeSpec>> UProbeManager::ExpandUProbeTmpl(
+    const ArrayView<UProbeTmpl>& probe_tmpls, obj_tools::ElfReader* elf_reader) {
   using bpf_tools::BPFProbeAttachType;
 
-  int uprobe_count = 0;
+  std::vector<bpf_tools::UProbeSpec> specs;
   for (const auto& tmpl : probe_tmpls) {
-    bpf_tools::UProbeSpec spec = {binary,
+    bpf_tools::UProbeSpec spec = {/*binary_path*/ {},
                                   /*symbol*/ {},
                                   /*address*/ 0,    bpf_tools::UProbeSpec::kDefaultPID,
                                   tmpl.attach_type, std::string(tmpl.probe_fn)};
@@ -111,8 +127,7 @@ StatusOr<int> UProbeManager::AttachUProbeTmpl(const ArrayView<UProbeTmpl>& probe
         case BPFProbeAttachType::kEntry:
         case BPFProbeAttachType::kReturn: {
           spec.symbol = symbol_info.name;
-          PL_RETURN_IF_ERROR(LogAndAttachUProbe(spec));
-          ++uprobe_count;
+          specs.push_back(spec);
           break;
         }
         case BPFProbeAttachType::kReturnInsts: {
@@ -129,8 +144,7 @@ StatusOr<int> UProbeManager::AttachUProbeTmpl(const ArrayView<UProbeTmpl>& probe
           for (const uint64_t& addr : ret_inst_addrs) {
             spec.attach_type = BPFProbeAttachType::kEntry;
             spec.address = addr;
-            PL_RETURN_IF_ERROR(LogAndAttachUProbe(spec));
-            ++uprobe_count;
+            specs.push_back(spec);
           }
           break;
         }
@@ -139,9 +153,33 @@ StatusOr<int> UProbeManager::AttachUProbeTmpl(const ArrayView<UProbeTmpl>& probe
       }
     }
   }
+  return specs;
+}
+
+StatusOr<int> UProbeManager::AttachUProbes(const std::vector<bpf_tools::UProbeSpec>& specs,
+                                           const std::string& binary) {
+  std::vector<bpf_tools::UProbeSpec> binary_specs = specs;
+  for (bpf_tools::UProbeSpec& spec : binary_specs) {
+    spec.binary_path = binary;
+  }
+
+  int uprobe_count = 0;
+  for (const bpf_tools::UProbeSpec& spec :
+       bpf_tools::BCCWrapper::ResolveUProbeSymbols(ToArrayView(binary_specs))) {
+    PL_RETURN_IF_ERROR(LogAndAttachUProbe(spec));
+    ++uprobe_count;
+  }
   return uprobe_count;
 }
 
+StatusOr<int> UProbeManager::AttachUProbeTmpl(const ArrayView<UProbeTmpl>& probe_tmpls,
+                                              const std::string& binary,
+                                              obj_tools::ElfReader* elf_reader) {
+  PL_ASSIGN_OR_RETURN(std::vector<bpf_tools::UProbeSpec> specs,
+                      ExpandUProbeTmpl(probe_tmpls, elf_reader));
+  return AttachUProbes(specs, binary);
+}
+
 Status UProbeManager::UpdateOpenSSLSymAddrs(RawFptrManager* fptr_manager,
                                             std::filesystem::path libcrypto_path, uint32_t pid) {
   PL_ASSIGN_OR_RETURN(struct openssl_symaddrs_t symaddrs,
@@ -152,39 +190,25 @@ Status UProbeManager::UpdateOpenSSLSymAddrs(RawFptrManager* fptr_manager,
   return Status::OK();
 }
 
-Status UProbeManager::UpdateGoCommonSymAddrs(ElfReader* elf_reader, DwarfReader* dwarf_reader,
-                                             const std::vector<int32_t>& pids) {
-  PL_ASSIGN_OR_RETURN(struct go_common_symaddrs_t symaddrs,
-                      GoCommonSymAddrs(elf_reader, dwarf_reader));
-
+void UProbeManager::UpdateGoCommonSymAddrs(const struct go_common_symaddrs_t& symaddrs,
+                                           const std::vector<int32_t>& pids) {
   for (auto& pid : pids) {
     go_common_symaddrs_map_->UpdateValue(pid, symaddrs);
   }
-
-  return Status::OK();
 }
 
-Status UProbeManager::UpdateGoHTTP2SymAddrs(ElfReader* elf_reader, DwarfReader* dwarf_reader,
-                                            const std::vector<int32_t>& pids) {
-  PL_ASSIGN_OR_RETURN(struct go_http2_symaddrs_t symaddrs,
-                      GoHTTP2SymAddrs(elf_reader, dwarf_reader));
-
+void UProbeManager::UpdateGoHTTP2SymAddrs(const struct go_http2_symaddrs_t& symaddrs,
+                                          const std::vector<int32_t>& pids) {
   for (auto& pid : pids) {
     go_http2_symaddrs_map_->UpdateValue(pid, symaddrs);
   }
-
-  return Status::OK();
 }
 
-Status UProbeManager::UpdateGoTLSSymAddrs(ElfReader* elf_reader, DwarfReader* dwarf_reader,
-                                          const std::vector<int32_t>& pids) {
-  PL_ASSIGN_OR_RETURN(struct go_tls_symaddrs_t symaddrs, GoTLSSymAddrs(elf_reader, dwarf_reader));
-
+void UProbeManager::UpdateGoTLSSymAddrs(const struct go_tls_symaddrs_t& symaddrs,
+                                        const std::vector<int32_t>& pids) {
   for (auto& pid : pids) {
     go_tls_symaddrs_map_->UpdateValue(pid, symaddrs);
   }
-
-  return Status::OK();
 }
 
 Status UProbeManager::UpdateNodeTLSWrapSymAddrs(int32_t pid, const std::filesystem::path& node_exe,
@@ -404,9 +428,7 @@ void UProbeManager::SetupGOIDMaps(const std::string& binary, const std::vector<i
 }
 
 StatusOr<int> UProbeManager::AttachGoRuntimeUProbes(const std::string& binary,
-                                                    obj_tools::ElfReader* elf_reader,
-                                                    obj_tools::DwarfReader* /* dwarf_reader */,
-                                                    const std::vector<int32_t>& /* pids */) {
+                                                    const GoUProbeAnalysis& analysis) {
   // Step 1: Update BPF symbols_map on all new PIDs.
   // TODO(oazizi): Implement this piece.
 
@@ -416,21 +438,20 @@ StatusOr<int> UProbeManager::AttachGoRuntimeUProbes(const std::string& binary,
     // This is not a new binary, so nothing more to do.
     return 0;
   }
-  return AttachUProbeTmpl(kGoRuntimeUProbeTmpls, binary, elf_reader);
+  return AttachUProbes(analysis.runtime_uprobes, binary);
 }
 
 StatusOr<int> UProbeManager::AttachGoTLSUProbes(const std::string& binary,
-                                                obj_tools::ElfReader* elf_reader,
-                                                obj_tools::DwarfReader* dwarf_reader,
+                                                const GoUProbeAnalysis& analysis,
                                                 const std::vector<int32_t>& pids) {
   // Step 1: Update BPF symbols_map on all new PIDs.
-  Status s = UpdateGoTLSSymAddrs(elf_reader, dwarf_reader, pids);
-  if (!s.ok()) {
+  if (!analysis.tls_symaddrs.has_value()) {
     // Doesn't appear to be a binary with the mandatory symbols.
     // Might not even be a golang binary.
     // Either way, not of interest to probe.
     return 0;
   }
+  UpdateGoTLSSymAddrs(analysis.tls_symaddrs.value(), pids);
 
   // Step 2: Deploy uprobes on all new binaries.
   auto result = go_tls_probed_binaries_.insert(binary);
@@ -438,7 +459,7 @@ StatusOr<int> UProbeManager::AttachGoTLSUProbes(const std::string& binary,
     // This is not a new binary, so nothing more to do.
     return 0;
   }
-  return AttachUProbeTmpl(kGoTLSUProbeTmpls, binary, elf_reader);
+  return AttachUProbes(analysis.tls_uprobes, binary);
 }
 
 // TODO(oazizi/yzhao): Should HTTP uprobes use a different set of perf buffers than the kprobes?
@@ -446,14 +467,13 @@ StatusOr<int> UProbeManager::AttachGoTLSUProbes(const std::string& binary,
 // cleanly. For example, right now, enabling uprobe & kprobe simultaneously can crash Stirling,
 // because of the mixed & duplicate data events from these 2 sources.
 StatusOr<int> UProbeManager::AttachGoHTTP2Probes(const std::string& binary,
-                                                 obj_tools::ElfReader* elf_reader,
-                                                 obj_tools::DwarfReader* dwarf_reader,
+                                                 const GoUProbeAnalysis& analysis,
                                                  const std::vector<int32_t>& pids) {
   // Step 1: Update BPF symaddrs for this binary.
-  Status s = UpdateGoHTTP2SymAddrs(elf_reader, dwarf_reader, pids);
-  if (!s.ok()) {
+  if (!analysis.http2_symaddrs.has_value()) {
     return 0;
   }
+  UpdateGoHTTP2SymAddrs(analysis.http2_symaddrs.value(), pids);
 
   // Step 2: Deploy uprobes on all new binaries.
   auto result = go_http2_probed_binaries_.insert(binary);
@@ -461,7 +481,7 @@ StatusOr<int> UProbeManager::AttachGoHTTP2Probes(const std::string& binary,
     // This is not a new binary, so nothing more to do.
     return 0;
   }
-  return AttachUProbeTmpl(kHTTP2ProbeTmpls, binary, elf_reader);
+  return AttachUProbes(analysis.http2_uprobes, binary);
 }
 
 namespace {
@@ -566,105 +586,282 @@ int UProbeManager::DeployOpenSSLUProbes(const absl::flat_hash_set<md::UPID>& pid
   return uprobe_count;
 }
 
-int UProbeManager::DeployGoUProbes(const absl::flat_hash_set<md::UPID>& pids) {
-  int uprobe_count = 0;
-
-  static int32_t kPID = getpid();
+namespace {
 
-  for (const auto& [binary, pid_vec] : ConvertPIDsListToMap(pids, &fp_resolver_)) {
-    // Don't bother rescanning binaries that have been scanned before to avoid unnecessary work.
-    if (!scanned_binaries_.insert(binary).second) {
-      continue;
+// Runs fn(i) for i in [0, n), on at most max_threads threads.
+void ParallelFor(size_t n, int max_threads, const std::function<void(size_t)>& fn) {
+  const size_t num_threads = std::min<size_t>(n, std::max(max_threads, 1));
+  if (num_threads <= 1) {
+    for (size_t i = 0; i < n; ++i) {
+      fn(i);
     }
+    return;
+  }
 
-    if (cfg_disable_self_probing_) {
-      // Don't try to attach uprobes to self.
-      // This speeds up stirling_wrapper initialization significantly.
-      if (pid_vec.size() == 1 && pid_vec[0] == kPID) {
-        continue;
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&]() {
+      for (size_t i = next++; i < n; i = next++) {
+        fn(i);
       }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace
+
+std::string UProbeManager::GoUProbeTmplsFingerprint() {
+  XXH64_state_t* state = XXH64_createState();
+  DEFER(XXH64_freeState(state));
+  XXH64_reset(state, /*seed*/ 0);
+
+  auto update = [state](const ArrayView<UProbeTmpl>& probe_tmpls) {
+    for (const auto& tmpl : probe_tmpls) {
+      // Each string is followed by a null, so that adjacent fields cannot run together.
+      XXH64_update(state, tmpl.symbol.data(), tmpl.symbol.size());
+      XXH64_update(state, "", 1);
+      XXH64_update(state, tmpl.probe_fn.data(), tmpl.probe_fn.size());
+      XXH64_update(state, "", 1);
+      const uint32_t types[] = {static_cast<uint32_t>(tmpl.match_type),
+                                static_cast<uint32_t>(tmpl.attach_type)};
+      XXH64_update(state, types, sizeof(types));
     }
+    // Separates the template groups, since they are analyzed separately.
+    XXH64_update(state, "", 1);
+  };
+  update(kGoRuntimeUProbeTmpls);
+  update(kGoTLSUProbeTmpls);
+  update(kHTTP2ProbeTmpls);
+
+  return absl::StrCat(absl::Hex(XXH64_digest(state), absl::kZeroPad16));
+}
+
+StatusOr<std::string> UProbeManager::GoBinaryKey(const std::string& binary) const {
+  PL_ASSIGN_OR_RETURN(std::unique_ptr<ElfReader> elf_reader, ElfReader::Create(binary));
+  if (!IsGoExecutable(elf_reader.get())) {
+    return error::NotFound("$0 is not a Go binary.", binary);
+  }
+  return go_analysis_cache_.BinaryKey(binary);
+}
+
+StatusOr<GoUProbeAnalysis> UProbeManager::AnalyzeGoBinary(const std::string& binary) {
+  GoUProbeAnalysis analysis;
+
+  // Read binary's symbols.
+  PL_ASSIGN_OR_RETURN(std::unique_ptr<ElfReader> elf_reader, ElfReader::Create(binary));
+
+  // A failure to expand a group of probes only drops that group.
+  auto expand_tmpl = [&binary, &elf_reader](const ArrayView<UProbeTmpl>& probe_tmpls) {
+    StatusOr<std::vector<bpf_tools::UProbeSpec>> specs_status =
+        ExpandUProbeTmpl(probe_tmpls, elf_reader.get());
+    if (!specs_status.ok()) {
+      LOG_FIRST_N(WARNING, 10) << absl::Substitute("Failed to find uprobe targets in $0: $1",
+                                                   binary, specs_status.ToString());
+      return std::vector<bpf_tools::UProbeSpec>{};
+    }
+    return specs_status.ConsumeValueOrDie();
+  };
+
+  // Avoid going past this point if not a golang program.
+  // The DwarfReader is memory intensive, and the remaining probes are Golang specific.
+  if (!IsGoExecutable(elf_reader.get())) {
+    return analysis;
+  }
+
+  StatusOr<std::unique_ptr<DwarfReader>> dwarf_reader_status =
+      DwarfReader::CreateIndexingAll(binary);
+  if (!dwarf_reader_status.ok()) {
+    VLOG(1) << absl::Substitute(
+        "Failed to get binary $0 debug symbols. Cannot deploy uprobes. "
+        "Message = $1",
+        binary, dwarf_reader_status.msg());
+    return analysis;
+  }
+  std::unique_ptr<DwarfReader> dwarf_reader = dwarf_reader_status.ConsumeValueOrDie();
+
+  StatusOr<struct go_common_symaddrs_t> common_symaddrs =
+      GoCommonSymAddrs(elf_reader.get(), dwarf_reader.get());
+  if (!common_symaddrs.ok()) {
+    VLOG(1) << absl::Substitute(
+        "Golang binary $0 does not have the mandatory symbols (e.g. TCPConn).", binary);
+    return analysis;
+  }
+  analysis.probeable = true;
+  analysis.common_symaddrs = common_symaddrs.ConsumeValueOrDie();
+
+  // Go Runtime Probes.
+  analysis.runtime_uprobes = expand_tmpl(kGoRuntimeUProbeTmpls);
+
+  // GoTLS Probes.
+  StatusOr<struct go_tls_symaddrs_t> tls_symaddrs =
+      GoTLSSymAddrs(elf_reader.get(), dwarf_reader.get());
+  if (tls_symaddrs.ok()) {
+    analysis.tls_symaddrs = tls_symaddrs.ConsumeValueOrDie();
+    analysis.tls_uprobes = expand_tmpl(kGoTLSUProbeTmpls);
+  }
 
-    // Read binary's symbols.
-    StatusOr<std::unique_ptr<ElfReader>> elf_reader_status = ElfReader::Create(binary);
-    if (!elf_reader_status.ok()) {
+  // Go HTTP2 Probes.
+  // These are computed even when HTTP2 tracing is disabled, so that cached analyses
+  // do not depend on the configuration.
+  StatusOr<struct go_http2_symaddrs_t> http2_symaddrs =
+      GoHTTP2SymAddrs(elf_reader.get(), dwarf_reader.get());
+  if (http2_symaddrs.ok()) {
+    analysis.http2_symaddrs = http2_symaddrs.ConsumeValueOrDie();
+    analysis.http2_uprobes = expand_tmpl(kHTTP2ProbeTmpls);
+  }
+
+  return analysis;
+}
+
+void UProbeManager::AnalyzeGoBinaries(
+    const absl::flat_hash_map<std::string, std::string>& binaries) {
+  std::vector<std::pair<std::string, std::string>> work(binaries.begin(), binaries.end());
+  std::vector<StatusOr<GoUProbeAnalysis>> results(work.size(), error::Internal("Not analyzed."));
+
+  // Analysis only reads the binaries, so it runs in parallel.
+  // The results are recorded (and the probes attached) sequentially, since neither the cache
+  // nor BCC are thread-safe.
+  ParallelFor(work.size(), FLAGS_stirling_uprobe_analysis_threads,
+              [&work, &results](size_t i) { results[i] = AnalyzeGoBinary(work[i].second); });
+
+  for (size_t i = 0; i < work.size(); ++i) {
+    const auto& [key, binary] = work[i];
+    if (!results[i].ok()) {
       LOG(WARNING) << absl::Substitute(
           "Cannot analyze binary $0 for uprobe deployment. "
           "If file is under /var/lib, container may have terminated. "
           "Message = $1",
-          binary, elf_reader_status.msg());
+          binary, results[i].msg());
       continue;
     }
-    std::unique_ptr<ElfReader> elf_reader = elf_reader_status.ConsumeValueOrDie();
+    go_analysis_cache_.Insert(
+        key, std::make_shared<const GoUProbeAnalysis>(results[i].ConsumeValueOrDie()));
+  }
+}
 
-    // Avoid going past this point if not a golang program.
-    // The DwarfReader is memory intensive, and the remaining probes are Golang specific.
-    if (!IsGoExecutable(elf_reader.get())) {
-      continue;
+int UProbeManager::DeployGoUProbes(const std::string& binary, const GoUProbeAnalysis& analysis,
+                                   const std::vector<int32_t>& pids) {
+  int uprobe_count = 0;
+
+  UpdateGoCommonSymAddrs(analysis.common_symaddrs, pids);
+
+  // Setup thread to GOID mapping.
+  SetupGOIDMaps(binary, pids);
+
+  // Go Runtime Probes.
+  {
+    StatusOr<int> attach_status = AttachGoRuntimeUProbes(binary, analysis);
+    if (!attach_status.ok()) {
+      monitor_.AppendSourceStatusRecord("socket_tracer", attach_status.status(),
+                                        "AttachGoRuntimeUProbes");
+      LOG_FIRST_N(WARNING, 10) << absl::Substitute("Failed to attach Go Runtime Uprobes to $0: $1",
+                                                   binary, attach_status.ToString());
+    } else {
+      uprobe_count += attach_status.ValueOrDie();
     }
+  }
 
-    StatusOr<std::unique_ptr<DwarfReader>> dwarf_reader_status =
-        DwarfReader::CreateIndexingAll(binary);
-    if (!dwarf_reader_status.ok()) {
-      VLOG(1) << absl::Substitute(
-          "Failed to get binary $0 debug symbols. Cannot deploy uprobes. "
-          "Message = $1",
-          binary, dwarf_reader_status.msg());
-      continue;
+  // GoTLS Probes.
+  {
+    StatusOr<int> attach_status = AttachGoTLSUProbes(binary, analysis, pids);
+    if (!attach_status.ok()) {
+      monitor_.AppendSourceStatusRecord("socket_tracer", attach_status.status(),
+                                        "AttachGoTLSUProbes");
+      LOG_FIRST_N(WARNING, 10) << absl::Substitute("Failed to attach GoTLS Uprobes to $0: $1",
+                                                   binary, attach_status.ToString());
+    } else {
+      uprobe_count += attach_status.ValueOrDie();
     }
-    std::unique_ptr<DwarfReader> dwarf_reader = dwarf_reader_status.ConsumeValueOrDie();
+  }
 
-    Status s = UpdateGoCommonSymAddrs(elf_reader.get(), dwarf_reader.get(), pid_vec);
-    if (!s.ok()) {
-      VLOG(1) << absl::Substitute(
-          "Golang binary $0 does not have the mandatory symbols (e.g. TCPConn).", binary);
+  // Go HTTP2 Probes.
+  if (cfg_enable_http2_tracing_) {
+    StatusOr<int> attach_status = AttachGoHTTP2Probes(binary, analysis, pids);
+    if (!attach_status.ok()) {
+      monitor_.AppendSourceStatusRecord("socket_tracer", attach_status.status(),
+                                        "AttachGoHTTP2Probes");
+      LOG_FIRST_N(WARNING, 10) << absl::Substitute("Failed to attach HTTP2 Uprobes to $0: $1",
+                                                   binary, attach_status.ToString());
+    } else {
+      uprobe_count += attach_status.ValueOrDie();
+    }
+  }
+
+  return uprobe_count;
+}
+
+int UProbeManager::DeployGoUProbes(const absl::flat_hash_set<md::UPID>& pids) {
+  int uprobe_count = 0;
+
+  static int32_t kPID = getpid();
+
+  struct NewBinary {
+    std::string path;
+    std::vector<int32_t> pids;
+    // The analysis cache key; empty if the binary is not a Go binary, or could not be read.
+    std::string key;
+  };
+  std::vector<NewBinary> new_binaries;
+
+  for (auto& [binary, pid_vec] : ConvertPIDsListToMap(pids, &fp_resolver_)) {
+    // Don't bother rescanning binaries that have been scanned before to avoid unnecessary work.
+    if (!scanned_binaries_.insert(binary).second) {
       continue;
     }
 
-    // Setup thread to GOID mapping.
-    SetupGOIDMaps(binary, pid_vec);
-
-    // Go Runtime Probes.
-    {
-      StatusOr<int> attach_status =
-          AttachGoRuntimeUProbes(binary, elf_reader.get(), dwarf_reader.get(), pid_vec);
-      if (!attach_status.ok()) {
-        monitor_.AppendSourceStatusRecord("socket_tracer", attach_status.status(),
-                                          "AttachGoRuntimeUProbes");
-        LOG_FIRST_N(WARNING, 10) << absl::Substitute(
-            "Failed to attach Go Runtime Uprobes to $0: $1", binary, attach_status.ToString());
-      } else {
-        uprobe_count += attach_status.ValueOrDie();
+    if (cfg_disable_self_probing_) {
+      // Don't try to attach uprobes to self.
+      // This speeds up stirling_wrapper initialization significantly.
+      if (pid_vec.size() == 1 && pid_vec[0] == kPID) {
+        continue;
       }
     }
 
-    // GoTLS Probes.
-    {
-      StatusOr<int> attach_status =
-          AttachGoTLSUProbes(binary, elf_reader.get(), dwarf_reader.get(), pid_vec);
-      if (!attach_status.ok()) {
-        monitor_.AppendSourceStatusRecord("socket_tracer", attach_status.status(),
-                                          "AttachGoTLSUProbes");
-        LOG_FIRST_N(WARNING, 10) << absl::Substitute("Failed to attach GoTLS Uprobes to $0: $1",
-                                                     binary, attach_status.ToString());
-      } else {
-        uprobe_count += attach_status.ValueOrDie();
-      }
+    new_binaries.push_back({binary, std::move(pid_vec), /*key*/ {}});
+  }
+
+  // Keying a binary can mean hashing its contents, so it is done in parallel too.
+  // Non-Go binaries are never probed, so they are filtered out before they are keyed.
+  ParallelFor(new_binaries.size(), FLAGS_stirling_uprobe_analysis_threads,
+              [this, &new_binaries](size_t i) {
+                NewBinary& new_binary = new_binaries[i];
+                StatusOr<std::string> key_status = GoBinaryKey(new_binary.path);
+                if (key_status.ok()) {
+                  new_binary.key = key_status.ConsumeValueOrDie();
+                } else if (!error::IsNotFound(key_status.status())) {
+                  LOG(WARNING) << absl::Substitute(
+                      "Cannot analyze binary $0 for uprobe deployment. "
+                      "If file is under /var/lib, container may have terminated. "
+                      "Message = $1",
+                      new_binary.path, key_status.msg());
+                }
+              });
+
+  // Binaries that have not been analyzed before, keyed by contents (so that copies of the same
+  // binary, e.g. in different containers, are only analyzed once).
+  absl::flat_hash_map<std::string, std::string> to_analyze;
+  for (const auto& new_binary : new_binaries) {
+    if (!new_binary.key.empty() && go_analysis_cache_.Lookup(new_binary.key) == nullptr) {
+      to_analyze.try_emplace(new_binary.key, new_binary.path);
     }
+  }
 
-    // Go HTTP2 Probes.
-    if (cfg_enable_http2_tracing_) {
-      StatusOr<int> attach_status =
-          AttachGoHTTP2Probes(binary, elf_reader.get(), dwarf_reader.get(), pid_vec);
-      if (!attach_status.ok()) {
-        monitor_.AppendSourceStatusRecord("socket_tracer", attach_status.status(),
-                                          "AttachGoHTTP2Probes");
-        LOG_FIRST_N(WARNING, 10) << absl::Substitute("Failed to attach HTTP2 Uprobes to $0: $1",
-                                                     binary, attach_status.ToString());
-      } else {
-        uprobe_count += attach_status.ValueOrDie();
-      }
+  AnalyzeGoBinaries(to_analyze);
+
+  for (const auto& new_binary : new_binaries) {
+    if (new_binary.key.empty()) {
+      continue;
     }
+    std::shared_ptr<const GoUProbeAnalysis> analysis = go_analysis_cache_.Lookup(new_binary.key);
+    if (analysis == nullptr || !analysis->probeable) {
+      continue;
+    }
+    uprobe_count += DeployGoUProbes(new_binary.path, *analysis, new_binary.pids);
   }
 
   return uprobe_count;
@@ -684,7 +881,8 @@ absl::flat_hash_set<md::UPID> UProbeManager::PIDsToRescanForUProbes() {
   for (const auto& pid : upids_with_mmap_) {
     md::UPID upid(asid, pid.pid, pid.start_time_ticks);
 
-    if (proc_tracker_.upids().contains(upid) && !proc_tracker_.new_upids().contains(upid)) {
+    if (proc_tracker_.upids().contains(upid) && !proc_tracker_.new_upids().contains(upid) &&
+        !deferred_upids_.contains(upid)) {
       // Filter out upids_to_rescan based on a backoff that is tracked per UPID.
       // Each UPID has a modulus, which defines the periodicity at which it can rescan.
       // This periodicity is used in a modulo operation, hence the term modulus.
@@ -716,6 +914,48 @@ absl::flat_hash_set<md::UPID> UProbeManager::PIDsToRescanForUProbes() {
   return upids_to_rescan;
 }
 
+absl::flat_hash_set<md::UPID> UProbeManager::UPIDsReadyForUProbes() {
+  const int64_t min_age_ns =
+      std::chrono::nanoseconds(std::chrono::milliseconds(FLAGS_stirling_uprobe_min_process_age_ms))
+          .count();
+  if (min_age_ns <= 0) {
+    return proc_tracker_.new_upids();
+  }
+
+  const int64_t now_ns = px::chrono::boot_clock::now().time_since_epoch().count();
+  const int64_t kernel_tick_ns = system::Config::GetInstance().KernelTickTimeNS();
+  auto old_enough = [&](const md::UPID& upid) {
+    return now_ns - upid.start_ts() * kernel_tick_ns >= min_age_ns;
+  };
+
+  UProbeDeployMetrics& metrics = UProbeDeployMetrics::Get();
+  absl::flat_hash_set<md::UPID> ready_upids;
+
+  for (auto iter = deferred_upids_.begin(); iter != deferred_upids_.end();) {
+    if (!proc_tracker_.upids().contains(*iter)) {
+      // The process exited before it was old enough, so no uprobes were spent on it.
+      metrics.short_lived_pids.Increment();
+      deferred_upids_.erase(iter++);
+    } else if (old_enough(*iter)) {
+      ready_upids.insert(*iter);
+      deferred_upids_.erase(iter++);
+    } else {
+      ++iter;
+    }
+  }
+
+  for (const md::UPID& upid : proc_tracker_.new_upids()) {
+    if (old_enough(upid)) {
+      ready_upids.insert(upid);
+    } else {
+      metrics.deferred_pids.Increment();
+      deferred_upids_.insert(upid);
+    }
+  }
+
+  return ready_upids;
+}
+
 void UProbeManager::DeployUProbes(const absl::flat_hash_set<md::UPID>& pids) {
   const std::lock_guard<std::mutex> lock(deploy_uprobes_mutex_);
 
@@ -727,13 +967,15 @@ void UProbeManager::DeployUProbes(const absl::flat_hash_set<md::UPID>& pids) {
   // Refresh our file path resolver so it is aware of all new mounts.
   fp_resolver_.Refresh();
 
+  const absl::flat_hash_set<md::UPID> ready_upids = UPIDsReadyForUProbes();
+
   int uprobe_count = 0;
 
-  uprobe_count += DeployOpenSSLUProbes(proc_tracker_.new_upids());
+  uprobe_count += DeployOpenSSLUProbes(ready_upids);
   if (FLAGS_stirling_rescan_for_dlopen) {
     uprobe_count += DeployOpenSSLUProbes(PIDsToRescanForUProbes());
   }
-  uprobe_count += DeployGoUProbes(proc_tracker_.new_upids());
+  uprobe_count += DeployGoUProbes(ready_upids);
 
   if (uprobe_count != 0) {
     LOG(INFO) << absl::Substitute("Number of uprobes deployed = $0", uprobe_count);
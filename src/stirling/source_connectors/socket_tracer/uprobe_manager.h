@@ -34,6 +34,7 @@
 #include "src/stirling/source_connectors/socket_tracer/bcc_bpf_intf/socket_trace.hpp"
 #include "src/stirling/source_connectors/socket_tracer/bcc_bpf_intf/symaddrs.h"
 
+#include "src/stirling/source_connectors/socket_tracer/go_uprobe_analysis.h"
 #include "src/stirling/source_connectors/socket_tracer/uprobe_symaddrs.h"
 #include "src/stirling/utils/detect_application.h"
 #include "src/stirling/utils/monitor.h"
@@ -42,6 +43,8 @@
 
 DECLARE_bool(stirling_rescan_for_dlopen);
 DECLARE_double(stirling_rescan_exp_backoff_factor);
+DECLARE_int32(stirling_uprobe_analysis_threads);
+DECLARE_int32(stirling_uprobe_min_process_age_ms);
 
 namespace px {
 namespace stirling {
@@ -392,6 +395,50 @@ class UProbeManager {
    */
   int DeployGoUProbes(const absl::flat_hash_set<md::UPID>& pids);
 
+  /**
+   * Returns a hash of the Go uprobe templates, which identifies the probes that Go binaries are
+   * analyzed for.
+   */
+  static std::string GoUProbeTmplsFingerprint();
+
+  /**
+   * Returns the analysis cache key of a Go binary. Checks that it is a Go binary first, so that
+   * other binaries are not hashed for nothing. Safe to call concurrently.
+   *
+   * @param binary The path to the binary.
+   * @return The key, or NotFound if the binary is not a Go binary.
+   */
+  StatusOr<std::string> GoBinaryKey(const std::string& binary) const;
+
+  /**
+   * Analyzes a Go binary for uprobe deployment. Reads the binary's ELF and DWARF information,
+   * but does not use any UProbeManager state, so that binaries can be analyzed in parallel.
+   *
+   * @param binary The path to the binary to analyze.
+   * @return The analysis, or error if the binary could not be read. It is not an error if the
+   *         binary is not a Go binary; instead the analysis is not probeable.
+   */
+  static StatusOr<GoUProbeAnalysis> AnalyzeGoBinary(const std::string& binary);
+
+  /**
+   * Analyzes the given binaries on up to FLAGS_stirling_uprobe_analysis_threads threads,
+   * and records the results in go_analysis_cache_.
+   *
+   * @param binaries Map of binary key (see GoUProbeAnalysisCache::BinaryKey()) to binary path.
+   */
+  void AnalyzeGoBinaries(const absl::flat_hash_map<std::string, std::string>& binaries);
+
+  /**
+   * Deploys Go uprobes on a binary, based on its analysis.
+   *
+   * @param binary The path to the binary on which to deploy Go probes.
+   * @param analysis The analysis of the binary, which must be probeable.
+   * @param pids The list of PIDs that are new instances of the binary.
+   * @return Number of uprobes deployed.
+   */
+  int DeployGoUProbes(const std::string& binary, const GoUProbeAnalysis& analysis,
+                      const std::vector<int32_t>& pids);
+
   /**
    * Sets up the BPF maps used for GOID tracking. Required for general Go tracing.
    *
@@ -401,53 +448,41 @@ class UProbeManager {
   void SetupGOIDMaps(const std::string& binary, const std::vector<int32_t>& pids);
 
   /**
-   * Attaches the required probes for general Go tracing to the specified binary, if it is a
-   * compatible Go binary.
+   * Attaches the required probes for general Go tracing to the specified binary.
    *
    * @param binary The path to the binary on which to deploy Go probes.
-   * @param elf_reader ELF reader for the binary.
-   * @param dwarf_reader DWARF reader for the binary.
-   * @param pids The list of PIDs that are new instances of the binary. Used to populate symbol
-   *             addresses.
-   * @return The number of uprobes deployed, or error. It is not an error if the binary
-   *         is not a Go binary; instead the return value will be zero.
+   * @param analysis The analysis of the binary.
+   * @return The number of uprobes deployed, or error.
    */
-  StatusOr<int> AttachGoRuntimeUProbes(const std::string& binary, obj_tools::ElfReader* elf_reader,
-                                       obj_tools::DwarfReader* dwarf_reader,
-                                       const std::vector<int32_t>& new_pids);
+  StatusOr<int> AttachGoRuntimeUProbes(const std::string& binary,
+                                       const GoUProbeAnalysis& analysis);
 
   /**
-   * Attaches the required probes for Go HTTP2 tracing to the specified binary, if it is a
-   * compatible Go binary.
+   * Attaches the required probes for Go HTTP2 tracing to the specified binary, if it uses
+   * a Go HTTP2 library.
    *
    * @param binary The path to the binary on which to deploy Go HTTP2 probes.
-   * @param elf_reader ELF reader for the binary.
-   * @param dwarf_reader DWARF reader for the binary.
+   * @param analysis The analysis of the binary.
    * @param pids The list of PIDs that are new instances of the binary. Used to populate symbol
    *             addresses.
    * @return The number of uprobes deployed, or error. It is not considered an error if the binary
-   *         is not a Go binary or doesn't use a Go HTTP2 library; instead the return value will be
-   *         zero.
+   *         doesn't use a Go HTTP2 library; instead the return value will be zero.
    */
-  StatusOr<int> AttachGoHTTP2Probes(const std::string& binary, obj_tools::ElfReader* elf_reader,
-                                    obj_tools::DwarfReader* dwarf_reader,
+  StatusOr<int> AttachGoHTTP2Probes(const std::string& binary, const GoUProbeAnalysis& analysis,
                                     const std::vector<int32_t>& pids);
 
   /**
-   * Attaches the required probes for GoTLS tracing to the specified binary, if it is a compatible
-   * Go binary.
+   * Attaches the required probes for GoTLS tracing to the specified binary, if it uses Go TLS.
    *
-   * @param binary The path to the binary on which to deploy Go HTTP2 probes.
-   * @param elf_reader ELF reader for the binary.
-   * @param dwarf_reader DWARF reader for the binary.
+   * @param binary The path to the binary on which to deploy Go TLS probes.
+   * @param analysis The analysis of the binary.
    * @param pids The list of PIDs that are new instances of the binary. Used to populate symbol
    *             addresses.
    * @return The number of uprobes deployed, or error. It is not an error if the binary
-   *         is not a Go binary or doesn't use Go TLS; instead the return value will be zero.
+   *         doesn't use Go TLS; instead the return value will be zero.
    */
-  StatusOr<int> AttachGoTLSUProbes(const std::string& binary, obj_tools::ElfReader* elf_reader,
-                                   obj_tools::DwarfReader* dwarf_reader,
-                                   const std::vector<int32_t>& new_pids);
+  StatusOr<int> AttachGoTLSUProbes(const std::string& binary, const GoUProbeAnalysis& analysis,
+                                   const std::vector<int32_t>& pids);
 
   /**
    * Attaches the required probes for OpenSSL tracing to the specified PID, if it uses OpenSSL.
@@ -489,19 +524,36 @@ class UProbeManager {
   StatusOr<int> AttachUProbeTmpl(const ArrayView<UProbeTmpl>& probe_tmpls,
                                  const std::string& binary, obj_tools::ElfReader* elf_reader);
 
+  /**
+   * Finds all symbol matches of the probe templates, and returns the uprobes to attach for them,
+   * without a binary path.
+   */
+  static StatusOr<std::vector<bpf_tools::UProbeSpec>> ExpandUProbeTmpl(
+      const ArrayView<UProbeTmpl>& probe_tmpls, obj_tools::ElfReader* elf_reader);
+
+  /**
+   * Attaches the given uprobes to the binary.
+   * @return Number of uprobes deployed, or error if uprobes failed to deploy.
+   */
+  StatusOr<int> AttachUProbes(const std::vector<bpf_tools::UProbeSpec>& specs,
+                              const std::string& binary);
+
   // Returns set of PIDs that have had mmap called on them since the last call.
   absl::flat_hash_set<md::UPID> PIDsToRescanForUProbes();
 
+  // Returns the new and deferred PIDs that are now old enough to have uprobes deployed
+  // (see FLAGS_stirling_uprobe_min_process_age_ms). Younger PIDs are deferred until a later call,
+  // and deferred PIDs that have exited in the meantime are dropped.
+  absl::flat_hash_set<md::UPID> UPIDsReadyForUProbes();
+
   Status UpdateOpenSSLSymAddrs(RawFptrManager* fptrManager, std::filesystem::path container_lib,
                                uint32_t pid);
-  Status UpdateGoCommonSymAddrs(obj_tools::ElfReader* elf_reader,
-                                obj_tools::DwarfReader* dwarf_reader,
-                                const std::vector<int32_t>& pids);
-  Status UpdateGoHTTP2SymAddrs(obj_tools::ElfReader* elf_reader,
-                               obj_tools::DwarfReader* dwarf_reader,
-                               const std::vector<int32_t>& pids);
-  Status UpdateGoTLSSymAddrs(obj_tools::ElfReader* elf_reader, obj_tools::DwarfReader* dwarf_reader,
+  void UpdateGoCommonSymAddrs(const struct go_common_symaddrs_t& symaddrs,
+                              const std::vector<int32_t>& pids);
+  void UpdateGoHTTP2SymAddrs(const struct go_http2_symaddrs_t& symaddrs,
                              const std::vector<int32_t>& pids);
+  void UpdateGoTLSSymAddrs(const struct go_tls_symaddrs_t& symaddrs,
+                           const std::vector<int32_t>& pids);
   Status UpdateNodeTLSWrapSymAddrs(int32_t pid, const std::filesystem::path& node_exe,
                                    const SemVer& ver);
 
@@ -528,6 +580,9 @@ class UProbeManager {
 
   absl::flat_hash_set<upid_t> upids_with_mmap_;
 
+  // New PIDs that were too young to have uprobes deployed when first seen.
+  absl::flat_hash_set<md::UPID> deferred_upids_;
+
   // Count the number of times PIDsToRescanForUProbes() has been called.
   int rescan_counter_ = 0;
 
@@ -546,6 +601,10 @@ class UProbeManager {
   absl::flat_hash_set<std::string> go_tls_probed_binaries_;
   absl::flat_hash_set<std::string> nodejs_binaries_;
 
+  // Results of analyzing Go binaries, keyed by binary contents, so that identical binaries
+  // (e.g. the same image in different pods) are only analyzed once.
+  GoUProbeAnalysisCache go_analysis_cache_;
+
   // BPF maps through which the addresses of symbols for a given pid are communicated to uprobes.
   std::unique_ptr<UserSpaceManagedBPFMap<uint32_t, struct openssl_symaddrs_t>>
       openssl_symaddrs_map_;
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "src/common/base/base.h"
+#include "src/stirling/core/canonical_types.h"
+#include "src/stirling/core/output.h"
+#include "src/stirling/core/source_connector.h"
+
+namespace px {
+namespace stirling {
+
+// clang-format off
+constexpr DataElement kSourceStatsElements[] = {
+  canonical_data_elements::kTime,
+  canonical_data_elements::kUPID,
+  {"source_connector", "The source connector whose cost is reported",
+   types::DataType::STRING, types::SemanticType::ST_NONE, types::PatternType::GENERAL},
+  {"num_transfers", "The number of data transfers (samplings) since the previous push",
+   types::DataType::INT64, types::SemanticType::ST_NONE, types::PatternType::METRIC_GAUGE},
+  {"transfer_wall_time_ns", "Wall time spent transferring data since the previous push",
+   types::DataType::INT64, types::SemanticType::ST_DURATION_NS, types::PatternType::METRIC_GAUGE},
+  {"transfer_cpu_time_ns", "CPU time spent transferring data since the previous push",
+   types::DataType::INT64, types::SemanticType::ST_DURATION_NS, types::PatternType::METRIC_GAUGE},
+  {"push_wall_time_ns", "Wall time spent pushing data to the table store",
+   types::DataType::INT64, types::SemanticType::ST_DURATION_NS, types::PatternType::METRIC_GAUGE},
+  {"push_cpu_time_ns", "CPU time spent pushing data to the table store",
+   types::DataType::INT64, types::SemanticType::ST_DURATION_NS, types::PatternType::METRIC_GAUGE},
+  {"records_pushed", "The number of records pushed to the table store",
+   types::DataType::INT64, types::SemanticType::ST_NONE, types::PatternType::METRIC_GAUGE},
+  {"bytes_pushed", "The number of bytes pushed to the table store",
+   types::DataType::INT64, types::SemanticType::ST_BYTES, types::PatternType::METRIC_GAUGE},
+  {"data_loss_events", "The number of events lost (e.g. by perf buffers) since the previous push",
+   types::DataType::INT64, types::SemanticType::ST_NONE, types::PatternType::METRIC_GAUGE},
+  {"info", "Optional source specific stats provided as a JSON",
+   types::DataType::STRING, types::SemanticType::ST_NONE, types::PatternType::GENERAL},
+};
+
+constexpr DataTableSchema kSourceStatsTable {
+  "stirling_source_stats",
+  "This table contains the cost and output of each Stirling source connector since its previous "
+  "push. A row is reported on every push, which happens at least once per push period, and earlier "
+  "when the source has buffered a lot of data",
+  kSourceStatsElements
+};
+
+// clang-format on
+DEFINE_PRINT_TABLE(SourceStats);
+
+}  // namespace stirling
+}  // namespace px
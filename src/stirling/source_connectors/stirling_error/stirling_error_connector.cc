@@ -40,7 +40,7 @@ Status StirlingErrorConnector::StopImpl() { return Status::OK(); }
 
 void StirlingErrorConnector::TransferDataImpl(ConnectorContext* ctx,
                                               const std::vector<DataTable*>& data_tables) {
-  DCHECK_EQ(data_tables.size(), 2) << "StirlingErrorConnector has two data tables.";
+  DCHECK_EQ(data_tables.size(), 3) << "StirlingErrorConnector has three data tables.";
 
   if (data_tables[kStirlingErrorTableNum] != nullptr) {
     TransferStirlingErrorTable(ctx, data_tables[kStirlingErrorTableNum]);
@@ -49,6 +49,10 @@ void StirlingErrorConnector::TransferDataImpl(ConnectorContext* ctx,
   if (data_tables[kProbeStatusTableNum] != nullptr) {
     TransferProbeStatusTable(ctx, data_tables[kProbeStatusTableNum]);
   }
+
+  if (data_tables[kSourceStatsTableNum] != nullptr) {
+    TransferSourceStatsTable(ctx, data_tables[kSourceStatsTableNum]);
+  }
 }
 
 void StirlingErrorConnector::TransferStirlingErrorTable(ConnectorContext* ctx,
@@ -80,5 +84,25 @@ void StirlingErrorConnector::TransferProbeStatusTable(ConnectorContext* ctx,
   }
 }
 
+void StirlingErrorConnector::TransferSourceStatsTable(ConnectorContext* ctx,
+                                                      DataTable* data_table) {
+  md::UPID upid = md::UPID(ctx->GetASID(), pid_, start_time_);
+  for (auto& record : monitor_.ConsumeSourceStatsRecords()) {
+    DataTable::RecordBuilder<&kSourceStatsTable> r(data_table, record.timestamp_ns);
+    r.Append<r.ColIndex("time_")>(static_cast<uint64_t>(record.timestamp_ns));
+    r.Append<r.ColIndex("upid")>(upid.value());
+    r.Append<r.ColIndex("source_connector")>(std::move(record.source_connector));
+    r.Append<r.ColIndex("num_transfers")>(record.num_transfers);
+    r.Append<r.ColIndex("transfer_wall_time_ns")>(record.transfer_wall_time_ns);
+    r.Append<r.ColIndex("transfer_cpu_time_ns")>(record.transfer_cpu_time_ns);
+    r.Append<r.ColIndex("push_wall_time_ns")>(record.push_wall_time_ns);
+    r.Append<r.ColIndex("push_cpu_time_ns")>(record.push_cpu_time_ns);
+    r.Append<r.ColIndex("records_pushed")>(record.records_pushed);
+    r.Append<r.ColIndex("bytes_pushed")>(record.bytes_pushed);
+    r.Append<r.ColIndex("data_loss_events")>(record.data_loss_events);
+    r.Append<r.ColIndex("info")>(std::move(record.info));
+  }
+}
+
 }  // namespace stirling
 }  // namespace px
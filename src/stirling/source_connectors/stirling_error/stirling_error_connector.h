@@ -26,6 +26,7 @@
 #include "src/common/base/base.h"
 #include "src/stirling/core/source_connector.h"
 #include "src/stirling/source_connectors/stirling_error/probe_status_table.h"
+#include "src/stirling/source_connectors/stirling_error/source_stats_table.h"
 #include "src/stirling/source_connectors/stirling_error/stirling_error_table.h"
 #include "src/stirling/utils/monitor.h"
 
@@ -37,9 +38,11 @@ class StirlingErrorConnector : public SourceConnector {
   static constexpr std::string_view kName = "stirling_error";
   static constexpr auto kSamplingPeriod = std::chrono::milliseconds{1000};
   static constexpr auto kPushPeriod = std::chrono::milliseconds{1000};
-  static constexpr auto kTables = MakeArray(kStirlingErrorTable, kProbeStatusTable);
+  static constexpr auto kTables =
+      MakeArray(kStirlingErrorTable, kProbeStatusTable, kSourceStatsTable);
   static constexpr uint32_t kStirlingErrorTableNum = TableNum(kTables, kStirlingErrorTable);
   static constexpr uint32_t kProbeStatusTableNum = TableNum(kTables, kProbeStatusTable);
+  static constexpr uint32_t kSourceStatsTableNum = TableNum(kTables, kSourceStatsTable);
 
   StirlingErrorConnector() = delete;
   ~StirlingErrorConnector() override = default;
@@ -59,6 +62,7 @@ class StirlingErrorConnector : public SourceConnector {
 
   void TransferStirlingErrorTable(ConnectorContext* ctx, DataTable* data_table);
   void TransferProbeStatusTable(ConnectorContext* ctx, DataTable* data_table);
+  void TransferSourceStatsTable(ConnectorContext* ctx, DataTable* data_table);
 
   StirlingMonitor& monitor_ = *StirlingMonitor::GetInstance();
   int32_t pid_ = -1;
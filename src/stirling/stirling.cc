@@ -29,6 +29,9 @@
 #include <vector>
 
 #include <absl/base/internal/spinlock.h>
+#include <absl/functional/bind_front.h>
+#include <absl/strings/str_split.h>
+#include <absl/synchronization/mutex.h>
 
 #include "src/common/base/base.h"
 #include "src/common/json/json.h"
@@ -36,10 +39,12 @@
 #include "src/stirling/utils/system_info.h"
 
 #include "src/stirling/bpf_tools/probe_cleaner.h"
+#include "src/stirling/core/data_push_queue.h"
 #include "src/stirling/core/data_table.h"
 #include "src/stirling/core/pub_sub_manager.h"
 #include "src/stirling/core/source_connector.h"
 #include "src/stirling/core/source_registry.h"
+#include "src/stirling/core/source_runner.h"
 #include "src/stirling/proto/stirling.pb.h"
 
 #include "src/stirling/source_connectors/dynamic_bpftrace/dynamic_bpftrace_connector.h"
@@ -58,6 +63,26 @@
 
 #include "src/stirling/source_connectors/dynamic_tracer/dynamic_tracing/dynamic_tracer.h"
 
+DEFINE_bool(stirling_source_threads,
+            gflags::BoolFromEnv("PL_STIRLING_SOURCE_THREADS", false),
+            "If true, each source connector is sampled and pushed on its own thread, so that a "
+            "slow source does not delay the others. Otherwise, all sources run in turn on the "
+            "main Stirling thread.");
+
+DEFINE_int64(stirling_data_push_queue_bytes,
+             gflags::Int64FromEnv("PL_STIRLING_DATA_PUSH_QUEUE_BYTES", 0),
+             "If non-zero, sources hand their data to a queue of up to this many bytes, which a "
+             "separate thread pushes to the table store, so that a slow table store does not stall "
+             "the sources. When the queue is full, data is dropped, except for the tables in "
+             "--stirling_data_push_queue_block_tables. If zero, sources push directly.");
+
+DEFINE_string(stirling_data_push_queue_block_tables,
+              gflags::StringFromEnv("PL_STIRLING_DATA_PUSH_QUEUE_BLOCK_TABLES",
+                                    "stirling_error,probe_status,stirling_source_stats"),
+              "Comma separated list of tables whose sources wait for room in a full data push "
+              "queue (for up to 100ms), instead of dropping their data. Only applies with "
+              "--stirling_source_threads, since otherwise waiting would stall all sources.");
+
 DEFINE_string(
     stirling_sources, gflags::StringFromEnv("PL_STIRLING_SOURCES", "kProd"),
     "Choose sources to enable. [kAll|kProd|kMetrics|kTracers|kProfiler] or comma separated list of "
@@ -239,6 +264,28 @@ class StirlingImpl final : public Stirling {
   // Main run implementation.
   void RunCore();
 
+  // Runs all sources in turn on the calling thread, until Stirling is stopped.
+  void RunSourcesInTurn();
+
+  // Runs every source on its own SourceRunner thread, until Stirling is stopped.
+  void RunSourceThreads();
+
+  // Returns the source with the given name, or sources_.end().
+  std::vector<std::unique_ptr<SourceConnector>>::iterator FindSource(std::string_view source_name)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(info_class_mgrs_lock_);
+
+  // Creates and starts the runner of a source.
+  void StartSourceRunner(SourceConnector* source, const SourceOutput& output)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(info_class_mgrs_lock_);
+
+  // Runs fn on every source, between iterations of its runner if it has one.
+  void ForEachSource(const std::function<void(SourceConnector*)>& fn);
+
+  // Pushes data to data_push_queue_ if there is one, or else through data_push_callback_.
+  // Source runners push concurrently, but the callback expects one caller at a time.
+  Status PushData(uint32_t table_id, types::TabletID tablet_id,
+                  std::unique_ptr<types::ColumnWrapperRecordBatch> record_batch);
+
   // Wait for Stirling to stop its main loop.
   void WaitForStop();
 
@@ -255,6 +302,17 @@ class StirlingImpl final : public Stirling {
 
   InfoClassManagerVec info_class_mgrs_ ABSL_GUARDED_BY(info_class_mgrs_lock_);
 
+  // The runner thread of each source, when running with --stirling_source_threads.
+  // Shared, so that runners can be stopped and used without holding info_class_mgrs_lock_.
+  absl::flat_hash_map<SourceConnector*, std::shared_ptr<SourceRunner>> source_runners_
+      ABSL_GUARDED_BY(info_class_mgrs_lock_);
+  bool use_source_runners_ ABSL_GUARDED_BY(info_class_mgrs_lock_) = false;
+
+  absl::Mutex data_push_mu_;
+
+  // Decouples the sources from data_push_callback_, when --stirling_data_push_queue_bytes is set.
+  std::unique_ptr<DataPushQueue> data_push_queue_;
+
   // Lock to protect both info_class_mgrs_ and sources_.
   absl::base_internal::SpinLock info_class_mgrs_lock_;
 
@@ -401,6 +459,15 @@ Status StirlingImpl::Init() {
     return error::NotFound("Source registry doesn't exist");
   }
 
+  if (FLAGS_stirling_data_push_queue_bytes > 0) {
+    data_push_queue_ = std::make_unique<DataPushQueue>(
+        [this](uint32_t table_id, types::TabletID tablet_id,
+               std::unique_ptr<types::ColumnWrapperRecordBatch> record_batch) {
+          return data_push_callback_(table_id, std::move(tablet_id), std::move(record_batch));
+        },
+        FLAGS_stirling_data_push_queue_bytes);
+  }
+
   for (const auto& [name, create_source_fn, _] : registry_->sources()) {
     auto source_ptr = create_source_fn(name);
 
@@ -423,6 +490,21 @@ std::unique_ptr<ConnectorContext> StirlingImpl::GetContext() {
 
 namespace {
 
+DataPushQueue::OverflowPolicy DataPushQueueOverflowPolicy(std::string_view table_name) {
+  // Without source threads, all sources push from the main Stirling loop (while holding
+  // info_class_mgrs_lock_), so a blocked push would stall every source.
+  if (!FLAGS_stirling_source_threads) {
+    return DataPushQueue::OverflowPolicy::kDrop;
+  }
+  for (std::string_view name :
+       absl::StrSplit(FLAGS_stirling_data_push_queue_block_tables, ',', absl::SkipEmpty())) {
+    if (name == table_name) {
+      return DataPushQueue::OverflowPolicy::kBlock;
+    }
+  }
+  return DataPushQueue::OverflowPolicy::kDrop;
+}
+
 std::vector<DataTable*> GetDataTables(const std::vector<InfoClassManager*>& info_class_mgrs) {
   std::vector<DataTable*> data_tables;
   data_tables.reserve(info_class_mgrs.size());
@@ -447,6 +529,10 @@ Status StirlingImpl::AddSource(std::unique_ptr<SourceConnector> source) {
     LOG(INFO) << absl::Substitute("Adding info class: [$0/$1]", source->name(), schema.name());
     auto mgr = std::make_unique<InfoClassManager>(schema);
     mgr->SetSourceConnector(source.get());
+    if (data_push_queue_ != nullptr) {
+      data_push_queue_->RegisterTable(mgr->id(), std::string(schema.name()),
+                                      DataPushQueueOverflowPolicy(schema.name()));
+    }
     mgrs.push_back(mgr.get());
     info_class_mgrs_.push_back(std::move(mgr));
   }
@@ -456,31 +542,71 @@ Status StirlingImpl::AddSource(std::unique_ptr<SourceConnector> source) {
   source_output_map_[source.get()] = {std::move(mgrs),
                                       // DataTable objects are created after subscribing.
                                       std::move(data_tables)};
+  if (use_source_runners_) {
+    StartSourceRunner(source.get(), source_output_map_[source.get()]);
+  }
   sources_.push_back(std::move(source));
 
   return Status::OK();
 }
 
+std::vector<std::unique_ptr<SourceConnector>>::iterator StirlingImpl::FindSource(
+    std::string_view source_name) {
+  return std::find_if(sources_.begin(), sources_.end(),
+                      [&source_name](const std::unique_ptr<SourceConnector>& s) {
+                        return s->name() == source_name;
+                      });
+}
+
 Status StirlingImpl::RemoveSource(std::string_view source_name) {
+  // Stop the runner before the source, so that the source is no longer sampled.
+  // Stopping waits for the runner to finish its current iteration, so it is done without holding
+  // the lock, which the main loop needs. The runner is also destroyed after the lock is released.
+  std::shared_ptr<SourceRunner> runner;
+  {
+    absl::base_internal::SpinLockHolder lock(&info_class_mgrs_lock_);
+    auto source_iter = FindSource(source_name);
+    if (source_iter == sources_.end()) {
+      return error::Internal("RemoveSource(): could not find source with name=$0", source_name);
+    }
+    auto runner_iter = source_runners_.find(source_iter->get());
+    if (runner_iter != source_runners_.end()) {
+      runner = runner_iter->second;
+    }
+  }
+  if (runner != nullptr) {
+    runner->Stop();
+  }
+
   absl::base_internal::SpinLockHolder lock(&info_class_mgrs_lock_);
 
-  // Find the source.
-  auto source_iter = std::find_if(sources_.begin(), sources_.end(),
-                                  [&source_name](const std::unique_ptr<SourceConnector>& s) {
-                                    return s->name() == source_name;
-                                  });
+  // Find the source again, since the lock was released.
+  auto source_iter = FindSource(source_name);
   if (source_iter == sources_.end()) {
     return error::Internal("RemoveSource(): could not find source with name=$0", source_name);
   }
   std::unique_ptr<SourceConnector>& source = *source_iter;
+  source_runners_.erase(source.get());
 
   // Remove all info class managers that point back to the source.
+  std::vector<uint64_t> table_ids;
+  for (const auto& mgr : info_class_mgrs_) {
+    if (mgr->source() == source.get()) {
+      table_ids.push_back(mgr->id());
+    }
+  }
   info_class_mgrs_.erase(std::remove_if(info_class_mgrs_.begin(), info_class_mgrs_.end(),
                                         [&source](std::unique_ptr<InfoClassManager>& mgr) {
                                           return mgr->source() == source.get();
                                         }),
                          info_class_mgrs_.end());
 
+  if (data_push_queue_ != nullptr) {
+    for (uint64_t table_id : table_ids) {
+      data_push_queue_->UnregisterTable(table_id);
+    }
+  }
+
   // Now perform the removal.
   PL_RETURN_IF_ERROR(source->Stop());
   source_output_map_.erase(source.get());
@@ -766,25 +892,6 @@ void SleepForDuration(std::chrono::milliseconds sleep_duration) {
   }
 }
 
-// Returns true if any of the input tables are beyond the threshold.
-bool DataExceedsThreshold(const std::vector<DataTable*>& data_tables) {
-  // Data push threshold, based on percentage of buffer that is filled.
-  constexpr uint32_t kDefaultOccupancyPctThreshold = 100;
-
-  // Data push threshold, based number of records after which a push.
-  constexpr uint32_t kDefaultOccupancyThreshold = 1024;
-
-  for (const auto* data_table : data_tables) {
-    if (static_cast<uint32_t>(100 * data_table->OccupancyPct()) > kDefaultOccupancyPctThreshold) {
-      return true;
-    }
-    if (data_table->Occupancy() > kDefaultOccupancyThreshold) {
-      return true;
-    }
-  }
-  return false;
-}
-
 }  // namespace
 
 // Main Data Collector loop.
@@ -803,9 +910,33 @@ void StirlingImpl::RunCore() {
   }
   // TODO(oazizi): We need to call InitContext on dynamic sources too. Fix.
 
+  if (data_push_queue_ != nullptr) {
+    data_push_queue_->Start();
+  }
+
   // Indicates completion of initialization, and start of data collection.
   LOG(INFO) << "Stirling is running.";
 
+  if (FLAGS_stirling_source_threads) {
+    RunSourceThreads();
+  } else {
+    RunSourcesInTurn();
+  }
+
+  // Push the data still queued, now that the sources are no longer pushing.
+  if (data_push_queue_ != nullptr) {
+    data_push_queue_->Stop();
+  }
+  running_ = false;
+}
+
+void StirlingImpl::RunSourcesInTurn() {
+  // Without a queue, this thread is the only caller of data_push_callback_.
+  DataPushCallback push_callback = data_push_callback_;
+  if (data_push_queue_ != nullptr) {
+    push_callback = absl::bind_front(&DataPushQueue::Push, data_push_queue_.get());
+  }
+
   while (run_enable_) {
     auto sleep_duration = std::chrono::milliseconds::zero();
 
@@ -829,7 +960,7 @@ void StirlingImpl::RunCore() {
         }
         // Phase 2: Push Data upstream.
         if (source->push_freq_mgr().Expired() || DataExceedsThreshold(output.data_tables)) {
-          source->PushData(data_push_callback_, output.data_tables);
+          source->PushData(push_callback, output.data_tables);
         }
       }
 
@@ -839,7 +970,79 @@ void StirlingImpl::RunCore() {
 
     SleepForDuration(sleep_duration);
   }
-  running_ = false;
+}
+
+void StirlingImpl::StartSourceRunner(SourceConnector* source, const SourceOutput& output) {
+  auto runner = std::make_shared<SourceRunner>(
+      source, output.data_tables,
+      absl::bind_front(&StirlingImpl::PushData, this),
+      std::bind(&StirlingImpl::GetContext, this));
+  runner->Start();
+  source_runners_[source] = std::move(runner);
+}
+
+Status StirlingImpl::PushData(uint32_t table_id, types::TabletID tablet_id,
+                              std::unique_ptr<types::ColumnWrapperRecordBatch> record_batch) {
+  if (data_push_queue_ != nullptr) {
+    return data_push_queue_->Push(table_id, std::move(tablet_id), std::move(record_batch));
+  }
+  absl::MutexLock lock(&data_push_mu_);
+  return data_push_callback_(table_id, tablet_id, std::move(record_batch));
+}
+
+void StirlingImpl::RunSourceThreads() {
+  {
+    absl::base_internal::SpinLockHolder lock(&info_class_mgrs_lock_);
+    for (const auto& [source, output] : source_output_map_) {
+      StartSourceRunner(source, output);
+    }
+    use_source_runners_ = true;
+  }
+
+  // The runners do all the work; this thread only waits for Stop().
+  constexpr std::chrono::milliseconds kStopPollPeriod{100};
+  while (run_enable_) {
+    std::this_thread::sleep_for(kStopPollPeriod);
+  }
+
+  // Stopping waits for the runners to finish their current iteration, so it is done without
+  // holding the lock. The runners stay in source_runners_ until then, so that RemoveSource() still
+  // stops the runner of the source it removes.
+  std::vector<std::shared_ptr<SourceRunner>> runners;
+  {
+    absl::base_internal::SpinLockHolder lock(&info_class_mgrs_lock_);
+    use_source_runners_ = false;
+    for (const auto& [source, runner] : source_runners_) {
+      runners.push_back(runner);
+    }
+  }
+  for (const auto& runner : runners) {
+    runner->Stop();
+  }
+
+  absl::base_internal::SpinLockHolder lock(&info_class_mgrs_lock_);
+  source_runners_.clear();
+}
+
+void StirlingImpl::ForEachSource(const std::function<void(SourceConnector*)>& fn) {
+  // RunExclusive() waits for the runner to finish its current iteration, so it is called without
+  // holding the lock. Sources without a runner are only sampled under the lock, so fn runs on them
+  // under the lock.
+  std::vector<std::shared_ptr<SourceRunner>> runners;
+  {
+    absl::base_internal::SpinLockHolder lock(&info_class_mgrs_lock_);
+    for (auto& s : sources_) {
+      auto iter = source_runners_.find(s.get());
+      if (iter != source_runners_.end()) {
+        runners.push_back(iter->second);
+      } else {
+        fn(s.get());
+      }
+    }
+  }
+  for (const auto& runner : runners) {
+    runner->RunExclusive(fn);
+  }
 }
 
 bool StirlingImpl::IsRunning() const { return running_; }
@@ -874,25 +1077,15 @@ void StirlingImpl::Stop() {
 }
 
 void StirlingImpl::SetDebugLevel(int level) {
-  // Lock not really required, but compiler is making sure we're safe.
-  absl::base_internal::SpinLockHolder lock(&info_class_mgrs_lock_);
-  for (auto& s : sources_) {
-    s->SetDebugLevel(level);
-  }
+  ForEachSource([level](SourceConnector* source) { source->SetDebugLevel(level); });
 }
 
 void StirlingImpl::EnablePIDTrace(int pid) {
-  absl::base_internal::SpinLockHolder lock(&info_class_mgrs_lock_);
-  for (auto& s : sources_) {
-    s->EnablePIDTrace(pid);
-  }
+  ForEachSource([pid](SourceConnector* source) { source->EnablePIDTrace(pid); });
 }
 
 void StirlingImpl::DisablePIDTrace(int pid) {
-  absl::base_internal::SpinLockHolder lock(&info_class_mgrs_lock_);
-  for (auto& s : sources_) {
-    s->DisablePIDTrace(pid);
-  }
+  ForEachSource([pid](SourceConnector* source) { source->DisablePIDTrace(pid); });
 }
 
 void StirlingImpl::UpdateDynamicTraceStatus(const sole::uuid& trace_id,
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <numeric>
 #include <vector>
 
 namespace px {
@@ -45,6 +47,22 @@ std::vector<size_t> SortedIndexes(const std::vector<T>& v) {
   return idx;
 }
 
+// Same as above, but for a vector whose first sorted_prefix_size elements are already sorted.
+// Only the remaining tail is sorted, and then merged with the prefix, which is cheap when the
+// values arrive nearly in order: O(n + k*log(k)) for a tail of size k.
+template <typename T>
+std::vector<size_t> SortedIndexes(const std::vector<T>& v, size_t sorted_prefix_size) {
+  std::vector<size_t> idx(v.size());
+  std::iota(idx.begin(), idx.end(), 0);
+
+  auto cmp = [&v](size_t i1, size_t i2) { return v[i1] < v[i2]; };
+  auto mid = idx.begin() + std::min(sorted_prefix_size, idx.size());
+  std::stable_sort(mid, idx.end(), cmp);
+  std::inplace_merge(idx.begin(), mid, idx.end(), cmp);
+
+  return idx;
+}
+
 // An iterator that walks over a vector according to provided indexes.
 // Used in conjunction with SortedIndexes to iterate through an unsorted vector in sorted order.
 template <typename T>
@@ -34,6 +34,20 @@ TEST(SortedIndexes, Basic) {
   EXPECT_EQ(sort_indexes, (std::vector<size_t>{1, 0, 2, 5, 4, 3}));
 }
 
+TEST(SortedIndexes, SortedPrefix) {
+  std::vector<int> data = {0, 2, 4, 6, 8, 3, 9, 1, 3};
+
+  // The result matches a full (stable) sort, for any prefix that is actually sorted.
+  for (size_t prefix_size = 0; prefix_size <= 5; ++prefix_size) {
+    EXPECT_EQ(SortedIndexes(data, prefix_size), SortedIndexes(data)) << prefix_size;
+  }
+  EXPECT_EQ(SortedIndexes(data, 5), (std::vector<size_t>{0, 7, 1, 5, 8, 2, 3, 4, 6}));
+
+  // A fully sorted vector has the identity order.
+  std::vector<int> sorted = {1, 1, 2, 3};
+  EXPECT_EQ(SortedIndexes(sorted, sorted.size()), (std::vector<size_t>{0, 1, 2, 3}));
+}
+
 TEST(SplitSortedVector, Basic) {
   // Corresponds to {0, 2, 4, 6, 8, 10} after applying sort_indexes
   std::vector<int> data = {2, 0, 4, 10, 8, 6};
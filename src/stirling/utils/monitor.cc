@@ -35,27 +35,37 @@ StirlingMonitor::StirlingMonitor()
           BuildCounter(kJavaProcCrashedDuringAttach,
                        "Count of Java process crashes during symbolization agent attach.")) {}
 
-void StirlingMonitor::ResetJavaProcessAttachTrackers() { java_proc_attach_times_.clear(); }
+void StirlingMonitor::ResetJavaProcessAttachTrackers() {
+  absl::base_internal::SpinLockHolder lock(&java_proc_attach_lock_);
+  java_proc_attach_times_.clear();
+}
 
 void StirlingMonitor::NotifyJavaProcessAttach(const struct upid_t& upid) {
+  absl::base_internal::SpinLockHolder lock(&java_proc_attach_lock_);
   DCHECK(java_proc_attach_times_.find(upid) == java_proc_attach_times_.end());
   java_proc_attach_times_[upid] = std::chrono::steady_clock::now();
 }
 
 void StirlingMonitor::NotifyJavaProcessCrashed(const struct upid_t& upid) {
-  const auto iter = java_proc_attach_times_.find(upid);
-  if (iter != java_proc_attach_times_.end()) {
-    const auto& t_attach = iter->second;
-    const auto t_now = std::chrono::steady_clock::now();
-    const auto delta = std::chrono::duration_cast<std::chrono::seconds>(t_now - t_attach);
-    if (delta < kCrashWindow) {
-      java_proc_crashed_during_attach_.Increment();
-      FLAGS_stirling_profiler_java_symbols = false;
-      LOG(WARNING) << absl::Substitute(
-          "Detected Java process crash, pid: $0, within $1 seconds of symbolization agent attach. "
-          "Disabling Java symbolization.",
-          upid.pid, delta.count());
+  timestamp_t t_attach;
+  {
+    absl::base_internal::SpinLockHolder lock(&java_proc_attach_lock_);
+    const auto iter = java_proc_attach_times_.find(upid);
+    if (iter == java_proc_attach_times_.end()) {
+      return;
     }
+    t_attach = iter->second;
+  }
+
+  const auto t_now = std::chrono::steady_clock::now();
+  const auto delta = std::chrono::duration_cast<std::chrono::seconds>(t_now - t_attach);
+  if (delta < kCrashWindow) {
+    java_proc_crashed_during_attach_.Increment();
+    java_symbols_disabled_ = true;
+    LOG(WARNING) << absl::Substitute(
+        "Detected Java process crash, pid: $0, within $1 seconds of symbolization agent attach. "
+        "Disabling Java symbolization.",
+        upid.pid, delta.count());
   }
 }
 
@@ -84,5 +94,18 @@ std::vector<ProbeStatusRecord> StirlingMonitor::ConsumeProbeStatusRecords() {
   return std::move(probe_status_records_);
 }
 
+void StirlingMonitor::AppendSourceStatsRecord(SourceStatsRecord record) {
+  absl::base_internal::SpinLockHolder lock(&source_stats_lock_);
+  if (source_stats_records_.size() >= kMaxSourceStatsRecords) {
+    return;
+  }
+  source_stats_records_.push_back(std::move(record));
+}
+
+std::vector<SourceStatsRecord> StirlingMonitor::ConsumeSourceStatsRecords() {
+  absl::base_internal::SpinLockHolder lock(&source_stats_lock_);
+  return std::move(source_stats_records_);
+}
+
 }  // namespace stirling
 }  // namespace px
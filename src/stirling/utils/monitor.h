@@ -20,7 +20,9 @@
 
 #include <prometheus/counter.h>
 
+#include <absl/base/internal/spinlock.h>
 #include <absl/container/flat_hash_map.h>
+#include <atomic>
 #include <string>
 #include <utility>
 #include <vector>
@@ -51,6 +53,23 @@ struct ProbeStatusRecord {
   std::string info = "";
 };
 
+// Cost and output of a Stirling Source Connector since its previous push.
+// One record is added per push, which happens at least once per push period, and earlier when the
+// source has buffered a lot of data (see DataExceedsThreshold()).
+struct SourceStatsRecord {
+  int64_t timestamp_ns = 0;
+  std::string source_connector;
+  int64_t num_transfers = 0;
+  int64_t transfer_wall_time_ns = 0;
+  int64_t transfer_cpu_time_ns = 0;
+  int64_t push_wall_time_ns = 0;
+  int64_t push_cpu_time_ns = 0;
+  int64_t records_pushed = 0;
+  int64_t bytes_pushed = 0;
+  int64_t data_loss_events = 0;
+  std::string info = "";
+};
+
 class StirlingMonitor : NotCopyMoveable {
  public:
   static StirlingMonitor* GetInstance() {
@@ -59,10 +78,17 @@ class StirlingMonitor : NotCopyMoveable {
   }
 
   // Java Process.
+  // These are called from different sources (perf profiler and proc_exit), which may run on
+  // different threads, so the attach times are guarded by a lock.
   void NotifyJavaProcessAttach(const struct upid_t& upid);
   void NotifyJavaProcessCrashed(const struct upid_t& upid);
   void ResetJavaProcessAttachTrackers();
 
+  // True once a Java process crashed within kCrashWindow of a symbolization agent attach.
+  // No more symbolization agents are attached after that.
+  bool java_symbols_disabled() const { return java_symbols_disabled_; }
+  void ResetJavaSymbolsDisabledForTesting() { java_symbols_disabled_ = false; }
+
   // Stirling Error Reporting.
   void AppendProbeStatusRecord(const std::string& source_connector, const std::string& tracepoint,
                                const Status& status, const std::string& info);
@@ -71,21 +97,35 @@ class StirlingMonitor : NotCopyMoveable {
   std::vector<ProbeStatusRecord> ConsumeProbeStatusRecords();
   std::vector<SourceStatusRecord> ConsumeSourceStatusRecords();
 
+  // Stirling Source Connector cost reporting.
+  void AppendSourceStatsRecord(SourceStatsRecord record);
+  std::vector<SourceStatsRecord> ConsumeSourceStatsRecords();
+
   static constexpr auto kCrashWindow = std::chrono::seconds{5};
 
+  // Source stats records are only consumed if the stirling_error source is registered,
+  // so the number of buffered records is capped. Records beyond the cap are dropped.
+  static constexpr size_t kMaxSourceStatsRecords = 1024;
+
  private:
   StirlingMonitor();
   using timestamp_t = std::chrono::time_point<std::chrono::steady_clock>;
-  absl::flat_hash_map<struct upid_t, timestamp_t> java_proc_attach_times_;
+  absl::flat_hash_map<struct upid_t, timestamp_t> java_proc_attach_times_
+      ABSL_GUARDED_BY(java_proc_attach_lock_);
+  std::atomic<bool> java_symbols_disabled_ = false;
 
   // Records of probe deployment status.
   std::vector<ProbeStatusRecord> probe_status_records_ ABSL_GUARDED_BY(probe_status_lock_);
   // Records of Stirling Source Connector status.
   std::vector<SourceStatusRecord> source_status_records_ ABSL_GUARDED_BY(source_status_lock_);
+  // Records of Stirling Source Connector cost.
+  std::vector<SourceStatsRecord> source_stats_records_ ABSL_GUARDED_BY(source_stats_lock_);
 
-  // Lock to protect probe and source records.
+  // Locks to protect Java process attach times, and probe and source records.
+  absl::base_internal::SpinLock java_proc_attach_lock_;
   absl::base_internal::SpinLock probe_status_lock_;
   absl::base_internal::SpinLock source_status_lock_;
+  absl::base_internal::SpinLock source_stats_lock_;
 
   prometheus::Counter& java_proc_crashed_during_attach_;
 };
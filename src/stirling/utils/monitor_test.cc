@@ -22,38 +22,36 @@
 #include "src/stirling/testing/common.h"
 #include "src/stirling/utils/monitor.h"
 
-DECLARE_bool(stirling_profiler_java_symbols);
-
 namespace px {
 namespace stirling {
 
 TEST(MonitorTest, DisablesJavaIfCrashInWindow) {
-  PL_SET_FOR_SCOPE(FLAGS_stirling_profiler_java_symbols, true);
   StirlingMonitor& monitor = *StirlingMonitor::GetInstance();
+  monitor.ResetJavaSymbolsDisabledForTesting();
   constexpr struct upid_t kUPID = {{0}, 0};
   monitor.NotifyJavaProcessAttach(kUPID);
 
-  EXPECT_TRUE(FLAGS_stirling_profiler_java_symbols);
+  EXPECT_FALSE(monitor.java_symbols_disabled());
   monitor.NotifyJavaProcessCrashed(kUPID);
-  EXPECT_FALSE(FLAGS_stirling_profiler_java_symbols);
+  EXPECT_TRUE(monitor.java_symbols_disabled());
 }
 
 TEST(MonitorTest, DoesNotDisableAfterTrackerClear) {
-  PL_SET_FOR_SCOPE(FLAGS_stirling_profiler_java_symbols, true);
   StirlingMonitor& monitor = *StirlingMonitor::GetInstance();
+  monitor.ResetJavaSymbolsDisabledForTesting();
 
   constexpr struct upid_t kUPID = {{1}, 0};
   monitor.NotifyJavaProcessAttach(kUPID);
 
-  EXPECT_TRUE(FLAGS_stirling_profiler_java_symbols);
+  EXPECT_FALSE(monitor.java_symbols_disabled());
   monitor.ResetJavaProcessAttachTrackers();
   monitor.NotifyJavaProcessCrashed(kUPID);
-  EXPECT_TRUE(FLAGS_stirling_profiler_java_symbols);
+  EXPECT_FALSE(monitor.java_symbols_disabled());
 }
 
 TEST(MonitorTest, DoesNotDisableJavaIfNotInCrashInWindow) {
-  PL_SET_FOR_SCOPE(FLAGS_stirling_profiler_java_symbols, true);
   StirlingMonitor& monitor = *StirlingMonitor::GetInstance();
+  monitor.ResetJavaSymbolsDisabledForTesting();
 
   constexpr struct upid_t kUPID = {{2}, 0};
   monitor.NotifyJavaProcessAttach(kUPID);
@@ -61,9 +59,23 @@ TEST(MonitorTest, DoesNotDisableJavaIfNotInCrashInWindow) {
   // TODO(jps): Switch over to clock injection method.
   sleep(StirlingMonitor::kCrashWindow.count());
 
-  EXPECT_TRUE(FLAGS_stirling_profiler_java_symbols);
+  EXPECT_FALSE(monitor.java_symbols_disabled());
   monitor.NotifyJavaProcessCrashed(kUPID);
-  EXPECT_TRUE(FLAGS_stirling_profiler_java_symbols);
+  EXPECT_FALSE(monitor.java_symbols_disabled());
+}
+
+TEST(MonitorTest, SourceStatsRecordsAreCapped) {
+  StirlingMonitor& monitor = *StirlingMonitor::GetInstance();
+  monitor.ConsumeSourceStatsRecords();
+
+  for (size_t i = 0; i < StirlingMonitor::kMaxSourceStatsRecords + 10; ++i) {
+    monitor.AppendSourceStatsRecord({.source_connector = "source", .num_transfers = 1});
+  }
+  EXPECT_EQ(monitor.ConsumeSourceStatsRecords().size(), StirlingMonitor::kMaxSourceStatsRecords);
+
+  // Consuming makes room for new records.
+  monitor.AppendSourceStatsRecord({.source_connector = "source", .num_transfers = 1});
+  EXPECT_EQ(monitor.ConsumeSourceStatsRecords().size(), 1);
 }
 
 }  // namespace stirling
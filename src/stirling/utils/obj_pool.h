@@ -18,13 +18,29 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
 namespace px {
 namespace stirling {
 
+/**
+ * Hit/miss counters for a recycling pool. A hit is a Pop() that was served from the pool,
+ * a miss is one that required a fresh allocation.
+ */
+struct PoolStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+
+  double HitRate() const {
+    uint64_t total = hits + misses;
+    return total == 0 ? 0.0 : 1.0 * hits / total;
+  }
+};
+
 /**
  * ObjPool manages a pool of objects that can be recycled to avoid memory reallocations.
  */
@@ -49,11 +65,13 @@ class ObjPool {
    */
   std::unique_ptr<T> Pop() {
     if (obj_pool_.empty()) {
+      ++stats_.misses;
       auto obj_ptr = std::make_unique<T>();
       VLOG(1) << absl::Substitute("Pool is empty...creating new object [addr=$0].", obj_ptr.get());
       return obj_ptr;
     }
 
+    ++stats_.hits;
     VLOG(1) << absl::Substitute("Retrieving object from recycle pool [addr=$0].", obj_pool_.back());
     // The objects's memory was never released, but we still to initialize the object
     // as though it is new, so we use C++ "placement new" to do so.
@@ -80,9 +98,65 @@ class ObjPool {
     obj_ptr->~T();
   }
 
+  const PoolStats& stats() const { return stats_; }
+
  private:
   size_t capacity_;
   std::vector<T*> obj_pool_;
+  PoolStats stats_;
+};
+
+/**
+ * ValuePool holds moved-from values whose internal storage (e.g. the blocks of a container)
+ * can be reused. Unlike ObjPool, the objects are not reconstructed on Pop(); the caller is
+ * responsible for putting them into a clean state, typically by clearing them before Recycle().
+ *
+ * Multiple pools can share a single PoolStats so that hit rates can be reported for a family of
+ * pools (e.g. one per frame type).
+ */
+template <typename T>
+class ValuePool {
+ public:
+  explicit ValuePool(size_t capacity, PoolStats* stats = nullptr)
+      : capacity_(capacity), stats_(stats != nullptr ? stats : &own_stats_) {
+    pool_.reserve(capacity_);
+  }
+
+  ValuePool(const ValuePool&) = delete;
+  ValuePool& operator=(const ValuePool&) = delete;
+
+  /**
+   * Pop() returns a recycled value, or std::nullopt if the pool is empty.
+   */
+  std::optional<T> Pop() {
+    if (pool_.empty()) {
+      ++stats_->misses;
+      return std::nullopt;
+    }
+    ++stats_->hits;
+    std::optional<T> val(std::move(pool_.back()));
+    pool_.pop_back();
+    return val;
+  }
+
+  /**
+   * Recycle() submits a value for recycling. The value is dropped if the pool is at capacity.
+   */
+  void Recycle(T&& val) {
+    if (pool_.size() >= capacity_) {
+      return;
+    }
+    pool_.push_back(std::move(val));
+  }
+
+  size_t size() const { return pool_.size(); }
+  const PoolStats& stats() const { return *stats_; }
+
+ private:
+  size_t capacity_;
+  std::vector<T> pool_;
+  PoolStats own_stats_;
+  PoolStats* stats_;
 };
 
 }  // namespace stirling
@@ -16,7 +16,9 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "src/common/testing/testing.h"
 
@@ -88,6 +90,48 @@ TEST_F(ObjPoolTest, Capacity) {
   EXPECT_NE(uptrs[4].get(), ptrs[1]);
   EXPECT_NE(uptrs[4].get(), ptrs[2]);
   EXPECT_NE(uptrs[4].get(), ptrs[3]);
+
+  EXPECT_EQ(obj_pool.stats().hits, 4);
+  EXPECT_EQ(obj_pool.stats().misses, 6);
+}
+
+TEST(ValuePoolTest, StorageRecycled) {
+  ValuePool<std::vector<int>> pool(1);
+
+  EXPECT_EQ(pool.Pop(), std::nullopt);
+
+  std::vector<int> v(1000);
+  const int* data = v.data();
+  v.clear();
+  pool.Recycle(std::move(v));
+
+  // Pool is at capacity, so this one is dropped.
+  pool.Recycle(std::vector<int>(10));
+  EXPECT_EQ(pool.size(), 1);
+
+  std::optional<std::vector<int>> recycled = pool.Pop();
+  ASSERT_TRUE(recycled.has_value());
+  EXPECT_TRUE(recycled->empty());
+  EXPECT_GE(recycled->capacity(), 1000);
+  EXPECT_EQ(recycled->data(), data);
+
+  EXPECT_EQ(pool.stats().hits, 1);
+  EXPECT_EQ(pool.stats().misses, 1);
+  EXPECT_DOUBLE_EQ(pool.stats().HitRate(), 0.5);
+}
+
+TEST(ValuePoolTest, SharedStats) {
+  PoolStats stats;
+  ValuePool<std::string> pool_a(4, &stats);
+  ValuePool<std::vector<int>> pool_b(4, &stats);
+
+  pool_a.Pop();
+  pool_b.Recycle(std::vector<int>(10));
+  pool_b.Pop();
+
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(&pool_a.stats(), &pool_b.stats());
 }
 
 }  // namespace stirling
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <absl/base/internal/spinlock.h>
 #include <absl/container/flat_hash_set.h>
 
 #include <utility>
@@ -64,6 +65,7 @@ class ProcTracker : NotCopyMoveable {
 
 /**
  * Tracks the java processes that are being monitored by Java profiling agent.
+ * Added to by the perf profiler and queried by proc_exit, which may run on different threads.
  */
 class JavaProfilingProcTracker : NotCopyMoveable {
  public:
@@ -78,17 +80,30 @@ class JavaProfilingProcTracker : NotCopyMoveable {
   /**
    * Inserts the upid of a Java process to the list being tracked.
    */
-  void Add(struct upid_t upid) { upids_.insert(std::move(upid)); }
+  void Add(struct upid_t upid) {
+    absl::base_internal::SpinLockHolder lock(&lock_);
+    upids_.insert(std::move(upid));
+  }
 
   /**
    * Removes the upid of a Java process from the list being tracked.
    */
-  void Remove(const struct upid_t& upid) { upids_.erase(upid); }
+  void Remove(const struct upid_t& upid) {
+    absl::base_internal::SpinLockHolder lock(&lock_);
+    upids_.erase(upid);
+  }
 
-  const auto& upids() const { return upids_; }
+  /**
+   * Returns true if the upid of a Java process is being tracked.
+   */
+  bool Contains(const struct upid_t& upid) const {
+    absl::base_internal::SpinLockHolder lock(&lock_);
+    return upids_.contains(upid);
+  }
 
  private:
-  absl::flat_hash_set<struct upid_t> upids_;
+  mutable absl::base_internal::SpinLock lock_;
+  absl::flat_hash_set<struct upid_t> upids_ ABSL_GUARDED_BY(lock_);
 };
 
 }  // namespace stirling
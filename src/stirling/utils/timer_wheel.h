@@ -0,0 +1,137 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace px {
+namespace stirling {
+
+/**
+ * TimerWheel is a hierarchical timing wheel that schedules items at integer ticks.
+ *
+ * Scheduling an item is O(1), and advancing the wheel by one tick only touches the items that
+ * are due on that tick (plus an amortized cascade of the items in the higher levels), so
+ * the cost of advancing is independent of the number of items that are scheduled in the future.
+ *
+ * Each of the kNumLevels levels has kNumSlots slots; level L covers deadlines that are less
+ * than kNumSlots^(L+1) ticks away. Deadlines beyond the range of the wheel are clamped to the
+ * furthest tick that fits, so callers must be prepared to receive an item before its deadline
+ * and reschedule it.
+ *
+ * There is no cancellation; callers should tolerate stale items (e.g. by checking a
+ * per-item deadline when the item fires).
+ */
+template <typename T>
+class TimerWheel {
+ public:
+  static constexpr int kSlotBits = 6;
+  static constexpr size_t kNumSlots = 1 << kSlotBits;
+  static constexpr int kNumLevels = 4;
+  static constexpr uint64_t kMaxDelta = (uint64_t{1} << (kSlotBits * kNumLevels)) - 1;
+
+  /**
+   * Schedules an item to fire at the specified tick.
+   * Deadlines that are not in the future fire on the next tick.
+   */
+  void Schedule(T item, uint64_t deadline_tick) {
+    deadline_tick = std::clamp(deadline_tick, current_tick_ + 1, current_tick_ + kMaxDelta);
+    Insert(Entry{std::move(item), deadline_tick});
+    ++size_;
+  }
+
+  /**
+   * Advances the wheel to the specified tick, appending all items due at or before it to
+   * expired. Each expired item is returned with its (possibly clamped) deadline.
+   */
+  void Advance(uint64_t tick, std::vector<std::pair<T, uint64_t>>* expired) {
+    while (current_tick_ < tick) {
+      ++current_tick_;
+
+      // Cascade the higher levels down first, from the top, so that their items land in the
+      // lower-level slots before those are processed.
+      for (int level = kNumLevels - 1; level > 0; --level) {
+        if ((current_tick_ & LevelMask(level)) == 0) {
+          Cascade(level);
+        }
+      }
+
+      auto& slot = levels_[0][SlotIndex(current_tick_, 0)];
+      for (auto& entry : slot) {
+        expired->emplace_back(std::move(entry.item), entry.deadline_tick);
+      }
+      size_ -= slot.size();
+      slot.clear();
+    }
+  }
+
+  uint64_t current_tick() const { return current_tick_; }
+
+  /**
+   * Number of items scheduled, including ones that may be stale to the caller.
+   */
+  size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+ private:
+  struct Entry {
+    T item;
+    uint64_t deadline_tick;
+  };
+
+  // Mask of the tick bits below the given level.
+  static constexpr uint64_t LevelMask(int level) {
+    return (uint64_t{1} << (kSlotBits * level)) - 1;
+  }
+
+  static constexpr size_t SlotIndex(uint64_t tick, int level) {
+    return (tick >> (kSlotBits * level)) & (kNumSlots - 1);
+  }
+
+  void Insert(Entry entry) {
+    const uint64_t delta = entry.deadline_tick - current_tick_;
+
+    int level = 0;
+    while (level < kNumLevels - 1 && delta > LevelMask(level + 1)) {
+      ++level;
+    }
+    levels_[level][SlotIndex(entry.deadline_tick, level)].push_back(std::move(entry));
+  }
+
+  void Cascade(int level) {
+    auto& slot = levels_[level][SlotIndex(current_tick_, level)];
+    std::vector<Entry> entries;
+    entries.swap(slot);
+    for (auto& entry : entries) {
+      Insert(std::move(entry));
+    }
+  }
+
+  uint64_t current_tick_ = 0;
+  size_t size_ = 0;
+  std::array<std::array<std::vector<Entry>, kNumSlots>, kNumLevels> levels_;
+};
+
+}  // namespace stirling
+}  // namespace px
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "src/common/testing/testing.h"
+
+#include "src/stirling/utils/timer_wheel.h"
+
+namespace px {
+namespace stirling {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::Pair;
+using ::testing::UnorderedElementsAre;
+
+TEST(TimerWheelTest, FiresOnDeadline) {
+  TimerWheel<int> wheel;
+  std::vector<std::pair<int, uint64_t>> expired;
+
+  wheel.Schedule(1, 3);
+  wheel.Schedule(2, 3);
+  wheel.Schedule(3, 100);
+  EXPECT_EQ(wheel.size(), 3);
+
+  wheel.Advance(2, &expired);
+  EXPECT_THAT(expired, IsEmpty());
+
+  wheel.Advance(3, &expired);
+  EXPECT_THAT(expired, UnorderedElementsAre(Pair(1, 3), Pair(2, 3)));
+  EXPECT_EQ(wheel.size(), 1);
+
+  expired.clear();
+  wheel.Advance(99, &expired);
+  EXPECT_THAT(expired, IsEmpty());
+
+  // Items in higher levels cascade down and fire on time.
+  wheel.Advance(100, &expired);
+  EXPECT_THAT(expired, ElementsAre(Pair(3, 100)));
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, PastDeadlinesFireOnNextTick) {
+  TimerWheel<int> wheel;
+  std::vector<std::pair<int, uint64_t>> expired;
+
+  wheel.Advance(10, &expired);
+  wheel.Schedule(1, 5);
+  wheel.Advance(11, &expired);
+  EXPECT_THAT(expired, ElementsAre(Pair(1, 11)));
+}
+
+TEST(TimerWheelTest, FarDeadlinesAreClamped) {
+  TimerWheel<int> wheel;
+  std::vector<std::pair<int, uint64_t>> expired;
+
+  wheel.Schedule(1, TimerWheel<int>::kMaxDelta * 2);
+  wheel.Advance(TimerWheel<int>::kMaxDelta, &expired);
+  EXPECT_THAT(expired, ElementsAre(Pair(1, TimerWheel<int>::kMaxDelta)));
+}
+
+// Compares the wheel against a reference std::multimap, over random deadlines that span all
+// levels of the wheel and random advance step sizes.
+TEST(TimerWheelTest, MatchesReference) {
+  constexpr uint64_t kMaxTick = 1 << 22;
+  std::default_random_engine rng(37);
+  std::uniform_int_distribution<int> level_dist(0, TimerWheel<int>::kNumLevels - 1);
+  std::uniform_int_distribution<uint64_t> step_dist(1, 200);
+
+  TimerWheel<int> wheel;
+  std::multimap<uint64_t, int> reference;
+  std::vector<std::pair<int, uint64_t>> expired;
+
+  int id = 0;
+  uint64_t tick = 0;
+  while (tick < kMaxTick) {
+    int level = level_dist(rng);
+    std::uniform_int_distribution<uint64_t> delta_dist(0, uint64_t{1} << (6 * (level + 1)));
+    uint64_t deadline = tick + delta_dist(rng);
+    wheel.Schedule(id, deadline);
+    reference.emplace(std::clamp(deadline, tick + 1, tick + TimerWheel<int>::kMaxDelta), id);
+    ++id;
+
+    tick += step_dist(rng);
+    expired.clear();
+    wheel.Advance(tick, &expired);
+
+    std::vector<int> expected_ids;
+    while (!reference.empty() && reference.begin()->first <= tick) {
+      expected_ids.push_back(reference.begin()->second);
+      reference.erase(reference.begin());
+    }
+    std::vector<int> ids;
+    for (const auto& [item, deadline_tick] : expired) {
+      ASSERT_LE(deadline_tick, tick);
+      ids.push_back(item);
+    }
+    std::sort(ids.begin(), ids.end());
+    std::sort(expected_ids.begin(), expected_ids.end());
+    ASSERT_EQ(ids, expected_ids);
+    ASSERT_EQ(wheel.size(), reference.size());
+  }
+}
+
+}  // namespace stirling
+}  // namespace px
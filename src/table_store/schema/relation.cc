@@ -182,7 +182,8 @@ Status Relation::FromProto(const table_store::schemapb::Relation* relation_pb) {
   }
   for (int idx = 0; idx < relation_pb->columns_size(); ++idx) {
     auto column = relation_pb->columns(idx);
-    AddColumn(column.column_type(), column.column_name(), column.column_semantic_type());
+    AddColumn(column.column_type(), column.column_name(), column.column_semantic_type(),
+              column.column_desc());
   }
   return Status::OK();
 }
@@ -19,8 +19,11 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <absl/strings/match.h>
+
 #include "src/common/base/base.h"
 #include "src/shared/types/typespb/wrapper/types_pb_wrapper.h"
 #include "src/table_store/schemapb/schema.pb.h"
@@ -35,6 +38,15 @@ using ColDescArray = std::vector<std::string>;
 using ColPatternTypeArray = std::vector<types::PatternType>;
 using ColSemanticTypeArray = std::vector<types::SemanticType>;
 
+// Columns whose description ends with this hold metadata that was resolved when the row was
+// written (e.g. the pod_id column that the PEM adds to tables with a upid). The planner reads the
+// metadata from these columns, instead of converting a key column.
+inline constexpr std::string_view kIngestTimeMetadataDescSuffix = " (resolved at ingest time)";
+
+inline bool IsIngestTimeMetadataDesc(std::string_view desc) {
+  return absl::EndsWith(desc, kIngestTimeMetadataDescSuffix);
+}
+
 /**
  * Relation tracks columns/types for a given table/operator
  */
@@ -39,10 +39,21 @@ DEFINE_int32(table_store_stirling_error_limit_bytes,
              "The maximum amount of data to store in the two tables for Stirling error reporting, "
              "the stirling_error table and probe_status table.");
 
+DEFINE_int32(table_store_stirling_source_stats_limit_bytes,
+             gflags::Int32FromEnv("PL_TABLE_STORE_STIRLING_SOURCE_STATS_LIMIT_BYTES",
+                                  4 * 1024 * 1024),
+             "The maximum amount of data to store in the stirling_source_stats table.");
+
 DEFINE_int32(table_store_proc_exit_events_limit_bytes,
              gflags::Int32FromEnv("PL_TABLE_STORE_PROC_EXIT_EVENTS_LIMIT_BYTES", 10 * 1024 * 1024),
              "The maximum amount of data to store in the proc_exit_events table.");
 
+DEFINE_bool(pem_enrich_upid_metadata,
+            gflags::BoolFromEnv("PL_PEM_ENRICH_UPID_METADATA", false),
+            "Whether to add the pod ID, service ID and namespace of the process to the records of "
+            "tables with a UPID column, when they are ingested. Queries read these columns "
+            "instead of looking up the metadata of every row.");
+
 namespace px {
 namespace vizier {
 namespace agent {
@@ -54,9 +65,18 @@ Status PEMManager::InitImpl() {
 }
 
 Status PEMManager::PostRegisterHookImpl() {
-  stirling_->RegisterDataPushCallback(std::bind(&table_store::TableStore::AppendData, table_store(),
-                                                std::placeholders::_1, std::placeholders::_2,
-                                                std::placeholders::_3));
+  if (FLAGS_pem_enrich_upid_metadata) {
+    upid_metadata_enricher_ = std::make_unique<UPIDMetadataEnricher>(
+        table_store(),
+        std::bind(&px::md::AgentMetadataStateManager::CurrentAgentMetadataState, mds_manager()));
+    stirling_->RegisterDataPushCallback(
+        std::bind(&UPIDMetadataEnricher::AppendData, upid_metadata_enricher_.get(),
+                  std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+  } else {
+    stirling_->RegisterDataPushCallback(std::bind(&table_store::TableStore::AppendData,
+                                                  table_store(), std::placeholders::_1,
+                                                  std::placeholders::_2, std::placeholders::_3));
+  }
 
   // Enable use of USR1/USR2 for controlling Stirling debug.
   stirling_->RegisterUserDebugSignalHandlers();
@@ -97,12 +117,20 @@ Status PEMManager::InitSchemas() {
   int64_t http_table_size = (FLAGS_table_store_http_events_percent * memory_limit) / 100;
   int64_t stirling_error_table_size = FLAGS_table_store_stirling_error_limit_bytes / 2;
   int64_t probe_status_table_size = FLAGS_table_store_stirling_error_limit_bytes / 2;
+  int64_t source_stats_table_size = FLAGS_table_store_stirling_source_stats_limit_bytes;
   int64_t proc_exit_events_table_size = FLAGS_table_store_proc_exit_events_limit_bytes;
-  int64_t other_table_size = (memory_limit - http_table_size - stirling_error_table_size -
-                              probe_status_table_size - proc_exit_events_table_size) /
-                             (num_tables - 4);
+  int64_t other_table_size =
+      (memory_limit - http_table_size - stirling_error_table_size - probe_status_table_size -
+       source_stats_table_size - proc_exit_events_table_size) /
+      (num_tables - 5);
+
+  for (auto& relation_info : relation_info_vec) {
+    if (upid_metadata_enricher_ != nullptr &&
+        UPIDMetadataEnricher::CanEnrich(relation_info.relation)) {
+      relation_info.relation =
+          upid_metadata_enricher_->AddTable(relation_info.id, relation_info.relation);
+    }
 
-  for (const auto& relation_info : relation_info_vec) {
     std::shared_ptr<table_store::Table> table_ptr;
     if (relation_info.name == "http_events") {
       // Special case to set the max size of the http_events table differently from the other
@@ -116,6 +144,9 @@ Status PEMManager::InitSchemas() {
     } else if (relation_info.name == "probe_status") {
       table_ptr = std::make_shared<table_store::Table>(relation_info.name, relation_info.relation,
                                                        probe_status_table_size);
+    } else if (relation_info.name == "stirling_source_stats") {
+      table_ptr = std::make_shared<table_store::Table>(relation_info.name, relation_info.relation,
+                                                       source_stats_table_size);
     } else if (relation_info.name == "proc_exit_events") {
       table_ptr = std::make_shared<table_store::Table>(relation_info.name, relation_info.relation,
                                                        proc_exit_events_table_size);
@@ -29,6 +29,7 @@
 #include "src/stirling/stirling.h"
 #include "src/vizier/services/agent/manager/manager.h"
 #include "src/vizier/services/agent/pem/tracepoint_manager.h"
+#include "src/vizier/services/agent/pem/upid_metadata_enricher.h"
 
 namespace px {
 namespace vizier {
@@ -91,6 +92,9 @@ class PEMManager : public Manager {
 
   std::unique_ptr<stirling::Stirling> stirling_;
   std::shared_ptr<TracepointManager> tracepoint_manager_;
+  // Adds K8s metadata columns to Stirling records before they reach the table store.
+  // Only set when enabled by --pem_enrich_upid_metadata.
+  std::unique_ptr<UPIDMetadataEnricher> upid_metadata_enricher_;
 
   // Timer for triggering ClockConverter polls.
   px::event::TimerUPtr clock_converter_timer_;
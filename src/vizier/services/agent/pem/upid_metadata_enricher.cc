@@ -0,0 +1,118 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "src/vizier/services/agent/pem/upid_metadata_enricher.h"
+
+#include <utility>
+
+#include "src/carnot/funcs/metadata/metadata_ops.h"
+
+namespace px {
+namespace vizier {
+namespace agent {
+
+using ::px::table_store::schema::kIngestTimeMetadataDescSuffix;
+using ::px::table_store::schema::Relation;
+
+bool UPIDMetadataEnricher::CanEnrich(const Relation& relation) {
+  if (!relation.HasColumn(kUPIDColumn) ||
+      relation.GetColumnType(kUPIDColumn) != types::DataType::UINT128) {
+    return false;
+  }
+  for (const char* col : {kPodIDColumn, kServiceIDColumn, kNamespaceColumn}) {
+    if (relation.HasColumn(col)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Relation UPIDMetadataEnricher::AddTable(uint64_t table_id, const Relation& relation) {
+  DCHECK(CanEnrich(relation));
+  upid_col_idxs_[table_id] = relation.GetColumnIndex(kUPIDColumn);
+
+  Relation enriched_relation(relation);
+  // The description marks the columns as precomputed metadata for the planner.
+  enriched_relation.AddColumn(
+      types::DataType::STRING, kPodIDColumn, types::ST_NONE,
+      absl::StrCat("The ID of the pod of the process", kIngestTimeMetadataDescSuffix));
+  enriched_relation.AddColumn(
+      types::DataType::STRING, kServiceIDColumn, types::ST_NONE,
+      absl::StrCat("The ID of the service of the process", kIngestTimeMetadataDescSuffix));
+  enriched_relation.AddColumn(
+      types::DataType::STRING, kNamespaceColumn, types::ST_NAMESPACE_NAME,
+      absl::StrCat("The namespace of the process", kIngestTimeMetadataDescSuffix));
+  return enriched_relation;
+}
+
+Status UPIDMetadataEnricher::AppendData(
+    uint64_t table_id, types::TabletID tablet_id,
+    std::unique_ptr<types::ColumnWrapperRecordBatch> record_batch) {
+  auto it = upid_col_idxs_.find(table_id);
+  if (it != upid_col_idxs_.end()) {
+    Enrich(it->second, record_batch.get());
+  }
+  return table_store_->AppendData(table_id, tablet_id, std::move(record_batch));
+}
+
+const UPIDMetadataEnricher::UPIDMetadata& UPIDMetadataEnricher::LookupUPID(
+    const absl::uint128& upid) {
+  auto [it, inserted] = upid_metadata_.try_emplace(upid);
+  if (inserted) {
+    // Resolve through the metadata UDFs, so that the values are the ones a query would compute.
+    carnot::udf::FunctionContext ctx(cached_md_, nullptr);
+    types::UInt128Value upid_value(upid);
+    it->second.pod_id = carnot::funcs::metadata::UPIDToPodIDUDF().Exec(&ctx, upid_value);
+    it->second.service_id = carnot::funcs::metadata::UPIDToServiceIDUDF().Exec(&ctx, upid_value);
+    it->second.ns = carnot::funcs::metadata::UPIDToNamespaceUDF().Exec(&ctx, upid_value);
+  }
+  return it->second;
+}
+
+void UPIDMetadataEnricher::Enrich(int64_t upid_col_idx,
+                                  types::ColumnWrapperRecordBatch* record_batch) {
+  auto md = agent_metadata_callback_();
+  if (md != cached_md_ || upid_metadata_.size() > kMaxCachedUPIDs) {
+    upid_metadata_.clear();
+    cached_md_ = std::move(md);
+  }
+
+  const auto& upid_col = record_batch->at(upid_col_idx);
+  size_t num_records = upid_col->Size();
+  auto pod_ids = std::make_shared<types::StringValueColumnWrapper>(num_records);
+  auto service_ids = std::make_shared<types::StringValueColumnWrapper>(num_records);
+  auto namespaces = std::make_shared<types::StringValueColumnWrapper>(num_records);
+
+  // Without metadata, the columns are left empty, as the metadata UDFs would return.
+  if (cached_md_ != nullptr) {
+    for (size_t i = 0; i < num_records; ++i) {
+      const UPIDMetadata& upid_md = LookupUPID(upid_col->Get<types::UInt128Value>(i).val);
+      (*pod_ids)[i] = upid_md.pod_id;
+      (*service_ids)[i] = upid_md.service_id;
+      (*namespaces)[i] = upid_md.ns;
+    }
+  }
+
+  record_batch->push_back(std::move(pod_ids));
+  record_batch->push_back(std::move(service_ids));
+  record_batch->push_back(std::move(namespaces));
+}
+
+}  // namespace agent
+}  // namespace vizier
+}  // namespace px
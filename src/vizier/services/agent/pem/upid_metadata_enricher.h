@@ -0,0 +1,108 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/numeric/int128.h>
+
+#include "src/common/base/base.h"
+#include "src/shared/metadata/metadata_state.h"
+#include "src/shared/types/column_wrapper.h"
+#include "src/table_store/schema/relation.h"
+#include "src/table_store/table/table_store.h"
+
+namespace px {
+namespace vizier {
+namespace agent {
+
+/**
+ * UPIDMetadataEnricher adds K8s metadata columns to the records of tables that have a UPID
+ * column, before they are appended to the table store.
+ *
+ * The pod ID, service ID and namespace of each row are resolved from the agent metadata when the
+ * row is written. Queries can then read them directly, rather than looking them up for every row
+ * of every query, and rows keep their attribution after the pod's metadata has expired.
+ */
+class UPIDMetadataEnricher : public NotCopyable {
+ public:
+  using AgentMetadataCallback = std::function<std::shared_ptr<const md::AgentMetadataState>()>;
+
+  static constexpr char kUPIDColumn[] = "upid";
+  static constexpr char kPodIDColumn[] = "pod_id";
+  static constexpr char kServiceIDColumn[] = "service_id";
+  static constexpr char kNamespaceColumn[] = "namespace";
+
+  // Bounds the UPID cache between metadata updates.
+  static constexpr size_t kMaxCachedUPIDs = 64 * 1024;
+
+  UPIDMetadataEnricher(table_store::TableStore* table_store,
+                       AgentMetadataCallback agent_metadata_callback)
+      : table_store_(table_store), agent_metadata_callback_(std::move(agent_metadata_callback)) {}
+
+  /**
+   * Returns whether records of the relation can be enriched: it needs a UPID column, and none of
+   * the enrichment columns.
+   */
+  static bool CanEnrich(const table_store::schema::Relation& relation);
+
+  /**
+   * Registers a table for enrichment, and returns the relation of the enriched records, which
+   * is the relation the table must be created with.
+   * Tables are registered before any data is pushed, so registration is not thread-safe.
+   */
+  table_store::schema::Relation AddTable(uint64_t table_id,
+                                         const table_store::schema::Relation& relation);
+
+  /**
+   * Enriches the records of registered tables, and appends them to the table store.
+   * Records of other tables are appended unchanged.
+   * Has the same signature as TableStore::AppendData, so it can be used as a data push callback.
+   */
+  Status AppendData(uint64_t table_id, types::TabletID tablet_id,
+                    std::unique_ptr<types::ColumnWrapperRecordBatch> record_batch);
+
+ private:
+  struct UPIDMetadata {
+    std::string pod_id;
+    std::string service_id;
+    std::string ns;
+  };
+
+  const UPIDMetadata& LookupUPID(const absl::uint128& upid);
+  void Enrich(int64_t upid_col_idx, types::ColumnWrapperRecordBatch* record_batch);
+
+  table_store::TableStore* table_store_;
+  AgentMetadataCallback agent_metadata_callback_;
+
+  // Index of the UPID column, by table ID.
+  absl::flat_hash_map<uint64_t, int64_t> upid_col_idxs_;
+
+  // The metadata of every UPID seen since the last metadata update. A UPID repeats on many
+  // records, so each one is only resolved once, and its strings are copied into the columns.
+  std::shared_ptr<const md::AgentMetadataState> cached_md_;
+  absl::flat_hash_map<absl::uint128, UPIDMetadata> upid_metadata_;
+};
+
+}  // namespace agent
+}  // namespace vizier
+}  // namespace px
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2018- The Pixie Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "src/common/testing/testing.h"
+#include "src/shared/k8s/metadatapb/test_proto.h"
+#include "src/shared/metadata/state_manager.h"
+#include "src/shared/metadata/test_utils.h"
+#include "src/vizier/services/agent/pem/upid_metadata_enricher.h"
+
+namespace px {
+namespace vizier {
+namespace agent {
+
+using ::px::table_store::Table;
+using ::px::table_store::schema::Relation;
+using ResourceUpdate = px::shared::k8s::metadatapb::ResourceUpdate;
+
+constexpr uint64_t kTableID = 1;
+
+class UPIDMetadataEnricherTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    metadata_state_ = std::make_shared<md::AgentMetadataState>(
+        /* hostname */ "myhost",
+        /* asid */ 1, /* pid */ 123, sole::uuid4(), "mypod", sole::uuid4(), "myvizier");
+    moodycamel::BlockingConcurrentQueue<std::unique_ptr<ResourceUpdate>> updates;
+    updates.enqueue(metadatapb::testutils::CreateRunningContainerUpdatePB());
+    updates.enqueue(metadatapb::testutils::CreateRunningPodUpdatePB());
+    updates.enqueue(metadatapb::testutils::CreateRunningServiceUpdatePB());
+    updates.enqueue(metadatapb::testutils::CreateTerminatingContainerUpdatePB());
+    updates.enqueue(metadatapb::testutils::CreateTerminatingPodUpdatePB());
+    updates.enqueue(metadatapb::testutils::CreateTerminatingServiceUpdatePB());
+    md::TestAgentMetadataFilter md_filter;
+    ASSERT_OK(md::ApplyK8sUpdates(10, metadata_state_.get(), &md_filter, &updates));
+
+    auto upid1 = md::UPID(123, 567, 89101);
+    metadata_state_->AddUPID(
+        upid1, std::make_unique<md::PIDInfo>(upid1, "exe", "test", "pod1_container_1"));
+    auto upid2 = md::UPID(123, 567, 468);
+    metadata_state_->AddUPID(
+        upid2, std::make_unique<md::PIDInfo>(upid2, "exe", "cmdline", "pod2_container_1"));
+
+    enricher_ = std::make_unique<UPIDMetadataEnricher>(&table_store_,
+                                                       [this]() { return metadata_state_; });
+  }
+
+  std::shared_ptr<md::AgentMetadataState> metadata_state_;
+  table_store::TableStore table_store_;
+  std::unique_ptr<UPIDMetadataEnricher> enricher_;
+};
+
+TEST_F(UPIDMetadataEnricherTest, can_enrich) {
+  EXPECT_TRUE(UPIDMetadataEnricher::CanEnrich(
+      Relation({types::TIME64NS, types::UINT128}, {"time_", "upid"})));
+  EXPECT_FALSE(UPIDMetadataEnricher::CanEnrich(Relation({types::TIME64NS}, {"time_"})));
+  EXPECT_FALSE(UPIDMetadataEnricher::CanEnrich(
+      Relation({types::UINT128, types::STRING}, {"upid", "pod_id"})));
+}
+
+TEST_F(UPIDMetadataEnricherTest, append_data) {
+  Relation relation({types::TIME64NS, types::UINT128}, {"time_", "upid"});
+  Relation enriched_relation = enricher_->AddTable(kTableID, relation);
+  EXPECT_EQ(enriched_relation,
+            Relation({types::TIME64NS, types::UINT128, types::STRING, types::STRING,
+                      types::STRING},
+                     {"time_", "upid", "pod_id", "service_id", "namespace"}));
+  EXPECT_FALSE(table_store::schema::IsIngestTimeMetadataDesc(enriched_relation.GetColumnDesc(1)));
+  for (size_t i = 2; i < enriched_relation.NumColumns(); ++i) {
+    EXPECT_TRUE(table_store::schema::IsIngestTimeMetadataDesc(enriched_relation.GetColumnDesc(i)));
+  }
+
+  std::shared_ptr<Table> table = Table::Create("test_table", enriched_relation);
+  table_store_.AddTable(table, "test_table", kTableID);
+
+  auto record_batch = std::make_unique<types::ColumnWrapperRecordBatch>();
+  std::vector<types::Time64NSValue> times = {1, 2, 3, 4};
+  std::vector<types::UInt128Value> upids = {
+      md::UPID(123, 567, 89101).value(), md::UPID(123, 567, 468).value(),
+      md::UPID(123, 567, 89101).value(), md::UPID(123, 567, 1).value()};
+  record_batch->push_back(std::make_shared<types::Time64NSValueColumnWrapper>(times));
+  record_batch->push_back(std::make_shared<types::UInt128ValueColumnWrapper>(upids));
+  ASSERT_OK(enricher_->AppendData(kTableID, "", std::move(record_batch)));
+
+  Table::Cursor cursor(table.get());
+  auto rb = cursor.GetNextRowBatch({2, 3, 4}).ConsumeValueOrDie();
+  std::vector<types::StringValue> pod_ids = {"1_uid", "2_uid", "1_uid", ""};
+  std::vector<types::StringValue> service_ids = {"3_uid", "4_uid", "3_uid", ""};
+  std::vector<types::StringValue> namespaces = {"pl", "pl", "pl", ""};
+  EXPECT_TRUE(rb->ColumnAt(0)->Equals(types::ToArrow(pod_ids, arrow::default_memory_pool())));
+  EXPECT_TRUE(rb->ColumnAt(1)->Equals(types::ToArrow(service_ids, arrow::default_memory_pool())));
+  EXPECT_TRUE(rb->ColumnAt(2)->Equals(types::ToArrow(namespaces, arrow::default_memory_pool())));
+}
+
+TEST_F(UPIDMetadataEnricherTest, other_tables_unchanged) {
+  Relation relation({types::TIME64NS}, {"time_"});
+  std::shared_ptr<Table> table = Table::Create("test_table", relation);
+  table_store_.AddTable(table, "test_table", kTableID);
+
+  auto record_batch = std::make_unique<types::ColumnWrapperRecordBatch>();
+  std::vector<types::Time64NSValue> times = {1, 2};
+  record_batch->push_back(std::make_shared<types::Time64NSValueColumnWrapper>(times));
+  ASSERT_OK(enricher_->AppendData(kTableID, "", std::move(record_batch)));
+
+  Table::Cursor cursor(table.get());
+  auto rb = cursor.GetNextRowBatch({0}).ConsumeValueOrDie();
+  EXPECT_EQ(1, rb->num_columns());
+  EXPECT_EQ(2, rb->num_rows());
+}
+
+}  // namespace agent
+}  // namespace vizier
+}  // namespace px